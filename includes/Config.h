@@ -10,6 +10,156 @@
 #define ENABLE_BLINN_PHONG 1
 #define ENABLE_GAMMA_CORRECTION 1
 
+// Texture Cook Settings
+#define ENABLE_TEXTURE_COOKING 1
+#define TEXTURE_CACHE_DIRECTORY "resources/cache/textures"
+#define TEXTURE_MAX_RESOLUTION 2048
+#define TEXTURE_COOK_VERSION 2
+#define ENABLE_TEXTURE_COMPRESSION 1
+#define ENABLE_TEXTURE_STREAMING 1
+#define TEXTURE_STREAM_FRAME_BUDGET (1 << 20)
+#define TEXTURE_STREAM_RING_SLOTS 3
+#define TEXTURE_STREAM_INITIAL_SIZE 64
+#define TEXTURE_STREAM_MEMORY_BUDGET (64 << 20)
+
+// Texture Unit Settings
+#define RESERVED_TEXTURE_UNIT_FIRST 8
+#define RESERVED_TEXTURE_UNIT_COUNT 7
+#define SHADOW_ATLAS_TEXTURE_UNIT (RESERVED_TEXTURE_UNIT_FIRST + 0)
+#define SHADOW_TEXTURE_UNIT (RESERVED_TEXTURE_UNIT_FIRST + 2)
+#define VISIBILITY_TEXTURE_UNIT (RESERVED_TEXTURE_UNIT_FIRST + 3)
+#define CLUSTER_TEXTURE_UNIT (RESERVED_TEXTURE_UNIT_FIRST + 4)
+#if RESERVED_TEXTURE_UNIT_FIRST + RESERVED_TEXTURE_UNIT_COUNT > 16
+#error "Reserved texture units must fit in the 16 units GL 3.3 guarantees"
+#endif
+
+// Texture Array Settings
+#define TEXTURE_BIN_SPARE_UNITS 3
+
+// Dynamic Buffer Settings
+#define DYNAMIC_BUFFER_FRAMES 3
+#define DYNAMIC_BUFFER_FRAME_SIZE (4 << 20)
+
+// Render Target Settings
+#define RENDER_TARGET_IDLE_FRAMES 120
+#define RENDER_GRAPH_QUERY_FRAMES 3
+
+// Post Processing Settings
+#define POST_BLUR_SIGMA 4.0f
+#define POST_BLUR_MAX_TAPS 16
+#define POST_UPSCALE_SHARPNESS 0.5f
+
+// Dynamic Resolution Settings
+#define ENABLE_DYNAMIC_RESOLUTION 1
+#define DRS_FRAME_BUDGET 14.0f
+#define DRS_LOWER_THRESHOLD 0.75f
+#define DRS_MIN_SCALE 0.5f
+#define DRS_MAX_SCALE 1.0f
+#define DRS_MAX_STEP_DOWN 0.15f
+#define DRS_MAX_STEP_UP 0.05f
+#define DRS_SCALE_GRANULARITY 0.05f
+#define DRS_HYSTERESIS_FRAMES 8
+#define DRS_SMOOTHING 0.2f
+
+// Clustered Lighting Settings
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_NEAR_DEPTH 0.5f
+#define CLUSTER_LIGHT_TEXELS 6
+#define CLUSTER_LIGHT_CUTOFF 0.01f
+#define CLUSTER_SPOT_RANGE CAMERA_FAR_PLANE
+#define CLUSTER_STRESS_LIGHTS 256
+
+// Deferred Shading Settings
+#define ENABLE_DEFERRED_SHADING 0
+#define DEFERRED_SPHERE_SLICES 16
+#define DEFERRED_SPHERE_STACKS 8
+#define DEFERRED_CONE_SLICES 16
+
+// Depth Prepass Settings
+#define ENABLE_DEPTH_PREPASS 0
+
+// Visibility Buffer Settings
+#define ENABLE_VISIBILITY_BUFFER 0
+#define VISIBILITY_MATERIAL_DEPTH_STEPS 65536
+
+// Shadow Settings
+#define ENABLE_SHADOWS 1
+#define SHADOW_CASCADE_COUNT 4
+#define SHADOW_MAX_DIRECTIONAL_LIGHTS 2
+#define SHADOW_RESOLUTION 1024
+#define SHADOW_DISTANCE 40.0f
+#define SHADOW_SPLIT_LAMBDA 0.75f
+#define SHADOW_CACHE_MARGIN 1.25f
+#define SHADOW_NORMAL_OFFSET 1.5f
+#define SHADOW_SLOPE_BIAS 2.0f
+#define SHADOW_CONSTANT_BIAS 4.0f
+
+// Shadow Atlas Settings
+#define ENABLE_SHADOW_ATLAS 1
+#define SHADOW_ATLAS_SIZE 4096
+#define SHADOW_ATLAS_MIN_TILE 64
+#define SHADOW_ATLAS_MAX_TILE 1024
+#define SHADOW_ATLAS_TILE_SCALE 0.5f
+#define SHADOW_ATLAS_HYSTERESIS 0.15f
+#define SHADOW_ATLAS_UPDATES_PER_FRAME 8
+#define SHADOW_ATLAS_MOVING_PRIORITY 4.0f
+#define SHADOW_ATLAS_NEAR_PLANE 0.05f
+#define SHADOW_ATLAS_MAX_SPOT_ANGLE 60.0f
+#define SHADOW_ATLAS_RECORD_TEXELS 5
+
+// Mesh Optimization Settings
+#define ENABLE_MESH_OPTIMIZATION 1
+#define ENABLE_OVERDRAW_OPTIMIZATION 1
+#define MESH_OPTIMIZATION_CACHE_SIZE 16
+#define MESH_OVERDRAW_THRESHOLD 1.05f
+
+// Mesh LOD Settings
+#define ENABLE_MESH_LODS 1
+#define MESH_LOD_COUNT 3
+#define MESH_LOD_RATIO 0.5f
+#define MESH_LOD_MIN_REDUCTION 0.85f
+#define MESH_LOD_SCREEN_SIZE 256.0f
+#define MESH_LOD_HYSTERESIS 0.15f
+
+// Meshlet Settings
+#define ENABLE_MESHLETS 1
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+#define MESHLET_MIN_MESH_TRIANGLES 512
+#define MESHLET_CULL_BATCH 64
+
+// Static Batching Settings
+#define ENABLE_STATIC_BATCHING 1
+#define ENABLE_WORLD_BATCHING 0
+#define STATIC_BATCH_MAX_VERTICES 65536
+#define STATIC_BATCH_CELL_SIZE 16.0f
+
+// Vertex Quantization Settings
+#define ENABLE_VERTEX_QUANTIZATION 1
+#define VERTEX_QUANTIZATION_POSITION_ERROR 0.0005f
+#define VERTEX_QUANTIZATION_NORMAL_ERROR 0.005f
+#define VERTEX_QUANTIZATION_UV_ERROR (1.0f / 1024.0f)
+
+// Geometry Pool Settings
+#define GEOMETRY_POOL_VERTEX_CAPACITY (1 << 18)
+#define GEOMETRY_POOL_INDEX_CAPACITY (1 << 20)
+#define GEOMETRY_POOL_DEFRAG_BLOCKS 8
+#define INSTANCE_TRANSFORM_LOCATION 4
+
+// Indirect Draw Settings
+#define ENABLE_INDIRECT_DRAWING 1
+#define INDIRECT_INITIAL_RECORDS 256
+#define INDIRECT_CULL_GROUP_SIZE 64
+#define INDIRECT_DRAW_ID_LOCATION 3
+
+// Benchmark Settings
+#define BENCHMARK_WARMUP_FRAMES 120
+#define BENCHMARK_FRAMES 600
+#define BENCHMARK_GRID_SIZE 8
+#define BENCHMARK_GRID_SPACING 3.0f
+
 // Window Settings
 #define WINDOW_NAME "Graphics And Shaders"
 #define WINDOW_HEIGHT 500
@@ -5,6 +5,8 @@
 #include "gui/GUI.h"
 #include "rendering/Renderer.h"
 #include "object/Actor.h"
+#include "rendering/PostChain.h"
+#include "rendering/ResolutionScaler.h"
 #include "rendering/Shader.h"
 #include "rendering/Texture.h"
 
@@ -13,10 +15,16 @@
 #include <vector>
 
 // Shows the main menu bar on top on screen
-void show_main_menu_bar(Renderer *renderer, bool *toRender, bool *showActorUI);
+void show_main_menu_bar(Renderer *renderer, bool *toRender, bool *showActorUI, bool *showStreamingUI);
 // Shows a section in Actor UI
 void show_section_header(const char *title);
 // Shows Actor UI window
 void show_actor_ui(std::vector<RenderActor *> *actors, std::vector<RenderActor> *lightActors, std::vector<LightSource *> *lights, bool *showUI);
+// Shows the texture streaming window with resident and requested memory
+void show_texture_streaming_ui(TextureStreamer *streamer, bool *showUI);
+// Shows the post processing stages with their GPU time inside the current window
+void show_post_chain_ui(PostChain *chain, RenderGraph *graph);
+// Shows the dynamic resolution controls and the resolution the scene renders at
+void show_resolution_ui(ResolutionScaler *scaler, PostChain *chain, int sceneWidth, int sceneHeight);
 
 #endif // !WIDGETS_H
@@ -34,7 +34,8 @@ enum ACTOR_TYPE
 class RenderActor : public Actor
 {
 public:
-    bool toRender = true; // Whether to render this actor
+    bool toRender = true;  // Whether to render this actor
+    bool isStatic = false; // Whether the actor never moves and may be merged into a world batch
     Material mat;         // Material for the actor
     ACTOR_TYPE type;      // Defines type of render actor
 
@@ -51,6 +52,7 @@ class ModelActor : public RenderActor
 {
 public:
     Model *model; // Model Class pointer
+    int lod = 0;  // Level of detail the model was drawn at last frame
 
     // Default ModelActor constructor
     ModelActor(std::string name_ = "New ModelActor");
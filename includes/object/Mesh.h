@@ -10,6 +10,8 @@
 #include "rendering/Texture.h"
 #include "rendering/Shader.h"
 #include "rendering/Renderer.h"
+#include "rendering/GeometryPool.h"
+#include "rendering/VertexLayout.h"
 
 // Standard Headers
 #include <vector>
@@ -22,6 +24,58 @@ struct Vertex
     glm::vec2 uv;       // UV coordinate of vertex
 };
 
+template <>
+inline GeometryFormat VertexLayout<Vertex>::get_format(GLenum indexType)
+{
+    return vertex_format<Vertex>({vertex_attribute(0, &Vertex::position),
+                                  vertex_attribute(1, &Vertex::normal),
+                                  vertex_attribute(2, &Vertex::uv)},
+                                 indexType);
+}
+
+// Texture bound to a unit when drawing a Mesh
+struct MeshBinding
+{
+    int unit;             // Texture unit the texture is bound to
+    unsigned int texture; // ID of the texture
+    std::string uniform;  // Name of the sampler uniform
+};
+
+// Uniform locations of a Mesh's bindings in one shader program
+struct MeshProgram
+{
+    unsigned int program;       // Shader program the locations belong to
+    std::vector<int> locations; // Location of each binding's sampler uniform, -1 when the program has none
+    int positionOffset;         // Location of the quantized position offset
+    int positionScale;          // Location of the quantized position scale
+    int instanced;              // Location of the toggle reading transforms from instance data
+};
+
+// Geometry and textures of a Mesh before upload, in the space it is drawn in
+struct MeshSource
+{
+    std::vector<Vertex> vertices;      // Vertices of the source
+    std::vector<unsigned int> indices; // Triangle indices into the vertices
+    std::vector<Texture> textures;     // Textures the source is drawn with
+    std::string name;                  // Name used when logging
+};
+
+// Run of indices drawing one level of detail of a Mesh
+struct MeshLod
+{
+    size_t firstIndex; // First index of the level, counted from the start of the Mesh's range
+    size_t indexCount; // Indices of the level
+};
+
+// Cluster of a Mesh's triangles culled as one unit
+struct Meshlet
+{
+    glm::vec4 bounds;        // Model space bounding sphere, center in xyz and radius in w
+    glm::vec4 cone;          // Average normal in xyz and the half angle in radians of the cone holding every normal in w
+    unsigned int firstIndex; // First index, counted from the start of the Mesh's range
+    unsigned int indexCount; // Indices of the cluster
+};
+
 // Mesh class for storing and rendering vertex data
 class Mesh
 {
@@ -29,20 +83,53 @@ public:
     std::vector<Vertex> vertices;      // List of Vertex in Mesh
     std::vector<unsigned int> indices; // List of indices for the faces of the Mesh
     std::vector<Texture> textures;     // List of textures for the Mesh
-    VertexArray varray;                // Vertex Array to draw the Mesh
+    int geometry = -1;                          // Handle of the Mesh's range in the GeometryPool
+    bool quantized = false;                     // Whether the pool holds PackedVertex data for the Mesh
+    glm::vec3 positionOffset = glm::vec3(0.0f); // Offset restoring quantized positions in the vertex shader
+    glm::vec3 positionScale = glm::vec3(1.0f);  // Scale restoring quantized positions in the vertex shader
+    glm::vec3 boundsCenter = glm::vec3(0.0f);   // Center of the bounding sphere in model space
+    float boundsRadius = 0.0f;                  // Radius of the bounding sphere in model space
+    std::vector<MeshBinding> bindings;          // Texture bindings applied on draw
+    std::vector<MeshProgram> programs;          // Binding locations in every program the Mesh was drawn with
+    int currentProgram = -1;                    // Index in programs of the program last drawn with
+    std::vector<MeshLod> lods;                  // Levels of detail sharing the vertices, lods[0] is the full Mesh
+    std::vector<Meshlet> meshlets;              // Clusters of the full level, empty when the Mesh is too small to split
+    static bool legacyBindings;                 // Whether draws look every uniform up by name as before the binding tables, for the benchmark
 
     // Default Mesh Constructor
     Mesh();
-    // Value constructor for Mesh
-    Mesh(std::vector<Vertex> vertices_, std::vector<unsigned int> indices_, std::vector<Texture> textures_);
-    // Draws a mesh using a Shader as input
-    void draw(Shader *shader);
+    // Value constructor for Mesh, with optional simplified index lists below the full Mesh
+    Mesh(std::vector<Vertex> vertices_, std::vector<unsigned int> indices_, std::vector<Texture> textures_, std::vector<std::vector<unsigned int>> lodIndices = {}, std::vector<Meshlet> meshlets_ = {});
+    // Draws a level of detail of a mesh using a Shader as input
+    void draw(Shader *shader, int lod = 0);
+    // Draws a level of detail once per transform in an instance buffer, switching the Shader to instance transforms for the draw
+    void draw_instanced(Shader *shader, int lod, unsigned int instanceBuffer, int firstInstance, int instanceCount);
+    // Draws runs of the full level, counted from the start of the Mesh's range, with one multi-draw
+    void draw_runs(Shader *shader, const std::vector<MeshLod> &runs);
+    // Returns the level of detail drawn for a requested one
+    const MeshLod &get_lod(int lod);
+    // Binds the Mesh's textures to their sampler uniforms in a Shader
+    void bind_textures(Shader *shader);
+    // Restores the identity position transform in a Shader for the unquantized draws that follow
+    void reset_position_transform(Shader *shader);
     // Frees mesh data
     void free_data();
 
 private:
-    // Sets up the vertex array for the mesh
-    void setup_mesh();
+    // Copies the vertex data and the index lists of every level into the shared GeometryPool
+    void setup_mesh(const std::vector<std::vector<unsigned int>> &lodIndices);
+    // Computes the bounding sphere around the box of the vertices
+    void compute_bounds();
+    // Assigns a texture unit and sampler uniform to each texture
+    void setup_bindings();
+    // Returns the uniform locations in a shader program, looking them up the first time the program is seen
+    const MeshProgram &resolve_bindings(Shader *shader);
+    // Uses a Shader and sets the Mesh's textures and position transform in it
+    void bind_program(Shader *shader);
+    // Binds the textures by building and looking up each sampler uniform's name, the path the binding tables replaced
+    void bind_textures_by_name(Shader *shader);
+    // Packs the vertices relative to their box, returns false when the error exceeds the configured bounds
+    bool quantize_vertices(std::vector<PackedVertex> *packed);
 };
 
 #endif // !MESH_H
@@ -0,0 +1,44 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+// Custom Headers
+#include "Config.h"
+#include "object/Mesh.h"
+
+// Standard Headers
+#include <string>
+#include <vector>
+
+// Post-transform cache efficiency of an index buffer
+struct MeshCacheStats
+{
+    float acmr = 0.0f; // Average cache misses per triangle, 0.5 is ideal for large grids
+    float atvr = 0.0f; // Average transforms per vertex, 1.0 is ideal
+};
+
+// Import-time optimisations which reorder mesh data and build its simplified levels of detail
+class MeshOptimizer
+{
+public:
+    // Welds, reorders triangles and vertices and logs the cache statistics before and after
+    static void optimize(std::vector<Vertex> *vertices, std::vector<unsigned int> *indices, const std::string &name);
+    // Merges identical vertices, rewriting the indices to the first copy
+    static void weld_vertices(std::vector<Vertex> *vertices, std::vector<unsigned int> *indices);
+    // Reorders triangles for the post-transform vertex cache with Forsyth's linear-speed algorithm
+    static void optimize_vertex_cache(std::vector<unsigned int> *indices, size_t vertexCount);
+    // Sorts cache-friendly clusters of triangles so outward facing ones draw first
+    static void optimize_overdraw(const std::vector<Vertex> &vertices, std::vector<unsigned int> *indices, float threshold);
+    // Renumbers vertices in the order the indices first use them, dropping unused ones
+    static void optimize_vertex_fetch(std::vector<Vertex> *vertices, std::vector<unsigned int> *indices);
+    // Simulates a FIFO post-transform cache over the indices
+    static MeshCacheStats analyze_vertex_cache(const std::vector<unsigned int> &indices, size_t vertexCount, int cacheSize = MESH_OPTIMIZATION_CACHE_SIZE);
+    // Collapses edges by quadric error until the index count reaches the target, returns indices into the same vertices
+    static std::vector<unsigned int> simplify(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, size_t targetIndexCount, float *error = NULL);
+    // Groups triangles into clusters of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles,
+    // reordering the indices so each cluster is one contiguous run
+    static std::vector<Meshlet> build_meshlets(const std::vector<Vertex> &vertices, std::vector<unsigned int> *indices);
+    // Simplifies a mesh to successive MESH_LOD_RATIO fractions of its triangles, returns the index lists below the full mesh
+    static std::vector<std::vector<unsigned int>> build_lods(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const std::string &name);
+};
+
+#endif // !MESHOPTIMIZER_H
@@ -8,39 +8,71 @@
 #include "thirdparty/assimp/postprocess.h"
 #include "thirdparty/glm/glm.hpp"
 #include "thirdparty/glm/gtc/matrix_transform.hpp"
+#include "thirdparty/glm/gtc/type_ptr.hpp"
 
 // Custom Headers
 #include "object/Mesh.h"
+#include "object/MeshOptimizer.h"
+#include "rendering/MeshletCuller.h"
 #include "rendering/Texture.h"
 #include "rendering/Shader.h"
 
 // Standard Headers
+#include <cmath>
 #include <vector>
 
+// Node of a model's hierarchy
+struct ModelNode
+{
+    std::string name;        // Name of the node in the model file
+    int parent;              // Index of the parent node, -1 for the root
+    glm::mat4 local;         // Transform relative to the parent
+    glm::mat4 world;         // Transform relative to the model, updated parent first
+    std::vector<int> meshes; // Meshes drawn at the node
+};
+
 // Model class for storing Meshes and textures of a 3D Model file
 class Model
 {
 public:
-    std::vector<Mesh> meshes;      // List of meshes in a model
-    std::vector<Texture> textures; // List of textures in a model
-    std::string dir;               // Directory of model file
-    bool gamma;                    // Whether to correct gamma of textures
+    std::vector<Mesh> meshes;                // List of meshes in a model, each stored once
+    std::vector<Texture> textures;           // List of textures in a model
+    std::string dir;                         // Directory of model file
+    bool gamma;                              // Whether to correct gamma of textures
+    std::vector<ModelNode> nodes;            // Node hierarchy flattened so parents precede their children
+    std::vector<std::vector<int>> meshNodes; // Nodes drawing each mesh, one instance per node
+    unsigned int instanceVBO = 0;            // World transforms of every instance, grouped by mesh
+    std::vector<int> instanceOffsets;        // First instance of each mesh in instanceVBO
     // Default Model constructor
     Model();
     // Path constructor for Model
     Model(std::string path, bool gamma_ = false);
-    // Draw function to draw a model using a Shader
-    void draw(Shader *shader);
+    // Draw function to draw a level of detail of a model using a Shader, culling the clusters of the full level when given a culler
+    void draw(Shader *shader, int lod = 0, MeshletCuller *culler = NULL, glm::mat4 matrix = glm::mat4(1.0f));
+    // Returns the most levels of detail any mesh in the model has
+    int get_lod_count();
+    // Picks the level of detail for a projected diameter in pixels, keeping the current one inside the hysteresis band
+    int select_lod(float screenSize, int currentLod);
+    // Optimizes a source, builds its levels of detail and uploads it as a new Mesh drawn at some nodes
+    void add_mesh(MeshSource source, std::vector<int> instanceNodes = {0});
+    // Recomputes the node transforms parent first and uploads the instance transforms
+    void update_node_transforms();
+    // Returns the model space transform of an instance of a mesh
+    glm::mat4 get_instance_transform(int mesh, int instance);
+    // Returns the model space bounding sphere of an instance of a mesh
+    glm::vec4 get_instance_bounds(int mesh, int instance);
     // Frees the data in the model
     void free_data();
 
 private:
     // Loads the model file and starts loading process
     void load_model(std::string path);
-    // Loads the meshes in the model recursively starting from the root node
-    void process_node(aiNode *node, const aiScene *scene);
-    // Process a Mesh present in Node into the Mesh Class
-    Mesh process_mesh(aiMesh *mesh, const aiScene *scene);
+    // Appends a node and its children to the flattened hierarchy, recording the nodes using each scene mesh
+    void process_node(aiNode *node, int parent, std::vector<std::vector<int>> *meshUsers);
+    // Process a Mesh of the scene into a MeshSource in its own space
+    MeshSource process_mesh(aiMesh *mesh, const aiScene *scene);
+    // Returns whether a mesh is drawn once without any node transform
+    bool is_single_instance(int mesh);
     // Loads all the textures in a given Material based on its type
     std::vector<Texture> load_material_textures(aiMaterial *mat, aiTextureType type, std::string textureType);
 };
@@ -0,0 +1,43 @@
+#ifndef STATICBATCHER_H
+#define STATICBATCHER_H
+
+// Third-party Headers
+#include "thirdparty/glm/glm.hpp"
+
+// Custom Headers
+#include "Config.h"
+#include "object/Actor.h"
+#include "object/Mesh.h"
+
+// Standard Headers
+#include <unordered_set>
+#include <vector>
+
+// Merges meshes sharing a material into single draws, per model at load time and per world cell for static actors
+class StaticBatcher
+{
+public:
+    std::vector<ModelActor *> batches; // World space batches drawn in place of the static actors
+
+    // Returns whether two texture lists bind the same textures in the same order
+    static bool same_material(const std::vector<Texture> &a, const std::vector<Texture> &b);
+    // Transforms positions and normals by a matrix
+    static void transform_vertices(std::vector<Vertex> *vertices, const glm::mat4 &transform);
+    // Appends a source transformed by a matrix to a batch
+    static void append(MeshSource *batch, const MeshSource &source, const glm::mat4 &transform);
+    // Merges sources with the same material into batches of at most STATIC_BATCH_MAX_VERTICES vertices
+    static std::vector<MeshSource> merge(const std::vector<MeshSource> &sources);
+    // Merges the visible static model actors into world space batches per cell, replacing previous batches
+    void build(const std::vector<RenderActor *> &actors, float cellSize = STATIC_BATCH_CELL_SIZE);
+    // Returns the actors to draw, the batches taking the place of the actors merged into them
+    std::vector<RenderActor *> get_draw_list(const std::vector<RenderActor *> &actors);
+    // Returns the number of actors merged into batches
+    int get_batched_count();
+    // Frees the batches
+    void free_data();
+
+private:
+    std::unordered_set<RenderActor *> batchedActors; // Actors drawn by a batch
+};
+
+#endif // !STATICBATCHER_H
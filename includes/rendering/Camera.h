@@ -51,4 +51,9 @@ private:
     void update_camera_vectors();
 };
 
+// Returns the diameter in pixels of a sphere at a view space position
+float get_screen_size(glm::mat4 projection, glm::vec3 viewPosition, float radius, float viewportHeight);
+// Extracts the six world space frustum planes of a view projection matrix, inside where dot(plane, point) >= 0
+void get_frustum_planes(glm::mat4 viewProjection, glm::vec4 planes[6]);
+
 #endif // !CAMERA_H
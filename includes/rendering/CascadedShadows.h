@@ -0,0 +1,93 @@
+#ifndef CASCADEDSHADOWS_H
+#define CASCADEDSHADOWS_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+#include "thirdparty/glm/glm.hpp"
+
+// Custom Headers
+#include "Config.h"
+#include "object/Actor.h"
+#include "rendering/RenderGraph.h"
+#include "rendering/Shader.h"
+
+// Standard Headers
+#include <functional>
+#include <vector>
+
+// World space bounds of an actor drawn into the cascades
+struct ShadowCaster
+{
+    RenderActor *actor = NULL;          // Actor the caster draws
+    glm::vec3 center = glm::vec3(0.0f); // Centre of its bounding sphere
+    float radius = 0.0f;                // Radius of its bounding sphere
+};
+
+// Light space window of one cascade, kept while the camera's slice stays inside it so its static casters stay valid
+struct ShadowCascade
+{
+    glm::vec3 center = glm::vec3(0.0f); // Light space centre, snapped to whole texels
+    float halfSize = 0.0f;              // Half the width and depth of the window
+    glm::mat4 matrix = glm::mat4(1.0f); // World to clip space of the window
+    bool staticValid = false;           // Whether the static layer holds the static casters of the window
+    bool onlyStatic = false;            // Whether the shadow layer holds the static layer with nothing drawn over it
+    int dynamicCount = 0;               // Dynamic casters touching the window this frame
+};
+
+// Cascaded shadow maps of the first directional lights, fitted to slices of the camera's frustum. Static casters are
+// rendered into a persistent layer refreshed only when the light, the static actors or the cascade's window move,
+// and each frame the dynamic casters are drawn over a copy of it
+class CascadedShadows
+{
+public:
+    // Creates the static and shadow layers and loads the depth program, returns whether it linked
+    bool initialise();
+    // Fits the cascades of the first directional lights to the camera and gathers the casters' bounds
+    void update(const std::vector<LightSource *> &lights, const std::vector<RenderActor *> &actors, glm::mat4 view, glm::mat4 projection);
+    // Declares the pass refreshing stale static layers and drawing the dynamic casters over them, the callback draws one caster,
+    // returns the shadow layers imported into the graph for the lit passes to read, -1 when no light casts shadows
+    int add_pass(RenderGraph *graph, std::function<void(RenderActor *, Shader *)> drawCaster);
+    // Binds the shadow layers to their unit, done once per frame before any lit draw
+    void bind_textures();
+    // Sets the uniforms a lighting shader samples the cascades with
+    void set_uniforms(Shader *shader);
+    // Returns the number of directional lights with shadows this frame
+    int get_light_count();
+    // Returns the number of static layers rendered last frame
+    int get_static_refresh_count();
+    // Returns the number of layers dynamic casters were drawn into last frame
+    int get_composite_count();
+    // Returns the number of casters drawn last frame across all layers
+    int get_caster_draw_count();
+    // Returns the world space bounding sphere of an actor casting shadows
+    static glm::vec4 get_caster_bounds(RenderActor *actor);
+    // Frees the layers, framebuffers and program
+    void free_data();
+
+private:
+    Shader program;                                                               // Depth-only program drawing the casters
+    unsigned int textures[2] = {};                                                // Static layers and the shadow layers lighting samples
+    unsigned int framebuffers[2] = {};                                            // Framebuffers reading a static layer and drawing a layer
+    ShadowCascade cascades[SHADOW_MAX_DIRECTIONAL_LIGHTS * SHADOW_CASCADE_COUNT]; // Windows of each light's cascades, light by light
+    glm::vec3 directions[SHADOW_MAX_DIRECTIONAL_LIGHTS];                          // Direction each light's static layers were rendered for
+    glm::mat4 rotations[SHADOW_MAX_DIRECTIONAL_LIGHTS];                           // World to light space rotation of each light
+    float splitDepths[SHADOW_CASCADE_COUNT] = {};                                 // View depth where each cascade ends
+    int lightCount = 0;                                                           // Directional lights with shadows this frame
+    std::vector<ShadowCaster> staticCasters;                                      // Casters cached in the static layers
+    std::vector<ShadowCaster> dynamicCasters;                                     // Casters drawn every frame
+    size_t staticHash = 0;                                                        // Hash of the static casters and their transforms
+    int staticRefreshes = 0;                                                      // Static layers rendered last frame
+    int composites = 0;                                                           // Layers dynamic casters were drawn into last frame
+    int casterDraws = 0;                                                          // Casters drawn last frame
+
+    // Moves a cascade's window over the bounding sphere of its slice when the sphere has left it
+    void fit_cascade(ShadowCascade *cascade, const glm::mat4 &rotation, glm::vec3 center, float radius);
+    // Returns whether a caster's bounds reach into a cascade's window
+    static bool touches(const ShadowCaster &caster, const ShadowCascade &cascade, const glm::mat4 &rotation);
+    // Draws the casters touching a cascade into the bound layer, returns how many were drawn
+    int draw_casters(const std::vector<ShadowCaster> &casters, int layer, std::function<void(RenderActor *, Shader *)> &drawCaster);
+    // Attaches a layer of one of the arrays to a framebuffer
+    void attach_layer(int framebuffer, int texture, int layer);
+};
+
+#endif // !CASCADEDSHADOWS_H
@@ -0,0 +1,97 @@
+#ifndef CLUSTEREDLIGHTING_H
+#define CLUSTEREDLIGHTING_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+#include "thirdparty/glm/glm.hpp"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/CascadedShadows.h"
+#include "rendering/DynamicBuffer.h"
+#include "rendering/ShadowAtlas.h"
+#include "rendering/Shader.h"
+
+// Standard Headers
+#include <vector>
+
+// View space bounds of a light tested against the clusters
+struct ClusterLight
+{
+    glm::vec3 position;  // View space position
+    float range;         // Distance past which the light adds nothing
+    glm::vec3 direction; // View space direction of a spot light
+    float cosAngle;      // Cosine of a spot light's outer half angle, -1 for point lights
+    float sinAngle;      // Sine of a spot light's outer half angle
+    int index;           // Index of the light in the light buffer
+};
+
+// Splits the view frustum into a grid of clusters and lists the point and spot lights touching each of them,
+// so fragments only shade the lights of their own cluster
+class ClusteredLighting
+{
+public:
+    // Creates the texture buffers holding the lights, the grid and the index lists, uploaded through a per-frame ring when given one
+    void initialise(DynamicBuffer *ring_ = NULL);
+    // Sets the shadows the lighting shaders sample, bound and set up along with the lights
+    void set_shadows(CascadedShadows *shadows_);
+    // Sets the atlas holding point and spot light shadows, whose tile records are packed with the lights
+    void set_shadow_atlas(ShadowAtlas *atlas_);
+    // Packs the lights, assigns them to the clusters of the camera unless told not to, and uploads the result
+    void update(const std::vector<LightSource *> &lights, glm::mat4 view, glm::mat4 projection, int screenWidth, int screenHeight, bool gamma, bool assignClusters = true);
+    // Binds the buffers to their units, done once per frame before any lit draw
+    void bind_buffers();
+    // Sets the uniforms a lighting shader needs to find its cluster
+    void set_uniforms(Shader *shader);
+    // Returns the number of point and spot lights assigned this frame
+    int get_clustered_count();
+    // Returns the number of light indices across all clusters
+    int get_index_count();
+    // Returns the most lights a single cluster holds
+    int get_max_cluster_lights();
+    // Returns the point and spot lights packed this frame, in view space
+    const std::vector<ClusterLight> &get_lights();
+    // Returns the first directional light in the light buffer
+    int get_directional_offset();
+    // Returns the number of directional lights in the light buffer
+    int get_directional_count();
+    // Returns the attenuation-based range of a point light, past which it is cut off
+    static float get_point_light_range(const PointLight *light, bool gamma);
+    // Returns whether a sphere touches a box, both in the same space
+    static bool sphere_intersects_box(glm::vec3 center, float radius, glm::vec3 boxMin, glm::vec3 boxMax);
+    // Returns whether a sphere touches a cone opening from an origin along a direction
+    static bool sphere_intersects_cone(glm::vec3 center, float radius, const ClusterLight &cone);
+    // Frees the buffers and textures
+    void free_data();
+
+private:
+    unsigned int buffers[3] = {};                      // Light, grid and index buffers
+    unsigned int textures[3] = {};                     // Texture views of the buffers
+    int maxTexels = 65536;                             // Largest texture buffer the context allows
+    DynamicBuffer *ring = NULL;                        // Per-frame ring the buffers are written to when texture views can point into it
+    int textureAlignment = 256;                        // Offset alignment of texture buffer ranges
+    std::vector<glm::vec4> lightData;                  // Packed lights, CLUSTER_LIGHT_TEXELS texels each
+    std::vector<ClusterLight> clusterLights;           // Point and spot lights in view space
+    int directionalOffset = 0;                         // First directional light in the light buffer
+    int directionalCount = 0;                          // Directional lights, shaded everywhere
+    glm::mat4 boundsProjection = glm::mat4(0.0f);      // Projection the cluster bounds were built for
+    std::vector<glm::vec3> clusterMin;                 // View space minimum corner of each cluster
+    std::vector<glm::vec3> clusterMax;                 // View space maximum corner of each cluster
+    float sliceDepths[CLUSTER_GRID_Z + 1];             // View depth where each slice starts
+    std::vector<std::vector<unsigned int>> sliceLists; // Light indices of each depth slice's clusters
+    std::vector<glm::uvec2> grid;                      // Offset and count of each cluster's light indices
+    std::vector<unsigned int> indices;                 // Light indices of every cluster back to back
+    glm::vec2 tileScale = glm::vec2(0.0f);             // Clusters per pixel along each axis
+    int maxClusterLights = 0;                          // Most lights in a single cluster this frame
+    CascadedShadows *shadows = NULL;                   // Shadows of the directional lights, NULL without them
+    ShadowAtlas *atlas = NULL;                         // Shadows of the point and spot lights, NULL without them
+
+    // Rebuilds the view space bounds of every cluster for a projection
+    void build_bounds(glm::mat4 projection);
+    // Assigns the lights to the clusters of one depth slice
+    void assign_slice(int slice);
+    // Replaces the contents of a texture buffer
+    void upload(int buffer, const void *data, size_t size);
+};
+
+#endif // !CLUSTEREDLIGHTING_H
@@ -0,0 +1,83 @@
+#ifndef DEFERREDRENDERER_H
+#define DEFERREDRENDERER_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+#include "thirdparty/glm/glm.hpp"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/ClusteredLighting.h"
+#include "rendering/DynamicBuffer.h"
+#include "rendering/RenderGraph.h"
+#include "rendering/Shader.h"
+
+// Standard Headers
+#include <functional>
+#include <vector>
+
+// Shapes the lights are accumulated with, matching the volumeType of the light program
+enum DEFERRED_VOLUME
+{
+    DEFERRED_FULL_SCREEN,
+    DEFERRED_SPHERE,
+    DEFERRED_CONE,
+    DEFERRED_VOLUME_COUNT,
+};
+
+// Deferred path writing surfaces into a G-buffer once, then adding each light only over the pixels its volume covers
+class DeferredRenderer
+{
+public:
+    // Loads the programs and builds the volume meshes, light instances go through a per-frame ring when given one, returns whether all linked
+    bool initialise(ClusteredLighting *lighting_, bool indirect, DynamicBuffer *ring_ = NULL);
+    // Returns the G-buffer program replacing a forward template shader
+    Shader *get_geometry_program(SHADER_TEMPLATE shader);
+    // Returns the G-buffer program for the indirect path, NULL when it was not built
+    Shader *get_indirect_program();
+    // Sets the camera and toggles of the frame the passes are declared for
+    void set_frame(glm::mat4 view_, glm::mat4 projection_, glm::vec3 cameraPosition_, glm::vec3 background_, bool blinnPhong_, bool gamma_);
+    // Declares the geometry, light and composite passes writing the scene colour and depth, keeping the depth a pre-pass laid down,
+    // the geometry and light passes read the shadow maps
+    void add_passes(RenderGraph *graph, std::function<void()> drawGeometry, int sceneColor, int sceneDepth, const std::vector<int> &shadowMaps, int width, int height, bool depthPrepassed = false);
+    // Returns the number of light volumes drawn last frame
+    int get_volume_count();
+    // Frees the programs and buffers
+    void free_data();
+
+private:
+    ClusteredLighting *lighting = NULL;            // Lights packed for the frame, shared with the forward path
+    Shader geometryPrograms[LOADED_SHADERS_COUNT]; // G-buffer program of each template shader
+    Shader indirectProgram;                        // G-buffer program reading the indirect draw records
+    Shader lightProgram;                           // Program adding one light over its volume
+    Shader compositeProgram;                       // Program resolving the accumulated light into the scene colour
+    bool indirectBuilt = false;                    // Whether indirectProgram was built
+    unsigned int VAOs[DEFERRED_VOLUME_COUNT] = {}; // Vertex array of each volume, full-screen reads instances only
+    unsigned int vertexBuffers[2] = {};            // Unit sphere and cone positions
+    unsigned int indexBuffers[2] = {};             // Unit sphere and cone triangles
+    int indexCounts[2] = {};                       // Indices of the sphere and cone
+    unsigned int instanceBuffer = 0;               // Light indices of the volumes when the ring has no room
+    DynamicBuffer *ring = NULL;                    // Per-frame ring the light indices are written to
+    unsigned int instanceSource = 0;               // Buffer the light indices were uploaded to this frame
+    size_t instanceOffset = 0;                     // Offset of the light indices in instanceSource
+    std::vector<unsigned int> instances;           // Light indices uploaded this frame
+    int instanceFirst[DEFERRED_VOLUME_COUNT] = {}; // First instance of each shape
+    int instanceCount[DEFERRED_VOLUME_COUNT] = {}; // Instances of each shape
+    glm::mat4 view = glm::mat4(1.0f);              // View matrix of the frame
+    glm::mat4 projection = glm::mat4(1.0f);        // Projection matrix of the frame
+    glm::vec3 cameraPosition = glm::vec3(0.0f);    // World space camera position
+    glm::vec3 background = glm::vec3(0.0f);        // Colour of pixels no geometry covers
+    bool blinnPhong = ENABLE_BLINN_PHONG;          // Whether specular uses the half vector
+    bool gamma = ENABLE_GAMMA_CORRECTION;          // Whether the composite applies gamma
+
+    // Groups the frame's lights by volume shape, dropping those wholly behind the camera or past the far plane
+    void gather_instances();
+    // Draws every light volume into the accumulation target
+    void draw_lights(unsigned int albedo, unsigned int normal, unsigned int specular, unsigned int ambient, unsigned int depth, int width, int height);
+    // Builds a unit mesh, circumscribing the shape it approximates so no covered pixel is missed
+    void build_volume(int volume, const std::vector<glm::vec3> &positions, const std::vector<unsigned int> &indices);
+    // Points the instance attribute of the bound vertex array at a shape's first light index
+    void bind_instances(int first);
+};
+
+#endif // !DEFERREDRENDERER_H
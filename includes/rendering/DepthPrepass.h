@@ -0,0 +1,50 @@
+#ifndef DEPTHPREPASS_H
+#define DEPTHPREPASS_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/GeometryPool.h"
+#include "rendering/Shader.h"
+
+// Depth-only pass laying down the nearest surfaces before shading, so the lighting shaders run once per pixel,
+// and the occlusion queries measuring how many fragments the shading pass runs per covered pixel
+class DepthPrepass
+{
+public:
+    // Loads the depth-only programs, the indirect one only when asked, returns whether they all linked
+    bool initialise(bool indirect);
+    // Returns the program drawing positions only
+    Shader *get_program();
+    // Returns the depth-only program for the indirect path, NULL when it was not built
+    Shader *get_indirect_program();
+    // Switches draws to the position streams and turns colour writes off
+    void begin_depth();
+    // Switches draws back to the full vertex streams and turns colour writes on
+    void end_depth();
+    // Starts counting shaded fragments, testing for equal depth without writing it when the pre-pass ran
+    void begin_shading(bool prepassed);
+    // Stops counting, counts the pixels the scene covers and restores the depth state
+    void end_shading();
+    // Returns the shaded fragments per covered pixel last read back
+    float get_overdraw();
+    // Frees the programs and queries
+    void free_data();
+
+private:
+    Shader program;                                              // Depth-only program for the template shaders
+    Shader indirectProgram;                                      // Depth-only program reading the indirect draw records
+    Shader coverageProgram;                                      // Program drawing a full-screen triangle on the far plane
+    bool indirectBuilt = false;                                  // Whether indirectProgram was built
+    unsigned int VAO = 0;                                        // Empty vertex array for the full-screen triangle
+    unsigned int shadedQueries[RENDER_GRAPH_QUERY_FRAMES] = {};  // Fragments passing the shading pass's depth test
+    unsigned int coveredQueries[RENDER_GRAPH_QUERY_FRAMES] = {}; // Pixels holding geometry after the shading pass
+    bool pending[RENDER_GRAPH_QUERY_FRAMES] = {};                // Whether each query pair still holds an unread result
+    int frame = 0;                                               // Shading passes measured so far
+    bool measuring = false;                                      // Whether the current shading pass is being counted
+    float overdraw = 1.0f;                                       // Shaded fragments per covered pixel
+};
+
+#endif // !DEPTHPREPASS_H
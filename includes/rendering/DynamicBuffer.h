@@ -0,0 +1,66 @@
+#ifndef DYNAMICBUFFER_H
+#define DYNAMICBUFFER_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/GLExtensions.h"
+
+// Standard Headers
+#include <cstddef>
+#include <vector>
+
+// Region of the dynamic buffer handed out for one frame
+struct DynamicAllocation
+{
+    void *data = NULL; // Write pointer for the region, NULL when the frame's space ran out
+    size_t offset = 0; // Offset of the region in the buffer, used when binding or drawing from it
+    size_t size = 0;   // Bytes in the region
+};
+
+// Triple-buffered ring for per-frame vertex, uniform and indirect data, paced by a fence per frame
+class DynamicBuffer
+{
+public:
+    // Default DynamicBuffer constructor
+    DynamicBuffer();
+    // Creates the ring with a region of frameSize bytes for each frame in flight
+    void initialise(size_t frameSize_ = DYNAMIC_BUFFER_FRAME_SIZE);
+    // Returns whether the ring has been created
+    bool is_active();
+    // Returns whether the ring is persistently mapped rather than staged through glBufferSubData
+    bool is_persistent();
+    // Waits for the GPU to release the next frame's region and starts handing it out
+    void begin_frame();
+    // Fences the current frame's region after its last use has been submitted
+    void end_frame();
+    // Hands out bytes from the current frame's region at an offset aligned to alignment
+    DynamicAllocation allocate(size_t bytes, size_t alignment = 16);
+    // Makes writes to an allocation visible to the GPU, only needed without persistent mapping
+    void flush(const DynamicAllocation &allocation);
+    // Allocates room for a copy of data and makes it visible to the GPU, the returned data is NULL when the frame's space ran out
+    DynamicAllocation upload(const void *data, size_t bytes, size_t alignment = 16);
+    // Returns the GL buffer holding the ring
+    unsigned int get_buffer();
+    // Returns the bytes handed out in the current frame
+    size_t get_frame_used();
+    // Returns the number of frames that waited on a fence
+    int get_stall_count();
+    // Frees the buffer and fences
+    void free_data();
+
+private:
+    unsigned int buffer = 0;       // Buffer holding every frame's region
+    size_t frameSize = 0;          // Bytes in each frame's region
+    int frame = 0;                 // Region of the current frame
+    size_t head = 0;               // Bytes handed out in the current frame
+    char *mapped = NULL;           // Persistent mapping of the whole buffer
+    std::vector<char> staging;     // CPU copy of the current region when the buffer cannot stay mapped
+    std::vector<GLsync> fences;    // Fence of each region's last frame
+    int stallCount = 0;            // Frames that had to wait on a fence
+    bool overflowReported = false; // Whether an overflow has been logged
+};
+
+#endif // !DYNAMICBUFFER_H
@@ -0,0 +1,147 @@
+#ifndef GEOMETRYPOOL_H
+#define GEOMETRYPOOL_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/GLExtensions.h"
+
+// Standard Headers
+#include <cstddef>
+#include <map>
+#include <vector>
+
+// Vertex attribute of a geometry format
+struct GeometryAttribute
+{
+    int location;    // Attribute location in the vertex shader
+    int count;       // Components of the attribute
+    GLenum type;     // Type of each component
+    bool normalized; // Whether integer components are normalized
+    size_t offset;   // Offset of the attribute inside a vertex
+};
+
+// Vertex layout shared by the meshes of a page
+struct GeometryFormat
+{
+    GLsizei stride = 0;                        // Bytes per vertex
+    std::vector<GeometryAttribute> attributes; // Attributes of a vertex
+    GLenum indexType = GL_UNSIGNED_INT;        // GL_UNSIGNED_INT or GL_UNSIGNED_SHORT indices
+
+    // Compares two layouts attribute by attribute
+    bool operator==(const GeometryFormat &other) const;
+};
+
+// Offset allocator handing out ranges of elements from a free list
+class RangeAllocator
+{
+public:
+    // Capacity constructor for RangeAllocator
+    RangeAllocator(size_t capacity_ = 0);
+    // Finds the smallest free block that fits, returns whether one was found
+    bool allocate(size_t count, size_t *offset);
+    // Returns a range to the free list, merging it with its neighbours
+    void release(size_t offset, size_t count);
+    // Returns the number of elements managed
+    size_t get_capacity();
+    // Returns the number of free elements
+    size_t get_free();
+    // Returns the number of separate free blocks
+    int get_free_block_count();
+
+private:
+    size_t capacity;                     // Elements managed
+    size_t freeCount;                    // Elements not handed out
+    std::map<size_t, size_t> freeBlocks; // Free blocks by offset with their sizes
+};
+
+// Range of a mesh inside a geometry page
+struct GeometryRange
+{
+    int page = -1;          // Page holding the mesh, -1 for a released handle
+    size_t baseVertex = 0;  // First vertex of the mesh in the page
+    size_t vertexCount = 0; // Vertices of the mesh
+    size_t firstIndex = 0;  // First index of the mesh in the page
+    size_t indexCount = 0;  // Indices of the mesh
+};
+
+// Large vertex and index buffers shared by the meshes of one format
+struct GeometryPage
+{
+    unsigned int VAO = 0;         // Vertex array shared by every mesh in the page
+    unsigned int VBO = 0;         // Vertex buffer of the page
+    unsigned int EBO = 0;         // Index buffer of the page
+    unsigned int positionVAO = 0; // Vertex array reading only the position stream
+    unsigned int positionVBO = 0; // Positions of the page's vertices packed back to back
+    int format = -1;              // Format of the vertices, -1 for an unused page
+    RangeAllocator vertices;      // Allocator over the vertex buffer
+    RangeAllocator indices;       // Allocator over the index buffer
+};
+
+// Pool sub-allocating mesh geometry from a few large buffers per vertex format
+class GeometryPool
+{
+public:
+    // Returns the pool shared by every mesh
+    static GeometryPool &get();
+    // Copies a mesh into a page of its format, returns the handle of its range
+    int allocate(const GeometryFormat &format, const void *vertexData, size_t vertexCount, const void *indexData, size_t indexCount);
+    // Releases the range of a handle
+    void release(int handle);
+    // Returns the range of a handle
+    const GeometryRange &get_range(int handle);
+    // Binds the shared vertex array of a page, or its position stream in position only mode
+    void bind_page(int page);
+    // Makes every draw read the position stream alone, for passes that only write depth
+    void set_position_only(bool enabled);
+    // Returns the index type of a page
+    GLenum get_index_type(int page);
+    // Returns the vertex layout of a page
+    const GeometryFormat &get_format(int page);
+    // Returns the vertex buffer of a page, for passes fetching vertices themselves
+    unsigned int get_vertex_buffer(int page);
+    // Returns the index buffer of a page, for passes fetching triangles themselves
+    unsigned int get_index_buffer(int page);
+    // Returns the bytes in an index of a type
+    static size_t get_index_size(GLenum indexType);
+    // Returns the bytes of vertex and index storage handed out to meshes
+    size_t get_used_bytes();
+    // Draws the range of a handle with glDrawElementsBaseVertex
+    void draw(int handle);
+    // Draws a run of a handle's indices, counted from its first index
+    void draw(int handle, size_t firstIndex, size_t indexCount);
+    // Draws several runs of a handle's indices, counted from its first index, with glMultiDrawElementsBaseVertex
+    void draw_multi(int handle, const GLsizei *counts, const size_t *firstIndices, int drawCount);
+    // Draws a run of a handle's indices once per mat4 in an instance buffer, starting at an instance
+    void draw_instanced(int handle, size_t firstIndex, size_t indexCount, unsigned int instanceBuffer, int firstInstance, int instanceCount);
+    // Compacts fragmented pages and frees empty ones
+    void defragment();
+    // Frees every page
+    void free_data();
+
+private:
+    std::vector<GeometryFormat> formats; // Formats with at least one page
+    std::vector<GeometryPage> pages;     // Pages of every format
+    std::vector<GeometryRange> ranges;   // Range of each handle
+    std::vector<int> freeHandles;        // Released handles ready for reuse
+    bool positionOnly = false;           // Whether draws bind the position streams
+
+    // Returns the bytes of an attribute in a vertex
+    static size_t get_attribute_size(const GeometryAttribute &attribute);
+    // Returns the position attribute of a format
+    static const GeometryAttribute &get_position_attribute(const GeometryFormat &format);
+    // Returns the index of a format, registering it if new
+    int find_format(const GeometryFormat &format);
+    // Creates the buffers of a page
+    int create_page(int format, size_t vertexCapacity, size_t indexCapacity);
+    // Creates buffer storage which is not resized after creation
+    void create_storage(GLenum target, unsigned int buffer, GLsizeiptr size);
+    // Points the vertex array of a page at its buffers
+    void setup_page_vao(GeometryPage *page);
+    // Moves the live ranges of a page to the front of new buffers
+    void compact_page(int page);
+};
+
+#endif // !GEOMETRYPOOL_H
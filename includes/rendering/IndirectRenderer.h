@@ -0,0 +1,113 @@
+#ifndef INDIRECTRENDERER_H
+#define INDIRECTRENDERER_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+#include "thirdparty/glm/glm.hpp"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/DynamicBuffer.h"
+#include "rendering/GLExtensions.h"
+#include "rendering/GeometryPool.h"
+#include "rendering/Shader.h"
+#include "object/Model.h"
+
+// Standard Headers
+#include <vector>
+
+// Per-instance draw record read by the culling and vertex shaders, laid out for std430
+struct IndirectRecord
+{
+    glm::mat4 model;          // Model matrix of the instance
+    glm::vec4 bounds;         // Model space bounding sphere, center in xyz and radius in w
+    glm::vec4 cone;           // Model space normal cone axis in xyz and half angle in w, pi for draws never back facing
+    glm::vec4 positionOffset; // Offset restoring quantized positions, w unused
+    glm::vec4 positionScale;  // Scale restoring quantized positions, w unused
+    unsigned int indexCount;  // Indices of the mesh
+    unsigned int firstIndex;  // First index of the mesh in its geometry page
+    unsigned int baseVertex;  // First vertex of the mesh in its geometry page
+    unsigned int group;       // Draw group the instance is submitted with
+};
+
+// Command layout consumed by glMultiDrawElementsIndirect
+struct IndirectCommand
+{
+    unsigned int count;         // Indices to draw
+    unsigned int instanceCount; // Instances to draw, zero for culled slots
+    unsigned int firstIndex;    // First index in the page
+    int baseVertex;             // Value added to each index
+    unsigned int baseInstance;  // Record of the draw, fetched through the instanced draw attribute
+};
+
+// Draws sharing a geometry page, texture bindings and shininess, submitted by one multi-draw
+struct IndirectGroup
+{
+    int page;         // Geometry page of the draws
+    Mesh *mesh;       // Mesh whose texture bindings the group uses
+    float shininess;  // Shininess of the material
+    int firstCommand; // First command slot of the group
+    int commandCount; // Command slots of the group
+};
+
+// GL 4.3 path culling draws on the GPU and submitting them with multi-draw indirect
+class IndirectRenderer
+{
+public:
+    Shader shader; // Lighting shader reading model matrices from the draw records
+
+    // Default IndirectRenderer constructor
+    IndirectRenderer();
+    // Compiles the shaders and creates the buffers, returns false when the context lacks GL 4.3 features
+    bool initialise(const char *vertexPath, const char *fragmentPath, const char *cullPath, DynamicBuffer *ring_ = NULL);
+    // Returns whether the indirect path can be used
+    bool is_active();
+    // Clears the draws of the previous frame
+    void begin_frame();
+    // Adds a draw record for every mesh instance of a model at a level of detail, or one per cluster of the full level
+    void add_model(Model *model, glm::mat4 matrix, float shininess, int lod = 0, bool useMeshlets = false);
+    // Returns the number of draw records added this frame
+    int get_record_count();
+    // Returns the most indices a single draw record of this frame covers
+    unsigned int get_max_index_count();
+    // Returns the draw groups of this frame
+    const std::vector<IndirectGroup> &get_groups();
+    // Binds the uploaded records to storage binding 0 for passes reading them without drawing
+    void bind_records();
+    // Uploads the records and culls them against the frustum, and back facing clusters against the camera, in a compute pass
+    void cull(glm::mat4 viewProjection, glm::vec3 cameraPosition = glm::vec3(0.0f), bool coneCulling = false);
+    // Submits one multi-draw per group with the lighting shader or another program reading the records, whose uniforms are already set
+    void draw(Shader *program = NULL);
+    // Frees the buffers and shaders
+    void free_data();
+
+private:
+    bool active = false;                  // Whether initialise succeeded
+    Shader cullShader;                    // Compute shader writing the compacted commands
+    unsigned int recordBuffer = 0;        // Storage buffer of draw records
+    unsigned int commandBuffer = 0;       // Indirect buffer of draw commands when the ring has no room
+    unsigned int groupBuffer = 0;         // Storage buffer of group first slots and visible counts
+    unsigned int drawIdBuffer = 0;        // Vertex buffer holding 0..n, read per instance as the record index
+    DynamicBuffer *ring = NULL;           // Per-frame ring the records, group slots and commands are placed in
+    int storageAlignment = 256;           // Offset alignment of storage buffer bindings
+    unsigned int recordSource = 0;        // Buffer the records were uploaded to this frame
+    size_t recordOffset = 0;              // Offset of the records in recordSource
+    unsigned int commandSource = 0;       // Buffer the commands are written to this frame
+    size_t commandOffset = 0;             // Offset of the commands in commandSource
+    size_t bufferCapacity = 0;            // Records the buffers can hold
+    unsigned int maxIndexCount = 0;       // Most indices in one record this frame
+    std::vector<IndirectRecord> records;  // Records of this frame
+    std::vector<IndirectGroup> groups;    // Groups of this frame
+    std::vector<unsigned int> groupSlots; // First slot and visible count of each group for upload
+
+    // Returns the group for a mesh, creating it if needed
+    int find_group(Mesh *mesh, int page, float shininess);
+    // Grows the buffers to hold a number of records
+    void reserve(size_t count);
+    // Writes the records and group slots into the ring and reserves the commands there, returns false when it has no room left
+    bool upload_to_ring();
+    // Points the draw id attribute of a page's vertex array at the draw id buffer
+    void bind_draw_ids(int page);
+};
+
+#endif // !INDIRECTRENDERER_H
@@ -0,0 +1,21 @@
+#ifndef KTX2_H
+#define KTX2_H
+
+// Custom Headers
+#include "rendering/TextureCook.h"
+
+// Standard Headers
+#include <map>
+#include <string>
+
+// Reader and writer for the KTX2 texture container
+class KTX2
+{
+public:
+    // Writes a cooked texture and its key/value metadata to a KTX2 file
+    static bool write(const std::string &path, const CookedTexture &texture, const std::map<std::string, std::string> &metadata);
+    // Reads a cooked texture and its key/value metadata from a KTX2 file, levels outside [firstLevel, lastLevel] are left empty
+    static bool read(const std::string &path, CookedTexture *texture, std::map<std::string, std::string> *metadata, int firstLevel = 0, int lastLevel = -1);
+};
+
+#endif // !KTX2_H
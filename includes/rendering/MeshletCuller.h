@@ -0,0 +1,38 @@
+#ifndef MESHLETCULLER_H
+#define MESHLETCULLER_H
+
+// Third-party Headers
+#include "thirdparty/glm/glm.hpp"
+
+// Custom Headers
+#include "Config.h"
+#include "object/Mesh.h"
+
+// Standard Headers
+#include <vector>
+
+// CPU culling of mesh clusters against the frustum and their normal cones, spread over the job system
+class MeshletCuller
+{
+public:
+    // Sets the camera the clusters are culled against this frame and clears the counters
+    void begin_frame(glm::mat4 viewProjection, glm::vec3 cameraPosition_, bool coneCulling_);
+    // Culls the clusters of a mesh drawn with a model matrix, returns the visible indices as merged runs
+    void cull(const Mesh &mesh, glm::mat4 model, std::vector<MeshLod> *runs);
+    // Returns whether a cluster survives the frustum test and, when enabled, the back facing cone test
+    static bool is_visible(const glm::vec4 &bounds, const glm::vec4 &cone, const glm::mat4 &model, const glm::vec4 planes[6], glm::vec3 cameraPosition, bool coneCulling);
+    // Returns the number of clusters tested this frame
+    int get_tested_count();
+    // Returns the number of clusters which survived this frame
+    int get_visible_count();
+
+private:
+    glm::vec4 planes[6];                // World space frustum planes of this frame
+    glm::vec3 cameraPosition;           // World space camera position of this frame
+    bool coneCulling = false;           // Whether back facing clusters are rejected, only valid with face culling on
+    int testedCount = 0;                // Clusters tested this frame
+    int visibleCount = 0;               // Clusters visible this frame
+    std::vector<unsigned char> visible; // Visibility of each cluster of the mesh being culled
+};
+
+#endif // !MESHLETCULLER_H
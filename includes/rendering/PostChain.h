@@ -0,0 +1,86 @@
+#ifndef POSTCHAIN_H
+#define POSTCHAIN_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/RenderGraph.h"
+#include "rendering/Shader.h"
+
+// Standard Headers
+#include <string>
+#include <vector>
+
+// Effects a post processing stage can apply
+enum POST_EFFECT
+{
+    POST_INVERT,
+    POST_GRAYSCALE,
+    POST_SHARPEN,
+    POST_BLUR,
+    POST_EDGE,
+    POST_EMBOSS,
+    POST_EFFECT_COUNT,
+};
+
+// Effect names for the scene ui
+static const char *postEffectNames[] = {"Invert", "GrayScale", "Sharpen", "Blur", "Edge", "Emboss"};
+
+// Filters resampling the chain's result up to the output resolution
+enum POST_UPSCALE_FILTER
+{
+    POST_UPSCALE_BILINEAR,
+    POST_UPSCALE_EDGE,
+    POST_UPSCALE_FILTER_COUNT,
+};
+
+// Upscale filter names for the scene ui
+static const char *postUpscaleNames[] = {"Bilinear", "Edge Aware"};
+
+// Stage of the post processing chain
+struct PostStage
+{
+    POST_EFFECT effect;  // Effect applied by the stage
+    int scale = 1;       // Divisor of the screen resolution the stage renders at
+    bool enabled = true; // Whether the stage runs
+};
+
+// Chain of full-screen effects, each its own program, ping-ponging between pooled targets of the render graph
+class PostChain
+{
+public:
+    std::vector<PostStage> stages;                         // Stages applied in order
+    float kernelOffset = 0.002f;                           // UV distance between the taps of the 3x3 kernels
+    float blurSigma = POST_BLUR_SIGMA;                     // Standard deviation of the blur in screen pixels
+    POST_UPSCALE_FILTER upscaleFilter = POST_UPSCALE_EDGE; // Filter of the final pass when it changes resolution
+    float upscaleSharpness = POST_UPSCALE_SHARPNESS;       // Strength of the edge aware filter's sharpening
+
+    // Loads the program of every effect, returns whether they all linked
+    bool initialise();
+    // Appends a stage at the resolution suited to its effect
+    void add_stage(POST_EFFECT effect);
+    // Declares the passes of the enabled stages at the source size, the last one resampling into the output size
+    void add_passes(RenderGraph *graph, int source, int sourceWidth, int sourceHeight, int output, int outputWidth, int outputHeight);
+    // Returns the GPU time of a stage's passes as last measured by the graph, in milliseconds
+    float get_stage_time(RenderGraph *graph, int stage);
+    // Fills the offsets and weights of a gaussian folded for linear sampling, returns the tap count
+    static int get_blur_taps(float sigma, float *offsets, float *weights);
+    // Frees the programs and vertex array
+    void free_data();
+
+private:
+    Shader programs[POST_EFFECT_COUNT];              // Program of each effect
+    Shader copyProgram;                              // Program resampling a texture unchanged
+    Shader upscaleProgram;                           // Program upscaling along edges and sharpening
+    unsigned int VAO = 0;                            // Empty vertex array for the full-screen triangle
+    std::vector<std::vector<std::string>> passNames; // Graph passes of each stage declared last
+
+    // Draws one direction of the separable blur, direction being a texel of the target
+    void draw_blur(unsigned int texture, glm::vec2 direction, float sigma);
+    // Draws the full-screen triangle sampling a texture with a program
+    void draw(Shader *program, unsigned int texture);
+};
+
+#endif // !POSTCHAIN_H
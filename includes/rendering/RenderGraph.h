@@ -0,0 +1,115 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/RenderTargetPool.h"
+
+// Standard Headers
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Texture declared to the graph, either transient or owned outside of it
+struct RenderGraphResource
+{
+    std::string name;         // Name shown in the timings
+    int width = 0;            // Width in pixels
+    int height = 0;           // Height in pixels
+    GLenum format = GL_RGBA8; // Sized internal format
+    bool imported = false;    // Whether the texture lives outside the graph
+    unsigned int texture = 0; // Texture of an imported resource, 0 with imported set for the window's framebuffer
+    int target = -1;          // Pooled target of a transient resource while it is alive
+    int firstPass = -1;       // First executed pass using the resource
+    int lastPass = -1;        // Last executed pass using the resource
+};
+
+// Pass declared to the graph with the resources it reads and writes
+struct RenderGraphPass
+{
+    std::string name;              // Name shown in the timings
+    std::function<void()> execute; // Records the GL commands of the pass
+    std::vector<int> reads;        // Resources sampled by the pass
+    std::vector<int> writes;       // Resources attached as outputs, in attachment order
+    bool sideEffect = false;       // Whether the pass must run even when nothing reads its outputs
+    bool ownFramebuffer = false;   // Whether the pass binds its own framebuffer instead of one made from its outputs
+    bool culled = false;           // Whether compile found the pass unused
+};
+
+// Rolling timings of a pass, kept across frames by name
+struct RenderGraphTiming
+{
+    unsigned int queries[RENDER_GRAPH_QUERY_FRAMES] = {}; // Time elapsed queries, one per frame in flight
+    bool pending[RENDER_GRAPH_QUERY_FRAMES] = {};         // Whether each query still holds an unread result
+    float gpuTime = 0.0f;                                 // Last GPU time read back, in milliseconds
+    float cpuTime = 0.0f;                                 // CPU time of the last recording, in milliseconds
+    int lastFrame = 0;                                    // Frame the pass last ran in
+};
+
+// Frame graph ordering declared passes, culling unused ones and aliasing transient targets through the pool
+class RenderGraph
+{
+public:
+    // Sets the pool transient targets are drawn from
+    void initialise(RenderTargetPool *pool_);
+    // Clears the passes and resources declared last frame
+    void reset();
+    // Declares a transient texture living from its first to its last use this frame
+    int create_texture(std::string name, int width, int height, GLenum format);
+    // Declares a texture owned outside of the graph
+    int import_texture(std::string name, unsigned int texture, int width, int height, GLenum format);
+    // Declares the window's framebuffer, passes writing it always run
+    int import_backbuffer(std::string name, int width, int height);
+    // Declares a pass, its callback runs during execute with its outputs bound
+    int add_pass(std::string name, std::function<void()> execute);
+    // Declares a resource sampled by a pass
+    void read(int pass, int resource);
+    // Declares a resource attached as an output of a pass, a second writer keeps the earlier contents
+    void write(int pass, int resource);
+    // Keeps a pass even when nothing reads its outputs
+    void set_side_effect(int pass);
+    // Leaves binding the outputs to the pass, for outputs a 2D framebuffer attachment cannot describe
+    void set_own_framebuffer(int pass);
+    // Orders the passes, culls unused ones and computes resource lifetimes
+    void compile();
+    // Runs the passes in order, binding their outputs and timing each of them
+    void execute();
+    // Returns the texture of a resource, only valid while the resource is alive
+    unsigned int get_texture(int resource);
+    // Returns the passes in execution order
+    const std::vector<int> &get_order();
+    // Returns a declared pass
+    const RenderGraphPass &get_pass(int pass);
+    // Returns the rolling timings of every pass seen so far, by name
+    const std::map<std::string, RenderGraphTiming> &get_timings();
+    // Returns the GPU time of the passes executed this frame as last measured, in milliseconds
+    float get_gpu_time();
+    // Returns the number of transient resources declared this frame
+    int get_transient_count();
+    // Returns the number of distinct textures backing them
+    int get_physical_count();
+    // Frees the framebuffers and queries
+    void free_data();
+
+private:
+    RenderTargetPool *pool = NULL;                                  // Pool transient targets come from
+    std::vector<RenderGraphResource> resources;                     // Resources declared this frame
+    std::vector<RenderGraphPass> passes;                            // Passes declared this frame
+    std::vector<int> order;                                         // Passes kept by compile, in execution order
+    std::map<std::vector<unsigned int>, unsigned int> framebuffers; // Framebuffer of each attachment set
+    std::map<std::string, RenderGraphTiming> timings;               // Timings of each pass by name
+    int frame = 0;                                                  // Frames executed so far
+    int physicalCount = 0;                                          // Distinct textures used by transients this frame
+    int poolAllocations = 0;                                        // Pool allocations seen when the framebuffers were made
+
+    // Binds the framebuffer of a pass's outputs and sets the viewport to them
+    void bind_outputs(const RenderGraphPass &pass);
+    // Reads back a finished query and starts timing a pass, returns whether the query was started
+    bool begin_timing(RenderGraphTiming *timing);
+};
+
+#endif // !RENDERGRAPH_H
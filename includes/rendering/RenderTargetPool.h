@@ -0,0 +1,65 @@
+#ifndef RENDERTARGETPOOL_H
+#define RENDERTARGETPOOL_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/GLExtensions.h"
+
+// Standard Headers
+#include <cstddef>
+#include <vector>
+
+// Texture a pass renders into, its storage is fixed for its whole life
+struct RenderTarget
+{
+    unsigned int texture = 0; // Texture holding the target, 0 for a freed handle
+    int width = 0;            // Width in pixels
+    int height = 0;           // Height in pixels
+    GLenum format = GL_RGBA8; // Sized internal format
+    bool inUse = false;       // Whether a pass currently holds the target
+    int lastUsedFrame = 0;    // Frame the target was last acquired or released in
+};
+
+// Pool of render targets keyed by size and format, so passes reuse attachments instead of reallocating them
+class RenderTargetPool
+{
+public:
+    // Returns a free target of a size and format, creating one only when none is free
+    int acquire(int width, int height, GLenum format);
+    // Returns a target to the pool, its texture stays allocated for the next acquire
+    void release(int target);
+    // Returns the target of a handle
+    const RenderTarget &get_target(int target);
+    // Returns the texture of a handle
+    unsigned int get_texture(int target);
+    // Ends the frame, freeing targets left unused for RENDER_TARGET_IDLE_FRAMES frames
+    void end_frame();
+    // Returns the number of live targets
+    int get_target_count();
+    // Returns the number of textures created since startup
+    int get_allocation_count();
+    // Returns the bytes held by live targets
+    size_t get_used_bytes();
+    // Returns whether a format is a depth or depth stencil format
+    static bool is_depth_format(GLenum format);
+    // Returns the bytes per pixel of a format
+    static size_t get_format_size(GLenum format);
+    // Frees every target
+    void free_data();
+
+private:
+    std::vector<RenderTarget> targets; // Target of each handle
+    std::vector<int> freeHandles;      // Freed handles ready for reuse
+    int frame = 0;                     // Frames ended so far
+    int allocationCount = 0;           // Textures created since startup
+
+    // Creates the storage of a target, immutable when the context allows it
+    void create_storage(RenderTarget *target);
+    // Deletes the texture of a handle and recycles it
+    void free_target(int target);
+};
+
+#endif // !RENDERTARGETPOOL_H
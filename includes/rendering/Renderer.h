@@ -8,7 +8,13 @@
 // Custom Headers
 #include "Config.h"
 #include "rendering/Camera.h"
+#include "rendering/DynamicBuffer.h"
+#include "rendering/GLExtensions.h"
+#include "rendering/GeometryPool.h"
+#include "rendering/RenderGraph.h"
+#include "rendering/RenderTargetPool.h"
 #include "rendering/Texture.h"
+#include "rendering/TextureStreamer.h"
 
 // Standard Headers
 #include <iostream>
@@ -24,48 +30,17 @@ struct RenderCamera
     float yOffset;     // Offset of cursor since last frame along Y
 };
 
-// Framebuffer class for Renderer
-class FrameBuffer
+// Paths the scene can be shaded with
+enum SHADING_PATH
 {
-public:
-    unsigned int FBO;           // Frame buffer object
-    unsigned int RBO;           // Render buffer object
-    Texture textureColorBuffer; // Texture to store framebuffer data
-
-    // Default Framebuffer constructor
-    FrameBuffer();
-    // Generates the FBO in memory
-    void generate_fbo();
-    // Binds the FBO in memory
-    void bind_fbo();
-    // Unbinds the FBO from memory
-    void unbind_fbo();
-    // Frees the FBO from memory
-    void free_fbo();
-    // Generates RBO in memory
-    void generate_rbo();
-    // Binds the RBO in memory
-    void bind_rbo();
-    // Unbinds the RBO from memory
-    void unbind_rbo();
-    // Ubnbinds the RBO from memory
-    void free_rbo();
-    // Refreshes the RBO based on screen resolution
-    void refresh_rbo(int width, int height);
-    // Refreshes the texture based on screen resolution
-    void refresh_texture(int width, int height);
-    // Attaches RBO to FBO
-    void attach_rbo();
-    // Attaches texture to FBO
-    void attach_texture();
-    // Refreshes the FBO at start of each frame
-    void new_frame(int width, int height);
-    // Checks if Framebuffer created sucessfully
-    void check_status();
-
-private:
+    SHADING_FORWARD,
+    SHADING_DEFERRED,
+    SHADING_VISIBILITY,
 };
 
+// Shading path names to use for UI
+static const char *shadingPathNames[] = {"Forward", "Deferred", "Visibility Buffer"};
+
 // Renderer Class for Window
 class Renderer
 {
@@ -74,13 +49,18 @@ private:
     float currentTime;  // Time of current frame
 
 public:
-    int major;               // Major version of OpenGL
-    int minor;               // Minor version of OpenGL
-    int width;               // Start width of window
-    int height;              // Start height of window
-    float deltaTime;         // Delta Time for current frame
-    GLFWwindow *window;      // Window instance for Renderer
-    FrameBuffer frameBuffer; // Framebuffer for the Renderer
+    int major;                       // Major version of OpenGL
+    int minor;                       // Minor version of OpenGL
+    int width;                       // Start width of window
+    int height;                      // Start height of window
+    float deltaTime;                 // Delta Time for current frame
+    GLFWwindow *window;              // Window instance for Renderer
+    int frameWidth;                  // Width of the window's framebuffer in pixels
+    int frameHeight;                 // Height of the window's framebuffer in pixels
+    RenderTargetPool renderTargets;  // Attachments shared by the render passes
+    RenderGraph renderGraph;         // Passes of the frame and their targets
+    TextureStreamer textureStreamer; // Streams texture uploads across frames
+    DynamicBuffer dynamicBuffer;     // Ring for data rewritten every frame
 
     // Default Renderer Constructor
     Renderer(int major_ = OPENGL_MAJOR_VERSION, int minor_ = OPENGL_MINOR_VERSION, int width_ = WINDOW_WIDTH, int height_ = WINDOW_HEIGHT);
@@ -92,8 +72,14 @@ public:
     bool create_window();
     // Setups the window Data
     void setup_window_data();
-    // FrameBuffer Setup
-    void setup_frame_buffer();
+    // Render Graph Setup
+    void setup_render_graph();
+    // Takes the framebuffer size the window last reported, returns whether it changed
+    bool update_frame_size();
+    // Starts streaming textures loaded from paths
+    void setup_texture_streamer();
+    // Creates the ring for per-frame dynamic data
+    void setup_dynamic_buffer();
     // Checks whether to close window
     bool close_window();
     // Swaps the window buffers and ends the frame
@@ -120,8 +106,8 @@ public:
     float get_width();
     // Get current width of screen
     float get_height();
-    // Starts the FBO Render pass
-    void start_fbo_pass(float r, float g, float b);
+    // Frees the render graph and pooled targets
+    void free_render_graph();
 };
 
 // Callback function for window resizing
@@ -145,9 +131,9 @@ public:
     // Bind the current VAO to Renderer
     void bind_vao();
     // Binds the current VBO to Renderer
-    void bind_vbo(int vertexCount, GLsizeiptr stride, void *pointer);
+    void bind_vbo(int vertexCount, GLsizeiptr stride, void *pointer, GLenum usage = GL_STATIC_DRAW);
     // Binds the current EBO to Renderer
-    void bind_ebo(int indexCount, void *pointer);
+    void bind_ebo(int indexCount, void *pointer, GLenum usage = GL_STATIC_DRAW);
     // Unbinds the current VAO from Renderer
     void unbind_vao();
     // Unbinds the current VBO from Renderer
@@ -155,7 +141,9 @@ public:
     // Unbinds the current EBO from Renderer
     void unbind_ebo();
     // Sets Vertex Data for a given layout
-    void set_attribute_array(int layoutLayer, int count, GLsizeiptr stride, const void *pointer = (void *)0);
+    void set_attribute_array(int layoutLayer, int count, GLsizeiptr stride, const void *pointer = (void *)0, GLenum type = GL_FLOAT, bool normalized = false);
+    // Sets Vertex Data for every attribute of a layout, see VertexLayout
+    void set_layout(const GeometryFormat &format);
     // Draws using vertices
     void draw_triangle(int count, int startIndex);
     // Draws using indices
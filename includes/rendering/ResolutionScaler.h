@@ -0,0 +1,35 @@
+#ifndef RESOLUTIONSCALER_H
+#define RESOLUTIONSCALER_H
+
+// Third-party Headers
+#include "thirdparty/glm/glm.hpp"
+
+// Custom Headers
+#include "Config.h"
+
+// Controller picking the scene resolution that keeps the measured GPU frame time inside a budget
+class ResolutionScaler
+{
+public:
+    bool enabled = ENABLE_DYNAMIC_RESOLUTION; // Whether the scale follows the frame time
+    float budget = DRS_FRAME_BUDGET;          // GPU time a frame may take, in milliseconds
+    float minScale = DRS_MIN_SCALE;           // Smallest scale of the scene resolution
+    float maxScale = DRS_MAX_SCALE;           // Largest scale of the scene resolution
+
+    // Feeds the GPU time of the last measured frame, returns whether the scale changed
+    bool update(float gpuTime);
+    // Returns the scale of the scene resolution along each axis
+    float get_scale();
+    // Returns the smoothed GPU time the controller steers on, in milliseconds
+    float get_frame_time();
+    // Scales a window dimension to the scene resolution
+    int get_scaled_size(int size);
+
+private:
+    float scale = DRS_MAX_SCALE; // Current scale of the scene resolution
+    float frameTime = 0.0f;      // Smoothed GPU frame time
+    int overFrames = 0;          // Consecutive frames above the budget
+    int underFrames = 0;         // Consecutive frames comfortably below the budget
+};
+
+#endif // !RESOLUTIONSCALER_H
@@ -98,6 +98,7 @@ enum SHADER_TYPE
 {
     VERTEX_SHADER,
     FRAGMENT_SHADER,
+    COMPUTE_SHADER,
     COMBINED_SHADER,
 };
 
@@ -115,6 +116,8 @@ public:
     Shader(const char *vertexPath, const char *fragmentPath);
     // Create shader program from path
     void create_shader(const char *vertexPath, const char *fragmentPath);
+    // Create compute shader program from path, needs a GL 4.3 context
+    void create_compute_shader(const char *computePath);
     // Compile individual shader code files
     unsigned int compile_shader(const char *code, SHADER_TYPE type);
     // Bind current shader ID to renderer
@@ -145,8 +148,8 @@ public:
     void set_mat3(const std::string name, glm::mat3 value);
     // Set a mat4 uniform in shader
     void set_mat4(const std::string name, glm::mat4 value);
-    // Set a texture uniform in shader
-    void set_texture(const std::string name, Texture *tex);
+    // Binds a texture to a unit and points a sampler uniform at it
+    void set_texture(const std::string name, Texture *tex, int unit = 0);
     // Sets the matrices for a 3D object
     void set_matrices(glm::mat4 model, glm::mat4 view, glm::mat4 projection);
     // Sets the material for a 3D object
@@ -0,0 +1,125 @@
+#ifndef SHADOWATLAS_H
+#define SHADOWATLAS_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+#include "thirdparty/glm/glm.hpp"
+
+// Custom Headers
+#include "Config.h"
+#include "object/Actor.h"
+#include "rendering/CascadedShadows.h"
+#include "rendering/DynamicBuffer.h"
+#include "rendering/RenderGraph.h"
+#include "rendering/Shader.h"
+
+// Standard Headers
+#include <functional>
+#include <map>
+#include <vector>
+
+// Region of the atlas holding a spot light or one cube face of a point light
+struct ShadowTile
+{
+    int x = 0;                               // Left edge in texels
+    int y = 0;                               // Bottom edge in texels
+    int size = 0;                            // Width and height in texels, 0 while the tile has no space in the atlas
+    glm::mat4 matrix = glm::mat4(1.0f);      // World to clip space of the tile's view
+    glm::vec4 planes[6];                     // World space planes of the tile's view
+    glm::mat4 drawnMatrix = glm::mat4(1.0f); // View the tile was last drawn with, sampled until it is redrawn
+    bool drawn = false;                      // Whether the tile holds depth drawn at its current place and view
+    bool dirty = false;                      // Whether a caster or the light moved since it was drawn
+    bool moving = false;                     // Whether a caster moved inside the tile's view since it was drawn
+    int lastDrawn = 0;                       // Frame the tile was last drawn
+};
+
+// Shadow state of a point or spot light, kept across frames
+struct ShadowLight
+{
+    LightSource *light = NULL;             // Light the shadows belong to
+    glm::vec3 position = glm::vec3(0.0f);  // World space position the tiles were set up for
+    glm::vec3 direction = glm::vec3(0.0f); // Direction of a spot light
+    float range = 0.0f;                    // Distance past which the light adds nothing
+    float angle = 0.0f;                    // Outer half angle of a spot light in degrees, 0 for point lights
+    int faceCount = 0;                     // Six cube faces for point lights, a single tile for spot lights
+    ShadowTile tiles[6];                   // Tile of each face
+    float importance = 0.0f;               // Screen size of the light's volume in pixels, 0 when off screen
+    int record = -1;                       // First tile record in the tile buffer this frame, -1 without shadows
+    int lastSeen = 0;                      // Frame the light was last active
+};
+
+// Caster moved this frame, kept by its bounds before and after the move
+struct ShadowMove
+{
+    glm::vec4 before = glm::vec4(-1.0f); // Bounding sphere last frame, negative radius for a new caster
+    glm::vec4 after = glm::vec4(-1.0f);  // Bounding sphere this frame, negative radius for a removed caster
+};
+
+// Shared depth atlas for point and spot light shadows. Lights get tiles sized by how large their volume is on screen,
+// point lights only for the cube faces that see the camera's frustum and hold casters, and at most
+// SHADOW_ATLAS_UPDATES_PER_FRAME tiles are redrawn per frame, the ones with moving casters first
+class ShadowAtlas
+{
+public:
+    // Creates the atlas, its framebuffer and the tile buffer, uploaded through a per-frame ring when given one, returns whether the depth program linked
+    bool initialise(DynamicBuffer *ring_ = NULL);
+    // Sizes and places the tiles of the active lights and marks those whose light or casters moved
+    void update(const std::vector<LightSource *> &lights, const std::vector<RenderActor *> &actors, glm::mat4 view, glm::mat4 projection, float viewportHeight, bool gamma);
+    // Declares the pass redrawing the scheduled tiles and uploading the tile records, the callback draws one caster,
+    // returns the atlas imported into the graph for the lit passes to read, -1 when no light has a tile
+    int add_pass(RenderGraph *graph, std::function<void(RenderActor *, Shader *)> drawCaster);
+    // Returns the first tile record of a light, -1 when it has no shadows this frame
+    int get_tile_record(LightSource *light);
+    // Binds the atlas and the tile records to their units, done once per frame before any lit draw
+    void bind_textures();
+    // Sets the uniforms a lighting shader samples the atlas with
+    void set_uniforms(Shader *shader);
+    // Returns the number of lights holding tiles this frame
+    int get_light_count();
+    // Returns the number of tiles placed in the atlas this frame
+    int get_tile_count();
+    // Returns the number of tiles waiting to be redrawn after last frame's updates
+    int get_pending_count();
+    // Returns the number of tiles redrawn last frame
+    int get_update_count();
+    // Frees the atlas, framebuffer, tile buffer and program
+    void free_data();
+
+private:
+    Shader program;                                    // Depth-only program drawing the casters
+    unsigned int atlas = 0;                            // Depth texture every tile lives in
+    unsigned int framebuffer = 0;                      // Framebuffer drawing into the atlas
+    unsigned int tileBuffer = 0;                       // Rectangle and matrix of every tile record
+    unsigned int tileTexture = 0;                      // Texture view of the tile buffer
+    DynamicBuffer *ring = NULL;                        // Per-frame ring the records are written to when texture views can point into it
+    int textureAlignment = 256;                        // Offset alignment of texture buffer ranges
+    std::map<LightSource *, ShadowLight> shadowLights; // Shadow state of every light seen recently
+    std::vector<ShadowLight *> ranked;                 // Lights holding tiles this frame, most important first
+    std::vector<ShadowCaster> casters;                 // Casters drawn into the tiles
+    std::map<RenderActor *, glm::mat4> lastMatrices;   // Transform of each caster last frame
+    std::map<RenderActor *, glm::vec4> lastBounds;     // Bounds of each caster last frame
+    std::vector<ShadowMove> moves;                     // Casters that moved, appeared or disappeared this frame
+    std::vector<unsigned char> cells;                  // Whether each SHADOW_ATLAS_MIN_TILE cell of the atlas is taken
+    std::vector<glm::vec4> records;                    // Tile records uploaded for the lighting shaders
+    int frame = 0;                                     // Frames updated so far
+    int tileCount = 0;                                 // Tiles placed this frame
+    int pendingCount = 0;                              // Tiles left waiting after the last updates
+    int updateCount = 0;                               // Tiles redrawn last frame
+
+    // Points a light's tiles at its current position, direction and range
+    void set_views(ShadowLight *shadow);
+    // Returns whether a cube face or spot tile sees any of the camera's frustum and holds a caster
+    bool needs_tile(const ShadowTile &tile, const glm::vec4 cameraPlanes[6]);
+    // Finds free space for a tile of a size, returns whether it was placed
+    bool allocate(ShadowTile *tile, int size);
+    // Gives a tile's space back to the atlas
+    void release(ShadowTile *tile);
+    // Returns whether a sphere reaches into a tile's view
+    static bool touches(const ShadowTile &tile, glm::vec4 sphere);
+    // Picks the tiles to redraw this frame and draws them
+    void draw_tiles(std::function<void(RenderActor *, Shader *)> &drawCaster);
+    // Rebuilds and uploads the tile records of the ranked lights
+    void upload_records();
+};
+
+#endif // !SHADOWATLAS_H
@@ -7,6 +7,10 @@
 #include "thirdparty/stb_image.h"
 #include "Config.h"
 
+// Custom Headers
+#include "rendering/TextureCook.h"
+#include "rendering/TextureStreamer.h"
+
 // Standard Headers
 #include <iostream>
 
@@ -24,6 +28,8 @@ public:
     Texture(std::string path_, bool gamma = false);
     // Loads the textures from local path
     void load_texture_from_path(bool gamma);
+    // Uploads a cooked mip chain level by level
+    void load_texture_from_cook(const CookedTexture &cooked);
     // Generates Texture ID
     void generate_texture();
     // Binds the current ID to the renderer
@@ -36,6 +42,8 @@ private:
 
 // Sets the active texture based on index to the renderer
 void set_active_texture(int index);
+// Sets the streamer used to load textures asynchronously, NULL loads them immediately
+void set_texture_streamer(TextureStreamer *streamer);
 
 // Texture path for loading textures
 extern std::string texturePaths[LOADED_TEXTURES_COUNT];
@@ -0,0 +1,66 @@
+#ifndef TEXTUREARRAY_H
+#define TEXTUREARRAY_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/TextureCook.h"
+
+// Standard Headers
+#include <string>
+#include <vector>
+
+// Layer of a texture inside a texture array bin
+struct TextureLayer
+{
+    int bin = -1;  // Index of the bin holding the texture
+    int layer = 0; // Layer of the texture in the bin
+};
+
+// Texture array holding textures of one size and format
+struct TextureBin
+{
+    unsigned int id = 0;                          // ID of the GL_TEXTURE_2D_ARRAY
+    int width = 0;                                // Width of each layer
+    int height = 0;                               // Height of each layer
+    int levelCount = 0;                           // Mip levels of each layer
+    int components = 0;                           // Channels stored per pixel
+    bool gamma = false;                           // Whether color channels are sRGB encoded
+    COMPRESSION_FORMAT format = COMPRESSION_NONE; // Block compression of the layers
+    std::string swizzle = "rgba";                 // Channel swizzle applied when sampling
+    std::vector<std::string> paths;               // Source image of each layer
+};
+
+// Packs textures of matching size and format into texture arrays
+class TextureArrayBins
+{
+public:
+    std::vector<TextureBin> bins; // Texture arrays created so far
+
+    // Default TextureArrayBins constructor
+    TextureArrayBins();
+    // Cooks textures in parallel and packs them into bins, returns the layer of each texture
+    std::vector<TextureLayer> load_textures(const std::vector<std::string> &paths, const std::vector<bool> &gammas);
+    // Binds bins to consecutive texture units starting at a unit, up to the spare units below the reserved block, called once per frame
+    void bind_bins(int firstUnit = 0);
+    // Returns the texture unit a layer's bin is bound to, binding it on the spare unit of a sampler slot if it has none
+    int get_unit(const TextureLayer &layer, int slot);
+    // Frees the texture arrays
+    void free_data();
+
+private:
+    int firstBoundUnit = 0; // Unit of the first bin
+    int boundCount = 0;     // Bins with a unit of their own
+    int firstSpareUnit = 0; // First of the units shared by bins past the unit limit, one per sampler slot of a draw
+
+    // Returns whether a cooked texture can be stored in a bin
+    bool matches_bin(const TextureBin &bin, const CookedTexture &cooked);
+    // Creates the texture array storage for a bin
+    void allocate_bin(TextureBin *bin, int layerCount);
+    // Uploads the mip chain of a cooked texture into a layer of a bin
+    void upload_layer(const TextureBin &bin, int layer, const CookedTexture &cooked);
+};
+
+#endif // !TEXTUREARRAY_H
@@ -0,0 +1,61 @@
+#ifndef TEXTURECOMPRESSION_H
+#define TEXTURECOMPRESSION_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+
+// Standard Headers
+#include <string>
+#include <vector>
+
+// Block compressed formats outside of the GL 3.3 core headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
+// Formats a cooked texture can be stored in
+enum COMPRESSION_FORMAT
+{
+    COMPRESSION_NONE, // Uncompressed 8-bit channels
+    COMPRESSION_BC1,  // Opaque color, 4 bits per pixel
+    COMPRESSION_BC3,  // Color with alpha, 8 bits per pixel
+    COMPRESSION_BC4,  // Single channel mask, 4 bits per pixel
+    COMPRESSION_BC5,  // Two channel mask, 8 bits per pixel
+    COMPRESSION_BC7,  // High quality color with alpha, 8 bits per pixel
+};
+
+// Bit flag for a compression format in a support mask
+#define COMPRESSION_BIT(format) (1u << (format))
+
+// Block encoder and format selection for cooked textures
+class TextureCompression
+{
+public:
+    // Returns the mask of formats the current GL context can sample, must be first called on the GL thread
+    static unsigned int get_supported_formats();
+    // Picks a format for an RGBA image from its content, filling the swizzle needed to sample it
+    static COMPRESSION_FORMAT select_format(const unsigned char *rgba, int width, int height, int components, bool gamma, unsigned int supportedFormats, std::string *swizzle);
+    // Encodes an RGBA image into blocks of the given format
+    static std::vector<unsigned char> compress(const unsigned char *rgba, int width, int height, COMPRESSION_FORMAT format);
+    // Returns the bytes used by one 4x4 block of a format
+    static int get_block_size(COMPRESSION_FORMAT format);
+    // Returns the GL internal format for a compressed format
+    static GLenum get_gl_format(COMPRESSION_FORMAT format, bool gamma);
+};
+
+#endif // !TEXTURECOMPRESSION_H
@@ -0,0 +1,60 @@
+#ifndef TEXTURECOOK_H
+#define TEXTURECOOK_H
+
+// Third-party Headers
+#include "thirdparty/stb_image.h"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/TextureCompression.h"
+#include "utility/FileSystem.h"
+
+// Standard Headers
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Single mip level of a cooked texture
+struct CookedMip
+{
+    int width;                       // Width of the level in pixels
+    int height;                      // Height of the level in pixels
+    std::vector<unsigned char> data; // Tightly packed pixels or compressed blocks of the level
+};
+
+// Texture data with a precomputed mip chain
+struct CookedTexture
+{
+    int width = 0;                                // Width of the top level
+    int height = 0;                               // Height of the top level
+    int components = 0;                           // Channels stored per pixel
+    bool gamma = false;                           // Whether color channels are sRGB encoded
+    COMPRESSION_FORMAT format = COMPRESSION_NONE; // Block compression of the levels
+    std::string swizzle = "rgba";                 // Channel swizzle applied when sampling
+    std::vector<CookedMip> mips;                  // Mip chain starting from the top level
+};
+
+// Cook step which converts source images into cached mip chains
+class TextureCook
+{
+public:
+    // Loads a cooked texture from the cache, cooking the source first if the cache is stale
+    static bool load(const std::string &sourcePath, bool gamma, CookedTexture *cooked, unsigned int compressionFormats = 0, int maxResolution = TEXTURE_MAX_RESOLUTION);
+    // Decodes a source image, builds its mip chain and block compresses it with one of the allowed formats
+    static bool cook(const std::string &sourcePath, bool gamma, CookedTexture *cooked, unsigned int compressionFormats = 0, int maxResolution = TEXTURE_MAX_RESOLUTION);
+    // Returns the compression formats cooking may use, must be first called on the GL thread
+    static unsigned int get_compression_formats();
+    // Returns the cache file path used for a source image
+    static std::string get_cache_path(const std::string &sourcePath, bool gamma);
+    // Returns the pixel and internal GL formats of a cooked texture, the pixel format is GL_NONE when compressed
+    static void get_gl_formats(const CookedTexture &cooked, GLenum *format, GLenum *internalFormat);
+    // Converts a swizzle string into GL_TEXTURE_SWIZZLE_RGBA values
+    static void get_gl_swizzle(const std::string &swizzle, GLint *glSwizzle);
+
+private:
+    // Returns a stamp identifying the source file and the cook settings
+    static std::string get_cook_stamp(const std::string &sourcePath, unsigned int compressionFormats, int maxResolution);
+};
+
+#endif // !TEXTURECOOK_H
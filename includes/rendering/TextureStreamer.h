@@ -0,0 +1,161 @@
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/GLExtensions.h"
+#include "rendering/TextureCook.h"
+
+// Standard Headers
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Texture waiting to be cooked and copied into the ring
+struct StreamItem
+{
+    unsigned int textureId;      // Texture the levels are uploaded into
+    std::string path;            // Source image path
+    bool gamma;                  // Whether color channels are sRGB encoded
+    bool cooked = false;         // Whether the cook job has finished
+    bool failed = false;         // Whether the cook job could not load the source
+    CookedTexture texture;       // Cooked mip chain
+    bool uploaded = false;       // Whether every level has been uploaded
+    int firstLevel = -1;         // Level the copy starts from, the smallest level of the chain when negative
+    int lastLevel = 0;           // Level the copy stops after
+    int nextLevel = -1;          // Level currently copied, counting down from the first level
+    size_t levelOffset = 0;      // Bytes of the current level already copied
+};
+
+// Mip residency of a streamed texture
+struct StreamTexture
+{
+    std::string path;                 // Source image path
+    bool gamma = false;               // Whether color channels are sRGB encoded
+    int size = 0;                     // Largest dimension of the top level
+    int levelCount = 0;               // Levels in the cooked chain, zero until the first levels arrive
+    std::vector<size_t> levelBytes;   // GPU bytes of each level
+    int minLevel = 0;                 // Level kept resident regardless of the budget
+    int residentLevel = 0;            // Finest level uploaded and sampled
+    int loadingLevel = 0;             // Finest level resident once the current load finishes
+    int wantedLevel = 0;              // Finest level needed by the last frame that drew the texture
+    float requestedSize = 0.0f;       // Largest screen size reported since the last update
+    unsigned long lastUsedFrame = 0;  // Last frame the texture was drawn
+    std::shared_ptr<StreamItem> load; // Levels being streamed in, NULL when idle
+};
+
+// Memory statistics of the streamed textures
+struct StreamStats
+{
+    size_t residentBytes = 0;  // Bytes of the levels currently resident
+    size_t requestedBytes = 0; // Bytes of the levels needed by the last drawn frames
+    size_t budgetBytes = 0;    // Budget the residency is kept under
+    int textureCount = 0;      // Streamed textures
+    int loadingCount = 0;      // Streamed textures waiting for levels
+};
+
+// Part of a mip level copied into a ring slot
+struct StreamUpload
+{
+    std::shared_ptr<StreamItem> item; // Texture the chunk belongs to
+    int level;                        // Mip level of the chunk
+    int y;                            // First pixel row of the chunk
+    int height;                       // Pixel rows in the chunk
+    size_t offset;                    // Offset of the chunk in the slot buffer
+    size_t size;                      // Bytes in the chunk
+    bool firstChunk;                  // Whether the level storage is allocated before this chunk
+    bool lastChunk;                   // Whether the level is complete after this chunk
+};
+
+// States of a slot in the upload ring
+enum STREAM_SLOT_STATE
+{
+    SLOT_FREE,      // Owned by the GL thread and not in use by the GPU
+    SLOT_WRITING,   // Mapped and being filled by the copy thread
+    SLOT_READY,     // Filled and waiting to be submitted
+    SLOT_IN_FLIGHT, // Submitted and guarded by a fence
+};
+
+// Pixel buffer object in the upload ring
+struct StreamSlot
+{
+    unsigned int pbo = 0;              // Pixel unpack buffer of the slot
+    void *mapped = NULL;               // Mapped pointer while the copy thread may write
+    GLsync fence = NULL;               // Fence placed after the slot's uploads
+    STREAM_SLOT_STATE state = SLOT_FREE; // Current owner of the slot
+    std::vector<StreamUpload> uploads; // Chunks copied into the slot
+};
+
+// Streams cooked textures into GL through a ring of pixel buffer objects
+class TextureStreamer
+{
+public:
+    // Default TextureStreamer constructor
+    TextureStreamer();
+    // Creates the upload ring and starts the copy thread
+    void initialise(size_t frameBudget_ = TEXTURE_STREAM_FRAME_BUDGET, int slotCount = TEXTURE_STREAM_RING_SLOTS);
+    // Queues a texture to be cooked and streamed into an existing texture ID
+    void request(unsigned int textureId, const std::string &path, bool gamma);
+    // Reports the screen size in pixels a texture is drawn at this frame
+    void request_screen_size(unsigned int textureId, float screenSize);
+    // Submits at most one slot of uploads, recycles finished slots and balances mip residency, called once per frame
+    void update();
+    // Sets the GPU memory the streamed mip levels are kept under
+    void set_memory_budget(size_t bytes);
+    // Returns the memory statistics of the streamed textures
+    StreamStats get_stats();
+    // Returns the number of loads not fully uploaded yet
+    int get_pending_count();
+    // Returns whether the streamer has been initialised
+    bool is_active();
+    // Stops the copy thread and frees the upload ring
+    void free_data();
+
+private:
+    std::vector<StreamSlot> slots;                      // Slots of the upload ring
+    std::deque<std::shared_ptr<StreamItem>> items;      // Textures with data left to copy
+    std::map<unsigned int, StreamTexture> residency;    // Mip residency of each streamed texture ID
+    size_t frameBudget = 0;                             // Size of a slot, which bounds the bytes uploaded per frame
+    size_t memoryBudget = TEXTURE_STREAM_MEMORY_BUDGET; // GPU bytes the streamed levels are kept under
+    unsigned long frameIndex = 0;                       // Frames updated so far
+    int submitIndex = 0;                                // Next slot to submit
+    int writeIndex = 0;                                 // Next slot to hand to the copy thread
+    bool persistent = false;                            // Whether slots stay persistently mapped
+    bool active = false;                                // Whether the ring exists
+    bool stopping = false;                              // Whether the copy thread should exit
+    unsigned int compressionFormats = 0;                // Formats the cook jobs may use
+    std::atomic<int> pendingCount;                      // Loads queued but not uploaded
+    std::mutex streamMutex;                             // Guards items and slot states
+    std::condition_variable streamCondition;            // Wakes the copy thread
+    std::thread copyThread;                             // Thread copying cooked levels into slots
+
+    // Main loop of the copy thread
+    void copy_loop();
+    // Copies as many pending rows as fit into a slot, returns whether anything was copied
+    bool fill_slot(StreamSlot *slot);
+    // Issues the GL calls for one chunk from the bound pixel buffer
+    void apply_upload(const StreamUpload &upload);
+    // Returns whether a cooked item still has data to copy
+    bool has_copy_work();
+    // Queues a cook or cache read of a range of levels on the job system
+    void queue_item(const std::shared_ptr<StreamItem> &item);
+    // Moves finished and failed loads into the residency records
+    void update_loads();
+    // Streams in wanted levels and evicts least recently used levels to stay under the budget
+    void balance_residency();
+    // Frees the finest level of the best eviction candidate drawn before a frame, returns whether one was found
+    bool evict_level(unsigned int keepId, unsigned long usedBefore, size_t *committedBytes);
+    // Returns the bytes of the levels from a level down to the smallest
+    size_t get_chain_bytes(const StreamTexture &texture, int level);
+};
+
+#endif // !TEXTURESTREAMER_H
@@ -0,0 +1,147 @@
+#ifndef VERTEXLAYOUT_H
+#define VERTEXLAYOUT_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+#include "thirdparty/glm/glm.hpp"
+#include "thirdparty/glm/gtc/packing.hpp"
+#include "thirdparty/glm/gtc/type_precision.hpp"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/GeometryPool.h"
+
+// Standard Headers
+#include <cstdint>
+#include <initializer_list>
+
+// Two half-float components, uploaded as GL_HALF_FLOAT
+struct Half2
+{
+    uint16_t x; // Bits of the first half float
+    uint16_t y; // Bits of the second half float
+};
+
+// Normal packed as signed normalized 10:10:10:2, uploaded as GL_INT_2_10_10_10_REV
+struct PackedNormal
+{
+    uint32_t bits; // Packed components, x in the low bits
+};
+
+// Quantized vertex, half the size of the float Vertex
+struct PackedVertex
+{
+    glm::i16vec4 position; // Position normalized to the mesh's box, w unused
+    PackedNormal normal;   // Unit normal
+    Half2 uv;              // UV coordinate
+};
+
+// Components and GL type a member type is uploaded as
+template <typename C>
+struct ComponentInfo;
+
+template <>
+struct ComponentInfo<float>
+{
+    static const int count = 1;
+    static const GLenum type = GL_FLOAT;
+};
+
+template <>
+struct ComponentInfo<glm::vec2>
+{
+    static const int count = 2;
+    static const GLenum type = GL_FLOAT;
+};
+
+template <>
+struct ComponentInfo<glm::vec3>
+{
+    static const int count = 3;
+    static const GLenum type = GL_FLOAT;
+};
+
+template <>
+struct ComponentInfo<glm::i16vec4>
+{
+    static const int count = 4;
+    static const GLenum type = GL_SHORT;
+};
+
+template <>
+struct ComponentInfo<Half2>
+{
+    static const int count = 2;
+    static const GLenum type = GL_HALF_FLOAT;
+};
+
+template <>
+struct ComponentInfo<PackedNormal>
+{
+    static const int count = 4;
+    static const GLenum type = GL_INT_2_10_10_10_REV;
+};
+
+// Describes a member of a vertex type as an attribute at a shader location
+template <typename V, typename C>
+GeometryAttribute vertex_attribute(int location, C V::*member, bool normalized = false)
+{
+    static const V sample = V();
+    size_t offset = (size_t)((const char *)&(sample.*member) - (const char *)&sample);
+    return {location, ComponentInfo<C>::count, ComponentInfo<C>::type, normalized, offset};
+}
+
+// Builds the format of a vertex type from its attributes
+template <typename V>
+GeometryFormat vertex_format(std::initializer_list<GeometryAttribute> attributes, GLenum indexType = GL_UNSIGNED_INT)
+{
+    GeometryFormat format;
+    format.stride = sizeof(V);
+    format.attributes = attributes;
+    format.indexType = indexType;
+    return format;
+}
+
+// Attribute layout of a vertex type, specialised next to each vertex struct
+template <typename V>
+struct VertexLayout
+{
+    // Returns the format of the vertex type with an index type
+    static GeometryFormat get_format(GLenum indexType = GL_UNSIGNED_INT);
+};
+
+template <>
+inline GeometryFormat VertexLayout<PackedVertex>::get_format(GLenum indexType)
+{
+    return vertex_format<PackedVertex>({vertex_attribute(0, &PackedVertex::position, true),
+                                        vertex_attribute(1, &PackedVertex::normal, true),
+                                        vertex_attribute(2, &PackedVertex::uv)},
+                                       indexType);
+}
+
+// Packs a unit normal into 10:10:10:2 signed normalized bits
+inline PackedNormal pack_normal(glm::vec3 normal)
+{
+    return {glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f))};
+}
+
+// Unpacks a 10:10:10:2 normal
+inline glm::vec3 unpack_normal(PackedNormal normal)
+{
+    return glm::vec3(glm::unpackSnorm3x10_1x2(normal.bits));
+}
+
+// Packs two floats into half floats
+inline Half2 pack_half2(glm::vec2 value)
+{
+    uint32_t bits = glm::packHalf2x16(value);
+    return {(uint16_t)(bits & 0xFFFF), (uint16_t)(bits >> 16)};
+}
+
+// Unpacks two half floats
+inline glm::vec2 unpack_half2(Half2 value)
+{
+    return glm::unpackHalf2x16((uint32_t)value.x | ((uint32_t)value.y << 16));
+}
+
+#endif // !VERTEXLAYOUT_H
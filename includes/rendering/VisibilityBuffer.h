@@ -0,0 +1,69 @@
+#ifndef VISIBILITYBUFFER_H
+#define VISIBILITYBUFFER_H
+
+// Third-party Headers
+#include "thirdparty/glad/glad.h"
+#include "thirdparty/glm/glm.hpp"
+
+// Custom Headers
+#include "Config.h"
+#include "rendering/ClusteredLighting.h"
+#include "rendering/GeometryPool.h"
+#include "rendering/IndirectRenderer.h"
+#include "rendering/RenderGraph.h"
+#include "rendering/Shader.h"
+
+// Standard Headers
+#include <functional>
+#include <vector>
+
+// Visibility path rasterizing only the draw and triangle of each pixel, then shading every covered pixel once
+// from the shared geometry buffers, one full-screen pass per material of the indirect draws
+class VisibilityBuffer
+{
+public:
+    // Loads the id, classification and material programs, returns whether they all linked
+    bool initialise(IndirectRenderer *indirect_, ClusteredLighting *lighting_);
+    // Returns whether the path can be used, which needs the indirect draws
+    bool is_active();
+    // Sets the camera and toggles of the frame the passes are declared for
+    void set_frame(glm::mat4 view_, glm::mat4 projection_, glm::vec3 cameraPosition_, glm::vec3 background_, bool blinnPhong_, bool gamma_);
+    // Declares the id, classification and material passes, drawGeometry lays down the scene's depth and calls draw_ids,
+    // the material pass reads the shadow maps
+    void add_passes(RenderGraph *graph, std::function<void()> drawGeometry, int sceneColor, int sceneDepth, const std::vector<int> &shadowMaps, int width, int height);
+    // Writes the draw and triangle ids of the culled indirect draws, turning colour writes on for them
+    void draw_ids();
+    // Returns the number of material passes drawn last frame
+    int get_material_count();
+    // Returns the bits of each id naming the triangle last frame
+    int get_triangle_bits();
+    // Frees the programs
+    void free_data();
+
+private:
+    IndirectRenderer *indirect = NULL;          // Draws whose ids are written and whose materials are shaded
+    ClusteredLighting *lighting = NULL;         // Lights packed for the frame, shared with the forward path
+    Shader idProgram;                           // Program writing draw and triangle ids
+    Shader classifyProgram;                     // Program writing the material of each pixel as its depth
+    Shader materialProgram;                     // Program fetching a pixel's triangle and shading it
+    bool active = false;                        // Whether the programs were built
+    unsigned int VAO = 0;                       // Empty vertex array for the full-screen triangles
+    unsigned int triangleBits = 1;              // Low bits of an id naming the triangle within its draw
+    int materialCount = 0;                      // Material passes drawn last frame
+    bool warnedOverflow = false;                // Whether running out of id bits was reported
+    glm::mat4 view = glm::mat4(1.0f);           // View matrix of the frame
+    glm::mat4 projection = glm::mat4(1.0f);     // Projection matrix of the frame
+    glm::vec3 cameraPosition = glm::vec3(0.0f); // World space camera position
+    glm::vec3 background = glm::vec3(0.0f);     // Colour of pixels no geometry covers
+    bool blinnPhong = ENABLE_BLINN_PHONG;       // Whether specular uses the half vector
+    bool gamma = ENABLE_GAMMA_CORRECTION;       // Whether the material pass applies gamma
+
+    // Writes the draw group of every covered pixel into the material depth
+    void classify(unsigned int visibility);
+    // Shades the pixels of each draw group with a full-screen triangle at the group's material depth
+    void draw_materials(unsigned int visibility, int width, int height);
+    // Points an attribute uniform at the offset, type, count and normalization of a format's attribute
+    void set_attribute(const char *name, const GeometryFormat &format, int location);
+};
+
+#endif // !VISIBILITYBUFFER_H
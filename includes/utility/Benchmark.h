@@ -0,0 +1,40 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Standard Headers
+#include <string>
+#include <vector>
+
+// Frame time summary of a finished benchmark run, in milliseconds
+struct BenchmarkResult
+{
+    int frameCount = 0;   // Frames measured after the warmup
+    float average = 0.0f; // Mean frame time
+    float median = 0.0f;  // Median frame time
+    float high = 0.0f;    // Frame time only 1% of the frames exceed
+    float worst = 0.0f;   // Longest frame
+};
+
+// Times a fixed number of frames after a warmup, so render paths can be compared on the same scene
+class Benchmark
+{
+public:
+    // Starts a run measuring a number of frames after skipping the warmup frames
+    void start(int warmupFrames_, int frameCount_);
+    // Records the time of the last frame in seconds, returns whether the run still wants frames
+    bool record_frame(float frameTime);
+    // Returns whether a run is in progress
+    bool is_running();
+    // Returns the summary of the frames measured so far
+    BenchmarkResult get_result();
+    // Prints the summary of the frames measured so far under a label
+    void report(const std::string &label);
+
+private:
+    int warmupFrames = 0;          // Frames still to skip before measuring
+    int frameCount = 0;            // Frames to measure
+    bool running = false;          // Whether a run is in progress
+    std::vector<float> frameTimes; // Measured frame times in milliseconds
+};
+
+#endif // !BENCHMARK_H
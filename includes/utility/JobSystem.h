@@ -0,0 +1,45 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+// Standard Headers
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker thread pool for CPU side jobs
+class JobSystem
+{
+public:
+    // Starts the pool with a number of worker threads, 0 picks one less than the hardware threads
+    JobSystem(int threadCount = 0);
+    // Stops the pool and joins all workers
+    ~JobSystem();
+    // Returns the shared job system
+    static JobSystem &get();
+    // Queues a job to run on a worker thread
+    void submit(std::function<void()> job);
+    // Runs a function for every index in [0, count) across the workers and the calling thread
+    void parallel_for(int count, const std::function<void(int)> &func);
+    // Waits until every submitted job has finished
+    void wait();
+    // Returns the number of worker threads
+    int get_thread_count();
+
+private:
+    std::vector<std::thread> workers;         // Worker threads in the pool
+    std::deque<std::function<void()>> jobs;   // Jobs waiting for a worker
+    std::mutex queueMutex;                    // Guards the job queue
+    std::condition_variable queueCondition;   // Wakes workers when jobs arrive
+    std::condition_variable idleCondition;    // Wakes waiters when the pool goes idle
+    int activeJobs = 0;                       // Jobs queued or running
+    bool stopping = false;                    // Whether the pool is shutting down
+
+    // Main loop of a worker thread
+    void worker_loop();
+};
+
+#endif // !JOBSYSTEM_H
@@ -0,0 +1,8 @@
+#version 330 core
+
+void main()
+{
+    // One triangle covering the screen on the far plane, passing a greater test wherever geometry was drawn
+    vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    gl_Position = vec4(corner * 2.0f - 1.0f, 1.0f, 1.0f);
+}
@@ -0,0 +1,34 @@
+#version 430 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in uint aDrawId;
+
+struct DrawRecord {
+    mat4 model;
+    vec4 bounds;
+    vec4 cone;
+    vec4 positionOffset;
+    vec4 positionScale;
+    uint indexCount;
+    uint firstIndex;
+    uint baseVertex;
+    uint group;
+};
+
+layout (std430, binding = 0) readonly buffer Records {
+    DrawRecord records[];
+};
+
+// Computed exactly as the lighting pass does, so the depths it later tests for equality match bit for bit
+invariant gl_Position;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    DrawRecord record = records[aDrawId];
+    mat4 model = record.model;
+    vec3 pos = record.positionOffset.xyz + record.positionScale.xyz * aPos;
+    gl_Position = projection * view * model * vec4(pos,1.0f);
+}
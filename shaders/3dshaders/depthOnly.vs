@@ -0,0 +1,23 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 4) in mat4 aInstance;
+
+// Computed exactly as the lighting pass does, so the depths it later tests for equality match bit for bit
+invariant gl_Position;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+// Restores positions quantized to the mesh's box
+uniform vec3 positionOffset = vec3(0.0f);
+uniform vec3 positionScale = vec3(1.0f);
+// Applies the node transform of each instance when a mesh is reused by several nodes
+uniform bool instanced = false;
+
+void main()
+{
+    mat4 world = instanced ? model * aInstance : model;
+    vec3 pos = positionOffset + positionScale * aPos;
+    gl_Position = projection * view * world * vec4(pos,1.0f);
+}
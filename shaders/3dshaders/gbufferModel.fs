@@ -0,0 +1,32 @@
+#version 330 core
+
+struct Material {
+    sampler2D diffuse1;
+    sampler2D specular1;
+    float shininess;
+};
+uniform Material mat;
+
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gSpecular;
+layout (location = 3) out vec4 gAmbient;
+layout (location = 4) out float gDepth;
+layout (location = 5) out vec4 gEmission;
+
+in vec3 normal;
+in vec2 uv;
+in vec3 position;
+
+uniform mat4 view;
+
+void main()
+{
+    vec3 diffuse = vec3(texture(mat.diffuse1, uv));
+    gAlbedo = vec4(diffuse, 1.0f);
+    gNormal = vec4(normalize(normal), 0.0f);
+    gSpecular = vec4(vec3(texture(mat.specular1, uv)), mat.shininess / 256.0f);
+    gAmbient = vec4(diffuse, 1.0f);
+    gDepth = -(view * vec4(position, 1.0f)).z;
+    gEmission = vec4(0.0f);
+}
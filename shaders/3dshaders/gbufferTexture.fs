@@ -0,0 +1,44 @@
+#version 330 core
+
+struct Material {
+    sampler2DArray diffuse;
+    sampler2DArray specular;
+    sampler2DArray emission;
+    int diffuseLayer;
+    int specularLayer;
+    int emissionLayer;
+    float shininess;
+};
+uniform Material mat;
+
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gSpecular;
+layout (location = 3) out vec4 gAmbient;
+layout (location = 4) out float gDepth;
+layout (location = 5) out vec4 gEmission;
+
+in vec3 normal;
+in vec2 uv;
+in vec3 position;
+
+uniform mat4 view;
+uniform bool enableEmission;
+
+void main()
+{
+    vec3 diffuse = vec3(texture(mat.diffuse, vec3(uv, mat.diffuseLayer)));
+    vec3 specular = vec3(texture(mat.specular, vec3(uv, mat.specularLayer)));
+    gAlbedo = vec4(diffuse, 1.0f);
+    gNormal = vec4(normalize(normal), 0.0f);
+    gSpecular = vec4(specular, mat.shininess / 256.0f);
+    gAmbient = vec4(diffuse, 1.0f);
+    gDepth = -(view * vec4(position, 1.0f)).z;
+
+    // Emission lands straight in the light accumulation, which the light volumes add onto
+    gEmission = vec4(0.0f);
+    if(enableEmission && specular.x < 0.1f)
+    {
+        gEmission = vec4(vec3(texture(mat.emission, vec3(uv, mat.emissionLayer))), 0.0f);
+    }
+}
@@ -3,6 +3,10 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aUV;
+layout (location = 4) in mat4 aInstance;
+
+// Matches the depth pre-pass bit for bit, which the equal depth test relies on
+invariant gl_Position;
 
 out vec2 uv;
 out vec3 normal;
@@ -11,11 +15,18 @@ out vec3 position;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+// Restores positions quantized to the mesh's box
+uniform vec3 positionOffset = vec3(0.0f);
+uniform vec3 positionScale = vec3(1.0f);
+// Applies the node transform of each instance when a mesh is reused by several nodes
+uniform bool instanced = false;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos,1.0f);
+    mat4 world = instanced ? model * aInstance : model;
+    vec3 pos = positionOffset + positionScale * aPos;
+    gl_Position = projection * view * world * vec4(pos,1.0f);
     uv = aUV;
-    normal = mat3(transpose(inverse(model)))*aNormal;
-    position = (model * vec4(aPos,1.0f)).xyz;
+    normal = mat3(transpose(inverse(world)))*aNormal;
+    position = (world * vec4(pos,1.0f)).xyz;
 }
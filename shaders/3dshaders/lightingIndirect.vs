@@ -0,0 +1,43 @@
+#version 430 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aUV;
+layout (location = 3) in uint aDrawId;
+
+struct DrawRecord {
+    mat4 model;
+    vec4 bounds;
+    vec4 cone;
+    vec4 positionOffset;
+    vec4 positionScale;
+    uint indexCount;
+    uint firstIndex;
+    uint baseVertex;
+    uint group;
+};
+
+layout (std430, binding = 0) readonly buffer Records {
+    DrawRecord records[];
+};
+
+// Matches the depth pre-pass bit for bit, which the equal depth test relies on
+invariant gl_Position;
+
+out vec2 uv;
+out vec3 normal;
+out vec3 position;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    DrawRecord record = records[aDrawId];
+    mat4 model = record.model;
+    vec3 pos = record.positionOffset.xyz + record.positionScale.xyz * aPos;
+    gl_Position = projection * view * model * vec4(pos,1.0f);
+    uv = aUV;
+    normal = mat3(transpose(inverse(model)))*aNormal;
+    position = (model * vec4(pos,1.0f)).xyz;
+}
@@ -17,11 +17,9 @@ struct PointLight {
     float constant;
     float linear;
     float quadratic;
+
+    int shadowTile;
 };
-#define MAX_POINT_LIGHTS 5
-uniform PointLight pointLights[MAX_POINT_LIGHTS];
-uniform int pointLightCount;
-uniform bool enablePointLight;
 
 struct DirectionalLight {
     vec3 amb;
@@ -30,10 +28,6 @@ struct DirectionalLight {
 
     vec3 direction;
 };
-#define MAX_DIRECTIONAL_LIGHTS 3
-uniform DirectionalLight dirLights[MAX_DIRECTIONAL_LIGHTS];
-uniform int dirLightCount;
-uniform bool enableDirLight;
 
 struct SpotLight {
     vec3 amb;
@@ -45,11 +39,32 @@ struct SpotLight {
 
     float innerFalloff;
     float outerFalloff;
+
+    int shadowTile;
 };
-#define MAX_SPOT_LIGHTS 1
-uniform SpotLight spotLights[MAX_SPOT_LIGHTS];
-uniform int spotLightCount;
-uniform bool enableSpotLight;
+// Lights packed by the clustered lighting, LIGHT_TEXELS texels each
+#define LIGHT_TEXELS 6
+#define SPOT_LIGHT 2
+uniform samplerBuffer lightData;
+// Offset and count of each cluster's list of point and spot lights
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterIndices;
+uniform ivec3 clusterDims;
+uniform vec2 clusterTileScale;
+uniform vec2 clusterDepthParams;
+uniform float lightCutoff;
+// Directional lights reach everything and are stored after the clustered ones
+uniform int dirLightOffset;
+uniform int dirLightCount;
+// Cascaded shadow maps of the first directional lights, SHADOW_CASCADES layers each, both counts defined from Config.h on load
+uniform sampler2DArrayShadow shadowCascades;
+uniform mat4 shadowMatrices[SHADOW_LAYERS];
+uniform float shadowNormalOffsets[SHADOW_LAYERS];
+uniform float shadowSplits[SHADOW_CASCADES];
+uniform int shadowLightCount;
+// Atlas of point and spot light shadows, each tile described by SHADOW_TILE_TEXELS texels of the tile records, defined from Config.h on load
+uniform sampler2DShadow shadowAtlas;
+uniform samplerBuffer shadowTiles;
 
 out vec4 FragColor;
 
@@ -58,6 +73,7 @@ in vec2 uv;
 in vec3 position;
 
 uniform vec3 viewPos;
+uniform mat4 view;
 uniform bool enableBlinnPhong;
 uniform bool enableGamma;
 float gamma=2.2f;
@@ -66,36 +82,40 @@ vec3 get_ambient(vec3 amb);
 vec3 get_diffuse(vec3 diff,vec3 lightDir); // lightDir is point to light Direction
 vec3 get_specular(vec3 spec,vec3 lightDir, vec3 viewDirection); // lightDir is point to light Direction
 vec3 calculate_for_point_light(PointLight light, vec3 viewDirection);
-vec3 calculate_for_directional_light(DirectionalLight light, vec3 viewDirection);
+vec3 calculate_for_directional_light(DirectionalLight light, vec3 viewDirection, float shadow);
+float get_directional_shadow(int light, float viewDepth);
+float get_local_shadow(int tile, vec3 lightPos, bool point);
 vec3 calculate_for_spot_light(SpotLight light, vec3 viewDirection);
+PointLight fetch_point_light(int index);
+DirectionalLight fetch_directional_light(int index);
+SpotLight fetch_spot_light(int index);
 
 void main() 
 {
     vec3 resultant = vec3(0.0f);
     vec3 viewDirection = normalize(viewPos - position);
    
-    if(enablePointLight)
+    // Only the point and spot lights listed for this fragment's cluster can reach it
+    float viewDepth = -(view * vec4(position, 1.0f)).z;
+    int slice = int(log(max(viewDepth, 0.0001f)) * clusterDepthParams.x + clusterDepthParams.y);
+    ivec3 cluster = clamp(ivec3(ivec2(gl_FragCoord.xy * clusterTileScale), slice), ivec3(0), clusterDims - 1);
+    uvec2 lightList = texelFetch(clusterGrid, cluster.x + clusterDims.x * (cluster.y + clusterDims.y * cluster.z)).xy;
+    for(uint i=0u; i < lightList.y; i++)
     {
-        for(int i=0; i < min(MAX_POINT_LIGHTS, pointLightCount); i++)
+        int light = int(texelFetch(clusterIndices, int(lightList.x + i)).x);
+        if(int(texelFetch(lightData, light * LIGHT_TEXELS + 1).w) == SPOT_LIGHT)
         {
-            resultant += calculate_for_point_light(pointLights[i], viewDirection);
+            resultant += calculate_for_spot_light(fetch_spot_light(light), viewDirection);
         }
-    }
-    
-    if(enableDirLight)
-    {
-         for(int i=0; i < min(MAX_DIRECTIONAL_LIGHTS, dirLightCount); i++)
+        else
         {
-            resultant += calculate_for_directional_light(dirLights[i], viewDirection);
+            resultant += calculate_for_point_light(fetch_point_light(light), viewDirection);
         }
     }
 
-    if(enableSpotLight)
+    for(int i=0; i < dirLightCount; i++)
     {
-         for(int i=0; i < min(MAX_SPOT_LIGHTS, spotLightCount); i++)
-        {
-            resultant += calculate_for_spot_light(spotLights[i], viewDirection);
-        }
+        resultant += calculate_for_directional_light(fetch_directional_light(dirLightOffset + i), viewDirection, get_directional_shadow(i, viewDepth));
     }
     
     if(enableGamma)
@@ -117,6 +137,8 @@ vec3 calculate_for_point_light(PointLight light, vec3 viewDirection)
         {
             att = 1.0f / (light.constant+light.quadratic*distance*distance);
         }
+        // Shifted down so it reaches zero at the range the light was clustered with
+        att = max(att - lightCutoff, 0.0f) / (1.0f - lightCutoff);
     }
 
     vec3 ambient = get_ambient(light.amb);
@@ -126,10 +148,11 @@ vec3 calculate_for_point_light(PointLight light, vec3 viewDirection)
 
     vec3 specular = get_specular(light.spec, lightDir, viewDirection);
 
-    return att*(ambient+diffuse+specular);
+    float shadow = get_local_shadow(light.shadowTile, light.pos, true);
+    return att*(ambient+shadow*(diffuse+specular));
 }
 
-vec3 calculate_for_directional_light(DirectionalLight light, vec3 viewDirection)
+vec3 calculate_for_directional_light(DirectionalLight light, vec3 viewDirection, float shadow)
 {
     vec3 ambient = get_ambient(light.amb);
 
@@ -137,7 +160,97 @@ vec3 calculate_for_directional_light(DirectionalLight light, vec3 viewDirection)
 
     vec3 specular = get_specular(light.spec, -light.direction, viewDirection);
     
-    return (ambient+diffuse+specular);
+    return (ambient+shadow*(diffuse+specular));
+}
+
+float get_directional_shadow(int light, float viewDepth)
+{
+    if(light >= shadowLightCount || viewDepth >= shadowSplits[SHADOW_CASCADES - 1])
+    {
+        return 1.0f;
+    }
+    int cascade = 0;
+    while(viewDepth > shadowSplits[cascade])
+    {
+        cascade++;
+    }
+    int layer = light * SHADOW_CASCADES + cascade;
+
+    // Pushed out along the normal by about a texel of the cascade, so surfaces do not shadow themselves
+    vec3 offsetPosition = position + normalize(normal) * shadowNormalOffsets[layer];
+    vec3 coord = (shadowMatrices[layer] * vec4(offsetPosition, 1.0f)).xyz;
+    vec2 texelSize = 1.0f / vec2(textureSize(shadowCascades, 0).xy);
+    float lit = 0.0f;
+    for(int x = -1; x <= 1; x++)
+    {
+        for(int y = -1; y <= 1; y++)
+        {
+            lit += texture(shadowCascades, vec4(coord.xy + vec2(x, y) * texelSize, float(layer), min(coord.z, 1.0f)));
+        }
+    }
+    return lit / 9.0f;
+}
+
+float get_local_shadow(int tile, vec3 lightPos, bool point)
+{
+    if(tile < 0)
+    {
+        return 1.0f;
+    }
+    // Point lights hold a record per cube face, picked by the axis the fragment lies furthest along from the light
+    vec3 fromLight = position - lightPos;
+    if(point)
+    {
+        vec3 extent = abs(fromLight);
+        if(extent.x >= extent.y && extent.x >= extent.z)
+        {
+            tile += fromLight.x >= 0.0f ? 0 : 1;
+        }
+        else if(extent.y >= extent.z)
+        {
+            tile += fromLight.y >= 0.0f ? 2 : 3;
+        }
+        else
+        {
+            tile += fromLight.z >= 0.0f ? 4 : 5;
+        }
+    }
+    int base = tile * SHADOW_TILE_TEXELS;
+    vec4 rect = texelFetch(shadowTiles, base);
+    // Faces without space in the atlas or not drawn yet cast nothing
+    if(rect.w == 0.0f)
+    {
+        return 1.0f;
+    }
+
+    // Pushed out along the normal by about a texel of the tile at the fragment's distance, and projected with the
+    // view the tile was drawn with, which can lag behind a moving light until the tile's turn to be redrawn comes
+    vec3 offsetPosition = position + normalize(normal) * rect.w * length(fromLight);
+    mat4 matrix = mat4(texelFetch(shadowTiles, base + 1), texelFetch(shadowTiles, base + 2), texelFetch(shadowTiles, base + 3), texelFetch(shadowTiles, base + 4));
+    vec4 clip = matrix * vec4(offsetPosition, 1.0f);
+    if(clip.w <= 0.0f)
+    {
+        return 1.0f;
+    }
+    vec3 coord = clip.xyz / clip.w * 0.5f + 0.5f;
+    if(coord.z > 1.0f || any(lessThan(coord.xy, vec2(0.0f))) || any(greaterThan(coord.xy, vec2(1.0f))))
+    {
+        return 1.0f;
+    }
+    // Taps are kept inside the tile so its neighbours never bleed in
+    vec2 texelSize = 1.0f / vec2(textureSize(shadowAtlas, 0));
+    vec2 low = rect.xy + 1.5f * texelSize;
+    vec2 high = rect.xy + rect.zz - 1.5f * texelSize;
+    vec2 center = rect.xy + coord.xy * rect.zz;
+    float lit = 0.0f;
+    for(int x = -1; x <= 1; x++)
+    {
+        for(int y = -1; y <= 1; y++)
+        {
+            lit += texture(shadowAtlas, vec3(clamp(center + vec2(x, y) * texelSize, low, high), coord.z));
+        }
+    }
+    return lit / 9.0f;
 }
 
 vec3 calculate_for_spot_light(SpotLight light, vec3 viewDirection)
@@ -155,7 +268,55 @@ vec3 calculate_for_spot_light(SpotLight light, vec3 viewDirection)
 
     vec3 specular = get_specular(light.spec, lightDir, viewDirection);
     
-    return (ambient + (diffuse*intensity) + (specular*intensity));
+    float shadow = get_local_shadow(light.shadowTile, light.pos, false);
+    return (ambient + shadow*((diffuse*intensity) + (specular*intensity)));
+}
+
+PointLight fetch_point_light(int index)
+{
+    int base = index * LIGHT_TEXELS;
+    vec4 position = texelFetch(lightData, base);
+    vec4 ambient = texelFetch(lightData, base + 1);
+    vec4 diffuse = texelFetch(lightData, base + 2);
+    vec4 specular = texelFetch(lightData, base + 3);
+    PointLight light;
+    light.amb = ambient.rgb;
+    light.diff = diffuse.rgb;
+    light.spec = specular.rgb;
+    light.pos = position.xyz;
+    light.radius = diffuse.w;
+    light.constant = specular.w;
+    light.linear = texelFetch(lightData, base + 4).w;
+    light.quadratic = texelFetch(lightData, base + 5).z;
+    light.shadowTile = int(texelFetch(lightData, base + 5).w);
+    return light;
+}
+
+DirectionalLight fetch_directional_light(int index)
+{
+    int base = index * LIGHT_TEXELS;
+    DirectionalLight light;
+    light.amb = texelFetch(lightData, base + 1).rgb;
+    light.diff = texelFetch(lightData, base + 2).rgb;
+    light.spec = texelFetch(lightData, base + 3).rgb;
+    light.direction = texelFetch(lightData, base + 4).xyz;
+    return light;
+}
+
+SpotLight fetch_spot_light(int index)
+{
+    int base = index * LIGHT_TEXELS;
+    vec4 falloff = texelFetch(lightData, base + 5);
+    SpotLight light;
+    light.amb = texelFetch(lightData, base + 1).rgb;
+    light.diff = texelFetch(lightData, base + 2).rgb;
+    light.spec = texelFetch(lightData, base + 3).rgb;
+    light.direction = texelFetch(lightData, base + 4).xyz;
+    light.pos = texelFetch(lightData, base).xyz;
+    light.innerFalloff = falloff.x;
+    light.outerFalloff = falloff.y;
+    light.shadowTile = int(falloff.w);
+    return light;
 }
 
 vec3 get_ambient(vec3 amb)
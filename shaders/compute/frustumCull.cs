@@ -0,0 +1,77 @@
+#version 430 core
+
+layout (local_size_x = 64) in;
+
+struct DrawRecord {
+    mat4 model;
+    vec4 bounds;
+    vec4 cone;
+    vec4 positionOffset;
+    vec4 positionScale;
+    uint indexCount;
+    uint firstIndex;
+    uint baseVertex;
+    uint group;
+};
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Records {
+    DrawRecord records[];
+};
+layout (std430, binding = 1) writeonly buffer Commands {
+    DrawCommand commands[];
+};
+// First slot and visible count of each group
+layout (std430, binding = 2) buffer Groups {
+    uint groupSlots[];
+};
+
+uniform vec4 frustumPlanes[6];
+uniform uint recordCount;
+uniform vec3 cameraPosition;
+// Rejects clusters whose faces all point away from the camera, only valid with back face culling on
+uniform bool coneCulling;
+
+const float HALF_PI = 1.57079633f;
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= recordCount)
+        return;
+
+    DrawRecord record = records[index];
+    vec3 center = (record.model * vec4(record.bounds.xyz, 1.0f)).xyz;
+    float scale = max(length(record.model[0].xyz), max(length(record.model[1].xyz), length(record.model[2].xyz)));
+    float radius = record.bounds.w * scale;
+    for (int i = 0; i < 6; i++)
+    {
+        if (dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w < -radius)
+            return;
+    }
+
+    // Mirrored transforms flip the winding, so the cone no longer says which side is culled
+    mat3 linear = mat3(record.model);
+    if (coneCulling && record.cone.w < HALF_PI && determinant(linear) > 0.0f)
+    {
+        vec3 axis = normalize(transpose(inverse(linear)) * record.cone.xyz);
+        vec3 toCenter = center - cameraPosition;
+        float dist = length(toCenter);
+        if (dist > radius)
+        {
+            float viewAngle = acos(clamp(dot(toCenter / dist, axis), -1.0f, 1.0f));
+            if (viewAngle + record.cone.w + asin(radius / dist) < HALF_PI)
+                return;
+        }
+    }
+
+    uint slot = groupSlots[record.group * 2u] + atomicAdd(groupSlots[record.group * 2u + 1u], 1u);
+    commands[slot] = DrawCommand(record.indexCount, 1u, record.firstIndex, int(record.baseVertex), index);
+}
@@ -0,0 +1,29 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+// Summed light of every volume and the emission written by the geometry pass
+uniform sampler2D lighting;
+uniform sampler2D gDepth;
+uniform vec3 background;
+uniform bool enableGamma;
+float gamma=2.2f;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    // Pixels no geometry covered show the background, like the cleared forward target
+    if(texelFetch(gDepth, texel, 0).r <= 0.0f)
+    {
+        FragColor = vec4(background, 1.0f);
+        return;
+    }
+    vec3 resultant = texelFetch(lighting, texel, 0).rgb;
+    if(enableGamma)
+    {
+        resultant=pow(resultant,vec3(1.0f/gamma));
+    }
+    FragColor = vec4(resultant, 1.0f);
+}
@@ -0,0 +1,363 @@
+#version 330 core
+
+struct PointLight {
+    vec3 amb;
+    vec3 diff;
+    vec3 spec;
+
+    vec3 pos;
+    float radius;
+    float constant;
+    float linear;
+    float quadratic;
+
+    int shadowTile;
+};
+
+struct DirectionalLight {
+    vec3 amb;
+    vec3 diff;
+    vec3 spec;
+
+    vec3 direction;
+};
+
+struct SpotLight {
+    vec3 amb;
+    vec3 diff;
+    vec3 spec;
+
+    vec3 direction;
+    vec3 pos;
+
+    float innerFalloff;
+    float outerFalloff;
+
+    int shadowTile;
+};
+// Lights packed by the clustered lighting, LIGHT_TEXELS texels each
+#define LIGHT_TEXELS 6
+#define SPOT_LIGHT 2
+#define DIRECTIONAL_LIGHT 1
+uniform samplerBuffer lightData;
+uniform float lightCutoff;
+// Directional lights follow the clustered ones, the first of them have shadows
+uniform int dirLightOffset;
+// Cascaded shadow maps of the first directional lights, SHADOW_CASCADES layers each, both counts defined from Config.h on load
+uniform sampler2DArrayShadow shadowCascades;
+uniform mat4 shadowMatrices[SHADOW_LAYERS];
+uniform float shadowNormalOffsets[SHADOW_LAYERS];
+uniform float shadowSplits[SHADOW_CASCADES];
+uniform int shadowLightCount;
+// Atlas of point and spot light shadows, each tile described by SHADOW_TILE_TEXELS texels of the tile records, defined from Config.h on load
+uniform sampler2DShadow shadowAtlas;
+uniform samplerBuffer shadowTiles;
+
+// Surface attributes written by the geometry pass
+uniform sampler2D gAlbedo;
+uniform sampler2D gNormal;
+uniform sampler2D gSpecular;
+uniform sampler2D gAmbient;
+uniform sampler2D gDepth;
+
+out vec4 FragColor;
+
+flat in int light;
+
+uniform mat4 inverseViewProjection;
+uniform vec2 depthRange;
+uniform vec2 screenSize;
+uniform vec3 viewPos;
+uniform bool enableBlinnPhong;
+uniform bool enableGamma;
+
+// Surface of the fragment being lit, read back from the G-buffer
+vec3 position;
+vec3 normal;
+vec3 albedo;
+vec3 specularColor;
+vec3 ambientColor;
+float shininess;
+
+vec3 get_ambient(vec3 amb);
+vec3 get_diffuse(vec3 diff,vec3 lightDir); // lightDir is point to light Direction
+vec3 get_specular(vec3 spec,vec3 lightDir, vec3 viewDirection); // lightDir is point to light Direction
+vec3 calculate_for_point_light(PointLight light, vec3 viewDirection);
+vec3 calculate_for_directional_light(DirectionalLight light, vec3 viewDirection, float shadow);
+float get_directional_shadow(int light, float viewDepth);
+float get_local_shadow(int tile, vec3 lightPos, bool point);
+vec3 calculate_for_spot_light(SpotLight light, vec3 viewDirection);
+PointLight fetch_point_light(int index);
+DirectionalLight fetch_directional_light(int index);
+SpotLight fetch_spot_light(int index);
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float viewDepth = texelFetch(gDepth, texel, 0).r;
+    // Pixels no geometry covered keep the cleared depth
+    if(viewDepth <= 0.0f)
+    {
+        discard;
+    }
+
+    // Points on the near and far planes share their view depth everywhere, so the depth places the fragment
+    // along the line between them for perspective and orthographic projections alike
+    vec2 ndc = gl_FragCoord.xy / screenSize * 2.0f - 1.0f;
+    vec4 nearPoint = inverseViewProjection * vec4(ndc, -1.0f, 1.0f);
+    vec4 farPoint = inverseViewProjection * vec4(ndc, 1.0f, 1.0f);
+    position = mix(nearPoint.xyz / nearPoint.w, farPoint.xyz / farPoint.w, (viewDepth - depthRange.x) / (depthRange.y - depthRange.x));
+
+    int type = int(texelFetch(lightData, light * LIGHT_TEXELS + 1).w);
+    vec4 bounds = texelFetch(lightData, light * LIGHT_TEXELS);
+    // The volume's back faces only bound the light from behind, surfaces in front of it are dropped here
+    if(type != DIRECTIONAL_LIGHT && length(position - bounds.xyz) > bounds.w)
+    {
+        discard;
+    }
+
+    normal = normalize(texelFetch(gNormal, texel, 0).xyz);
+    albedo = texelFetch(gAlbedo, texel, 0).rgb;
+    vec4 specular = texelFetch(gSpecular, texel, 0);
+    specularColor = specular.rgb;
+    shininess = specular.a * 256.0f;
+    ambientColor = texelFetch(gAmbient, texel, 0).rgb;
+
+    vec3 viewDirection = normalize(viewPos - position);
+    vec3 resultant = vec3(0.0f);
+    if(type == SPOT_LIGHT)
+    {
+        resultant = calculate_for_spot_light(fetch_spot_light(light), viewDirection);
+    }
+    else if(type == DIRECTIONAL_LIGHT)
+    {
+        resultant = calculate_for_directional_light(fetch_directional_light(light), viewDirection, get_directional_shadow(light - dirLightOffset, viewDepth));
+    }
+    else
+    {
+        resultant = calculate_for_point_light(fetch_point_light(light), viewDirection);
+    }
+    // Lights add up in linear space, gamma is applied once when composing
+    FragColor = vec4(resultant, 0.0f);
+}
+
+vec3 calculate_for_point_light(PointLight light, vec3 viewDirection)
+{
+    float distance = length(light.pos-position);
+    float att = 1.0f;
+    if(distance > light.radius)
+    {
+        distance -= light.radius;
+        att = 1.0f / (light.constant+light.linear*distance+light.quadratic*distance*distance);
+        if(enableGamma)
+        {
+            att = 1.0f / (light.constant+light.quadratic*distance*distance);
+        }
+        // Shifted down so it reaches zero at the range the volume was sized to
+        att = max(att - lightCutoff, 0.0f) / (1.0f - lightCutoff);
+    }
+
+    vec3 ambient = get_ambient(light.amb);
+
+    vec3 lightDir = normalize(light.pos - position);
+    vec3 diffuse = get_diffuse(light.diff, lightDir);
+
+    vec3 specular = get_specular(light.spec, lightDir, viewDirection);
+
+    float shadow = get_local_shadow(light.shadowTile, light.pos, true);
+    return att*(ambient+shadow*(diffuse+specular));
+}
+
+vec3 calculate_for_directional_light(DirectionalLight light, vec3 viewDirection, float shadow)
+{
+    vec3 ambient = get_ambient(light.amb);
+
+    vec3 diffuse = get_diffuse(light.diff, -light.direction);
+
+    vec3 specular = get_specular(light.spec, -light.direction, viewDirection);
+    
+    return (ambient+shadow*(diffuse+specular));
+}
+
+float get_directional_shadow(int light, float viewDepth)
+{
+    if(light >= shadowLightCount || viewDepth >= shadowSplits[SHADOW_CASCADES - 1])
+    {
+        return 1.0f;
+    }
+    int cascade = 0;
+    while(viewDepth > shadowSplits[cascade])
+    {
+        cascade++;
+    }
+    int layer = light * SHADOW_CASCADES + cascade;
+
+    // Pushed out along the normal by about a texel of the cascade, so surfaces do not shadow themselves
+    vec3 offsetPosition = position + normalize(normal) * shadowNormalOffsets[layer];
+    vec3 coord = (shadowMatrices[layer] * vec4(offsetPosition, 1.0f)).xyz;
+    vec2 texelSize = 1.0f / vec2(textureSize(shadowCascades, 0).xy);
+    float lit = 0.0f;
+    for(int x = -1; x <= 1; x++)
+    {
+        for(int y = -1; y <= 1; y++)
+        {
+            lit += texture(shadowCascades, vec4(coord.xy + vec2(x, y) * texelSize, float(layer), min(coord.z, 1.0f)));
+        }
+    }
+    return lit / 9.0f;
+}
+
+float get_local_shadow(int tile, vec3 lightPos, bool point)
+{
+    if(tile < 0)
+    {
+        return 1.0f;
+    }
+    // Point lights hold a record per cube face, picked by the axis the fragment lies furthest along from the light
+    vec3 fromLight = position - lightPos;
+    if(point)
+    {
+        vec3 extent = abs(fromLight);
+        if(extent.x >= extent.y && extent.x >= extent.z)
+        {
+            tile += fromLight.x >= 0.0f ? 0 : 1;
+        }
+        else if(extent.y >= extent.z)
+        {
+            tile += fromLight.y >= 0.0f ? 2 : 3;
+        }
+        else
+        {
+            tile += fromLight.z >= 0.0f ? 4 : 5;
+        }
+    }
+    int base = tile * SHADOW_TILE_TEXELS;
+    vec4 rect = texelFetch(shadowTiles, base);
+    // Faces without space in the atlas or not drawn yet cast nothing
+    if(rect.w == 0.0f)
+    {
+        return 1.0f;
+    }
+
+    // Pushed out along the normal by about a texel of the tile at the fragment's distance, and projected with the
+    // view the tile was drawn with, which can lag behind a moving light until the tile's turn to be redrawn comes
+    vec3 offsetPosition = position + normalize(normal) * rect.w * length(fromLight);
+    mat4 matrix = mat4(texelFetch(shadowTiles, base + 1), texelFetch(shadowTiles, base + 2), texelFetch(shadowTiles, base + 3), texelFetch(shadowTiles, base + 4));
+    vec4 clip = matrix * vec4(offsetPosition, 1.0f);
+    if(clip.w <= 0.0f)
+    {
+        return 1.0f;
+    }
+    vec3 coord = clip.xyz / clip.w * 0.5f + 0.5f;
+    if(coord.z > 1.0f || any(lessThan(coord.xy, vec2(0.0f))) || any(greaterThan(coord.xy, vec2(1.0f))))
+    {
+        return 1.0f;
+    }
+    // Taps are kept inside the tile so its neighbours never bleed in
+    vec2 texelSize = 1.0f / vec2(textureSize(shadowAtlas, 0));
+    vec2 low = rect.xy + 1.5f * texelSize;
+    vec2 high = rect.xy + rect.zz - 1.5f * texelSize;
+    vec2 center = rect.xy + coord.xy * rect.zz;
+    float lit = 0.0f;
+    for(int x = -1; x <= 1; x++)
+    {
+        for(int y = -1; y <= 1; y++)
+        {
+            lit += texture(shadowAtlas, vec3(clamp(center + vec2(x, y) * texelSize, low, high), coord.z));
+        }
+    }
+    return lit / 9.0f;
+}
+
+vec3 calculate_for_spot_light(SpotLight light, vec3 viewDirection)
+{
+    vec3 lightDir=normalize(light.pos-position);
+
+    float theta=(dot(normalize(-light.direction),lightDir));
+    float epsilon=cos((3.14f/180.0f)*light.innerFalloff)-cos((3.14f/180.0f)*light.outerFalloff);
+    
+    float intensity=clamp(((theta-cos((3.14f/180.0f)*light.outerFalloff))/epsilon),0.0f,1.0f);
+    
+    vec3 ambient = get_ambient(light.amb);
+
+    vec3 diffuse = get_diffuse(light.diff, lightDir);
+
+    vec3 specular = get_specular(light.spec, lightDir, viewDirection);
+    
+    float shadow = get_local_shadow(light.shadowTile, light.pos, false);
+    return (ambient + shadow*((diffuse*intensity) + (specular*intensity)));
+}
+
+PointLight fetch_point_light(int index)
+{
+    int base = index * LIGHT_TEXELS;
+    vec4 position = texelFetch(lightData, base);
+    vec4 ambient = texelFetch(lightData, base + 1);
+    vec4 diffuse = texelFetch(lightData, base + 2);
+    vec4 specular = texelFetch(lightData, base + 3);
+    PointLight light;
+    light.amb = ambient.rgb;
+    light.diff = diffuse.rgb;
+    light.spec = specular.rgb;
+    light.pos = position.xyz;
+    light.radius = diffuse.w;
+    light.constant = specular.w;
+    light.linear = texelFetch(lightData, base + 4).w;
+    light.quadratic = texelFetch(lightData, base + 5).z;
+    light.shadowTile = int(texelFetch(lightData, base + 5).w);
+    return light;
+}
+
+DirectionalLight fetch_directional_light(int index)
+{
+    int base = index * LIGHT_TEXELS;
+    DirectionalLight light;
+    light.amb = texelFetch(lightData, base + 1).rgb;
+    light.diff = texelFetch(lightData, base + 2).rgb;
+    light.spec = texelFetch(lightData, base + 3).rgb;
+    light.direction = texelFetch(lightData, base + 4).xyz;
+    return light;
+}
+
+SpotLight fetch_spot_light(int index)
+{
+    int base = index * LIGHT_TEXELS;
+    vec4 falloff = texelFetch(lightData, base + 5);
+    SpotLight light;
+    light.amb = texelFetch(lightData, base + 1).rgb;
+    light.diff = texelFetch(lightData, base + 2).rgb;
+    light.spec = texelFetch(lightData, base + 3).rgb;
+    light.direction = texelFetch(lightData, base + 4).xyz;
+    light.pos = texelFetch(lightData, base).xyz;
+    light.innerFalloff = falloff.x;
+    light.outerFalloff = falloff.y;
+    light.shadowTile = int(falloff.w);
+    return light;
+}
+
+vec3 get_ambient(vec3 amb)
+{
+    return (ambientColor * amb);
+}
+
+vec3 get_diffuse(vec3 diff, vec3 lightDir)
+{
+    float diffuseFactor = max(0, dot(normal, lightDir));
+    return (albedo * diffuseFactor * diff);
+}
+
+vec3 get_specular(vec3 spec, vec3 lightDir, vec3 viewDirection)
+{
+    float specularFactor=0.0f;
+    if(enableBlinnPhong)
+    {
+        vec3 halfDir=normalize(viewDirection+lightDir);
+        specularFactor = pow(max(0, dot(normal, halfDir)), shininess*2.0f);
+    }
+    else
+    {
+        vec3 reflected = normalize(reflect(-lightDir, normal));
+        specularFactor = pow(max(0, dot(reflected, viewDirection)), shininess);
+    }
+    return (specularColor * specularFactor * spec);
+}
@@ -0,0 +1,42 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in uint aLight;
+
+// Lights packed by the clustered lighting, LIGHT_TEXELS texels each
+#define LIGHT_TEXELS 6
+#define FULL_SCREEN 0
+#define SPHERE_VOLUME 1
+#define CONE_VOLUME 2
+uniform samplerBuffer lightData;
+
+flat out int light;
+
+uniform mat4 viewProjection;
+uniform int volumeType;
+
+void main()
+{
+    light = int(aLight);
+    if(volumeType == FULL_SCREEN)
+    {
+        // One triangle covering the screen, built from the vertex index
+        vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+        gl_Position = vec4(corner * 2.0f - 1.0f, 0.0f, 1.0f);
+        return;
+    }
+
+    // Unit volumes are stretched over the light's reach, cones open along +z from their apex
+    vec4 bounds = texelFetch(lightData, light * LIGHT_TEXELS);
+    vec3 world = bounds.xyz + aPos * bounds.w;
+    if(volumeType == CONE_VOLUME)
+    {
+        vec3 axis = normalize(texelFetch(lightData, light * LIGHT_TEXELS + 4).xyz);
+        vec3 side = normalize(cross(abs(axis.y) < 0.99f ? vec3(0.0f, 1.0f, 0.0f) : vec3(1.0f, 0.0f, 0.0f), axis));
+        vec3 up = cross(axis, side);
+        float outer = radians(clamp(texelFetch(lightData, light * LIGHT_TEXELS + 5).y, 0.0f, 89.0f));
+        float spread = tan(outer) * bounds.w;
+        world = bounds.xyz + (side * aPos.x + up * aPos.y) * spread + axis * aPos.z * bounds.w;
+    }
+    gl_Position = viewProjection * vec4(world, 1.0f);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D tex;
+
+void main()
+{
+    // Bilinear filtering resamples between resolutions
+    FragColor = vec4(texture(tex, uv).rgb, 1.0f);
+}
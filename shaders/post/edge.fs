@@ -0,0 +1,25 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D tex;
+uniform float offset;
+
+// Edge kernel, rows from top to bottom
+const float kernel[9] = float[](
+    1.0f,  1.0f, 1.0f,
+    1.0f, -8.0f, 1.0f,
+    1.0f,  1.0f, 1.0f);
+
+void main()
+{
+    vec3 col = vec3(0.0f);
+    for (int i = 0; i < 9; i++)
+    {
+        vec2 tap = vec2(float(i % 3 - 1), float(1 - i / 3)) * offset;
+        col += texture(tex, uv + tap).rgb * kernel[i];
+    }
+    FragColor = vec4(col, 1.0f);
+}
@@ -0,0 +1,27 @@
+#version 330 core
+
+#define MAX_BLUR_TAPS 16
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D tex;
+uniform vec2 direction;
+uniform int tapCount;
+uniform float offsets[MAX_BLUR_TAPS];
+uniform float weights[MAX_BLUR_TAPS];
+
+// One direction of a separable gaussian, every tap after the first lands between two texels
+// so bilinear filtering fetches both with their combined weight
+void main()
+{
+    vec3 col = texture(tex, uv).rgb * weights[0];
+    for (int i = 1; i < tapCount; i++)
+    {
+        vec2 tap = direction * offsets[i];
+        col += texture(tex, uv + tap).rgb * weights[i];
+        col += texture(tex, uv - tap).rgb * weights[i];
+    }
+    FragColor = vec4(col, 1.0f);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D tex;
+
+void main()
+{
+    float luminance = dot(texture(tex, uv).rgb, vec3(0.2126f, 0.7152f, 0.0722f));
+    FragColor = vec4(vec3(luminance), 1.0f);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D tex;
+
+void main()
+{
+    FragColor = vec4(vec3(1.0f) - texture(tex, uv).rgb, 1.0f);
+}
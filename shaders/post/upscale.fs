@@ -0,0 +1,39 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D tex;
+uniform float sharpness;
+
+float luma(vec3 color)
+{
+    return dot(color, vec3(0.299f, 0.587f, 0.114f));
+}
+
+void main()
+{
+    vec2 texel = 1.0f / vec2(textureSize(tex, 0));
+    vec3 center = texture(tex, uv).rgb;
+    vec3 north = texture(tex, uv + vec2(0.0f, texel.y)).rgb;
+    vec3 south = texture(tex, uv - vec2(0.0f, texel.y)).rgb;
+    vec3 east = texture(tex, uv + vec2(texel.x, 0.0f)).rgb;
+    vec3 west = texture(tex, uv - vec2(texel.x, 0.0f)).rgb;
+
+    // Across an edge bilinear filtering smears, so two extra taps average along it instead
+    vec2 gradient = vec2(luma(east) - luma(west), luma(north) - luma(south));
+    float strength = length(gradient);
+    vec3 color = center;
+    if (strength > 0.02f)
+    {
+        vec2 along = vec2(-gradient.y, gradient.x) / strength * texel * 0.5f;
+        color = (2.0f * center + texture(tex, uv + along).rgb + texture(tex, uv - along).rgb) * 0.25f;
+    }
+
+    // Sharpening restores the contrast lost to the lower resolution, clamped to the neighbourhood so it never rings
+    vec3 low = min(center, min(min(north, south), min(east, west)));
+    vec3 high = max(center, max(max(north, south), max(east, west)));
+    vec3 sharpened = color + sharpness * (4.0f * color - north - south - east - west) * 0.25f;
+    FragColor = vec4(clamp(sharpened, low, high), 1.0f);
+}
@@ -0,0 +1,33 @@
+#version 430 core
+
+struct DrawRecord {
+    mat4 model;
+    vec4 bounds;
+    vec4 cone;
+    vec4 positionOffset;
+    vec4 positionScale;
+    uint indexCount;
+    uint firstIndex;
+    uint baseVertex;
+    uint group;
+};
+
+layout (std430, binding = 0) readonly buffer Records {
+    DrawRecord records[];
+};
+
+uniform usampler2D visibility;
+uniform uint triangleBits;
+// Depth step between materials, a power of two so every material depth is exact in the depth buffer
+uniform float materialDepthScale;
+
+void main()
+{
+    // Each covered pixel stores the depth of its draw's material, so only that material's pass reaches it
+    uint id = texelFetch(visibility, ivec2(gl_FragCoord.xy), 0).r;
+    if(id == 0u)
+    {
+        discard;
+    }
+    gl_FragDepth = float(records[(id >> triangleBits) - 1u].group + 1u) * materialDepthScale;
+}
@@ -0,0 +1,13 @@
+#version 430 core
+
+layout (location = 0) out uint visibility;
+
+flat in uint drawId;
+
+// The low bits hold the triangle within its draw, the high bits the draw record plus one so zero stays empty
+uniform uint triangleBits;
+
+void main()
+{
+    visibility = ((drawId + 1u) << triangleBits) | uint(gl_PrimitiveID);
+}
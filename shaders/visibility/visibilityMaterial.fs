@@ -0,0 +1,492 @@
+#version 430 core
+
+struct Material {
+    sampler2D diffuse1;
+    sampler2D specular1;
+    float shininess;
+};
+uniform Material mat;
+
+struct PointLight {
+    vec3 amb;
+    vec3 diff;
+    vec3 spec;
+
+    vec3 pos;
+    float radius;
+    float constant;
+    float linear;
+    float quadratic;
+
+    int shadowTile;
+};
+
+struct DirectionalLight {
+    vec3 amb;
+    vec3 diff;
+    vec3 spec;
+
+    vec3 direction;
+};
+
+struct SpotLight {
+    vec3 amb;
+    vec3 diff;
+    vec3 spec;
+
+    vec3 direction;
+    vec3 pos;
+
+    float innerFalloff;
+    float outerFalloff;
+
+    int shadowTile;
+};
+// Lights packed by the clustered lighting, LIGHT_TEXELS texels each
+#define LIGHT_TEXELS 6
+#define SPOT_LIGHT 2
+uniform samplerBuffer lightData;
+// Offset and count of each cluster's list of point and spot lights
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterIndices;
+uniform ivec3 clusterDims;
+uniform vec2 clusterTileScale;
+uniform vec2 clusterDepthParams;
+uniform float lightCutoff;
+// Directional lights reach everything and are stored after the clustered ones
+uniform int dirLightOffset;
+uniform int dirLightCount;
+// Cascaded shadow maps of the first directional lights, SHADOW_CASCADES layers each, both counts defined from Config.h on load
+uniform sampler2DArrayShadow shadowCascades;
+uniform mat4 shadowMatrices[SHADOW_LAYERS];
+uniform float shadowNormalOffsets[SHADOW_LAYERS];
+uniform float shadowSplits[SHADOW_CASCADES];
+uniform int shadowLightCount;
+// Atlas of point and spot light shadows, each tile described by SHADOW_TILE_TEXELS texels of the tile records, defined from Config.h on load
+uniform sampler2DShadow shadowAtlas;
+uniform samplerBuffer shadowTiles;
+
+out vec4 FragColor;
+
+// Surface of the pixel, interpolated from the triangle the visibility buffer names
+vec3 normal;
+vec2 uv;
+vec3 position;
+// Screen space derivatives of the uv, the full-screen pass has no neighbouring fragments to take them from
+vec2 uvDx;
+vec2 uvDy;
+
+uniform vec3 viewPos;
+uniform mat4 view;
+uniform bool enableBlinnPhong;
+uniform bool enableGamma;
+float gamma=2.2f;
+
+// Geometry of the draw records, the vertex and index buffers of the material's geometry page
+struct DrawRecord {
+    mat4 model;
+    vec4 bounds;
+    vec4 cone;
+    vec4 positionOffset;
+    vec4 positionScale;
+    uint indexCount;
+    uint firstIndex;
+    uint baseVertex;
+    uint group;
+};
+layout (std430, binding = 0) readonly buffer Records {
+    DrawRecord records[];
+};
+layout (std430, binding = 3) readonly buffer Vertices {
+    uint vertexWords[];
+};
+layout (std430, binding = 4) readonly buffer Indices {
+    uint indexWords[];
+};
+uniform usampler2D visibility;
+uniform uint triangleBits;
+uniform uint vertexStride;
+uniform bool shortIndices;
+// Byte offset, GL type, component count and normalization of each attribute in the page's format
+uniform ivec4 positionAttribute;
+uniform ivec4 normalAttribute;
+uniform ivec4 uvAttribute;
+uniform mat4 projection;
+uniform vec2 screenSize;
+
+#define TYPE_SHORT 0x1402
+#define TYPE_FLOAT 0x1406
+#define TYPE_HALF_FLOAT 0x140B
+#define TYPE_INT_2_10_10_10_REV 0x8D9F
+
+vec3 get_ambient(vec3 amb);
+vec3 get_diffuse(vec3 diff,vec3 lightDir); // lightDir is point to light Direction
+vec3 get_specular(vec3 spec,vec3 lightDir, vec3 viewDirection); // lightDir is point to light Direction
+vec3 calculate_for_point_light(PointLight light, vec3 viewDirection);
+vec3 calculate_for_directional_light(DirectionalLight light, vec3 viewDirection, float shadow);
+float get_directional_shadow(int light, float viewDepth);
+float get_local_shadow(int tile, vec3 lightPos, bool point);
+vec3 calculate_for_spot_light(SpotLight light, vec3 viewDirection);
+PointLight fetch_point_light(int index);
+DirectionalLight fetch_directional_light(int index);
+SpotLight fetch_spot_light(int index);
+uint fetch_index(uint index);
+vec4 fetch_attribute(uint vertex, ivec4 format);
+vec3 get_barycentrics(vec4 clip0, vec4 clip1, vec4 clip2, out vec3 ddx, out vec3 ddy);
+void load_surface();
+
+void main() 
+{
+    load_surface();
+
+    vec3 resultant = vec3(0.0f);
+    vec3 viewDirection = normalize(viewPos - position);
+   
+    // Only the point and spot lights listed for this fragment's cluster can reach it
+    float viewDepth = -(view * vec4(position, 1.0f)).z;
+    int slice = int(log(max(viewDepth, 0.0001f)) * clusterDepthParams.x + clusterDepthParams.y);
+    ivec3 cluster = clamp(ivec3(ivec2(gl_FragCoord.xy * clusterTileScale), slice), ivec3(0), clusterDims - 1);
+    uvec2 lightList = texelFetch(clusterGrid, cluster.x + clusterDims.x * (cluster.y + clusterDims.y * cluster.z)).xy;
+    for(uint i=0u; i < lightList.y; i++)
+    {
+        int light = int(texelFetch(clusterIndices, int(lightList.x + i)).x);
+        if(int(texelFetch(lightData, light * LIGHT_TEXELS + 1).w) == SPOT_LIGHT)
+        {
+            resultant += calculate_for_spot_light(fetch_spot_light(light), viewDirection);
+        }
+        else
+        {
+            resultant += calculate_for_point_light(fetch_point_light(light), viewDirection);
+        }
+    }
+
+    for(int i=0; i < dirLightCount; i++)
+    {
+        resultant += calculate_for_directional_light(fetch_directional_light(dirLightOffset + i), viewDirection, get_directional_shadow(i, viewDepth));
+    }
+    
+    if(enableGamma)
+    {
+        resultant=pow(resultant,vec3(1.0f/gamma));
+    }
+    FragColor = vec4(resultant.xyz, 1.0f);
+}
+
+vec3 calculate_for_point_light(PointLight light, vec3 viewDirection)
+{
+    float distance = length(light.pos-position);
+    float att = 1.0f;
+    if(distance > light.radius)
+    {
+        distance -= light.radius;
+        att = 1.0f / (light.constant+light.linear*distance+light.quadratic*distance*distance);
+        if(enableGamma)
+        {
+            att = 1.0f / (light.constant+light.quadratic*distance*distance);
+        }
+        // Shifted down so it reaches zero at the range the light was clustered with
+        att = max(att - lightCutoff, 0.0f) / (1.0f - lightCutoff);
+    }
+
+    vec3 ambient = get_ambient(light.amb);
+
+    vec3 lightDir = normalize(light.pos - position);
+    vec3 diffuse = get_diffuse(light.diff, lightDir);
+
+    vec3 specular = get_specular(light.spec, lightDir, viewDirection);
+
+    float shadow = get_local_shadow(light.shadowTile, light.pos, true);
+    return att*(ambient+shadow*(diffuse+specular));
+}
+
+vec3 calculate_for_directional_light(DirectionalLight light, vec3 viewDirection, float shadow)
+{
+    vec3 ambient = get_ambient(light.amb);
+
+    vec3 diffuse = get_diffuse(light.diff, -light.direction);
+
+    vec3 specular = get_specular(light.spec, -light.direction, viewDirection);
+    
+    return (ambient+shadow*(diffuse+specular));
+}
+
+float get_directional_shadow(int light, float viewDepth)
+{
+    if(light >= shadowLightCount || viewDepth >= shadowSplits[SHADOW_CASCADES - 1])
+    {
+        return 1.0f;
+    }
+    int cascade = 0;
+    while(viewDepth > shadowSplits[cascade])
+    {
+        cascade++;
+    }
+    int layer = light * SHADOW_CASCADES + cascade;
+
+    // Pushed out along the normal by about a texel of the cascade, so surfaces do not shadow themselves
+    vec3 offsetPosition = position + normalize(normal) * shadowNormalOffsets[layer];
+    vec3 coord = (shadowMatrices[layer] * vec4(offsetPosition, 1.0f)).xyz;
+    vec2 texelSize = 1.0f / vec2(textureSize(shadowCascades, 0).xy);
+    float lit = 0.0f;
+    for(int x = -1; x <= 1; x++)
+    {
+        for(int y = -1; y <= 1; y++)
+        {
+            lit += texture(shadowCascades, vec4(coord.xy + vec2(x, y) * texelSize, float(layer), min(coord.z, 1.0f)));
+        }
+    }
+    return lit / 9.0f;
+}
+
+float get_local_shadow(int tile, vec3 lightPos, bool point)
+{
+    if(tile < 0)
+    {
+        return 1.0f;
+    }
+    // Point lights hold a record per cube face, picked by the axis the fragment lies furthest along from the light
+    vec3 fromLight = position - lightPos;
+    if(point)
+    {
+        vec3 extent = abs(fromLight);
+        if(extent.x >= extent.y && extent.x >= extent.z)
+        {
+            tile += fromLight.x >= 0.0f ? 0 : 1;
+        }
+        else if(extent.y >= extent.z)
+        {
+            tile += fromLight.y >= 0.0f ? 2 : 3;
+        }
+        else
+        {
+            tile += fromLight.z >= 0.0f ? 4 : 5;
+        }
+    }
+    int base = tile * SHADOW_TILE_TEXELS;
+    vec4 rect = texelFetch(shadowTiles, base);
+    // Faces without space in the atlas or not drawn yet cast nothing
+    if(rect.w == 0.0f)
+    {
+        return 1.0f;
+    }
+
+    // Pushed out along the normal by about a texel of the tile at the fragment's distance, and projected with the
+    // view the tile was drawn with, which can lag behind a moving light until the tile's turn to be redrawn comes
+    vec3 offsetPosition = position + normalize(normal) * rect.w * length(fromLight);
+    mat4 matrix = mat4(texelFetch(shadowTiles, base + 1), texelFetch(shadowTiles, base + 2), texelFetch(shadowTiles, base + 3), texelFetch(shadowTiles, base + 4));
+    vec4 clip = matrix * vec4(offsetPosition, 1.0f);
+    if(clip.w <= 0.0f)
+    {
+        return 1.0f;
+    }
+    vec3 coord = clip.xyz / clip.w * 0.5f + 0.5f;
+    if(coord.z > 1.0f || any(lessThan(coord.xy, vec2(0.0f))) || any(greaterThan(coord.xy, vec2(1.0f))))
+    {
+        return 1.0f;
+    }
+    // Taps are kept inside the tile so its neighbours never bleed in
+    vec2 texelSize = 1.0f / vec2(textureSize(shadowAtlas, 0));
+    vec2 low = rect.xy + 1.5f * texelSize;
+    vec2 high = rect.xy + rect.zz - 1.5f * texelSize;
+    vec2 center = rect.xy + coord.xy * rect.zz;
+    float lit = 0.0f;
+    for(int x = -1; x <= 1; x++)
+    {
+        for(int y = -1; y <= 1; y++)
+        {
+            lit += texture(shadowAtlas, vec3(clamp(center + vec2(x, y) * texelSize, low, high), coord.z));
+        }
+    }
+    return lit / 9.0f;
+}
+
+vec3 calculate_for_spot_light(SpotLight light, vec3 viewDirection)
+{
+    vec3 lightDir=normalize(light.pos-position);
+
+    float theta=(dot(normalize(-light.direction),lightDir));
+    float epsilon=cos((3.14f/180.0f)*light.innerFalloff)-cos((3.14f/180.0f)*light.outerFalloff);
+    
+    float intensity=clamp(((theta-cos((3.14f/180.0f)*light.outerFalloff))/epsilon),0.0f,1.0f);
+    
+    vec3 ambient = get_ambient(light.amb);
+
+    vec3 diffuse = get_diffuse(light.diff, lightDir);
+
+    vec3 specular = get_specular(light.spec, lightDir, viewDirection);
+    
+    float shadow = get_local_shadow(light.shadowTile, light.pos, false);
+    return (ambient + shadow*((diffuse*intensity) + (specular*intensity)));
+}
+
+PointLight fetch_point_light(int index)
+{
+    int base = index * LIGHT_TEXELS;
+    vec4 position = texelFetch(lightData, base);
+    vec4 ambient = texelFetch(lightData, base + 1);
+    vec4 diffuse = texelFetch(lightData, base + 2);
+    vec4 specular = texelFetch(lightData, base + 3);
+    PointLight light;
+    light.amb = ambient.rgb;
+    light.diff = diffuse.rgb;
+    light.spec = specular.rgb;
+    light.pos = position.xyz;
+    light.radius = diffuse.w;
+    light.constant = specular.w;
+    light.linear = texelFetch(lightData, base + 4).w;
+    light.quadratic = texelFetch(lightData, base + 5).z;
+    light.shadowTile = int(texelFetch(lightData, base + 5).w);
+    return light;
+}
+
+DirectionalLight fetch_directional_light(int index)
+{
+    int base = index * LIGHT_TEXELS;
+    DirectionalLight light;
+    light.amb = texelFetch(lightData, base + 1).rgb;
+    light.diff = texelFetch(lightData, base + 2).rgb;
+    light.spec = texelFetch(lightData, base + 3).rgb;
+    light.direction = texelFetch(lightData, base + 4).xyz;
+    return light;
+}
+
+SpotLight fetch_spot_light(int index)
+{
+    int base = index * LIGHT_TEXELS;
+    vec4 falloff = texelFetch(lightData, base + 5);
+    SpotLight light;
+    light.amb = texelFetch(lightData, base + 1).rgb;
+    light.diff = texelFetch(lightData, base + 2).rgb;
+    light.spec = texelFetch(lightData, base + 3).rgb;
+    light.direction = texelFetch(lightData, base + 4).xyz;
+    light.pos = texelFetch(lightData, base).xyz;
+    light.innerFalloff = falloff.x;
+    light.outerFalloff = falloff.y;
+    light.shadowTile = int(falloff.w);
+    return light;
+}
+
+vec3 get_ambient(vec3 amb)
+{
+    return (vec3(textureGrad(mat.diffuse1,uv,uvDx,uvDy)) * amb);
+}
+
+vec3 get_diffuse(vec3 diff, vec3 lightDir)
+{
+    float diffuseFactor = max(0, dot(normalize(normal), lightDir));
+    return (vec3(textureGrad(mat.diffuse1,uv,uvDx,uvDy)) * diffuseFactor * diff);
+}
+
+vec3 get_specular(vec3 spec, vec3 lightDir, vec3 viewDirection)
+{
+    float specularFactor=0.0f;
+    if(enableBlinnPhong)
+    {
+        vec3 halfDir=normalize(viewDirection+lightDir);
+        specularFactor = pow(max(0, dot(normal, halfDir)), mat.shininess*2.0f);
+    }
+    else
+    {
+        vec3 reflected = normalize(reflect(-lightDir, normalize(normal)));
+        specularFactor = pow(max(0, dot(reflected, viewDirection)), mat.shininess);
+    }
+    return (vec3(textureGrad(mat.specular1,uv,uvDx,uvDy)) * specularFactor * spec);
+}
+
+void load_surface()
+{
+    // The id names the draw record and the triangle within its indices
+    uint id = texelFetch(visibility, ivec2(gl_FragCoord.xy), 0).r;
+    DrawRecord record = records[(id >> triangleBits) - 1u];
+    uint firstIndex = record.firstIndex + (id & ((1u << triangleBits) - 1u)) * 3u;
+    mat3 normalMatrix = mat3(transpose(inverse(record.model)));
+    vec3 positions[3];
+    vec3 normals[3];
+    vec2 uvs[3];
+    vec4 clips[3];
+    for(int i=0; i < 3; i++)
+    {
+        uint vertex = record.baseVertex + fetch_index(firstIndex + uint(i));
+        vec3 pos = record.positionOffset.xyz + record.positionScale.xyz * fetch_attribute(vertex, positionAttribute).xyz;
+        positions[i] = (record.model * vec4(pos, 1.0f)).xyz;
+        clips[i] = projection * view * vec4(positions[i], 1.0f);
+        normals[i] = normalMatrix * fetch_attribute(vertex, normalAttribute).xyz;
+        uvs[i] = fetch_attribute(vertex, uvAttribute).xy;
+    }
+
+    vec3 ddx, ddy;
+    vec3 weights = get_barycentrics(clips[0], clips[1], clips[2], ddx, ddy);
+    position = weights.x * positions[0] + weights.y * positions[1] + weights.z * positions[2];
+    normal = weights.x * normals[0] + weights.y * normals[1] + weights.z * normals[2];
+    uv = weights.x * uvs[0] + weights.y * uvs[1] + weights.z * uvs[2];
+    uvDx = ddx.x * uvs[0] + ddx.y * uvs[1] + ddx.z * uvs[2];
+    uvDy = ddy.x * uvs[0] + ddy.y * uvs[1] + ddy.z * uvs[2];
+}
+
+vec3 get_barycentrics(vec4 clip0, vec4 clip1, vec4 clip2, out vec3 ddx, out vec3 ddy)
+{
+    // Perspective correct weights of the pixel center, with their change one pixel right and one pixel up
+    vec3 invW = 1.0f / vec3(clip0.w, clip1.w, clip2.w);
+    vec2 ndc0 = clip0.xy * invW.x;
+    vec2 ndc1 = clip1.xy * invW.y;
+    vec2 ndc2 = clip2.xy * invW.z;
+    float invDet = 1.0f / determinant(mat2(ndc2 - ndc1, ndc0 - ndc1));
+    vec3 stepX = vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * invDet * invW;
+    vec3 stepY = vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * invDet * invW;
+    float stepXSum = dot(stepX, vec3(1.0f));
+    float stepYSum = dot(stepY, vec3(1.0f));
+
+    vec2 delta = (gl_FragCoord.xy / screenSize) * 2.0f - 1.0f - ndc0;
+    float interpInvW = invW.x + delta.x * stepXSum + delta.y * stepYSum;
+    vec3 weights = (vec3(invW.x, 0.0f, 0.0f) + delta.x * stepX + delta.y * stepY) / interpInvW;
+
+    vec2 pixel = 2.0f / screenSize;
+    stepX *= pixel.x;
+    stepY *= pixel.y;
+    ddx = (weights * interpInvW + stepX) / (interpInvW + stepXSum * pixel.x) - weights;
+    ddy = (weights * interpInvW + stepY) / (interpInvW + stepYSum * pixel.y) - weights;
+    return weights;
+}
+
+uint fetch_index(uint index)
+{
+    if(shortIndices)
+    {
+        return (indexWords[index >> 1] >> ((index & 1u) * 16u)) & 0xFFFFu;
+    }
+    return indexWords[index];
+}
+
+vec4 fetch_attribute(uint vertex, ivec4 format)
+{
+    // Decodes the formats vertices are stored in, as the vertex array would
+    uint byteOffset = vertex * vertexStride + uint(format.x);
+    bool normalized = format.w != 0;
+    if(format.y == TYPE_INT_2_10_10_10_REV)
+    {
+        int bits = int(vertexWords[byteOffset >> 2]);
+        vec4 components = vec4(bitfieldExtract(bits, 0, 10), bitfieldExtract(bits, 10, 10), bitfieldExtract(bits, 20, 10), bitfieldExtract(bits, 30, 2));
+        return normalized ? max(components / vec4(511.0f, 511.0f, 511.0f, 1.0f), -1.0f) : components;
+    }
+    vec4 value = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    for(int i=0; i < format.z; i++)
+    {
+        if(format.y == TYPE_FLOAT)
+        {
+            value[i] = uintBitsToFloat(vertexWords[(byteOffset >> 2) + uint(i)]);
+            continue;
+        }
+        uint componentOffset = byteOffset + uint(i) * 2u;
+        uint bits = vertexWords[componentOffset >> 2] >> ((componentOffset & 2u) * 8u);
+        if(format.y == TYPE_HALF_FLOAT)
+        {
+            value[i] = unpackHalf2x16(bits).x;
+        }
+        else
+        {
+            float component = float(bitfieldExtract(int(bits), 0, 16));
+            value[i] = normalized ? max(component / 32767.0f, -1.0f) : component;
+        }
+    }
+    return value;
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+// Window depth of the triangle, the material pass tests it for equality against the classified pixels
+uniform float materialDepth;
+
+void main()
+{
+    // One triangle covering the screen, built from the vertex index so no vertex buffer is needed
+    vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    gl_Position = vec4(corner * 2.0f - 1.0f, materialDepth * 2.0f - 1.0f, 1.0f);
+}
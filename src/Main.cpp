@@ -9,15 +9,30 @@
 #include "rendering/Renderer.h"
 #include "rendering/Shader.h"
 #include "rendering/Texture.h"
+#include "rendering/TextureArray.h"
+#include "rendering/GeometryPool.h"
+#include "rendering/IndirectRenderer.h"
+#include "rendering/MeshletCuller.h"
+#include "rendering/PostChain.h"
+#include "rendering/ResolutionScaler.h"
+#include "rendering/ClusteredLighting.h"
+#include "rendering/DeferredRenderer.h"
+#include "rendering/DepthPrepass.h"
+#include "rendering/VisibilityBuffer.h"
+#include "rendering/CascadedShadows.h"
+#include "rendering/ShadowAtlas.h"
+#include "utility/Benchmark.h"
 #include "utility/FileSystem.h"
 #include "object/Transform.h"
 #include "object/Actor.h"
 #include "object/Model.h"
+#include "object/StaticBatcher.h"
 #include "gui/GUI.h"
 #include "gui/Widgets.h"
 
 // Standard Headers
 #include <iostream>
+#include <random>
 #include <vector>
 
 // Renderer Data Setup
@@ -74,23 +89,27 @@ float vertices[] = {
     0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f};
 VertexArray varray;
 
-float qVertices[] = {
-    -1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-    1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-    1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-    -1.0f, -1.0f, 0.0f, 0.0f, 0.0f};
-unsigned int qIndices[] = {
-    0, 2, 1,
-    2, 0, 3};
-VertexArray qVArray;
-
 std::vector<RenderActor *> actors;
 std::vector<RenderActor> lightActors;
 std::vector<LightSource *> lights;
 bool renderScene = true;
 bool showActorUI = true;
+bool showStreamingUI = false;
 std::vector<Shader> templateShaders;
-std::vector<Texture> textures;
+TextureArrayBins textureBins;
+std::vector<TextureLayer> textureLayers;
+IndirectRenderer indirectRenderer;
+StaticBatcher staticBatcher;
+MeshletCuller meshletCuller;
+PostChain postChain;
+ResolutionScaler resolutionScaler;
+ClusteredLighting clusteredLighting;
+DeferredRenderer deferredRenderer;
+DepthPrepass depthPrepass;
+VisibilityBuffer visibilityBuffer;
+CascadedShadows cascadedShadows;
+ShadowAtlas shadowAtlas;
+Benchmark benchmark;
 
 // Application Data
 float totalTime = 0;
@@ -98,6 +117,8 @@ ImVec4 bkgColor(35.0f / 255.0f, 60.0f / 255.0f, 75.0f / 255.0f, 1.0f);
 const char *drawOptions[3] = {"Point", "Line", "Fill"};
 int drawOption = 2;
 int FPS = 0;
+float frameTime = 0.0f;
+int framesSinceUpdate = 0;
 float FPSfrequency = 3;
 float timer = 1;
 bool isPerspective = true;
@@ -110,19 +131,32 @@ bool enableDirLight = true;
 bool enableSpotLight = true;
 bool enableEmission = true;
 bool enableFaceCulling = true;
-const char *imageFilters[] = {"Normal", "Invert", "GrayScale",
-                              "Sharpen", "Blur", "Edge",
-                              "Emboss"};
-int imageFilter = 0;
-float kOffset = 0.002f;
 bool enableBlinnPhong = ENABLE_BLINN_PHONG;
 bool enableGamma = ENABLE_GAMMA_CORRECTION;
+bool enableIndirectDrawing = ENABLE_INDIRECT_DRAWING;
+int forcedLod = -1;
+bool enableWorldBatching = ENABLE_WORLD_BATCHING;
+bool enableMeshletCulling = ENABLE_MESHLETS;
+int shadingPath = ENABLE_VISIBILITY_BUFFER ? SHADING_VISIBILITY : (ENABLE_DEFERRED_SHADING ? SHADING_DEFERRED : SHADING_FORWARD);
+bool enableDepthPrepass = ENABLE_DEPTH_PREPASS;
+bool enableShadows = ENABLE_SHADOWS;
+bool enableShadowAtlas = ENABLE_SHADOW_ATLAS;
 
 // Sets the template shaders via path
 void load_template_shaders();
 void load_template_textures();
-
-int main()
+// Reports the screen size of an actor's textures to the texture streamer
+void request_texture_sizes(RenderActor *actor, glm::mat4 view, glm::mat4 projection, float viewportHeight);
+// Picks the level of detail of a model actor from its projected size, or the forced one
+void update_model_lod(ModelActor *actor, glm::mat4 view, glm::mat4 projection, float viewportHeight);
+// Sets the light and toggle uniforms shared by the lighting shaders
+void set_light_uniforms(Shader *shdr);
+// Adds small point lights of random colours scattered around the scene
+void add_random_point_lights(int count);
+// Adds a grid of textured models in front of the camera for the benchmark
+void add_benchmark_actors(int gridSize);
+
+int main(int argc, char **argv)
 {
     // Setup Renderer
     renderer.initialise_glfw();
@@ -131,7 +165,9 @@ int main()
         return -1;
     }
     renderer.setup_window_data();
-    renderer.setup_frame_buffer();
+    renderer.setup_render_graph();
+    renderer.setup_texture_streamer();
+    renderer.setup_dynamic_buffer();
     renderer.set_camera(camera);
 
     // Setup GUI
@@ -139,7 +175,20 @@ int main()
 
     // Load Data
     load_template_shaders();
+    indirectRenderer.initialise(FileSystem::get_path("shaders/3dshaders/lightingIndirect.vs").c_str(),
+                                FileSystem::get_path("shaders/3dshaders/lightingModel.fs").c_str(),
+                                FileSystem::get_path("shaders/compute/frustumCull.cs").c_str(),
+                                &renderer.dynamicBuffer);
     load_template_textures();
+    postChain.initialise();
+    clusteredLighting.initialise(&renderer.dynamicBuffer);
+    deferredRenderer.initialise(&clusteredLighting, indirectRenderer.is_active(), &renderer.dynamicBuffer);
+    depthPrepass.initialise(indirectRenderer.is_active());
+    visibilityBuffer.initialise(&indirectRenderer, &clusteredLighting);
+    cascadedShadows.initialise();
+    clusteredLighting.set_shadows(&cascadedShadows);
+    shadowAtlas.initialise(&renderer.dynamicBuffer);
+    clusteredLighting.set_shadow_atlas(&shadowAtlas);
 
     // Setup Vertex Array
     varray.generate_buffers();
@@ -152,20 +201,9 @@ int main()
     varray.unbind_vbo();
     varray.unbind_vao();
 
-    qVArray.generate_buffers();
-    qVArray.bind_vao();
-    qVArray.bind_vbo(4, 5 * sizeof(float), qVertices);
-    qVArray.bind_ebo(6, qIndices);
-    qVArray.set_attribute_array(0, 3, 5 * sizeof(float));
-    qVArray.set_attribute_array(1, 2, 5 * sizeof(float), (void *)(3 * sizeof(float)));
-    qVArray.unbind_vbo();
-    qVArray.unbind_vao();
-
     // Setup Shaders and Textures
     Shader lightshdr(FileSystem::get_path("shaders/3dshaders/3dShader.vs").c_str(),
                      FileSystem::get_path("shaders/3dshaders/colorShader.fs").c_str());
-    Shader frameShader(FileSystem::get_path("shaders/shaderFBO.vs").c_str(),
-                       FileSystem::get_path("shaders/shaderFBO.fs").c_str());
 
     // Setup Actors
     Transform transforms[] = {Transform(glm::vec3(0.0f, 0.0f, -5.0f)),
@@ -200,6 +238,24 @@ int main()
     sphere->tr.position = glm::vec3(4.0f, 0.0f, -3.0f);
     sphere->tr.scale = glm::vec3(1.5f, 1.5f, 1.5f);
     actors.push_back((RenderActor *)sphere);
+    teapot->isStatic = true;
+    plane->isStatic = true;
+    sphere->isStatic = true;
+
+    // Started with --benchmark the scene gains a grid of textured models and a fixed number of frames is timed with
+    // VSync off, GPU culling is left off so every mesh goes through Mesh::draw and its texture bindings
+    bool benchmarkMode = (argc > 1 && std::string(argv[1]) == "--benchmark");
+    if (benchmarkMode)
+    {
+        add_benchmark_actors(BENCHMARK_GRID_SIZE);
+        lockFrameRate = false;
+        enableIndirectDrawing = false;
+        benchmark.start(BENCHMARK_WARMUP_FRAMES, BENCHMARK_FRAMES);
+    }
+    if (enableWorldBatching)
+    {
+        staticBatcher.build(actors);
+    }
 
     Transform lightstr[] = {
         Transform(glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.2f)),
@@ -262,11 +318,32 @@ int main()
     {
         // New Renderer Frame
         renderer.new_frame();
+        renderer.textureStreamer.update();
+
+        // A finished benchmark prints its frame times, then runs again on the same scene with the per-draw uniform lookups
+        // the binding tables replaced, and closes the application once both are measured
+        if (benchmarkMode && benchmark.is_running() && !benchmark.record_frame(renderer.deltaTime))
+        {
+            benchmark.report(std::to_string(actors.size()) + " actors, " + (Mesh::legacyBindings ? "per-draw lookups" : "binding tables"));
+            if (!Mesh::legacyBindings)
+            {
+                Mesh::legacyBindings = true;
+                benchmark.start(BENCHMARK_WARMUP_FRAMES, BENCHMARK_FRAMES);
+            }
+            else
+            {
+                glfwSetWindowShouldClose(renderer.window, true);
+            }
+        }
 
         totalTime += renderer.deltaTime;
         timer += renderer.deltaTime;
+        framesSinceUpdate++;
         if (timer >= 1 / FPSfrequency)
         {
+            // Average frame time over the update window for comparing render paths
+            frameTime = 1000.0f * timer / framesSinceUpdate;
+            framesSinceUpdate = 0;
             timer = 0.0f;
             FPS = (int)(1 / renderer.deltaTime);
         }
@@ -355,14 +432,8 @@ int main()
             // Set Draw Mode
             renderer.set_draw_mode(drawOption);
 
-            // New Framebuffer Frame
-            renderer.frameBuffer.new_frame(currentWidth, currentHeight);
-
-            // Clear Previous Frame
-            renderer.clear_screen(bkgColor.x, bkgColor.y, bkgColor.z);
-
             // Setup Shader Uniforms
-            int pointLightCount = 0, dirLightCount = 0, spotLightCount = 0;
+            std::vector<LightSource *> activeLights;
             for (int i = 0; i < lightActors.size(); i++)
             {
                 switch (lights[i]->type)
@@ -372,13 +443,19 @@ int main()
                     ((PointLight *)lights[i])->ambient = lightActors[i].mat.ambient.color;
                     ((PointLight *)lights[i])->diffuse = lightActors[i].mat.diffuse.color;
                     ((PointLight *)lights[i])->specular = lightActors[i].mat.specular.color;
-                    pointLightCount++;
+                    if (enablePointLight)
+                    {
+                        activeLights.push_back(lights[i]);
+                    }
                     break;
                 case DIRECTIONAL_LIGHT:
                     ((DirectionalLight *)lights[i])->ambient = lightActors[i].mat.ambient.color;
                     ((DirectionalLight *)lights[i])->diffuse = lightActors[i].mat.diffuse.color;
                     ((DirectionalLight *)lights[i])->specular = lightActors[i].mat.specular.color;
-                    dirLightCount++;
+                    if (enableDirLight)
+                    {
+                        activeLights.push_back(lights[i]);
+                    }
                     break;
                 case SPOT_LIGHT:
                     ((SpotLight *)lights[i])->position = renderer.get_camera()->position;
@@ -387,136 +464,268 @@ int main()
                     ((SpotLight *)lights[i])->diffuse = lightActors[i].mat.diffuse.color;
                     ((SpotLight *)lights[i])->specular = lightActors[i].mat.specular.color;
                     lightActors[i].tr.position = renderer.get_camera()->position;
-                    spotLightCount++;
+                    if (enableSpotLight)
+                    {
+                        activeLights.push_back(lights[i]);
+                    }
                     break;
                 default:
                     break;
                 }
             }
-            set_active_texture(0);
-            for (int i = 0; i < actors.size(); i++)
+            // Declare the frame's targets, the graph allocates them when the passes using them run
+            // The scene renders at the resolution the scaler picked and the post chain upscales it to the window
+            RenderGraph *graph = &(renderer.renderGraph);
+            graph->reset();
+            int sceneWidth = resolutionScaler.get_scaled_size(renderer.frameWidth);
+            int sceneHeight = resolutionScaler.get_scaled_size(renderer.frameHeight);
+            int sceneColor = graph->create_texture("Scene Color", sceneWidth, sceneHeight, GL_RGB8);
+            int sceneDepth = graph->create_texture("Scene Depth", sceneWidth, sceneHeight, GL_DEPTH24_STENCIL8);
+            int backBuffer = graph->import_backbuffer("Back Buffer", renderer.frameWidth, renderer.frameHeight);
+
+            // The visibility path shades the indirect draws and falls back to forward without them,
+            // its id pass lays down the depth a pre-pass would
+            bool deferredShading = (shadingPath == SHADING_DEFERRED);
+            bool visibilityShading = (shadingPath == SHADING_VISIBILITY) && visibilityBuffer.is_active() && enableIndirectDrawing;
+            bool prepassed = enableDepthPrepass || visibilityShading;
+
+            // Fit the directional lights' cascades to this frame's view and place the point and spot lights' tiles,
+            // static actors merged into batches cast through their batch
+            std::vector<LightSource *> shadowedLights = enableShadows ? activeLights : std::vector<LightSource *>();
+            std::vector<RenderActor *> casterList = enableWorldBatching ? staticBatcher.get_draw_list(actors) : actors;
+            cascadedShadows.update(shadowedLights, casterList, view, projection);
+            shadowAtlas.update(enableShadowAtlas ? shadowedLights : std::vector<LightSource *>(), casterList, view, projection, (float)sceneHeight, enableGamma);
+
+            // Assign the enabled lights to the clusters of this frame's view, the deferred path only needs them packed,
+            // each light carries the tile records the atlas gave it this frame
+            clusteredLighting.update(activeLights, view, projection, sceneWidth, sceneHeight, enableGamma, !deferredShading);
+
+            // Scene Geometry, shaded directly, written to the G-buffer or only laid down as depth
+            // The first geometry pass of the frame picks the levels of detail and gathers the indirect draws,
+            // so a shading pass after the depth pre-pass draws exactly the same triangles
+            auto drawScene = [&](bool depthOnly)
             {
-                if (actors[i]->toRender)
-                {
-                    Shader *shdr = &(templateShaders[int(actors[i]->mat.shader)]);
-                    shdr->use();
-                    shdr->set_int("pointLightCount", pointLightCount);
-                    shdr->set_int("dirLightCount", dirLightCount);
-                    shdr->set_int("spotLightCount", spotLightCount);
-                    shdr->set_bool("enablePointLight", enablePointLight);
-                    shdr->set_bool("enableDirLight", enableDirLight);
-                    shdr->set_bool("enableSpotLight", enableSpotLight);
-                    shdr->set_bool("enableEmission", enableEmission);
-                    shdr->set_bool("enableBlinnPhong", enableBlinnPhong);
-                    shdr->set_bool("enableGamma", enableGamma);
-                    shdr->set_vec3("viewPos", renderer.get_camera()->position);
-                    int pLight = 0;
-                    int dLight = 0;
-                    int sLight = 0;
-                    switch (actors[i]->mat.shader)
+                bool gather = depthOnly || !prepassed;
+                if (!depthOnly)
+                {
+                    textureBins.bind_bins();
+                    clusteredLighting.bind_buffers();
+                    set_active_texture(0);
+                }
+                Shader *indirectShader = depthOnly ? depthPrepass.get_indirect_program() : deferredShading ? deferredRenderer.get_indirect_program() : &(indirectRenderer.shader);
+                bool useIndirect = enableIndirectDrawing && indirectRenderer.is_active() &&
+                                   (visibilityShading || ((!deferredShading || deferredRenderer.get_indirect_program()) && (!enableDepthPrepass || depthPrepass.get_indirect_program())));
+                if (useIndirect && gather)
+                {
+                    indirectRenderer.begin_frame();
+                }
+                // Back facing clusters may only be dropped while the rasterizer would drop their triangles too
+                meshletCuller.begin_frame(projection * view, renderer.get_camera()->position, enableFaceCulling);
+                // Static actors merged into world batches are drawn by their batch
+                std::vector<RenderActor *> drawList = enableWorldBatching ? staticBatcher.get_draw_list(actors) : actors;
+                for (int i = 0; i < drawList.size(); i++)
+                {
+                    if (drawList[i]->toRender)
                     {
-                    case COLOR_SHADER_3D:
-                        for (int i = 0; i < lightActors.size(); i++)
+                        // Models are gathered for GPU culling and drawn together after the loop
+                        if (drawList[i]->type == MODEL_ACTOR && gather)
                         {
-                            switch (lights[i]->type)
-                            {
-                            case POINT_LIGHT:
-                                shdr->set_point_light(pLight++, ((PointLight *)lights[i]));
-                                break;
-                            case DIRECTIONAL_LIGHT:
-                                shdr->set_directional_light(dLight++, ((DirectionalLight *)lights[i]));
-                                break;
-                            case SPOT_LIGHT:
-                                shdr->set_spot_light(sLight++, ((SpotLight *)lights[i]));
-                                break;
-                            default:
-                                break;
-                            }
+                            update_model_lod((ModelActor *)(drawList[i]), view, projection, (float)currentHeight);
                         }
-                        shdr->set_matrices(actors[i]->tr.get_model_matrix(), view, projection);
-                        shdr->set_material(actors[i]->mat.ambient.color, actors[i]->mat.diffuse.color,
-                                           actors[i]->mat.specular.color, actors[i]->mat.shininess);
-                        break;
-                    case TEXTURE_SHADER_3D:
-                        for (int i = 0; i < lightActors.size(); i++)
+                        if (useIndirect && drawList[i]->type == MODEL_ACTOR && drawList[i]->mat.shader == MODEL_SHADER_3D)
                         {
-                            switch (lights[i]->type)
+                            if (gather)
                             {
-                            case POINT_LIGHT:
-                                shdr->set_point_light(pLight++, ((PointLight *)lights[i]));
-                                break;
-                            case DIRECTIONAL_LIGHT:
-                                shdr->set_directional_light(dLight++, ((DirectionalLight *)lights[i]));
-                                break;
-                            case SPOT_LIGHT:
-                                shdr->set_spot_light(sLight++, ((SpotLight *)lights[i]));
-                                break;
-                            default:
-                                break;
+                                indirectRenderer.add_model(((ModelActor *)(drawList[i]))->model, drawList[i]->tr.get_model_matrix(), drawList[i]->mat.shininess, ((ModelActor *)(drawList[i]))->lod, enableMeshletCulling);
                             }
+                            if (!depthOnly)
+                            {
+                                request_texture_sizes(drawList[i], view, projection, (float)currentHeight);
+                            }
+                            continue;
                         }
-                        shdr->set_texture("mat.diffuse", &(textures[actors[i]->mat.diffuse.tex]));
-                        shdr->set_texture("mat.specular", &(textures[actors[i]->mat.specular.tex]));
-                        shdr->set_texture("mat.emission", &(textures[actors[i]->mat.emission.tex]));
-                        shdr->set_float("mat.shininess", actors[i]->mat.shininess);
-                        shdr->set_matrices(actors[i]->tr.get_model_matrix(), view, projection);
-                        break;
-                    case MODEL_SHADER_3D:
-                        for (int i = 0; i < lightActors.size(); i++)
+                        Shader *shdr = depthOnly ? depthPrepass.get_program() : deferredShading ? deferredRenderer.get_geometry_program(drawList[i]->mat.shader) : &(templateShaders[int(drawList[i]->mat.shader)]);
+                        shdr->use();
+                        if (depthOnly)
                         {
-                            switch (lights[i]->type)
+                            shdr->set_matrices(drawList[i]->tr.get_model_matrix(), view, projection);
+                        }
+                        else
+                        {
+                            set_light_uniforms(shdr);
+                            switch (drawList[i]->mat.shader)
                             {
-                            case POINT_LIGHT:
-                                shdr->set_point_light(pLight++, ((PointLight *)lights[i]));
+                            case COLOR_SHADER_3D:
+                                shdr->set_matrices(drawList[i]->tr.get_model_matrix(), view, projection);
+                                shdr->set_material(drawList[i]->mat.ambient.color, drawList[i]->mat.diffuse.color,
+                                                   drawList[i]->mat.specular.color, drawList[i]->mat.shininess);
                                 break;
-                            case DIRECTIONAL_LIGHT:
-                                shdr->set_directional_light(dLight++, ((DirectionalLight *)lights[i]));
+                            case TEXTURE_SHADER_3D:
+                                {
+                                    TextureLayer diffuseLayer = textureLayers[drawList[i]->mat.diffuse.tex];
+                                    TextureLayer specularLayer = textureLayers[drawList[i]->mat.specular.tex];
+                                    TextureLayer emissionLayer = textureLayers[drawList[i]->mat.emission.tex];
+                                    shdr->set_int("mat.diffuse", textureBins.get_unit(diffuseLayer, 0));
+                                    shdr->set_int("mat.diffuseLayer", diffuseLayer.layer);
+                                    shdr->set_int("mat.specular", textureBins.get_unit(specularLayer, 1));
+                                    shdr->set_int("mat.specularLayer", specularLayer.layer);
+                                    shdr->set_int("mat.emission", textureBins.get_unit(emissionLayer, 2));
+                                    shdr->set_int("mat.emissionLayer", emissionLayer.layer);
+                                }
+                                shdr->set_float("mat.shininess", drawList[i]->mat.shininess);
+                                shdr->set_matrices(drawList[i]->tr.get_model_matrix(), view, projection);
                                 break;
-                            case SPOT_LIGHT:
-                                shdr->set_spot_light(sLight++, ((SpotLight *)lights[i]));
+                            case MODEL_SHADER_3D:
+                                shdr->set_float("mat.shininess", drawList[i]->mat.shininess);
+                                shdr->set_matrices(drawList[i]->tr.get_model_matrix(), view, projection);
                                 break;
                             default:
                                 break;
                             }
+                            if (drawList[i]->mat.shader != COLOR_SHADER_3D)
+                            {
+                                request_texture_sizes(drawList[i], view, projection, (float)currentHeight);
+                            }
+                        }
+
+                        // Drawing Objects
+                        if (drawList[i]->type == OBJECT_ACTOR)
+                        {
+                            varray.draw_triangle(36, 0);
+                        }
+                        else if (drawList[i]->type == MODEL_ACTOR)
+                        {
+                            ((ModelActor *)(drawList[i]))->model->draw(shdr, ((ModelActor *)(drawList[i]))->lod, enableMeshletCulling ? &meshletCuller : NULL, drawList[i]->tr.get_model_matrix());
                         }
-                        shdr->set_float("mat.shininess", actors[i]->mat.shininess);
-                        shdr->set_matrices(actors[i]->tr.get_model_matrix(), view, projection);
-                        break;
-                    default:
-                        break;
                     }
-                    // Drawing Objects
-                    if (actors[i]->type == OBJECT_ACTOR)
+                }
+                if (useIndirect && indirectRenderer.get_record_count() > 0)
+                {
+                    if (gather)
                     {
-                        varray.draw_triangle(36, 0);
+                        indirectRenderer.cull(projection * view, renderer.get_camera()->position, enableFaceCulling);
+                    }
+                    if (visibilityShading)
+                    {
+                        // Models only write their ids, the material passes shade them
+                        if (depthOnly)
+                        {
+                            visibilityBuffer.draw_ids();
+                        }
+                    }
+                    else
+                    {
+                        indirectShader->use();
+                        if (!depthOnly)
+                        {
+                            set_light_uniforms(indirectShader);
+                        }
+                        indirectShader->set_mat4("view", view);
+                        indirectShader->set_mat4("projection", projection);
+                        indirectRenderer.draw(indirectShader);
                     }
-                    else if (actors[i]->type == MODEL_ACTOR)
+                }
+            };
+            // Shading draws count their fragments, and only touch the pre-pass's surfaces when it ran
+            auto drawShaded = [&]()
+            {
+                depthPrepass.begin_shading(prepassed);
+                drawScene(false);
+                depthPrepass.end_shading();
+            };
+
+            // Light Pass
+            auto drawLights = [&]()
+            {
+                lightshdr.use();
+                for (int i = 0; i < lightActors.size(); i++)
+                {
+                    if (lightActors[i].toRender)
                     {
-                        ((ModelActor *)(actors[i]))->model->draw(shdr);
+                        lightshdr.set_matrices(lightActors[i].tr.get_model_matrix(), view, projection);
+                        lightshdr.set_vec3("col", lights[i]->ambient);
+                        varray.draw_triangle(36, 0);
                     }
                 }
-            }
+            };
 
-            // Drawing Lights
-            lightshdr.use();
-            for (int i = 0; i < lightActors.size(); i++)
+            // Shadow Casters, drawn with whichever depth program the cascades or the atlas bind
+            auto drawCaster = [&](RenderActor *caster, Shader *shdr)
             {
-                if (lightActors[i].toRender)
+                shdr->set_mat4("model", caster->tr.get_model_matrix());
+                if (caster->type == OBJECT_ACTOR)
                 {
-                    lightshdr.set_matrices(lightActors[i].tr.get_model_matrix(), view, projection);
-                    lightshdr.set_vec3("col", lights[i]->ambient);
                     varray.draw_triangle(36, 0);
                 }
+                else
+                {
+                    ((ModelActor *)caster)->model->draw(shdr, ((ModelActor *)caster)->lod, NULL, caster->tr.get_model_matrix());
+                }
+            };
+
+            // Declare the passes with what they read and write, the graph orders them and culls unused ones
+            std::vector<int> shadowMaps;
+            int shadowCascades = cascadedShadows.add_pass(graph, drawCaster);
+            if (shadowCascades >= 0)
+            {
+                shadowMaps.push_back(shadowCascades);
+            }
+            int shadowTiles = shadowAtlas.add_pass(graph, drawCaster);
+            if (shadowTiles >= 0)
+            {
+                shadowMaps.push_back(shadowTiles);
+            }
+            if (enableDepthPrepass && !visibilityShading)
+            {
+                int depthPass = graph->add_pass("Depth Prepass", [&]()
+                                                {
+                                                    depthPrepass.begin_depth();
+                                                    glClear(GL_DEPTH_BUFFER_BIT);
+                                                    drawScene(true);
+                                                    depthPrepass.end_depth(); });
+                graph->write(depthPass, sceneDepth);
+            }
+            if (deferredShading)
+            {
+                deferredRenderer.set_frame(view, projection, renderer.get_camera()->position, glm::vec3(bkgColor.x, bkgColor.y, bkgColor.z), enableBlinnPhong, enableGamma);
+                deferredRenderer.add_passes(graph, drawShaded, sceneColor, sceneDepth, shadowMaps, sceneWidth, sceneHeight, enableDepthPrepass);
             }
-            // Drawing Frame Buffer
-            renderer.start_fbo_pass(1.0f, 1.0f, 1.0f);
-            renderer.set_draw_mode();
-            frameShader.use();
-            frameShader.set_texture("tex", &(renderer.frameBuffer.textureColorBuffer));
-            frameShader.set_int("cFilter", imageFilter);
-            frameShader.set_float("offset", kOffset);
-            set_active_texture(0);
-            qVArray.draw_indices(6);
+            else
+            {
+                // Actors outside the indirect draws are shaded forward over the materials, testing against the ids' depth
+                if (visibilityShading)
+                {
+                    visibilityBuffer.set_frame(view, projection, renderer.get_camera()->position, glm::vec3(bkgColor.x, bkgColor.y, bkgColor.z), enableBlinnPhong, enableGamma);
+                    visibilityBuffer.add_passes(graph, [&]()
+                                                {
+                                                    depthPrepass.begin_depth();
+                                                    drawScene(true);
+                                                    depthPrepass.end_depth(); },
+                                                sceneColor, sceneDepth, shadowMaps, sceneWidth, sceneHeight);
+                }
+                int scenePass = graph->add_pass("Scene", [&]()
+                                                {
+                                                    // Clear Previous Frame, the material pass has already cleared it on the visibility path
+                                                    glEnable(GL_DEPTH_TEST);
+                                                    if (!visibilityShading)
+                                                    {
+                                                        renderer.clear_screen(bkgColor.x, bkgColor.y, bkgColor.z, !prepassed);
+                                                    }
+                                                    drawShaded(); });
+                graph->write(scenePass, sceneColor);
+                graph->write(scenePass, sceneDepth);
+                for (int i = 0; i < shadowMaps.size(); i++)
+                {
+                    graph->read(scenePass, shadowMaps[i]);
+                }
+            }
+            int lightPass = graph->add_pass("Lights", drawLights);
+            graph->write(lightPass, sceneColor);
+            graph->write(lightPass, sceneDepth);
+            postChain.add_passes(graph, sceneColor, sceneWidth, sceneHeight, backBuffer, renderer.frameWidth, renderer.frameHeight);
+            graph->compile();
+            graph->execute();
+            resolutionScaler.update(graph->get_gpu_time());
 
             // Setup UI Windows
             if (!freeRoam)
@@ -525,12 +734,14 @@ int main()
                 {
                     show_actor_ui(&actors, &lightActors, &lights, &showActorUI);
                 }
+                if (showStreamingUI)
+                {
+                    show_texture_streaming_ui(&renderer.textureStreamer, &showStreamingUI);
+                }
                 // Scene UI
                 ImGui::Begin("Scene UI");
                 ImGui::ColorEdit3("Background Color", &bkgColor.x);
                 ImGui::Combo("RenderMode", &drawOption, &drawOptions[0], 3);
-                ImGui::Combo("Image Filter:", &imageFilter, &imageFilters[0], 7);
-                ImGui::SliderFloat("Kernel Offset", &kOffset, 0.001f, 0.02f);
                 ImGui::Checkbox("IsPerspective", &isPerspective);
                 ImGui::SliderFloat("Camera Size", &camSize, 1.0f, 10.0f);
                 ImGui::Checkbox("Enable Face Culling", &enableFaceCulling);
@@ -539,7 +750,55 @@ int main()
                 ImGui::SliderFloat("FPS Update Frequency", &FPSfrequency, 0.5f, 60.0f);
                 if (showFrameRate)
                 {
-                    ImGui::Text("%d FPS", FPS);
+                    ImGui::Text("%d FPS (%.2f ms)", FPS, frameTime);
+                    ImGui::Text("%d Render Targets (%.1f MB)", renderer.renderTargets.get_target_count(), renderer.renderTargets.get_used_bytes() / (1024.0f * 1024.0f));
+                    ImGui::Text("%d Transient Targets in %d Textures", graph->get_transient_count(), graph->get_physical_count());
+                    for (int i = 0; i < graph->get_order().size(); i++)
+                    {
+                        const RenderGraphPass &pass = graph->get_pass(graph->get_order()[i]);
+                        const RenderGraphTiming &timing = graph->get_timings().at(pass.name);
+                        ImGui::Text("  %s: %.2f ms GPU, %.2f ms CPU", pass.name.c_str(), timing.gpuTime, timing.cpuTime);
+                    }
+                }
+                ImGui::Combo("Shading Path", &shadingPath, &shadingPathNames[0], 3);
+                if (shadingPath == SHADING_VISIBILITY && !visibilityShading)
+                {
+                    ImGui::Text("Visibility Buffer Needs GPU Culling, Shading Forward");
+                }
+                ImGui::Checkbox("Depth Prepass:", &enableDepthPrepass);
+                if (visibilityShading)
+                {
+                    ImGui::Text("%d Material Passes, %d Triangle Bits per ID", visibilityBuffer.get_material_count(), visibilityBuffer.get_triangle_bits());
+                }
+                else
+                {
+                    ImGui::Text("Overdraw %.2fx Shaded Fragments per Pixel", depthPrepass.get_overdraw());
+                }
+                if (deferredShading)
+                {
+                    ImGui::Text("%d Light Volumes", deferredRenderer.get_volume_count());
+                }
+                else
+                {
+                    ImGui::Text("%d Clustered Lights, %d Indices, %d Most in a Cluster", clusteredLighting.get_clustered_count(), clusteredLighting.get_index_count(), clusteredLighting.get_max_cluster_lights());
+                }
+                if (ImGui::Button("Add Point Lights"))
+                {
+                    add_random_point_lights(CLUSTER_STRESS_LIGHTS);
+                }
+                if (renderer.textureStreamer.get_pending_count() > 0)
+                {
+                    ImGui::Text("Streaming %d Textures", renderer.textureStreamer.get_pending_count());
+                }
+                ImGui::Checkbox("Shadows:", &enableShadows);
+                if (cascadedShadows.get_light_count() > 0)
+                {
+                    ImGui::Text("%d Static Layers Redrawn, %d Layers Composited, %d Caster Draws", cascadedShadows.get_static_refresh_count(), cascadedShadows.get_composite_count(), cascadedShadows.get_caster_draw_count());
+                }
+                ImGui::Checkbox("Point and Spot Shadows:", &enableShadowAtlas);
+                if (shadowAtlas.get_light_count() > 0)
+                {
+                    ImGui::Text("%d Lights in %d Tiles, %d Tiles Redrawn, %d Waiting", shadowAtlas.get_light_count(), shadowAtlas.get_tile_count(), shadowAtlas.get_update_count(), shadowAtlas.get_pending_count());
                 }
                 ImGui::Checkbox("Enable Point Lights:", &enablePointLight);
                 ImGui::Checkbox("Enable Directional Lights:", &enableDirLight);
@@ -547,6 +806,30 @@ int main()
                 ImGui::Checkbox("Enable Emission:", &enableEmission);
                 ImGui::Checkbox("Enable Blinn Phong: ", &enableBlinnPhong);
                 ImGui::Checkbox("Enable Gamma:", &enableGamma);
+                if (indirectRenderer.is_active())
+                {
+                    ImGui::Checkbox("GPU Culling:", &enableIndirectDrawing);
+                }
+                ImGui::SliderInt("Force LOD (-1 Auto):", &forcedLod, -1, MESH_LOD_COUNT);
+                if (ImGui::Checkbox("World Batching:", &enableWorldBatching) && enableWorldBatching)
+                {
+                    staticBatcher.build(actors);
+                }
+                ImGui::Checkbox("Meshlet Culling:", &enableMeshletCulling);
+                if (enableMeshletCulling && meshletCuller.get_tested_count() > 0)
+                {
+                    ImGui::Text("%d / %d Meshlets Visible", meshletCuller.get_visible_count(), meshletCuller.get_tested_count());
+                }
+                if (enableWorldBatching)
+                {
+                    ImGui::Text("%d Static Actors in %d Batches", staticBatcher.get_batched_count(), (int)staticBatcher.batches.size());
+                    if (ImGui::Button("Rebuild Batches"))
+                    {
+                        staticBatcher.build(actors);
+                    }
+                }
+                show_resolution_ui(&resolutionScaler, &postChain, sceneWidth, sceneHeight);
+                show_post_chain_ui(&postChain, graph);
                 ImGui::End();
             }
         }
@@ -555,7 +838,7 @@ int main()
             // Clear Previous Frame
             renderer.clear_screen(DEFAULT_BACKGROUND_COLOR.x, DEFAULT_BACKGROUND_COLOR.y, DEFAULT_BACKGROUND_COLOR.z);
         }
-        show_main_menu_bar(&renderer, &renderScene, &showActorUI);
+        show_main_menu_bar(&renderer, &renderScene, &showActorUI, &showStreamingUI);
 
         // Draw UI
         gui.render_gui();
@@ -575,10 +858,25 @@ int main()
         delete actors[i];
     }
 
+    staticBatcher.free_data();
     gui.terminate_gui();
 
     lightshdr.free_data();
     varray.free_data();
+    textureBins.free_data();
+    indirectRenderer.free_data();
+    postChain.free_data();
+    clusteredLighting.free_data();
+    deferredRenderer.free_data();
+    depthPrepass.free_data();
+    visibilityBuffer.free_data();
+    cascadedShadows.free_data();
+    shadowAtlas.free_data();
+    GeometryPool::get().free_data();
+    set_texture_streamer(NULL);
+    renderer.textureStreamer.free_data();
+    renderer.dynamicBuffer.free_data();
+    renderer.free_render_graph();
     renderer.terminate_glfw();
 
     return 0;
@@ -595,9 +893,111 @@ void load_template_shaders()
 
 void load_template_textures()
 {
+    std::vector<std::string> paths;
+    std::vector<bool> gammas;
     for (int i = 0; i < LOADED_TEXTURES_COUNT; i++)
     {
-        Texture tex(FileSystem::get_path(texturePaths[i]), ((enableGamma && (texTypes[i] == "diffuse")) ? (true) : (false)));
-        textures.push_back(tex);
+        paths.push_back(FileSystem::get_path(texturePaths[i]));
+        gammas.push_back((enableGamma && (texTypes[i] == "diffuse")) ? (true) : (false));
+    }
+    textureLayers = textureBins.load_textures(paths, gammas);
+}
+
+void request_texture_sizes(RenderActor *actor, glm::mat4 view, glm::mat4 projection, float viewportHeight)
+{
+    TextureStreamer *streamer = &(renderer.textureStreamer);
+    glm::mat4 modelView = view * actor->tr.get_model_matrix();
+    float scale = glm::max(glm::max(actor->tr.scale.x, actor->tr.scale.y), actor->tr.scale.z);
+    // Template textures live fully resident in texture arrays, only model textures are streamed
+    if (actor->type == MODEL_ACTOR)
+    {
+        Model *model = ((ModelActor *)actor)->model;
+        for (int i = 0; i < model->meshes.size(); i++)
+        {
+            Mesh *mesh = &(model->meshes[i]);
+            for (int j = 0; j < model->meshNodes[i].size(); j++)
+            {
+                glm::vec4 bounds = model->get_instance_bounds(i, j);
+                glm::vec3 center = glm::vec3(modelView * glm::vec4(glm::vec3(bounds), 1.0f));
+                float size = get_screen_size(projection, center, bounds.w * scale, viewportHeight);
+                for (int k = 0; k < mesh->textures.size(); k++)
+                {
+                    streamer->request_screen_size(mesh->textures[k].id, size);
+                }
+            }
+        }
+    }
+}
+
+void update_model_lod(ModelActor *actor, glm::mat4 view, glm::mat4 projection, float viewportHeight)
+{
+    Model *model = actor->model;
+    if (forcedLod >= 0)
+    {
+        actor->lod = glm::min(forcedLod, model->get_lod_count() - 1);
+        return;
+    }
+    // The largest mesh on screen decides, so parts of one model never mix levels
+    glm::mat4 modelView = view * actor->tr.get_model_matrix();
+    float scale = glm::max(glm::max(actor->tr.scale.x, actor->tr.scale.y), actor->tr.scale.z);
+    float size = 0.0f;
+    for (int i = 0; i < model->meshes.size(); i++)
+    {
+        for (int j = 0; j < model->meshNodes[i].size(); j++)
+        {
+            glm::vec4 bounds = model->get_instance_bounds(i, j);
+            glm::vec3 center = glm::vec3(modelView * glm::vec4(glm::vec3(bounds), 1.0f));
+            size = glm::max(size, get_screen_size(projection, center, bounds.w * scale, viewportHeight));
+        }
+    }
+    actor->lod = model->select_lod(size, actor->lod);
+}
+
+void set_light_uniforms(Shader *shdr)
+{
+    shdr->set_bool("enableEmission", enableEmission);
+    shdr->set_bool("enableBlinnPhong", enableBlinnPhong);
+    shdr->set_bool("enableGamma", enableGamma);
+    shdr->set_vec3("viewPos", renderer.get_camera()->position);
+    clusteredLighting.set_uniforms(shdr);
+}
+
+void add_random_point_lights(int count)
+{
+    // Short range lights with a faint ambient term, so thousands of them stay local and do not wash out the scene
+    static std::mt19937 generator(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    int first = 1;
+    for (int i = 0; i < lights.size(); i++)
+    {
+        first += (lights[i]->type == POINT_LIGHT) ? 1 : 0;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        glm::vec3 position(-6.0f + 12.0f * unit(generator), -3.0f + 6.0f * unit(generator), -8.0f + 10.0f * unit(generator));
+        glm::vec3 color = glm::normalize(glm::vec3(unit(generator), unit(generator), unit(generator)) + 0.1f);
+        PointLight *light = new PointLight(0.05f * color, color, color, position, 0.05f, 30.0f, 0.5f, 1.0f);
+        lights.push_back((LightSource *)(light));
+
+        RenderActor rc;
+        rc.mat = Material(0.05f * color, color, color);
+        rc.tr = Transform(position, glm::vec3(0.0f), glm::vec3(0.05f));
+        rc.type = LIGHT_ACTOR;
+        rc.name = "PointLight " + std::to_string(first + i);
+        lightActors.push_back(rc);
+    }
+}
+
+void add_benchmark_actors(int gridSize)
+{
+    const char *paths[2] = {"resources/models/teapot/teapot.obj", "resources/models/sphere/sphere.obj"};
+    for (int i = 0; i < gridSize * gridSize; i++)
+    {
+        int x = i % gridSize;
+        int z = i / gridSize;
+        ModelActor *actor = new ModelActor(FileSystem::get_path(paths[i % 2]), "Benchmark " + std::to_string(i + 1), enableGamma);
+        actor->mat.shader = MODEL_SHADER_3D;
+        actor->tr.position = glm::vec3((x - (gridSize - 1) * 0.5f) * BENCHMARK_GRID_SPACING, -1.0f, -4.0f - z * BENCHMARK_GRID_SPACING);
+        actors.push_back((RenderActor *)actor);
     }
 }
@@ -1,6 +1,6 @@
 #include "gui/Widgets.h"
 
-void show_main_menu_bar(Renderer *renderer, bool *toRender, bool *showActorUI)
+void show_main_menu_bar(Renderer *renderer, bool *toRender, bool *showActorUI, bool *showStreamingUI)
 {
     if (ImGui::BeginMainMenuBar())
     {
@@ -25,6 +25,7 @@ void show_main_menu_bar(Renderer *renderer, bool *toRender, bool *showActorUI)
             if (*toRender)
             {
                 ImGui::MenuItem("Actor List", NULL, showActorUI);
+                ImGui::MenuItem("Texture Streaming", NULL, showStreamingUI);
             }
             else
             {
@@ -110,6 +111,10 @@ void show_actor_ui(std::vector<RenderActor *> *actors, std::vector<RenderActor>
             show_section_header("DATA");
             ImGui::InputText(":Name", &(actor->name[0]), 30);
             ImGui::Checkbox(":Visibility", &(actor->toRender));
+            if (actor->type == MODEL_ACTOR)
+            {
+                ImGui::Checkbox(":Static", &(actor->isStatic));
+            }
             show_section_header("TRANSFORM");
             ImGui::SliderFloat3(":Position", &(actor->tr.position.x), -10.0f, 10.0f);
             ImGui::SliderFloat3(":Rotation", &(actor->tr.rotation.x), -180.0f, 180.0f);
@@ -208,3 +213,100 @@ void show_actor_ui(std::vector<RenderActor *> *actors, std::vector<RenderActor>
     }
     ImGui::End();
 }
+
+void show_texture_streaming_ui(TextureStreamer *streamer, bool *showUI)
+{
+    ImGui::SetNextWindowSize(ImVec2(320, 180), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("TEXTURE STREAMING", showUI))
+    {
+        StreamStats stats = streamer->get_stats();
+        const float megabyte = 1024.0f * 1024.0f;
+        float budget = stats.budgetBytes / megabyte;
+        float resident = stats.residentBytes / megabyte;
+        float requested = stats.requestedBytes / megabyte;
+        char label[64];
+
+        show_section_header("Memory");
+        snprintf(label, sizeof(label), "%.1f / %.1f MB", resident, budget);
+        ImGui::Text("Resident");
+        ImGui::ProgressBar((budget > 0.0f) ? (resident / budget) : 0.0f, ImVec2(-1.0f, 0.0f), label);
+        snprintf(label, sizeof(label), "%.1f / %.1f MB", requested, budget);
+        ImGui::Text("Requested");
+        ImGui::ProgressBar((budget > 0.0f) ? (requested / budget) : 0.0f, ImVec2(-1.0f, 0.0f), label);
+        if (ImGui::SliderFloat("Budget (MB)", &budget, 1.0f, 1024.0f, "%.0f"))
+        {
+            streamer->set_memory_budget((size_t)(budget * megabyte));
+        }
+
+        show_section_header("Textures");
+        ImGui::Text("%d Streamed, %d Loading", stats.textureCount, stats.loadingCount);
+    }
+    ImGui::End();
+}
+
+void show_post_chain_ui(PostChain *chain, RenderGraph *graph)
+{
+    static const char *scaleNames[] = {"Full", "Half", "Quarter"};
+    static int newEffect = POST_BLUR;
+    show_section_header("POST PROCESSING");
+    int removed = -1;
+    for (int i = 0; i < chain->stages.size(); i++)
+    {
+        PostStage *stage = &(chain->stages[i]);
+        int effect = stage->effect;
+        int scale = (stage->scale >= 4) ? 2 : stage->scale - 1;
+        ImGui::PushID(i);
+        ImGui::Checkbox("##Enabled", &(stage->enabled));
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(100.0f);
+        if (ImGui::Combo("##Effect", &effect, postEffectNames, POST_EFFECT_COUNT))
+        {
+            stage->effect = (POST_EFFECT)effect;
+        }
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(80.0f);
+        if (ImGui::Combo("##Scale", &scale, scaleNames, 3))
+        {
+            stage->scale = 1 << scale;
+        }
+        ImGui::SameLine();
+        ImGui::Text("%.2f ms", chain->get_stage_time(graph, i));
+        ImGui::SameLine();
+        if (ImGui::SmallButton("X"))
+        {
+            removed = i;
+        }
+        ImGui::PopID();
+    }
+    if (removed >= 0)
+    {
+        chain->stages.erase(chain->stages.begin() + removed);
+    }
+    ImGui::SetNextItemWidth(100.0f);
+    ImGui::Combo("##NewEffect", &newEffect, postEffectNames, POST_EFFECT_COUNT);
+    ImGui::SameLine();
+    if (ImGui::Button("Add Stage"))
+    {
+        chain->add_stage((POST_EFFECT)newEffect);
+    }
+    ImGui::SliderFloat("Kernel Offset", &(chain->kernelOffset), 0.001f, 0.02f);
+    ImGui::SliderFloat("Blur Sigma", &(chain->blurSigma), 0.5f, 10.0f);
+}
+
+void show_resolution_ui(ResolutionScaler *scaler, PostChain *chain, int sceneWidth, int sceneHeight)
+{
+    int filter = chain->upscaleFilter;
+    show_section_header("DYNAMIC RESOLUTION");
+    ImGui::Checkbox("Dynamic Resolution", &(scaler->enabled));
+    ImGui::SliderFloat("GPU Budget (ms)", &(scaler->budget), 4.0f, 33.0f);
+    ImGui::SliderFloat("Min Scale", &(scaler->minScale), 0.25f, scaler->maxScale);
+    ImGui::Text("Scene %dx%d (%.0f%%), %.2f ms GPU", sceneWidth, sceneHeight, scaler->get_scale() * 100.0f, scaler->get_frame_time());
+    if (ImGui::Combo("Upscale Filter", &filter, postUpscaleNames, POST_UPSCALE_FILTER_COUNT))
+    {
+        chain->upscaleFilter = (POST_UPSCALE_FILTER)filter;
+    }
+    if (chain->upscaleFilter == POST_UPSCALE_EDGE)
+    {
+        ImGui::SliderFloat("Upscale Sharpness", &(chain->upscaleSharpness), 0.0f, 1.0f);
+    }
+}
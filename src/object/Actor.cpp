@@ -33,5 +33,6 @@ ModelActor::ModelActor(std::string path, std::string name_, bool gamma)
 
 ModelActor::~ModelActor()
 {
+    model->free_data();
     delete model;
 }
@@ -1,24 +1,150 @@
 #include "object/Mesh.h"
 
+bool Mesh::legacyBindings = false;
+
 Mesh::Mesh()
 {
 }
 
-Mesh::Mesh(std::vector<Vertex> vertices_, std::vector<unsigned int> indices_, std::vector<Texture> textures_)
+Mesh::Mesh(std::vector<Vertex> vertices_, std::vector<unsigned int> indices_, std::vector<Texture> textures_, std::vector<std::vector<unsigned int>> lodIndices, std::vector<Meshlet> meshlets_)
 {
     vertices = vertices_;
     indices = indices_;
     textures = textures_;
-    setup_mesh();
+    meshlets = meshlets_;
+    compute_bounds();
+    setup_mesh(lodIndices);
+    setup_bindings();
 }
 
-void Mesh::draw(Shader *shader)
+void Mesh::draw(Shader *shader, int lod)
+{
+    bind_program(shader);
+    const MeshLod &level = get_lod(lod);
+    GeometryPool::get().draw(geometry, level.firstIndex, level.indexCount);
+}
+
+void Mesh::draw_instanced(Shader *shader, int lod, unsigned int instanceBuffer, int firstInstance, int instanceCount)
+{
+    bind_program(shader);
+    int instanced = legacyBindings ? glGetUniformLocation(shader->id, "instanced") : programs[currentProgram].instanced;
+    if (instanced >= 0)
+    {
+        glUniform1i(instanced, 1);
+    }
+    const MeshLod &level = get_lod(lod);
+    GeometryPool::get().draw_instanced(geometry, level.firstIndex, level.indexCount, instanceBuffer, firstInstance, instanceCount);
+    if (instanced >= 0)
+    {
+        glUniform1i(instanced, 0);
+    }
+}
+
+void Mesh::draw_runs(Shader *shader, const std::vector<MeshLod> &runs)
+{
+    if (runs.empty())
+    {
+        return;
+    }
+    bind_program(shader);
+    std::vector<GLsizei> counts(runs.size());
+    std::vector<size_t> firstIndices(runs.size());
+    for (int i = 0; i < runs.size(); i++)
+    {
+        counts[i] = (GLsizei)runs[i].indexCount;
+        firstIndices[i] = runs[i].firstIndex;
+    }
+    GeometryPool::get().draw_multi(geometry, counts.data(), firstIndices.data(), (int)runs.size());
+}
+
+const MeshLod &Mesh::get_lod(int lod)
+{
+    return lods[glm::clamp(lod, 0, (int)lods.size() - 1)];
+}
+
+void Mesh::bind_textures(Shader *shader)
+{
+    const MeshProgram &resolved = resolve_bindings(shader);
+    for (int i = 0; i < bindings.size(); i++)
+    {
+        if (resolved.locations[i] < 0)
+        {
+            continue;
+        }
+        glActiveTexture(GL_TEXTURE0 + bindings[i].unit);
+        glBindTexture(GL_TEXTURE_2D, bindings[i].texture);
+        glUniform1i(resolved.locations[i], bindings[i].unit);
+    }
+    set_active_texture(0);
+}
+
+void Mesh::reset_position_transform(Shader *shader)
+{
+    const MeshProgram &resolved = resolve_bindings(shader);
+    glm::vec3 offset(0.0f), scale(1.0f);
+    glUniform3fv(resolved.positionOffset, 1, &offset[0]);
+    glUniform3fv(resolved.positionScale, 1, &scale[0]);
+}
+
+void Mesh::free_data()
+{
+    GeometryPool::get().release(geometry);
+    geometry = -1;
+}
+
+void Mesh::setup_mesh(const std::vector<std::vector<unsigned int>> &lodIndices)
+{
+    // Levels of detail follow the full index list in one range and reuse its vertices
+    std::vector<unsigned int> allIndices = indices;
+    lods.assign(1, {0, indices.size()});
+    for (int i = 0; i < lodIndices.size(); i++)
+    {
+        lods.push_back({allIndices.size(), lodIndices[i].size()});
+        allIndices.insert(allIndices.end(), lodIndices[i].begin(), lodIndices[i].end());
+    }
+
+    // Meshes addressable with 16 bits store half-size indices, relative to their base vertex
+    GLenum indexType = (vertices.size() <= 65536) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    std::vector<uint16_t> shortIndices;
+    const void *indexData = allIndices.data();
+    if (indexType == GL_UNSIGNED_SHORT)
+    {
+        shortIndices.assign(allIndices.begin(), allIndices.end());
+        indexData = shortIndices.data();
+    }
+
+#if ENABLE_VERTEX_QUANTIZATION
+    std::vector<PackedVertex> packed;
+    if (quantize_vertices(&packed))
+    {
+        quantized = true;
+        geometry = GeometryPool::get().allocate(VertexLayout<PackedVertex>::get_format(indexType), packed.data(), packed.size(), indexData, allIndices.size());
+        return;
+    }
+#endif
+    positionOffset = glm::vec3(0.0f);
+    positionScale = glm::vec3(1.0f);
+    geometry = GeometryPool::get().allocate(VertexLayout<Vertex>::get_format(indexType), vertices.data(), vertices.size(), indexData, allIndices.size());
+}
+
+void Mesh::compute_bounds()
+{
+    glm::vec3 minBound(0.0f), maxBound(0.0f);
+    for (int i = 0; i < vertices.size(); i++)
+    {
+        minBound = (i == 0) ? vertices[i].position : glm::min(minBound, vertices[i].position);
+        maxBound = (i == 0) ? vertices[i].position : glm::max(maxBound, vertices[i].position);
+    }
+    boundsCenter = (minBound + maxBound) * 0.5f;
+    boundsRadius = glm::length(maxBound - minBound) * 0.5f;
+}
+
+void Mesh::setup_bindings()
 {
-    shader->use();
     unsigned int diffuseNR = 1;
     unsigned int specularNR = 1;
 
-    set_active_texture(0);
+    bindings.clear();
     for (int i = 0; i < textures.size(); i++)
     {
         std::string number;
@@ -30,32 +156,129 @@ void Mesh::draw(Shader *shader)
         {
             number = std::to_string(specularNR++);
         }
+        bindings.push_back({(int)bindings.size(), textures[i].id, "mat." + textures[i].type + number});
+    }
+    if (specularNR == 1 && textures.size() > 0)
+    {
+        bindings.push_back({(int)bindings.size(), textures[0].id, "mat.specular1"});
+    }
+    programs.clear();
+    currentProgram = -1;
+}
 
-        shader->set_texture("mat." + textures[i].type + number, &(textures[i]));
+const MeshProgram &Mesh::resolve_bindings(Shader *shader)
+{
+    // Shadow casters, the depth pre-pass and the lit pass draw the same Mesh every frame, so each program keeps
+    // its own locations rather than the lookups running again on every switch
+    if (currentProgram >= 0 && programs[currentProgram].program == shader->id)
+    {
+        return programs[currentProgram];
     }
-    if (specularNR == 1)
+    for (int i = 0; i < programs.size(); i++)
     {
-        shader->set_texture("mat.specular1", &(textures[0]));
+        if (programs[i].program == shader->id)
+        {
+            currentProgram = i;
+            return programs[i];
+        }
     }
-    set_active_texture(0);
 
-    varray.draw_indices(indices.size());
+    MeshProgram resolved;
+    resolved.program = shader->id;
+    resolved.locations.resize(bindings.size());
+    for (int i = 0; i < bindings.size(); i++)
+    {
+        resolved.locations[i] = glGetUniformLocation(shader->id, bindings[i].uniform.c_str());
+    }
+    resolved.positionOffset = glGetUniformLocation(shader->id, "positionOffset");
+    resolved.positionScale = glGetUniformLocation(shader->id, "positionScale");
+    resolved.instanced = glGetUniformLocation(shader->id, "instanced");
+    programs.push_back(resolved);
+    currentProgram = (int)programs.size() - 1;
+    return programs.back();
 }
 
-void Mesh::free_data()
+void Mesh::bind_program(Shader *shader)
+{
+    shader->use();
+    if (legacyBindings)
+    {
+        bind_textures_by_name(shader);
+        shader->set_vec3("positionOffset", positionOffset);
+        shader->set_vec3("positionScale", positionScale);
+        return;
+    }
+    bind_textures(shader);
+    const MeshProgram &resolved = resolve_bindings(shader);
+    glUniform3fv(resolved.positionOffset, 1, &positionOffset[0]);
+    glUniform3fv(resolved.positionScale, 1, &positionScale[0]);
+}
+
+void Mesh::bind_textures_by_name(Shader *shader)
 {
-    varray.free_data();
+    unsigned int diffuseNR = 1;
+    unsigned int specularNR = 1;
+
+    for (int i = 0; i < textures.size(); i++)
+    {
+        std::string number;
+        if (textures[i].type == "diffuse")
+        {
+            number = std::to_string(diffuseNR++);
+        }
+        else if (textures[i].type == "specular")
+        {
+            number = std::to_string(specularNR++);
+        }
+        shader->set_texture("mat." + textures[i].type + number, &(textures[i]), i);
+    }
+    if (specularNR == 1 && textures.size() > 0)
+    {
+        shader->set_texture("mat.specular1", &(textures[0]), (int)textures.size());
+    }
+    set_active_texture(0);
 }
 
-void Mesh::setup_mesh()
+bool Mesh::quantize_vertices(std::vector<PackedVertex> *packed)
 {
-    varray.generate_buffers();
-    varray.bind_vao();
-    varray.bind_vbo(vertices.size(), sizeof(Vertex), &(vertices[0]));
-    varray.bind_ebo(indices.size(), &(indices[0]));
-    varray.set_attribute_array(0, 3, sizeof(Vertex));
-    varray.set_attribute_array(1, 3, sizeof(Vertex), (void *)(offsetof(Vertex, normal)));
-    varray.set_attribute_array(2, 2, sizeof(Vertex), (void *)(offsetof(Vertex, uv)));
-    varray.unbind_vbo();
-    varray.unbind_vao();
+    if (vertices.empty())
+    {
+        return false;
+    }
+    glm::vec3 minBound = vertices[0].position, maxBound = vertices[0].position;
+    for (int i = 1; i < vertices.size(); i++)
+    {
+        minBound = glm::min(minBound, vertices[i].position);
+        maxBound = glm::max(maxBound, vertices[i].position);
+    }
+    glm::vec3 center = (minBound + maxBound) * 0.5f;
+    glm::vec3 extent = glm::max((maxBound - minBound) * 0.5f, glm::vec3(1e-6f));
+    float positionTolerance = VERTEX_QUANTIZATION_POSITION_ERROR * glm::length(maxBound - minBound);
+
+    packed->resize(vertices.size());
+    for (int i = 0; i < vertices.size(); i++)
+    {
+        const Vertex &vertex = vertices[i];
+        PackedVertex &out = (*packed)[i];
+        glm::vec3 normalized = glm::clamp((vertex.position - center) / extent, -1.0f, 1.0f);
+        out.position = glm::i16vec4(glm::round(normalized * 32767.0f), 0.0f);
+        out.normal = pack_normal(glm::length(vertex.normal) > 0.0f ? glm::normalize(vertex.normal) : vertex.normal);
+        out.uv = pack_half2(vertex.uv);
+
+        // Decode the way the vertex shader will, rejecting the mesh if any attribute drifts too far
+        glm::vec3 position = center + extent * (glm::vec3(out.position) / 32767.0f);
+        float positionError = glm::length(position - vertex.position);
+        float normalError = glm::length(unpack_normal(out.normal) - (glm::length(vertex.normal) > 0.0f ? glm::normalize(vertex.normal) : vertex.normal));
+        glm::vec2 uvError = glm::abs(unpack_half2(out.uv) - vertex.uv);
+        if (positionError > positionTolerance || normalError > VERTEX_QUANTIZATION_NORMAL_ERROR ||
+            glm::max(uvError.x, uvError.y) > VERTEX_QUANTIZATION_UV_ERROR)
+        {
+            std::cout << "Mesh kept at full precision, quantization error above bounds" << std::endl;
+            packed->clear();
+            return false;
+        }
+    }
+    positionOffset = center;
+    positionScale = extent;
+    return true;
 }
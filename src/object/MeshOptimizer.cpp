@@ -0,0 +1,885 @@
+#include "object/MeshOptimizer.h"
+
+// Standard Headers
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <unordered_map>
+
+// Scoring constants from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static const int forsythCacheSize = 32;
+static const float forsythDecayPower = 1.5f;
+static const float forsythLastTriangleScore = 0.75f;
+static const float forsythValenceScale = 2.0f;
+static const float forsythValencePower = 0.5f;
+
+// Hashes the bytes of a vertex so bitwise identical vertices collide
+struct VertexHash
+{
+    size_t operator()(const Vertex &vertex) const
+    {
+        const unsigned char *bytes = (const unsigned char *)&vertex;
+        size_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(Vertex); i++)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+// Compares vertices bit for bit
+struct VertexEqual
+{
+    bool operator()(const Vertex &a, const Vertex &b) const
+    {
+        return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+    }
+};
+
+// Hashes the bytes of a position so vertices split by UV or normal seams collide
+struct PositionHash
+{
+    size_t operator()(const glm::vec3 &position) const
+    {
+        const unsigned char *bytes = (const unsigned char *)&position;
+        size_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(glm::vec3); i++)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+// Compares positions bit for bit
+struct PositionEqual
+{
+    bool operator()(const glm::vec3 &a, const glm::vec3 &b) const
+    {
+        return std::memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+    }
+};
+
+// Symmetric 4x4 error quadric of Garland and Heckbert, stored as its upper triangle with the summed plane weight
+struct Quadric
+{
+    double a[10] = {};   // xx, xy, xz, xd, yy, yz, yd, zz, zd, dd
+    double weight = 0.0; // Summed area of the planes, normalising the error to a distance
+
+    // Accumulates another quadric
+    void add(const Quadric &other)
+    {
+        for (int i = 0; i < 10; i++)
+        {
+            a[i] += other.a[i];
+        }
+        weight += other.weight;
+    }
+};
+
+// Adds the plane through a triangle to a quadric, weighted by the triangle's area
+static void add_triangle_plane(Quadric *quadric, glm::dvec3 normal, double d, double area)
+{
+    double plane[4] = {normal.x, normal.y, normal.z, d};
+    int k = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = i; j < 4; j++)
+        {
+            quadric->a[k++] += plane[i] * plane[j] * area;
+        }
+    }
+    quadric->weight += area;
+}
+
+// Returns the area weighted squared distance of a point to the planes of a quadric
+static double get_quadric_error(const Quadric &q, glm::dvec3 p)
+{
+    double error = q.a[0] * p.x * p.x + 2.0 * q.a[1] * p.x * p.y + 2.0 * q.a[2] * p.x * p.z + 2.0 * q.a[3] * p.x +
+                   q.a[4] * p.y * p.y + 2.0 * q.a[5] * p.y * p.z + 2.0 * q.a[6] * p.y +
+                   q.a[7] * p.z * p.z + 2.0 * q.a[8] * p.z + q.a[9];
+    return std::max(error, 0.0);
+}
+
+// Candidate collapse of one welded position onto a neighbouring one
+struct EdgeCollapse
+{
+    unsigned int from; // Position removed by the collapse
+    unsigned int to;   // Position the removed one moves onto
+    double cost;       // Quadric error of the merged position
+};
+
+// Simulates a triangle through a FIFO cache of MESH_OPTIMIZATION_CACHE_SIZE, returns its misses
+static int count_cache_misses(const std::vector<unsigned int> &indices, size_t triangle, std::vector<unsigned int> *cacheTime, unsigned int *time)
+{
+    int misses = 0;
+    for (int k = 0; k < 3; k++)
+    {
+        unsigned int v = indices[triangle * 3 + k];
+        if (*time - (*cacheTime)[v] > MESH_OPTIMIZATION_CACHE_SIZE)
+        {
+            (*cacheTime)[v] = (*time)++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+// Returns the Forsyth score of a vertex from its cache position and remaining triangles
+static float get_vertex_score(int cachePosition, int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+    {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // The last triangle's vertices score lower so the strip does not turn back on itself
+            score = forsythLastTriangleScore;
+        }
+        else
+        {
+            float scale = 1.0f / (forsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scale, forsythDecayPower);
+        }
+    }
+    return score + forsythValenceScale * std::pow((float)remainingTriangles, -forsythValencePower);
+}
+
+void MeshOptimizer::optimize(std::vector<Vertex> *vertices, std::vector<unsigned int> *indices, const std::string &name)
+{
+    if (vertices->empty() || indices->size() < 3)
+    {
+        return;
+    }
+    size_t sourceVertexCount = vertices->size();
+    MeshCacheStats before = analyze_vertex_cache(*indices, vertices->size());
+
+    weld_vertices(vertices, indices);
+    optimize_vertex_cache(indices, vertices->size());
+#if ENABLE_OVERDRAW_OPTIMIZATION
+    optimize_overdraw(*vertices, indices, MESH_OVERDRAW_THRESHOLD);
+#endif
+    optimize_vertex_fetch(vertices, indices);
+
+    MeshCacheStats after = analyze_vertex_cache(*indices, vertices->size());
+    std::cout << std::fixed << std::setprecision(3) << "Mesh " << name << ": " << sourceVertexCount << " -> " << vertices->size()
+              << " vertices, ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr
+              << std::defaultfloat << std::endl;
+}
+
+void MeshOptimizer::weld_vertices(std::vector<Vertex> *vertices, std::vector<unsigned int> *indices)
+{
+    std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+    unique.reserve(vertices->size());
+    std::vector<unsigned int> remap(vertices->size());
+    std::vector<Vertex> welded;
+    welded.reserve(vertices->size());
+    for (size_t i = 0; i < vertices->size(); i++)
+    {
+        auto inserted = unique.insert({(*vertices)[i], (unsigned int)welded.size()});
+        if (inserted.second)
+        {
+            welded.push_back((*vertices)[i]);
+        }
+        remap[i] = inserted.first->second;
+    }
+    for (size_t i = 0; i < indices->size(); i++)
+    {
+        (*indices)[i] = remap[(*indices)[i]];
+    }
+    vertices->swap(welded);
+}
+
+void MeshOptimizer::optimize_vertex_cache(std::vector<unsigned int> *indices, size_t vertexCount)
+{
+    size_t triangleCount = indices->size() / 3;
+    const std::vector<unsigned int> &source = *indices;
+
+    // Triangles using each vertex, as offsets into one adjacency array
+    std::vector<int> triangleOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+    {
+        triangleOffsets[source[i] + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        triangleOffsets[v + 1] += triangleOffsets[v];
+    }
+    std::vector<int> adjacency(triangleCount * 3);
+    std::vector<int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            adjacency[fill[source[t * 3 + k]]++] = (int)t;
+        }
+    }
+
+    std::vector<int> remaining(vertexCount);
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        remaining[v] = triangleOffsets[v + 1] - triangleOffsets[v];
+        vertexScore[v] = get_vertex_score(-1, remaining[v]);
+    }
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<char> emitted(triangleCount, 0);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        triangleScore[t] = vertexScore[source[t * 3]] + vertexScore[source[t * 3 + 1]] + vertexScore[source[t * 3 + 2]];
+    }
+
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    std::vector<unsigned int> cache, nextCache;
+    size_t scanStart = 0;
+    int best = -1;
+    while (output.size() < triangleCount * 3)
+    {
+        // Fall back to a linear scan when no cached vertex has triangles left
+        if (best < 0)
+        {
+            float bestScore = -1.0f;
+            for (size_t t = scanStart; t < triangleCount; t++)
+            {
+                if (!emitted[t] && triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = (int)t;
+                }
+            }
+            while (scanStart < triangleCount && emitted[scanStart])
+            {
+                scanStart++;
+            }
+        }
+
+        emitted[best] = 1;
+        nextCache.clear();
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = source[best * 3 + k];
+            output.push_back(v);
+            nextCache.push_back(v);
+            remaining[v]--;
+            // Drop the triangle from the vertex's list so later score updates skip it
+            int *begin = &adjacency[triangleOffsets[v]];
+            int *end = begin + remaining[v] + 1;
+            std::swap(*std::find(begin, end, best), *(end - 1));
+        }
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            unsigned int v = cache[i];
+            if (v != nextCache[0] && v != nextCache[1] && v != nextCache[2])
+            {
+                nextCache.push_back(v);
+            }
+        }
+        for (size_t i = forsythCacheSize; i < nextCache.size(); i++)
+        {
+            cachePosition[nextCache[i]] = -1;
+            vertexScore[nextCache[i]] = get_vertex_score(-1, remaining[nextCache[i]]);
+        }
+        nextCache.resize(std::min(nextCache.size(), (size_t)forsythCacheSize));
+        cache.swap(nextCache);
+
+        // Rescore the cached vertices and pick the best triangle touching them
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            cachePosition[cache[i]] = (int)i;
+            vertexScore[cache[i]] = get_vertex_score((int)i, remaining[cache[i]]);
+        }
+        best = -1;
+        float bestScore = -1.0f;
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            unsigned int v = cache[i];
+            for (int j = 0; j < remaining[v]; j++)
+            {
+                int t = adjacency[triangleOffsets[v] + j];
+                triangleScore[t] = vertexScore[source[t * 3]] + vertexScore[source[t * 3 + 1]] + vertexScore[source[t * 3 + 2]];
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+    }
+    indices->swap(output);
+}
+
+void MeshOptimizer::optimize_overdraw(const std::vector<Vertex> &vertices, std::vector<unsigned int> *indices, float threshold)
+{
+    size_t triangleCount = indices->size() / 3;
+    const std::vector<unsigned int> &source = *indices;
+
+    // Hard boundaries where the FIFO cache misses every vertex, reordering there costs nothing
+    std::vector<size_t> hardClusters;
+    std::vector<unsigned int> cacheTime(vertices.size(), 0);
+    unsigned int time = MESH_OPTIMIZATION_CACHE_SIZE + 1;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        if (t == 0 || count_cache_misses(source, t, &cacheTime, &time) == 3)
+        {
+            hardClusters.push_back(t);
+        }
+    }
+    hardClusters.push_back(triangleCount);
+
+    // Soft boundaries split a cluster once its ACMR from a cold cache is within threshold of the whole cluster's
+    std::vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hardClusters.size(); h++)
+    {
+        size_t begin = hardClusters[h], end = hardClusters[h + 1];
+        time += MESH_OPTIMIZATION_CACHE_SIZE + 1;
+        size_t clusterMisses = 0;
+        for (size_t t = begin; t < end; t++)
+        {
+            clusterMisses += count_cache_misses(source, t, &cacheTime, &time);
+        }
+        float clusterAcmr = (float)clusterMisses / (end - begin);
+
+        clusters.push_back(begin);
+        time += MESH_OPTIMIZATION_CACHE_SIZE + 1;
+        size_t start = begin, misses = 0;
+        for (size_t t = begin; t + 1 < end; t++)
+        {
+            misses += count_cache_misses(source, t, &cacheTime, &time);
+            if ((float)misses / (t - start + 1) <= threshold * clusterAcmr)
+            {
+                start = t + 1;
+                misses = 0;
+                clusters.push_back(start);
+                time += MESH_OPTIMIZATION_CACHE_SIZE + 1;
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    glm::vec3 meshCenter(0.0f);
+    for (size_t i = 0; i < source.size(); i++)
+    {
+        meshCenter += vertices[source[i]].position;
+    }
+    meshCenter /= (float)source.size();
+
+    // Clusters facing away from the mesh center are likely occluders, draw them first
+    std::vector<std::pair<float, size_t>> order(clusters.size() - 1);
+    for (size_t c = 0; c + 1 < clusters.size(); c++)
+    {
+        glm::vec3 center(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            glm::vec3 p0 = vertices[source[t * 3]].position;
+            glm::vec3 p1 = vertices[source[t * 3 + 1]].position;
+            glm::vec3 p2 = vertices[source[t * 3 + 2]].position;
+            glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+            float faceArea = glm::length(faceNormal);
+            center += (p0 + p1 + p2) * (faceArea / 3.0f);
+            normal += faceNormal;
+            area += faceArea;
+        }
+        center = (area > 0.0f) ? center / area : vertices[source[clusters[c] * 3]].position;
+        float normalLength = glm::length(normal);
+        normal = (normalLength > 0.0f) ? normal / normalLength : glm::vec3(0.0f);
+        order[c] = {-glm::dot(center - meshCenter, normal), c};
+    }
+    std::stable_sort(order.begin(), order.end());
+
+    std::vector<unsigned int> output;
+    output.reserve(source.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        size_t c = order[i].second;
+        output.insert(output.end(), source.begin() + clusters[c] * 3, source.begin() + clusters[c + 1] * 3);
+    }
+    indices->swap(output);
+}
+
+void MeshOptimizer::optimize_vertex_fetch(std::vector<Vertex> *vertices, std::vector<unsigned int> *indices)
+{
+    const unsigned int unused = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(vertices->size(), unused);
+    std::vector<Vertex> ordered;
+    ordered.reserve(vertices->size());
+    for (size_t i = 0; i < indices->size(); i++)
+    {
+        unsigned int &index = (*indices)[i];
+        if (remap[index] == unused)
+        {
+            remap[index] = (unsigned int)ordered.size();
+            ordered.push_back((*vertices)[index]);
+        }
+        index = remap[index];
+    }
+    vertices->swap(ordered);
+}
+
+MeshCacheStats MeshOptimizer::analyze_vertex_cache(const std::vector<unsigned int> &indices, size_t vertexCount, int cacheSize)
+{
+    MeshCacheStats stats;
+    if (indices.empty() || vertexCount == 0)
+    {
+        return stats;
+    }
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    size_t misses = 0;
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        if (time - cacheTime[indices[i]] > (unsigned int)cacheSize)
+        {
+            cacheTime[indices[i]] = time++;
+            misses++;
+        }
+    }
+    stats.acmr = (float)misses / (indices.size() / 3);
+    stats.atvr = (float)misses / vertexCount;
+    return stats;
+}
+
+std::vector<unsigned int> MeshOptimizer::simplify(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, size_t targetIndexCount, float *error)
+{
+    size_t vertexCount = vertices.size();
+    std::vector<unsigned int> result = indices;
+    double maxError = 0.0;
+
+    // Vertices split by seams share a welded position, collapses move whole positions
+    std::unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> unique;
+    unique.reserve(vertexCount);
+    std::vector<unsigned int> positionOf(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        positionOf[v] = unique.insert({vertices[v].position, (unsigned int)v}).first->second;
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t < result.size() / 3; t++)
+    {
+        glm::dvec3 p0 = vertices[result[t * 3]].position;
+        glm::dvec3 p1 = vertices[result[t * 3 + 1]].position;
+        glm::dvec3 p2 = vertices[result[t * 3 + 2]].position;
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double length = glm::length(normal);
+        if (length <= 0.0)
+        {
+            continue;
+        }
+        normal /= length;
+        for (int k = 0; k < 3; k++)
+        {
+            add_triangle_plane(&quadrics[positionOf[result[t * 3 + k]]], normal, -glm::dot(normal, p0), length * 0.5);
+        }
+    }
+
+    // Open borders and non-manifold edges are locked so the silhouette and holes keep their shape
+    std::unordered_map<uint64_t, int> edgeUses;
+    for (size_t t = 0; t < result.size() / 3; t++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            uint64_t a = positionOf[result[t * 3 + k]], b = positionOf[result[t * 3 + (k + 1) % 3]];
+            edgeUses[(std::min(a, b) << 32) | std::max(a, b)]++;
+        }
+    }
+    std::vector<char> locked(vertexCount, 0);
+    for (auto it = edgeUses.begin(); it != edgeUses.end(); it++)
+    {
+        if (it->second != 2)
+        {
+            locked[it->first >> 32] = 1;
+            locked[it->first & 0xffffffffull] = 1;
+        }
+    }
+
+    std::vector<int> triangleOffsets(vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<EdgeCollapse> collapses;
+    std::vector<char> touched(vertexCount);
+    std::vector<std::pair<unsigned int, unsigned int>> wedges;
+    const unsigned int noPartner = (unsigned int)-1;
+    while (result.size() > targetIndexCount)
+    {
+        size_t triangleCount = result.size() / 3;
+
+        // Triangles around each welded position, as offsets into one adjacency array
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            triangleOffsets[positionOf[result[i]] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            triangleOffsets[v + 1] += triangleOffsets[v];
+        }
+        adjacency.resize(result.size());
+        std::vector<int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            adjacency[fill[positionOf[result[i]]]++] = (unsigned int)(i / 3);
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            unsigned int from = positionOf[result[i]];
+            unsigned int to = positionOf[result[i - i % 3 + (i + 1) % 3]];
+            if (!locked[from])
+            {
+                Quadric merged = quadrics[from];
+                merged.add(quadrics[to]);
+                collapses.push_back({from, to, get_quadric_error(merged, vertices[to].position)});
+            }
+            if (!locked[to])
+            {
+                Quadric merged = quadrics[to];
+                merged.add(quadrics[from]);
+                collapses.push_back({to, from, get_quadric_error(merged, vertices[from].position)});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse &a, const EdgeCollapse &b)
+                  { return a.cost < b.cost; });
+
+        // Cheapest collapses first, each position changes at most once per pass so the adjacency stays valid
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t removeTarget = (result.size() - targetIndexCount + 2) / 3;
+        size_t removed = 0;
+        for (size_t c = 0; c < collapses.size() && removed < removeTarget; c++)
+        {
+            const EdgeCollapse &collapse = collapses[c];
+            if (touched[collapse.from] || touched[collapse.to])
+            {
+                continue;
+            }
+
+            // Every vertex at the removed position needs one partner at the kept position across a shared
+            // triangle, otherwise the collapse would smear UVs across a seam
+            wedges.clear();
+            bool valid = true;
+            for (int a = triangleOffsets[collapse.from]; a < triangleOffsets[collapse.from + 1] && valid; a++)
+            {
+                unsigned int t = adjacency[a];
+                unsigned int wedge = 0, partner = 0;
+                bool hasPartner = false;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int v = result[t * 3 + k];
+                    if (positionOf[v] == collapse.from)
+                    {
+                        wedge = v;
+                    }
+                    else if (positionOf[v] == collapse.to)
+                    {
+                        partner = v;
+                        hasPartner = true;
+                    }
+                }
+                int known = -1;
+                for (int w = 0; w < (int)wedges.size(); w++)
+                {
+                    known = (wedges[w].first == wedge) ? w : known;
+                }
+                if (known < 0)
+                {
+                    wedges.push_back({wedge, hasPartner ? partner : noPartner});
+                }
+                else if (hasPartner && wedges[known].second == noPartner)
+                {
+                    wedges[known].second = partner;
+                }
+                else if (hasPartner && wedges[known].second != partner)
+                {
+                    valid = false;
+                }
+            }
+            // Vertices split only by normals, as on flat shaded meshes, borrow the partner of one sharing their UV
+            for (int w = 0; w < (int)wedges.size() && valid; w++)
+            {
+                for (int o = 0; o < (int)wedges.size() && wedges[w].second == noPartner; o++)
+                {
+                    if (wedges[o].second != noPartner && vertices[wedges[o].first].uv == vertices[wedges[w].first].uv)
+                    {
+                        wedges[w].second = wedges[o].second;
+                    }
+                }
+                valid = wedges[w].second != noPartner;
+            }
+
+            // Reject collapses which would fold a remaining triangle over
+            glm::vec3 target = vertices[collapse.to].position;
+            for (int a = triangleOffsets[collapse.from]; a < triangleOffsets[collapse.from + 1] && valid; a++)
+            {
+                unsigned int t = adjacency[a];
+                glm::vec3 p[3], q[3];
+                bool degenerate = false;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int position = positionOf[result[t * 3 + k]];
+                    degenerate = degenerate || position == collapse.to;
+                    p[k] = vertices[result[t * 3 + k]].position;
+                    q[k] = (position == collapse.from) ? target : p[k];
+                }
+                if (degenerate)
+                {
+                    continue;
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                valid = glm::dot(before, after) > 0.25f * glm::length(before) * glm::length(after);
+            }
+            if (!valid)
+            {
+                continue;
+            }
+
+            for (int a = triangleOffsets[collapse.from]; a < triangleOffsets[collapse.from + 1]; a++)
+            {
+                unsigned int t = adjacency[a];
+                bool degenerate = false;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int &v = result[t * 3 + k];
+                    if (positionOf[v] == collapse.from)
+                    {
+                        for (int w = 0; w < (int)wedges.size(); w++)
+                        {
+                            v = (wedges[w].first == v) ? wedges[w].second : v;
+                        }
+                    }
+                    else
+                    {
+                        degenerate = degenerate || positionOf[v] == collapse.to;
+                        touched[positionOf[v]] = 1;
+                    }
+                }
+                removed += degenerate ? 1 : 0;
+            }
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            touched[collapse.from] = 1;
+            touched[collapse.to] = 1;
+            double weight = std::max(quadrics[collapse.to].weight, 1e-12);
+            maxError = std::max(maxError, collapse.cost / weight);
+        }
+        if (removed == 0)
+        {
+            break;
+        }
+
+        // Drop the triangles folded to a line by the collapses
+        size_t kept = 0;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            unsigned int a = positionOf[result[t * 3]], b = positionOf[result[t * 3 + 1]], c = positionOf[result[t * 3 + 2]];
+            if (a == b || b == c || a == c)
+            {
+                continue;
+            }
+            for (int k = 0; k < 3; k++)
+            {
+                result[kept * 3 + k] = result[t * 3 + k];
+            }
+            kept++;
+        }
+        result.resize(kept * 3);
+    }
+
+    if (error)
+    {
+        *error = (float)std::sqrt(maxError);
+    }
+    return result;
+}
+
+std::vector<std::vector<unsigned int>> MeshOptimizer::build_lods(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const std::string &name)
+{
+    std::vector<std::vector<unsigned int>> lods;
+    size_t previousCount = indices.size();
+    float ratio = 1.0f;
+    for (int level = 1; level <= MESH_LOD_COUNT; level++)
+    {
+        ratio *= MESH_LOD_RATIO;
+        size_t target = (size_t)(indices.size() / 3 * ratio) * 3;
+        float error = 0.0f;
+        std::vector<unsigned int> lod = simplify(vertices, indices, target, &error);
+
+        // Stop once locked borders and seams leave too little to remove for another level to pay off
+        if (lod.size() < 3 || lod.size() > previousCount * MESH_LOD_MIN_REDUCTION)
+        {
+            break;
+        }
+        optimize_vertex_cache(&lod, vertices.size());
+        std::cout << std::fixed << std::setprecision(4) << "Mesh " << name << " LOD " << level << ": " << indices.size() / 3 << " -> "
+                  << lod.size() / 3 << " triangles, error " << error << std::defaultfloat << std::endl;
+        previousCount = lod.size();
+        lods.push_back(lod);
+    }
+    return lods;
+}
+
+std::vector<Meshlet> MeshOptimizer::build_meshlets(const std::vector<Vertex> &vertices, std::vector<unsigned int> *indices)
+{
+    size_t triangleCount = indices->size() / 3;
+    const std::vector<unsigned int> &source = *indices;
+
+    // Triangles using each vertex, as offsets into one adjacency array
+    std::vector<int> triangleOffsets(vertices.size() + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+    {
+        triangleOffsets[source[i] + 1]++;
+    }
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+        triangleOffsets[v + 1] += triangleOffsets[v];
+    }
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    std::vector<int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+    {
+        adjacency[fill[source[i]]++] = (unsigned int)(i / 3);
+    }
+
+    std::vector<Meshlet> meshlets;
+    std::vector<unsigned int> ordered;
+    ordered.reserve(indices->size());
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<int> vertexMeshlet(vertices.size(), -1);
+    std::vector<unsigned int> meshletVertices, meshletTriangles, candidates;
+    size_t seed = 0;
+    while (true)
+    {
+        while (seed < triangleCount && emitted[seed])
+        {
+            seed++;
+        }
+        if (seed == triangleCount)
+        {
+            break;
+        }
+
+        // Grow from the first unused triangle, always taking the candidate that adds the fewest new vertices,
+        // ties going to the one closest to the cluster centroid so clusters stay round rather than strip shaped
+        int id = (int)meshlets.size();
+        meshletVertices.clear();
+        meshletTriangles.clear();
+        candidates.assign(1, (unsigned int)seed);
+        glm::vec3 positionSum(0.0f);
+        while (meshletTriangles.size() < MESHLET_MAX_TRIANGLES)
+        {
+            glm::vec3 centroid = meshletVertices.empty() ? glm::vec3(0.0f) : positionSum / (float)meshletVertices.size();
+            int best = -1, bestNew = 4;
+            float bestDistance = 0.0f;
+            for (int c = 0; c < candidates.size(); c++)
+            {
+                unsigned int t = candidates[c];
+                if (emitted[t])
+                {
+                    candidates[c--] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                int added = 0;
+                for (int k = 0; k < 3; k++)
+                {
+                    added += (vertexMeshlet[source[t * 3 + k]] == id) ? 0 : 1;
+                }
+                if (meshletVertices.size() + added > MESHLET_MAX_VERTICES || added > bestNew)
+                {
+                    continue;
+                }
+                glm::vec3 triangleCenter = (vertices[source[t * 3]].position + vertices[source[t * 3 + 1]].position + vertices[source[t * 3 + 2]].position) / 3.0f;
+                float distance = glm::dot(triangleCenter - centroid, triangleCenter - centroid);
+                if (added < bestNew || distance < bestDistance)
+                {
+                    best = c;
+                    bestNew = added;
+                    bestDistance = distance;
+                }
+            }
+            if (best < 0)
+            {
+                break;
+            }
+            unsigned int t = candidates[best];
+            emitted[t] = 1;
+            meshletTriangles.push_back(t);
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int v = source[t * 3 + k];
+                if (vertexMeshlet[v] == id)
+                {
+                    continue;
+                }
+                vertexMeshlet[v] = id;
+                meshletVertices.push_back(v);
+                positionSum += vertices[v].position;
+                for (int a = triangleOffsets[v]; a < triangleOffsets[v + 1]; a++)
+                {
+                    if (!emitted[adjacency[a]])
+                    {
+                        candidates.push_back(adjacency[a]);
+                    }
+                }
+            }
+        }
+
+        Meshlet meshlet;
+        meshlet.firstIndex = (unsigned int)ordered.size();
+        meshlet.indexCount = (unsigned int)meshletTriangles.size() * 3;
+        glm::vec3 minBound = vertices[meshletVertices[0]].position, maxBound = minBound;
+        for (int i = 1; i < meshletVertices.size(); i++)
+        {
+            minBound = glm::min(minBound, vertices[meshletVertices[i]].position);
+            maxBound = glm::max(maxBound, vertices[meshletVertices[i]].position);
+        }
+        glm::vec3 center = (minBound + maxBound) * 0.5f;
+        float radius = 0.0f;
+        for (int i = 0; i < meshletVertices.size(); i++)
+        {
+            radius = glm::max(radius, glm::length(vertices[meshletVertices[i]].position - center));
+        }
+
+        // The cone holds every face normal, a half angle of pi/2 or more can never be back facing as a whole
+        std::vector<glm::vec3> normals;
+        glm::vec3 axis(0.0f);
+        for (int i = 0; i < meshletTriangles.size(); i++)
+        {
+            unsigned int t = meshletTriangles[i];
+            glm::vec3 p0 = vertices[source[t * 3]].position;
+            glm::vec3 normal = glm::cross(vertices[source[t * 3 + 1]].position - p0, vertices[source[t * 3 + 2]].position - p0);
+            float length = glm::length(normal);
+            if (length > 0.0f)
+            {
+                normals.push_back(normal / length);
+                axis += normal;
+            }
+            ordered.insert(ordered.end(), {source[t * 3], source[t * 3 + 1], source[t * 3 + 2]});
+        }
+        float halfAngle = glm::pi<float>();
+        if (glm::length(axis) > 0.0f)
+        {
+            axis = glm::normalize(axis);
+            float minDot = 1.0f;
+            for (int i = 0; i < normals.size(); i++)
+            {
+                minDot = glm::min(minDot, glm::dot(axis, normals[i]));
+            }
+            halfAngle = std::acos(glm::clamp(minDot, -1.0f, 1.0f));
+        }
+        meshlet.bounds = glm::vec4(center, radius);
+        meshlet.cone = glm::vec4(axis, halfAngle);
+        meshlets.push_back(meshlet);
+    }
+    indices->swap(ordered);
+    return meshlets;
+}
@@ -1,4 +1,5 @@
 #include "object/Model.h"
+#include "object/StaticBatcher.h"
 
 Model::Model()
 {
@@ -10,12 +11,56 @@ Model::Model(std::string path, bool gamma_)
     load_model(path);
 }
 
-void Model::draw(Shader *shader)
+void Model::draw(Shader *shader, int lod, MeshletCuller *culler, glm::mat4 matrix)
 {
+    std::vector<MeshLod> runs;
     for (int i = 0; i < meshes.size(); i++)
     {
-        meshes[i].draw(shader);
+        if (is_single_instance(i) && culler && lod == 0 && !meshes[i].meshlets.empty())
+        {
+            culler->cull(meshes[i], matrix, &runs);
+            meshes[i].draw_runs(shader, runs);
+            continue;
+        }
+        if (is_single_instance(i))
+        {
+            meshes[i].draw(shader, lod);
+            continue;
+        }
+        // Meshes reused by several nodes draw once per node with the node transforms as instance data
+        meshes[i].draw_instanced(shader, lod, instanceVBO, instanceOffsets[i], (int)meshNodes[i].size());
+    }
+    // Template actors share the shader and draw unquantized vertices
+    if (!meshes.empty())
+    {
+        meshes.back().reset_position_transform(shader);
+    }
+}
+
+int Model::get_lod_count()
+{
+    int lodCount = 1;
+    for (int i = 0; i < meshes.size(); i++)
+    {
+        lodCount = glm::max(lodCount, (int)meshes[i].lods.size());
+    }
+    return lodCount;
+}
+
+int Model::select_lod(float screenSize, int currentLod)
+{
+    // Level k gives way to level k + 1 below MESH_LOD_SCREEN_SIZE / 2^k pixels
+    int lodCount = get_lod_count();
+    int lod = glm::clamp(currentLod, 0, lodCount - 1);
+    while (lod < lodCount - 1 && screenSize < std::ldexp(MESH_LOD_SCREEN_SIZE, -lod) * (1.0f - MESH_LOD_HYSTERESIS))
+    {
+        lod++;
     }
+    while (lod > 0 && screenSize > std::ldexp(MESH_LOD_SCREEN_SIZE, 1 - lod) * (1.0f + MESH_LOD_HYSTERESIS))
+    {
+        lod--;
+    }
+    return lod;
 }
 
 void Model::free_data()
@@ -24,6 +69,12 @@ void Model::free_data()
     {
         meshes[i].free_data();
     }
+    if (instanceVBO)
+    {
+        glDeleteBuffers(1, &instanceVBO);
+        instanceVBO = 0;
+    }
+    GeometryPool::get().defragment();
 }
 
 void Model::load_model(std::string path)
@@ -39,24 +90,141 @@ void Model::load_model(std::string path)
 
     dir = path.substr(0, path.find_last_of('/'));
 
-    process_node(scene->mRootNode, scene);
+    std::vector<std::vector<int>> meshUsers(scene->mNumMeshes);
+    process_node(scene->mRootNode, -1, &meshUsers);
+    update_node_transforms();
+
+    // Each scene mesh is stored once, drawn as an instance at every node using it
+    std::vector<MeshSource> batched;
+    for (int i = 0; i < scene->mNumMeshes; i++)
+    {
+        if (meshUsers[i].empty())
+        {
+            continue;
+        }
+        MeshSource source = process_mesh(scene->mMeshes[i], scene);
+#if ENABLE_STATIC_BATCHING
+        // Meshes used by one node are pre-transformed under the root so those sharing textures draw as one range
+        if (meshUsers[i].size() == 1)
+        {
+            StaticBatcher::transform_vertices(&source.vertices, glm::inverse(nodes[0].world) * nodes[meshUsers[i][0]].world);
+            batched.push_back(source);
+            continue;
+        }
+#endif
+        add_mesh(source, meshUsers[i]);
+    }
+#if ENABLE_STATIC_BATCHING
+    std::vector<MeshSource> merged = StaticBatcher::merge(batched);
+    if (merged.size() < batched.size())
+    {
+        std::cout << "Model " << path << ": batched " << batched.size() << " meshes into " << merged.size() << std::endl;
+    }
+    for (int i = 0; i < merged.size(); i++)
+    {
+        add_mesh(merged[i], {0});
+    }
+#endif
+    update_node_transforms();
+}
+
+void Model::add_mesh(MeshSource source, std::vector<int> instanceNodes)
+{
+#if ENABLE_MESH_OPTIMIZATION
+    MeshOptimizer::optimize(&source.vertices, &source.indices, source.name);
+#endif
+
+    // Dense meshes are split into clusters culled on their own, the cluster order replaces the index order
+    std::vector<Meshlet> meshlets;
+#if ENABLE_MESHLETS
+    if (source.indices.size() / 3 >= MESHLET_MIN_MESH_TRIANGLES)
+    {
+        meshlets = MeshOptimizer::build_meshlets(source.vertices, &source.indices);
+    }
+#endif
+
+    std::vector<std::vector<unsigned int>> lodIndices;
+#if ENABLE_MESH_LODS
+    lodIndices = MeshOptimizer::build_lods(source.vertices, source.indices, source.name);
+#endif
+
+    // Meshes added without a hierarchy hang off an identity root
+    if (nodes.empty())
+    {
+        nodes.push_back({"Root", -1, glm::mat4(1.0f), glm::mat4(1.0f), {}});
+    }
+    for (int i = 0; i < instanceNodes.size(); i++)
+    {
+        nodes[instanceNodes[i]].meshes.push_back((int)meshes.size());
+    }
+    meshNodes.push_back(instanceNodes);
+    meshes.push_back(Mesh(source.vertices, source.indices, source.textures, lodIndices, meshlets));
+}
+
+void Model::update_node_transforms()
+{
+    for (int i = 0; i < nodes.size(); i++)
+    {
+        nodes[i].world = (nodes[i].parent < 0) ? nodes[i].local : nodes[nodes[i].parent].world * nodes[i].local;
+    }
+
+    std::vector<glm::mat4> transforms;
+    instanceOffsets.resize(meshNodes.size());
+    for (int i = 0; i < meshNodes.size(); i++)
+    {
+        instanceOffsets[i] = (int)transforms.size();
+        for (int j = 0; j < meshNodes[i].size(); j++)
+        {
+            transforms.push_back(nodes[meshNodes[i][j]].world);
+        }
+    }
+    if (transforms.empty())
+    {
+        return;
+    }
+    if (!instanceVBO)
+    {
+        glGenBuffers(1, &instanceVBO);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, transforms.size() * sizeof(glm::mat4), transforms.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+glm::mat4 Model::get_instance_transform(int mesh, int instance)
+{
+    return nodes[meshNodes[mesh][instance]].world;
+}
+
+glm::vec4 Model::get_instance_bounds(int mesh, int instance)
+{
+    glm::mat4 transform = get_instance_transform(mesh, instance);
+    float scale = glm::max(glm::max(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1]))), glm::length(glm::vec3(transform[2])));
+    return glm::vec4(glm::vec3(transform * glm::vec4(meshes[mesh].boundsCenter, 1.0f)), meshes[mesh].boundsRadius * scale);
+}
+
+bool Model::is_single_instance(int mesh)
+{
+    return meshNodes[mesh].size() == 1 && nodes[meshNodes[mesh][0]].world == glm::mat4(1.0f);
 }
 
-void Model::process_node(aiNode *node, const aiScene *scene)
+void Model::process_node(aiNode *node, int parent, std::vector<std::vector<int>> *meshUsers)
 {
+    // Assimp matrices are row major
+    int index = (int)nodes.size();
+    nodes.push_back({node->mName.C_Str(), parent, glm::transpose(glm::make_mat4(&node->mTransformation.a1)), glm::mat4(1.0f), {}});
     for (int i = 0; i < node->mNumMeshes; i++)
     {
-        aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(process_mesh(mesh, scene));
+        (*meshUsers)[node->mMeshes[i]].push_back(index);
     }
 
     for (int i = 0; i < node->mNumChildren; i++)
     {
-        process_node(node->mChildren[i], scene);
+        process_node(node->mChildren[i], index, meshUsers);
     }
 }
 
-Mesh Model::process_mesh(aiMesh *mesh, const aiScene *scene)
+MeshSource Model::process_mesh(aiMesh *mesh, const aiScene *scene)
 {
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
@@ -107,7 +275,7 @@ Mesh Model::process_mesh(aiMesh *mesh, const aiScene *scene)
         textures.insert(textures.end(), specularmaps.begin(), specularmaps.end());
     }
 
-    return Mesh(vertices, indices, textures);
+    return {vertices, indices, textures, mesh->mName.C_Str()};
 }
 
 std::vector<Texture> Model::load_material_textures(aiMaterial *mat, aiTextureType type, std::string textureType)
@@ -0,0 +1,166 @@
+#include "object/StaticBatcher.h"
+
+// Standard Headers
+#include <iostream>
+#include <map>
+#include <tuple>
+
+bool StaticBatcher::same_material(const std::vector<Texture> &a, const std::vector<Texture> &b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (int i = 0; i < a.size(); i++)
+    {
+        if (a[i].id != b[i].id || a[i].type != b[i].type)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void StaticBatcher::transform_vertices(std::vector<Vertex> *vertices, const glm::mat4 &transform)
+{
+    if (transform == glm::mat4(1.0f))
+    {
+        return;
+    }
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+    for (int i = 0; i < vertices->size(); i++)
+    {
+        Vertex &vertex = (*vertices)[i];
+        vertex.position = glm::vec3(transform * glm::vec4(vertex.position, 1.0f));
+        if (glm::length(vertex.normal) > 0.0f)
+        {
+            vertex.normal = glm::normalize(normalMatrix * vertex.normal);
+        }
+    }
+}
+
+void StaticBatcher::append(MeshSource *batch, const MeshSource &source, const glm::mat4 &transform)
+{
+    unsigned int baseVertex = (unsigned int)batch->vertices.size();
+    std::vector<Vertex> vertices = source.vertices;
+    transform_vertices(&vertices, transform);
+    batch->vertices.insert(batch->vertices.end(), vertices.begin(), vertices.end());
+    for (int i = 0; i < source.indices.size(); i++)
+    {
+        batch->indices.push_back(baseVertex + source.indices[i]);
+    }
+}
+
+std::vector<MeshSource> StaticBatcher::merge(const std::vector<MeshSource> &sources)
+{
+    std::vector<MeshSource> batches;
+    for (int i = 0; i < sources.size(); i++)
+    {
+        // Batches stop growing at the vertex limit so they keep 16-bit indices
+        int target = -1;
+        for (int j = 0; j < batches.size() && target < 0; j++)
+        {
+            if (same_material(batches[j].textures, sources[i].textures) &&
+                batches[j].vertices.size() + sources[i].vertices.size() <= STATIC_BATCH_MAX_VERTICES)
+            {
+                target = j;
+            }
+        }
+        if (target < 0)
+        {
+            target = (int)batches.size();
+            batches.push_back({{}, {}, sources[i].textures, sources[i].name});
+        }
+        append(&batches[target], sources[i], glm::mat4(1.0f));
+    }
+    return batches;
+}
+
+void StaticBatcher::build(const std::vector<RenderActor *> &actors, float cellSize)
+{
+    free_data();
+
+    // Static actors are grouped by the cell of their position and their shininess, the only per actor uniform
+    std::map<std::tuple<int, int, int, float>, std::vector<ModelActor *>> cells;
+    for (int i = 0; i < actors.size(); i++)
+    {
+        RenderActor *actor = actors[i];
+        if (actor->type != MODEL_ACTOR || !actor->isStatic || !actor->toRender || actor->mat.shader != MODEL_SHADER_3D)
+        {
+            continue;
+        }
+        glm::ivec3 cell = glm::ivec3(glm::floor(actor->tr.position / cellSize));
+        cells[std::make_tuple(cell.x, cell.y, cell.z, actor->mat.shininess)].push_back((ModelActor *)actor);
+    }
+
+    for (auto it = cells.begin(); it != cells.end(); it++)
+    {
+        // A lone actor gains nothing from a copy of its geometry
+        std::vector<ModelActor *> &members = it->second;
+        if (members.size() < 2)
+        {
+            continue;
+        }
+        std::vector<MeshSource> sources;
+        for (int i = 0; i < members.size(); i++)
+        {
+            Model *model = members[i]->model;
+            for (int j = 0; j < model->meshes.size(); j++)
+            {
+                Mesh &mesh = model->meshes[j];
+                for (int k = 0; k < model->meshNodes[j].size(); k++)
+                {
+                    MeshSource source = {mesh.vertices, mesh.indices, mesh.textures, members[i]->name};
+                    transform_vertices(&source.vertices, members[i]->tr.get_model_matrix() * model->get_instance_transform(j, k));
+                    sources.push_back(source);
+                }
+            }
+            batchedActors.insert(members[i]);
+        }
+
+        ModelActor *batch = new ModelActor();
+        batch->name = "Static Batch " + std::to_string(batches.size() + 1);
+        batch->model = new Model();
+        batch->mat.shader = MODEL_SHADER_3D;
+        batch->mat.shininess = std::get<3>(it->first);
+        batch->isStatic = true;
+        sources = merge(sources);
+        for (int i = 0; i < sources.size(); i++)
+        {
+            batch->model->add_mesh(sources[i]);
+        }
+        batch->model->update_node_transforms();
+        batches.push_back(batch);
+    }
+    std::cout << "Static batching: " << batchedActors.size() << " actors merged into " << batches.size() << " world batches" << std::endl;
+}
+
+std::vector<RenderActor *> StaticBatcher::get_draw_list(const std::vector<RenderActor *> &actors)
+{
+    std::vector<RenderActor *> drawList;
+    drawList.reserve(actors.size() + batches.size());
+    for (int i = 0; i < actors.size(); i++)
+    {
+        if (batchedActors.count(actors[i]) == 0)
+        {
+            drawList.push_back(actors[i]);
+        }
+    }
+    drawList.insert(drawList.end(), batches.begin(), batches.end());
+    return drawList;
+}
+
+int StaticBatcher::get_batched_count()
+{
+    return (int)batchedActors.size();
+}
+
+void StaticBatcher::free_data()
+{
+    for (int i = 0; i < batches.size(); i++)
+    {
+        delete batches[i];
+    }
+    batches.clear();
+    batchedActors.clear();
+}
@@ -85,3 +85,25 @@ void Camera::update_camera_vectors()
     right = glm::normalize(glm::cross(lookAt, worldUp));
     up = glm::normalize(glm::cross(right, lookAt));
 }
+
+float get_screen_size(glm::mat4 projection, glm::vec3 viewPosition, float radius, float viewportHeight)
+{
+    // Clip w is the view depth for perspective projections and one for orthographic ones
+    float w = projection[2][3] * viewPosition.z + projection[3][3];
+    return radius * projection[1][1] * viewportHeight / glm::max(w, CAMERA_NEAR_PLANE);
+}
+
+void get_frustum_planes(glm::mat4 viewProjection, glm::vec4 planes[6])
+{
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+    {
+        row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+    // Left, right, bottom, top, near and far planes of the clip volume, normalised for sphere distances
+    for (int i = 0; i < 6; i++)
+    {
+        planes[i] = (i % 2 == 0) ? (row[3] + row[i / 2]) : (row[3] - row[i / 2]);
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
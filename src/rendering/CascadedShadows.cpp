@@ -0,0 +1,417 @@
+#include "rendering/CascadedShadows.h"
+
+// Custom Headers
+#include "rendering/GeometryPool.h"
+
+// Standard Headers
+#include <algorithm>
+#include <cmath>
+
+// Maps clip space to the texture coordinates and depth the shadow layers are sampled with
+static const glm::mat4 textureBias(0.5f, 0.0f, 0.0f, 0.0f,
+                                   0.0f, 0.5f, 0.0f, 0.0f,
+                                   0.0f, 0.0f, 0.5f, 0.0f,
+                                   0.5f, 0.5f, 0.5f, 1.0f);
+
+// Returns whether a program exists and linked
+static bool is_linked(Shader *program)
+{
+    int status = 0;
+    if (program->id != 0)
+    {
+        glGetProgramiv(program->id, GL_LINK_STATUS, &status);
+    }
+    return status != 0;
+}
+
+// Folds bytes into an FNV-1a hash
+static size_t hash_bytes(size_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool CascadedShadows::initialise()
+{
+    program.id = 0;
+    program.create_shader(FileSystem::get_path("shaders/3dshaders/depthOnly.vs").c_str(), FileSystem::get_path("shaders/3dshaders/depthOnly.fs").c_str());
+    bool linked = is_linked(&program);
+    if (!linked)
+    {
+        std::cout << "Failed to build shadow shaders" << std::endl;
+    }
+
+    // Past its window a cascade reads as lit, and the sampled layers compare in hardware for filtered lookups
+    float border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glGenTextures(2, textures);
+    for (int i = 0; i < 2; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textures[i]);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, SHADOW_RESOLUTION, SHADOW_RESOLUTION,
+                     SHADOW_MAX_DIRECTIONAL_LIGHTS * SHADOW_CASCADE_COUNT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, (i == 1) ? GL_LINEAR : GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, (i == 1) ? GL_LINEAR : GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+        if (i == 1)
+        {
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // Depth-only framebuffers, the layer attached changes per cascade
+    glGenFramebuffers(2, framebuffers);
+    for (int i = 0; i < 2; i++)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[i]);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[i], 0, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    for (int i = 0; i < SHADOW_MAX_DIRECTIONAL_LIGHTS; i++)
+    {
+        directions[i] = glm::vec3(0.0f);
+        rotations[i] = glm::mat4(1.0f);
+    }
+    return linked;
+}
+
+void CascadedShadows::update(const std::vector<LightSource *> &lights, const std::vector<RenderActor *> &actors, glm::mat4 view, glm::mat4 projection)
+{
+    // The first directional lights in light order get shadows, the same order the light buffer stores them in
+    lightCount = 0;
+    for (int i = 0; i < lights.size() && lightCount < SHADOW_MAX_DIRECTIONAL_LIGHTS; i++)
+    {
+        if (lights[i]->type != DIRECTIONAL_LIGHT)
+        {
+            continue;
+        }
+        glm::vec3 direction = glm::normalize(((DirectionalLight *)lights[i])->direction);
+        if (direction != directions[lightCount])
+        {
+            glm::vec3 up = (std::abs(direction.y) > 0.99f) ? WORLD_FORWARD : WORLD_UP;
+            directions[lightCount] = direction;
+            rotations[lightCount] = glm::lookAt(glm::vec3(0.0f), direction, up);
+            for (int j = 0; j < SHADOW_CASCADE_COUNT; j++)
+            {
+                cascades[lightCount * SHADOW_CASCADE_COUNT + j].staticValid = false;
+            }
+        }
+        lightCount++;
+    }
+
+    // Static casters are hashed with their transforms, so moving, adding or hiding one refreshes every static layer
+    staticCasters.clear();
+    dynamicCasters.clear();
+    size_t hash = 14695981039346656037ull;
+    for (int i = 0; i < actors.size(); i++)
+    {
+        RenderActor *actor = actors[i];
+        if (!actor->toRender || (actor->type != MODEL_ACTOR && actor->type != OBJECT_ACTOR))
+        {
+            continue;
+        }
+        glm::vec4 bounds = get_caster_bounds(actor);
+        ShadowCaster caster;
+        caster.actor = actor;
+        caster.center = glm::vec3(bounds);
+        caster.radius = bounds.w;
+        if (actor->isStatic)
+        {
+            glm::mat4 matrix = actor->tr.get_model_matrix();
+            hash = hash_bytes(hash, &actor, sizeof(actor));
+            hash = hash_bytes(hash, &matrix, sizeof(matrix));
+            staticCasters.push_back(caster);
+        }
+        else
+        {
+            dynamicCasters.push_back(caster);
+        }
+    }
+    if (hash != staticHash)
+    {
+        staticHash = hash;
+        for (int i = 0; i < SHADOW_MAX_DIRECTIONAL_LIGHTS * SHADOW_CASCADE_COUNT; i++)
+        {
+            cascades[i].staticValid = false;
+        }
+    }
+
+    // Corners of the camera's near and far planes, view depth changes linearly between matching corners
+    // for perspective and orthographic projections alike
+    glm::mat4 inverse = glm::inverse(projection * view);
+    glm::vec3 nearCorners[4], farCorners[4];
+    for (int i = 0; i < 4; i++)
+    {
+        glm::vec2 ndc((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f);
+        glm::vec4 nearPoint = inverse * glm::vec4(ndc, -1.0f, 1.0f);
+        glm::vec4 farPoint = inverse * glm::vec4(ndc, 1.0f, 1.0f);
+        nearCorners[i] = glm::vec3(nearPoint) / nearPoint.w;
+        farCorners[i] = glm::vec3(farPoint) / farPoint.w;
+    }
+
+    // Splits blend a logarithmic and a uniform spacing up to the shadow distance
+    float nearDepth = CAMERA_NEAR_PLANE;
+    float shadowDepth = glm::min(SHADOW_DISTANCE, CAMERA_FAR_PLANE);
+    float start = nearDepth;
+    for (int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+    {
+        float ratio = (float)(i + 1) / SHADOW_CASCADE_COUNT;
+        float logSplit = nearDepth * std::pow(shadowDepth / nearDepth, ratio);
+        float uniformSplit = nearDepth + (shadowDepth - nearDepth) * ratio;
+        float end = glm::mix(uniformSplit, logSplit, SHADOW_SPLIT_LAMBDA);
+        splitDepths[i] = end;
+
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (int j = 0; j < 4; j++)
+        {
+            corners[j] = glm::mix(nearCorners[j], farCorners[j], (start - CAMERA_NEAR_PLANE) / (CAMERA_FAR_PLANE - CAMERA_NEAR_PLANE));
+            corners[j + 4] = glm::mix(nearCorners[j], farCorners[j], (end - CAMERA_NEAR_PLANE) / (CAMERA_FAR_PLANE - CAMERA_NEAR_PLANE));
+            center += corners[j] + corners[j + 4];
+        }
+        center /= 8.0f;
+        // The sphere of a slice only depends on its shape, rounding its radius up keeps it from changing as the camera turns
+        float radius = 0.0f;
+        for (int j = 0; j < 8; j++)
+        {
+            radius = glm::max(radius, glm::length(corners[j] - center));
+        }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+        for (int light = 0; light < lightCount; light++)
+        {
+            ShadowCascade *cascade = &cascades[light * SHADOW_CASCADE_COUNT + i];
+            fit_cascade(cascade, rotations[light], center, radius);
+            cascade->dynamicCount = 0;
+            for (int j = 0; j < dynamicCasters.size(); j++)
+            {
+                cascade->dynamicCount += touches(dynamicCasters[j], *cascade, rotations[light]) ? 1 : 0;
+            }
+        }
+        start = end;
+    }
+}
+
+void CascadedShadows::fit_cascade(ShadowCascade *cascade, const glm::mat4 &rotation, glm::vec3 center, float radius)
+{
+    // The window is wider than the slice, so the camera can move a while before the static layer has to be redrawn
+    float halfSize = radius * SHADOW_CACHE_MARGIN;
+    glm::vec3 lightCenter = glm::vec3(rotation * glm::vec4(center, 1.0f));
+    glm::vec3 offset = glm::abs(lightCenter - cascade->center);
+    if (cascade->staticValid && cascade->halfSize == halfSize && glm::max(glm::max(offset.x, offset.y), offset.z) + radius <= halfSize)
+    {
+        return;
+    }
+
+    // Snapped to whole texels, a moved window rasterizes the casters it shares with the old one the same way
+    float texelSize = 2.0f * halfSize / SHADOW_RESOLUTION;
+    cascade->center = glm::vec3(std::floor(lightCenter.x / texelSize) * texelSize, std::floor(lightCenter.y / texelSize) * texelSize, lightCenter.z);
+    cascade->halfSize = halfSize;
+    glm::vec3 windowMin = cascade->center - halfSize;
+    glm::vec3 windowMax = cascade->center + halfSize;
+    // Light space looks down -z, the near plane is the side facing the light
+    cascade->matrix = glm::ortho(windowMin.x, windowMax.x, windowMin.y, windowMax.y, -windowMax.z, -windowMin.z) * rotation;
+    cascade->staticValid = false;
+}
+
+bool CascadedShadows::touches(const ShadowCaster &caster, const ShadowCascade &cascade, const glm::mat4 &rotation)
+{
+    // Casters between the light and the window are clamped onto its near plane, only those past its far side are dropped
+    glm::vec3 center = glm::vec3(rotation * glm::vec4(caster.center, 1.0f));
+    glm::vec3 offset = center - cascade.center;
+    float reach = cascade.halfSize + caster.radius;
+    return std::abs(offset.x) <= reach && std::abs(offset.y) <= reach && offset.z >= -reach;
+}
+
+int CascadedShadows::add_pass(RenderGraph *graph, std::function<void(RenderActor *, Shader *)> drawCaster)
+{
+    staticRefreshes = 0;
+    composites = 0;
+    casterDraws = 0;
+    if (lightCount == 0)
+    {
+        return -1;
+    }
+
+    // The layers live outside the graph and are imported so the passes sampling them wait on this one,
+    // the pass attaches the layers one at a time itself
+    int layers = graph->import_texture("Shadow Cascades", textures[1], SHADOW_RESOLUTION, SHADOW_RESOLUTION, GL_DEPTH_COMPONENT32F);
+    int pass = graph->add_pass("Shadows", [this, drawCaster]() mutable
+                               {
+                                   GLint polygonMode[2];
+                                   glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+                                   glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                                   glEnable(GL_DEPTH_CLAMP);
+                                   glEnable(GL_POLYGON_OFFSET_FILL);
+                                   glPolygonOffset(SHADOW_SLOPE_BIAS, SHADOW_CONSTANT_BIAS);
+                                   glEnable(GL_DEPTH_TEST);
+                                   glDepthFunc(GL_LESS);
+                                   glDepthMask(GL_TRUE);
+                                   glViewport(0, 0, SHADOW_RESOLUTION, SHADOW_RESOLUTION);
+                                   GeometryPool::get().set_position_only(true);
+                                   program.use();
+                                   program.set_mat4("view", glm::mat4(1.0f));
+                                   for (int layer = 0; layer < lightCount * SHADOW_CASCADE_COUNT; layer++)
+                                   {
+                                       ShadowCascade *cascade = &cascades[layer];
+                                       program.set_mat4("projection", cascade->matrix);
+                                       if (!cascade->staticValid)
+                                       {
+                                           attach_layer(1, 0, layer);
+                                           glClear(GL_DEPTH_BUFFER_BIT);
+                                           casterDraws += draw_casters(staticCasters, layer, drawCaster);
+                                           cascade->staticValid = true;
+                                           cascade->onlyStatic = false;
+                                           staticRefreshes++;
+                                       }
+                                       // A layer still holding the static casters alone is left as it is
+                                       if (cascade->dynamicCount == 0 && cascade->onlyStatic)
+                                       {
+                                           continue;
+                                       }
+                                       attach_layer(0, 0, layer);
+                                       attach_layer(1, 1, layer);
+                                       glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+                                       glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+                                       glBlitFramebuffer(0, 0, SHADOW_RESOLUTION, SHADOW_RESOLUTION, 0, 0, SHADOW_RESOLUTION, SHADOW_RESOLUTION, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+                                       glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[1]);
+                                       if (cascade->dynamicCount > 0)
+                                       {
+                                           casterDraws += draw_casters(dynamicCasters, layer, drawCaster);
+                                           composites++;
+                                       }
+                                       cascade->onlyStatic = (cascade->dynamicCount == 0);
+                                   }
+                                   GeometryPool::get().set_position_only(false);
+                                   glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                                   glDisable(GL_POLYGON_OFFSET_FILL);
+                                   glDisable(GL_DEPTH_CLAMP);
+                                   glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]); });
+    graph->write(pass, layers);
+    graph->set_own_framebuffer(pass);
+    return layers;
+}
+
+int CascadedShadows::draw_casters(const std::vector<ShadowCaster> &casters, int layer, std::function<void(RenderActor *, Shader *)> &drawCaster)
+{
+    int drawn = 0;
+    const glm::mat4 &rotation = rotations[layer / SHADOW_CASCADE_COUNT];
+    for (int i = 0; i < casters.size(); i++)
+    {
+        if (touches(casters[i], cascades[layer], rotation))
+        {
+            drawCaster(casters[i].actor, &program);
+            drawn++;
+        }
+    }
+    return drawn;
+}
+
+void CascadedShadows::attach_layer(int framebuffer, int texture, int layer)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[framebuffer]);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[texture], 0, layer);
+}
+
+void CascadedShadows::bind_textures()
+{
+    glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textures[1]);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void CascadedShadows::set_uniforms(Shader *shader)
+{
+    glm::mat4 matrices[SHADOW_MAX_DIRECTIONAL_LIGHTS * SHADOW_CASCADE_COUNT];
+    float normalOffsets[SHADOW_MAX_DIRECTIONAL_LIGHTS * SHADOW_CASCADE_COUNT];
+    for (int i = 0; i < lightCount * SHADOW_CASCADE_COUNT; i++)
+    {
+        matrices[i] = textureBias * cascades[i].matrix;
+        normalOffsets[i] = SHADOW_NORMAL_OFFSET * 2.0f * cascades[i].halfSize / SHADOW_RESOLUTION;
+    }
+    shader->set_int("shadowCascades", SHADOW_TEXTURE_UNIT);
+    shader->set_int("shadowLightCount", lightCount);
+    glUniform1fv(glGetUniformLocation(shader->id, "shadowSplits"), SHADOW_CASCADE_COUNT, splitDepths);
+    if (lightCount > 0)
+    {
+        glUniformMatrix4fv(glGetUniformLocation(shader->id, "shadowMatrices"), lightCount * SHADOW_CASCADE_COUNT, GL_FALSE, &matrices[0][0][0]);
+        glUniform1fv(glGetUniformLocation(shader->id, "shadowNormalOffsets"), lightCount * SHADOW_CASCADE_COUNT, normalOffsets);
+    }
+}
+
+int CascadedShadows::get_light_count()
+{
+    return lightCount;
+}
+
+int CascadedShadows::get_static_refresh_count()
+{
+    return staticRefreshes;
+}
+
+int CascadedShadows::get_composite_count()
+{
+    return composites;
+}
+
+int CascadedShadows::get_caster_draw_count()
+{
+    return casterDraws;
+}
+
+glm::vec4 CascadedShadows::get_caster_bounds(RenderActor *actor)
+{
+    glm::mat4 matrix = actor->tr.get_model_matrix();
+    float scale = glm::max(glm::max(glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1]))), glm::length(glm::vec3(matrix[2])));
+    if (actor->type != MODEL_ACTOR)
+    {
+        // Template actors are unit cubes
+        return glm::vec4(glm::vec3(matrix[3]), 0.8660254f * scale);
+    }
+
+    // One sphere around the box of the mesh instances' spheres
+    Model *model = ((ModelActor *)actor)->model;
+    std::vector<glm::vec4> spheres;
+    glm::vec3 boxMin(1e30f), boxMax(-1e30f);
+    for (int i = 0; i < model->meshes.size(); i++)
+    {
+        for (int j = 0; j < model->meshNodes[i].size(); j++)
+        {
+            glm::vec4 bounds = model->get_instance_bounds(i, j);
+            glm::vec4 sphere(glm::vec3(matrix * glm::vec4(glm::vec3(bounds), 1.0f)), bounds.w * scale);
+            boxMin = glm::min(boxMin, glm::vec3(sphere) - sphere.w);
+            boxMax = glm::max(boxMax, glm::vec3(sphere) + sphere.w);
+            spheres.push_back(sphere);
+        }
+    }
+    if (spheres.empty())
+    {
+        return glm::vec4(glm::vec3(matrix[3]), 0.0f);
+    }
+    glm::vec3 center = 0.5f * (boxMin + boxMax);
+    float radius = 0.0f;
+    for (int i = 0; i < spheres.size(); i++)
+    {
+        radius = glm::max(radius, glm::length(glm::vec3(spheres[i]) - center) + spheres[i].w);
+    }
+    return glm::vec4(center, radius);
+}
+
+void CascadedShadows::free_data()
+{
+    program.free_data();
+    if (textures[0])
+    {
+        glDeleteTextures(2, textures);
+        glDeleteFramebuffers(2, framebuffers);
+        textures[0] = 0;
+    }
+}
@@ -0,0 +1,455 @@
+#include "rendering/ClusteredLighting.h"
+
+// Custom Headers
+#include "utility/JobSystem.h"
+
+// Standard Headers
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLUSTERED_LIGHTING_SSE2 1
+#else
+#define CLUSTERED_LIGHTING_SSE2 0
+#endif
+
+// Light buffer layout, in RGBA32F texels
+// 0: position, range  1: ambient, type  2: diffuse, radius  3: specular, constant
+// 4: direction, linear  5: inner falloff, outer falloff, quadratic
+static const GLenum bufferFormats[3] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+
+void ClusteredLighting::initialise(DynamicBuffer *ring_)
+{
+    ring = ring_;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    if (glFeatures.textureBufferRange)
+    {
+        glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &textureAlignment);
+    }
+    glGenBuffers(3, buffers);
+    glGenTextures(3, textures);
+    for (int i = 0; i < 3; i++)
+    {
+        // A buffer with storage keeps the texture complete before the first upload
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_DYNAMIC_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, bufferFormats[i], buffers[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    sliceLists.resize(CLUSTER_GRID_Z);
+    grid.resize(CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z);
+}
+
+void ClusteredLighting::set_shadows(CascadedShadows *shadows_)
+{
+    shadows = shadows_;
+}
+
+void ClusteredLighting::set_shadow_atlas(ShadowAtlas *atlas_)
+{
+    atlas = atlas_;
+}
+
+void ClusteredLighting::update(const std::vector<LightSource *> &lights, glm::mat4 view, glm::mat4 projection, int screenWidth, int screenHeight, bool gamma, bool assignClusters)
+{
+    if (projection != boundsProjection)
+    {
+        build_bounds(projection);
+    }
+    tileScale = glm::vec2((float)CLUSTER_GRID_X / glm::max(screenWidth, 1), (float)CLUSTER_GRID_Y / glm::max(screenHeight, 1));
+
+    // Point and spot lights come first so their buffer index is also their index in the cluster lists,
+    // directional lights reach every fragment and follow them
+    int maxLights = maxTexels / CLUSTER_LIGHT_TEXELS;
+    lightData.clear();
+    clusterLights.clear();
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (pass == 1)
+        {
+            directionalOffset = (int)(lightData.size() / CLUSTER_LIGHT_TEXELS);
+        }
+        for (int i = 0; i < lights.size() && lightData.size() / CLUSTER_LIGHT_TEXELS < maxLights; i++)
+        {
+            LightSource *light = lights[i];
+            if ((light->type == DIRECTIONAL_LIGHT) != (pass == 1))
+            {
+                continue;
+            }
+            glm::vec4 texels[CLUSTER_LIGHT_TEXELS] = {};
+            texels[1] = glm::vec4(light->ambient, (float)light->type);
+            texels[2] = glm::vec4(light->diffuse, 0.0f);
+            texels[3] = glm::vec4(light->specular, 0.0f);
+            // The first tile record of a light's shadows, -1 when it has none
+            texels[5].w = atlas ? (float)atlas->get_tile_record(light) : -1.0f;
+            ClusterLight bounds;
+            bounds.index = (int)(lightData.size() / CLUSTER_LIGHT_TEXELS);
+            bounds.cosAngle = -1.0f;
+            bounds.sinAngle = 0.0f;
+            if (light->type == POINT_LIGHT)
+            {
+                PointLight *point = (PointLight *)light;
+                bounds.position = glm::vec3(view * glm::vec4(point->position, 1.0f));
+                bounds.range = get_point_light_range(point, gamma);
+                texels[0] = glm::vec4(point->position, bounds.range);
+                texels[2].w = point->radius;
+                texels[3].w = point->constant;
+                texels[4].w = point->linear;
+                texels[5] = glm::vec4(0.0f, 0.0f, point->quadratic, texels[5].w);
+            }
+            else if (light->type == SPOT_LIGHT)
+            {
+                SpotLight *spot = (SpotLight *)light;
+                float angle = glm::radians(glm::clamp(spot->outerFallOff, 0.0f, 89.0f));
+                bounds.position = glm::vec3(view * glm::vec4(spot->position, 1.0f));
+                bounds.range = CLUSTER_SPOT_RANGE;
+                bounds.direction = glm::normalize(glm::mat3(view) * spot->lookAt);
+                bounds.cosAngle = std::cos(angle);
+                bounds.sinAngle = std::sin(angle);
+                texels[0] = glm::vec4(spot->position, bounds.range);
+                texels[4] = glm::vec4(spot->lookAt, 0.0f);
+                texels[5] = glm::vec4(spot->innerFallOff, spot->outerFallOff, 0.0f, texels[5].w);
+            }
+            else
+            {
+                texels[4] = glm::vec4(((DirectionalLight *)light)->direction, 0.0f);
+            }
+            lightData.insert(lightData.end(), texels, texels + CLUSTER_LIGHT_TEXELS);
+            if (light->type != DIRECTIONAL_LIGHT)
+            {
+                clusterLights.push_back(bounds);
+            }
+        }
+    }
+    directionalCount = (int)(lightData.size() / CLUSTER_LIGHT_TEXELS) - directionalOffset;
+
+    // Slices own disjoint clusters, so each one fills its own list without locking, paths shading lights by
+    // their volumes instead leave every cluster empty
+    if (assignClusters)
+    {
+        JobSystem::get().parallel_for(CLUSTER_GRID_Z, [this](int slice)
+                                      { assign_slice(slice); });
+    }
+    else
+    {
+        for (int slice = 0; slice < CLUSTER_GRID_Z; slice++)
+        {
+            sliceLists[slice].clear();
+        }
+        std::fill(grid.begin(), grid.end(), glm::uvec2(0));
+    }
+
+    // The slice lists are joined into one index buffer and the grid offsets moved to match
+    int tilesPerSlice = CLUSTER_GRID_X * CLUSTER_GRID_Y;
+    indices.clear();
+    maxClusterLights = 0;
+    for (int slice = 0; slice < CLUSTER_GRID_Z; slice++)
+    {
+        unsigned int base = (unsigned int)indices.size();
+        for (int tile = 0; tile < tilesPerSlice; tile++)
+        {
+            glm::uvec2 *cell = &grid[slice * tilesPerSlice + tile];
+            cell->x += base;
+            maxClusterLights = glm::max(maxClusterLights, (int)cell->y);
+        }
+        indices.insert(indices.end(), sliceLists[slice].begin(), sliceLists[slice].end());
+    }
+    if (indices.size() > maxTexels)
+    {
+        // Lists past the end of the largest buffer lose their tail rather than reading out of bounds
+        for (int i = 0; i < grid.size(); i++)
+        {
+            grid[i].x = glm::min(grid[i].x, (unsigned int)maxTexels);
+            grid[i].y = glm::min(grid[i].y, (unsigned int)maxTexels - grid[i].x);
+        }
+        indices.resize(maxTexels);
+    }
+
+    upload(0, lightData.data(), lightData.size() * sizeof(glm::vec4));
+    upload(1, grid.data(), grid.size() * sizeof(glm::uvec2));
+    upload(2, indices.data(), indices.size() * sizeof(unsigned int));
+}
+
+void ClusteredLighting::bind_buffers()
+{
+    for (int i = 0; i < 3; i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + CLUSTER_TEXTURE_UNIT + i);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    if (shadows)
+    {
+        shadows->bind_textures();
+    }
+    if (atlas)
+    {
+        atlas->bind_textures();
+    }
+}
+
+void ClusteredLighting::set_uniforms(Shader *shader)
+{
+    // Slices are spaced evenly in log depth, so the slice of a depth is a scale and bias of its log
+    float logRange = std::log(CAMERA_FAR_PLANE / CLUSTER_NEAR_DEPTH);
+    shader->set_int("lightData", CLUSTER_TEXTURE_UNIT);
+    shader->set_int("clusterGrid", CLUSTER_TEXTURE_UNIT + 1);
+    shader->set_int("clusterIndices", CLUSTER_TEXTURE_UNIT + 2);
+    glUniform3i(glGetUniformLocation(shader->id, "clusterDims"), CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z);
+    shader->set_vec2("clusterTileScale", tileScale);
+    shader->set_vec2("clusterDepthParams", glm::vec2(CLUSTER_GRID_Z / logRange, -CLUSTER_GRID_Z * std::log(CLUSTER_NEAR_DEPTH) / logRange));
+    shader->set_int("dirLightOffset", directionalOffset);
+    shader->set_int("dirLightCount", directionalCount);
+    shader->set_float("lightCutoff", CLUSTER_LIGHT_CUTOFF);
+    if (shadows)
+    {
+        shadows->set_uniforms(shader);
+    }
+    if (atlas)
+    {
+        atlas->set_uniforms(shader);
+    }
+}
+
+int ClusteredLighting::get_clustered_count()
+{
+    return (int)clusterLights.size();
+}
+
+int ClusteredLighting::get_index_count()
+{
+    return (int)indices.size();
+}
+
+int ClusteredLighting::get_max_cluster_lights()
+{
+    return maxClusterLights;
+}
+
+const std::vector<ClusterLight> &ClusteredLighting::get_lights()
+{
+    return clusterLights;
+}
+
+int ClusteredLighting::get_directional_offset()
+{
+    return directionalOffset;
+}
+
+int ClusteredLighting::get_directional_count()
+{
+    return directionalCount;
+}
+
+float ClusteredLighting::get_point_light_range(const PointLight *light, bool gamma)
+{
+    // Past its radius a point light falls off as 1 / (constant + linear d + quadratic d^2), and the shaders drop
+    // the linear term with gamma correction on, so the range is where that reaches the cutoff
+    float linear = gamma ? 0.0f : light->linear;
+    float target = 1.0f / CLUSTER_LIGHT_CUTOFF - light->constant;
+    float distance = 0.0f;
+    if (light->quadratic > 0.0f)
+    {
+        distance = (-linear + std::sqrt(linear * linear + 4.0f * light->quadratic * target)) / (2.0f * light->quadratic);
+    }
+    else if (linear > 0.0f)
+    {
+        distance = target / linear;
+    }
+    else
+    {
+        distance = CLUSTER_SPOT_RANGE;
+    }
+    return light->radius + glm::max(distance, 0.0f);
+}
+
+bool ClusteredLighting::sphere_intersects_box(glm::vec3 center, float radius, glm::vec3 boxMin, glm::vec3 boxMax)
+{
+    glm::vec3 outside = glm::max(boxMin - center, 0.0f) + glm::max(center - boxMax, 0.0f);
+    return glm::dot(outside, outside) <= radius * radius;
+}
+
+bool ClusteredLighting::sphere_intersects_cone(glm::vec3 center, float radius, const ClusterLight &cone)
+{
+    // Distance from the sphere center to the cone's surface, measured perpendicular to the nearest side
+    glm::vec3 offset = center - cone.position;
+    float along = glm::dot(offset, cone.direction);
+    float across = std::sqrt(glm::max(glm::dot(offset, offset) - along * along, 0.0f));
+    float surfaceDistance = cone.cosAngle * across - along * cone.sinAngle;
+    return surfaceDistance <= radius && along <= cone.range + radius && along >= -radius;
+}
+
+void ClusteredLighting::free_data()
+{
+    if (buffers[0])
+    {
+        glDeleteBuffers(3, buffers);
+        glDeleteTextures(3, textures);
+        for (int i = 0; i < 3; i++)
+        {
+            buffers[i] = 0;
+            textures[i] = 0;
+        }
+    }
+    lightData.clear();
+    clusterLights.clear();
+    indices.clear();
+}
+
+void ClusteredLighting::build_bounds(glm::mat4 projection)
+{
+    boundsProjection = projection;
+    // The first slice also covers everything closer than the log spacing starts, which would otherwise waste
+    // most slices on the few centimetres in front of the camera
+    sliceDepths[0] = CAMERA_NEAR_PLANE;
+    for (int z = 1; z <= CLUSTER_GRID_Z; z++)
+    {
+        sliceDepths[z] = CLUSTER_NEAR_DEPTH * std::pow(CAMERA_FAR_PLANE / CLUSTER_NEAR_DEPTH, (float)z / CLUSTER_GRID_Z);
+    }
+
+    // Each tile corner is a line through the frustum, from the near plane to the far plane, straight for
+    // orthographic projections, and every slice cuts it at its two depths
+    glm::mat4 inverse = glm::inverse(projection);
+    clusterMin.resize(grid.size());
+    clusterMax.resize(grid.size());
+    for (int y = 0; y < CLUSTER_GRID_Y; y++)
+    {
+        for (int x = 0; x < CLUSTER_GRID_X; x++)
+        {
+            glm::vec3 nearPoints[4], farPoints[4];
+            for (int c = 0; c < 4; c++)
+            {
+                glm::vec2 ndc(-1.0f + 2.0f * (x + (c & 1)) / CLUSTER_GRID_X, -1.0f + 2.0f * (y + (c >> 1)) / CLUSTER_GRID_Y);
+                glm::vec4 nearPoint = inverse * glm::vec4(ndc, -1.0f, 1.0f);
+                glm::vec4 farPoint = inverse * glm::vec4(ndc, 1.0f, 1.0f);
+                nearPoints[c] = glm::vec3(nearPoint) / nearPoint.w;
+                farPoints[c] = glm::vec3(farPoint) / farPoint.w;
+            }
+            for (int z = 0; z < CLUSTER_GRID_Z; z++)
+            {
+                glm::vec3 low(1e30f), high(-1e30f);
+                for (int c = 0; c < 4; c++)
+                {
+                    for (int side = 0; side < 2; side++)
+                    {
+                        float depth = sliceDepths[z + side];
+                        float t = (-depth - nearPoints[c].z) / (farPoints[c].z - nearPoints[c].z);
+                        glm::vec3 point = glm::mix(nearPoints[c], farPoints[c], t);
+                        low = glm::min(low, point);
+                        high = glm::max(high, point);
+                    }
+                }
+                int cluster = (z * CLUSTER_GRID_Y + y) * CLUSTER_GRID_X + x;
+                clusterMin[cluster] = low;
+                clusterMax[cluster] = high;
+            }
+        }
+    }
+}
+
+void ClusteredLighting::assign_slice(int slice)
+{
+    // Lights whose depth range misses the slice are dropped up front, the rest are laid out four to a row
+    float nearDepth = sliceDepths[slice], farDepth = sliceDepths[slice + 1];
+    std::vector<float> soa;
+    std::vector<int> candidates;
+    for (int i = 0; i < clusterLights.size(); i++)
+    {
+        float depth = -clusterLights[i].position.z;
+        if (depth + clusterLights[i].range >= nearDepth && depth - clusterLights[i].range <= farDepth)
+        {
+            candidates.push_back(i);
+        }
+    }
+    int rows = (int)(candidates.size() + 3) / 4;
+    soa.assign(rows * 16, 0.0f);
+    for (int i = 0; i < rows * 4; i++)
+    {
+        float *row = &soa[(i / 4) * 16 + (i % 4)];
+        // Padding lanes sit far away with no reach so they never pass
+        glm::vec4 sphere = (i < candidates.size()) ? glm::vec4(clusterLights[candidates[i]].position, clusterLights[candidates[i]].range) : glm::vec4(1e30f, 1e30f, 1e30f, 0.0f);
+        row[0] = sphere.x;
+        row[4] = sphere.y;
+        row[8] = sphere.z;
+        row[12] = sphere.w * sphere.w;
+    }
+
+    std::vector<unsigned int> &list = sliceLists[slice];
+    list.clear();
+    int tilesPerSlice = CLUSTER_GRID_X * CLUSTER_GRID_Y;
+    for (int tile = 0; tile < tilesPerSlice; tile++)
+    {
+        int cluster = slice * tilesPerSlice + tile;
+        glm::vec3 low = clusterMin[cluster], high = clusterMax[cluster];
+        glm::vec3 center = (low + high) * 0.5f;
+        float radius = glm::length(high - low) * 0.5f;
+        unsigned int first = (unsigned int)list.size();
+        for (int row = 0; row < rows; row++)
+        {
+            const float *lanes = &soa[row * 16];
+            int mask = 0;
+#if CLUSTERED_LIGHTING_SSE2
+            // Distance from each sphere center to the box, four lights at a time
+            __m128 zero = _mm_setzero_ps();
+            __m128 x = _mm_loadu_ps(lanes), y = _mm_loadu_ps(lanes + 4), z = _mm_loadu_ps(lanes + 8);
+            __m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(low.x), x), zero), _mm_max_ps(_mm_sub_ps(x, _mm_set1_ps(high.x)), zero));
+            __m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(low.y), y), zero), _mm_max_ps(_mm_sub_ps(y, _mm_set1_ps(high.y)), zero));
+            __m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(low.z), z), zero), _mm_max_ps(_mm_sub_ps(z, _mm_set1_ps(high.z)), zero));
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            mask = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_loadu_ps(lanes + 12)));
+#else
+            for (int lane = 0; lane < 4; lane++)
+            {
+                glm::vec3 point(lanes[lane], lanes[lane + 4], lanes[lane + 8]);
+                glm::vec3 outside = glm::max(low - point, 0.0f) + glm::max(point - high, 0.0f);
+                mask |= (glm::dot(outside, outside) <= lanes[lane + 12]) ? (1 << lane) : 0;
+            }
+#endif
+            for (int lane = 0; mask; lane++, mask >>= 1)
+            {
+                if (!(mask & 1))
+                {
+                    continue;
+                }
+                const ClusterLight &light = clusterLights[candidates[row * 4 + lane]];
+                // Spot lights passed on their bounding sphere, their cone decides
+                if (light.cosAngle > -1.0f && !sphere_intersects_cone(center, radius, light))
+                {
+                    continue;
+                }
+                list.push_back((unsigned int)light.index);
+            }
+        }
+        grid[cluster] = glm::uvec2(first, (unsigned int)list.size() - first);
+    }
+}
+
+void ClusteredLighting::upload(int buffer, const void *data, size_t size)
+{
+    // The ring gives every frame in flight its own copy, which the texture view is pointed at
+    glBindTexture(GL_TEXTURE_BUFFER, textures[buffer]);
+    if (size > 0 && ring != NULL && ring->is_active() && glFeatures.textureBufferRange)
+    {
+        DynamicAllocation allocation = ring->upload(data, size, textureAlignment);
+        if (allocation.data != NULL)
+        {
+            glTexBufferRange(GL_TEXTURE_BUFFER, bufferFormats[buffer], ring->get_buffer(), allocation.offset, size);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+            return;
+        }
+    }
+    glTexBuffer(GL_TEXTURE_BUFFER, bufferFormats[buffer], buffers[buffer]);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    // Orphaning the old storage lets the driver hand out fresh memory instead of waiting on draws still reading it
+    glBindBuffer(GL_TEXTURE_BUFFER, buffers[buffer]);
+    glBufferData(GL_TEXTURE_BUFFER, glm::max(size, (size_t)16), NULL, GL_STREAM_DRAW);
+    if (size > 0)
+    {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
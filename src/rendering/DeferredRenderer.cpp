@@ -0,0 +1,389 @@
+#include "rendering/DeferredRenderer.h"
+
+// Standard Headers
+#include <cmath>
+
+// G-buffer fragment program of each template shader, in SHADER_TEMPLATE order
+static const char *geometryPaths[] = {"shaders/3dshaders/gbufferColor.fs", "shaders/3dshaders/gbufferTexture.fs", "shaders/3dshaders/gbufferModel.fs"};
+
+// Returns whether a program exists and linked
+static bool is_linked(Shader *program)
+{
+    int status = 0;
+    if (program->id != 0)
+    {
+        glGetProgramiv(program->id, GL_LINK_STATUS, &status);
+    }
+    return status != 0;
+}
+
+bool DeferredRenderer::initialise(ClusteredLighting *lighting_, bool indirect, DynamicBuffer *ring_)
+{
+    ring = ring_;
+    lighting = lighting_;
+    std::string lightingVertex = FileSystem::get_path("shaders/3dshaders/lighting.vs");
+    bool linked = true;
+    for (int i = 0; i < LOADED_SHADERS_COUNT; i++)
+    {
+        geometryPrograms[i].id = 0;
+        geometryPrograms[i].create_shader(lightingVertex.c_str(), FileSystem::get_path(geometryPaths[i]).c_str());
+        linked = linked && is_linked(&geometryPrograms[i]);
+    }
+    if (indirect)
+    {
+        indirectProgram.id = 0;
+        indirectProgram.create_shader(FileSystem::get_path("shaders/3dshaders/lightingIndirect.vs").c_str(),
+                                      FileSystem::get_path(geometryPaths[MODEL_SHADER_3D]).c_str());
+        indirectBuilt = is_linked(&indirectProgram);
+        linked = linked && indirectBuilt;
+    }
+    lightProgram.id = 0;
+    lightProgram.create_shader(FileSystem::get_path("shaders/deferred/deferredLight.vs").c_str(),
+                               FileSystem::get_path("shaders/deferred/deferredLight.fs").c_str());
+    compositeProgram.id = 0;
+    compositeProgram.create_shader(FileSystem::get_path("shaders/post/post.vs").c_str(),
+                                   FileSystem::get_path("shaders/deferred/deferredComposite.fs").c_str());
+    linked = linked && is_linked(&lightProgram) && is_linked(&compositeProgram);
+    if (!linked)
+    {
+        std::cout << "Failed to build deferred shading shaders" << std::endl;
+    }
+
+    glGenVertexArrays(DEFERRED_VOLUME_COUNT, VAOs);
+    glGenBuffers(2, vertexBuffers);
+    glGenBuffers(2, indexBuffers);
+    glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, 16, NULL, GL_STREAM_DRAW);
+
+    // Sphere faces sit closer to the center than their corners, the rings and slices are pushed out to keep
+    // every face outside the unit sphere
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    float pi = glm::pi<float>();
+    float sphereScale = 1.0f / (std::cos(pi / DEFERRED_SPHERE_SLICES) * std::cos(0.5f * pi / DEFERRED_SPHERE_STACKS));
+    for (int stack = 0; stack <= DEFERRED_SPHERE_STACKS; stack++)
+    {
+        float polar = pi * stack / DEFERRED_SPHERE_STACKS;
+        for (int slice = 0; slice <= DEFERRED_SPHERE_SLICES; slice++)
+        {
+            float azimuth = 2.0f * pi * slice / DEFERRED_SPHERE_SLICES;
+            positions.push_back(sphereScale * glm::vec3(std::sin(polar) * std::cos(azimuth), std::cos(polar), std::sin(polar) * std::sin(azimuth)));
+        }
+    }
+    for (int stack = 0; stack < DEFERRED_SPHERE_STACKS; stack++)
+    {
+        for (int slice = 0; slice < DEFERRED_SPHERE_SLICES; slice++)
+        {
+            unsigned int a = stack * (DEFERRED_SPHERE_SLICES + 1) + slice;
+            unsigned int b = a + DEFERRED_SPHERE_SLICES + 1;
+            unsigned int quad[6] = {a, a + 1, b, b, a + 1, b + 1};
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+    build_volume(DEFERRED_SPHERE, positions, indices);
+
+    // Cones open along +z from their apex at the origin to a unit radius cap at z = 1
+    positions.assign(1, glm::vec3(0.0f));
+    indices.clear();
+    float coneScale = 1.0f / std::cos(pi / DEFERRED_CONE_SLICES);
+    for (int slice = 0; slice < DEFERRED_CONE_SLICES; slice++)
+    {
+        float azimuth = 2.0f * pi * slice / DEFERRED_CONE_SLICES;
+        positions.push_back(glm::vec3(coneScale * std::cos(azimuth), coneScale * std::sin(azimuth), 1.0f));
+    }
+    positions.push_back(glm::vec3(0.0f, 0.0f, 1.0f));
+    unsigned int cap = (unsigned int)positions.size() - 1;
+    for (unsigned int slice = 0; slice < DEFERRED_CONE_SLICES; slice++)
+    {
+        unsigned int current = 1 + slice, next = 1 + (slice + 1) % DEFERRED_CONE_SLICES;
+        unsigned int triangles[6] = {0, next, current, cap, current, next};
+        indices.insert(indices.end(), triangles, triangles + 6);
+    }
+    build_volume(DEFERRED_CONE, positions, indices);
+
+    // The full-screen shape builds its triangle from the vertex index and only reads instances
+    glBindVertexArray(VAOs[DEFERRED_FULL_SCREEN]);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return linked;
+}
+
+Shader *DeferredRenderer::get_geometry_program(SHADER_TEMPLATE shader)
+{
+    return &geometryPrograms[(int)shader];
+}
+
+Shader *DeferredRenderer::get_indirect_program()
+{
+    return indirectBuilt ? &indirectProgram : NULL;
+}
+
+void DeferredRenderer::set_frame(glm::mat4 view_, glm::mat4 projection_, glm::vec3 cameraPosition_, glm::vec3 background_, bool blinnPhong_, bool gamma_)
+{
+    view = view_;
+    projection = projection_;
+    cameraPosition = cameraPosition_;
+    background = background_;
+    blinnPhong = blinnPhong_;
+    gamma = gamma_;
+}
+
+void DeferredRenderer::add_passes(RenderGraph *graph, std::function<void()> drawGeometry, int sceneColor, int sceneDepth, const std::vector<int> &shadowMaps, int width, int height, bool depthPrepassed)
+{
+    // Surfaces are stored once, the light accumulation starts out holding their emission
+    int albedo = graph->create_texture("GBuffer Albedo", width, height, GL_RGBA8);
+    int normal = graph->create_texture("GBuffer Normal", width, height, GL_RGBA16F);
+    int specular = graph->create_texture("GBuffer Specular", width, height, GL_RGBA8);
+    int ambient = graph->create_texture("GBuffer Ambient", width, height, GL_RGBA8);
+    int depth = graph->create_texture("GBuffer Depth", width, height, GL_R32F);
+    int accumulation = graph->create_texture("Light Accumulation", width, height, GL_RGBA16F);
+
+    int geometryPass = graph->add_pass("GBuffer", [drawGeometry, depthPrepassed]()
+                                       {
+                                           // Zero depth marks the pixels no geometry covers
+                                           glEnable(GL_DEPTH_TEST);
+                                           glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+                                           glClear(depthPrepassed ? GL_COLOR_BUFFER_BIT : (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+                                           drawGeometry(); });
+    int outputs[7] = {albedo, normal, specular, ambient, depth, accumulation, sceneDepth};
+    for (int i = 0; i < 7; i++)
+    {
+        graph->write(geometryPass, outputs[i]);
+    }
+    for (int i = 0; i < shadowMaps.size(); i++)
+    {
+        graph->read(geometryPass, shadowMaps[i]);
+    }
+
+    int lightPass = graph->add_pass("Deferred Lights", [this, graph, albedo, normal, specular, ambient, depth, width, height]()
+                                    { draw_lights(graph->get_texture(albedo), graph->get_texture(normal), graph->get_texture(specular),
+                                                  graph->get_texture(ambient), graph->get_texture(depth), width, height); });
+    graph->read(lightPass, albedo);
+    graph->read(lightPass, normal);
+    graph->read(lightPass, specular);
+    graph->read(lightPass, ambient);
+    graph->read(lightPass, depth);
+    for (int i = 0; i < shadowMaps.size(); i++)
+    {
+        graph->read(lightPass, shadowMaps[i]);
+    }
+    graph->write(lightPass, accumulation);
+    graph->write(lightPass, sceneDepth);
+
+    int compositePass = graph->add_pass("Deferred Composite", [this, graph, accumulation, depth]()
+                                        {
+                                            glDisable(GL_DEPTH_TEST);
+                                            compositeProgram.use();
+                                            compositeProgram.set_int("lighting", 0);
+                                            compositeProgram.set_int("gDepth", 1);
+                                            compositeProgram.set_vec3("background", background);
+                                            compositeProgram.set_bool("enableGamma", gamma);
+                                            glActiveTexture(GL_TEXTURE0);
+                                            glBindTexture(GL_TEXTURE_2D, graph->get_texture(accumulation));
+                                            glActiveTexture(GL_TEXTURE1);
+                                            glBindTexture(GL_TEXTURE_2D, graph->get_texture(depth));
+                                            glBindVertexArray(VAOs[DEFERRED_FULL_SCREEN]);
+                                            glDrawArrays(GL_TRIANGLES, 0, 3);
+                                            glBindVertexArray(0);
+                                            glActiveTexture(GL_TEXTURE0);
+                                            // Passes after the composite draw into the scene with depth testing, as after the forward pass
+                                            glEnable(GL_DEPTH_TEST); });
+    graph->read(compositePass, accumulation);
+    graph->read(compositePass, depth);
+    graph->write(compositePass, sceneColor);
+}
+
+int DeferredRenderer::get_volume_count()
+{
+    return instanceCount[DEFERRED_SPHERE] + instanceCount[DEFERRED_CONE];
+}
+
+void DeferredRenderer::free_data()
+{
+    for (int i = 0; i < LOADED_SHADERS_COUNT; i++)
+    {
+        geometryPrograms[i].free_data();
+    }
+    if (indirectBuilt)
+    {
+        indirectProgram.free_data();
+        indirectBuilt = false;
+    }
+    lightProgram.free_data();
+    compositeProgram.free_data();
+    if (VAOs[0])
+    {
+        glDeleteVertexArrays(DEFERRED_VOLUME_COUNT, VAOs);
+        glDeleteBuffers(2, vertexBuffers);
+        glDeleteBuffers(2, indexBuffers);
+        glDeleteBuffers(1, &instanceBuffer);
+        for (int i = 0; i < DEFERRED_VOLUME_COUNT; i++)
+        {
+            VAOs[i] = 0;
+        }
+        instanceBuffer = 0;
+    }
+    instances.clear();
+}
+
+void DeferredRenderer::gather_instances()
+{
+    // Point and spot lights are packed first so their light index is also their position in the cluster list
+    const std::vector<ClusterLight> &lights = lighting->get_lights();
+    instances.clear();
+    for (int volume = DEFERRED_SPHERE; volume <= DEFERRED_CONE; volume++)
+    {
+        instanceFirst[volume] = (int)instances.size();
+        for (int i = 0; i < lights.size(); i++)
+        {
+            const ClusterLight &light = lights[i];
+            bool cone = light.cosAngle > -1.0f;
+            if (cone != (volume == DEFERRED_CONE))
+            {
+                continue;
+            }
+            float depth = -light.position.z;
+            if (depth + light.range < CAMERA_NEAR_PLANE || depth - light.range > CAMERA_FAR_PLANE)
+            {
+                continue;
+            }
+            instances.push_back((unsigned int)light.index);
+        }
+        instanceCount[volume] = (int)instances.size() - instanceFirst[volume];
+    }
+    instanceFirst[DEFERRED_FULL_SCREEN] = (int)instances.size();
+    instanceCount[DEFERRED_FULL_SCREEN] = lighting->get_directional_count();
+    for (int i = 0; i < instanceCount[DEFERRED_FULL_SCREEN]; i++)
+    {
+        instances.push_back((unsigned int)(lighting->get_directional_offset() + i));
+    }
+
+    // The ring gives every frame in flight its own copy, the fixed buffer remains as the overflow path
+    if (!instances.empty() && ring != NULL && ring->is_active())
+    {
+        size_t size = instances.size() * sizeof(unsigned int);
+        DynamicAllocation allocation = ring->upload(instances.data(), size, sizeof(unsigned int));
+        if (allocation.data != NULL)
+        {
+            instanceSource = ring->get_buffer();
+            instanceOffset = allocation.offset;
+            return;
+        }
+    }
+    instanceSource = instanceBuffer;
+    instanceOffset = 0;
+
+    // Orphaning the old storage lets the driver hand out fresh memory instead of waiting on last frame's draws
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, glm::max(instances.size() * sizeof(unsigned int), (size_t)16), NULL, GL_STREAM_DRAW);
+    if (!instances.empty())
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(unsigned int), instances.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DeferredRenderer::draw_lights(unsigned int albedo, unsigned int normal, unsigned int specular, unsigned int ambient, unsigned int depth, int width, int height)
+{
+    gather_instances();
+    GLint polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    GLboolean culling = glIsEnabled(GL_CULL_FACE);
+
+    lightProgram.use();
+    lighting->bind_buffers();
+    lighting->set_uniforms(&lightProgram);
+    unsigned int textures[5] = {albedo, normal, specular, ambient, depth};
+    const char *names[5] = {"gAlbedo", "gNormal", "gSpecular", "gAmbient", "gDepth"};
+    for (int i = 0; i < 5; i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        lightProgram.set_int(names[i], i);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    lightProgram.set_mat4("viewProjection", projection * view);
+    lightProgram.set_mat4("inverseViewProjection", glm::inverse(projection * view));
+    lightProgram.set_vec2("depthRange", glm::vec2(CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE));
+    lightProgram.set_vec2("screenSize", glm::vec2((float)width, (float)height));
+    lightProgram.set_vec3("viewPos", cameraPosition);
+    lightProgram.set_bool("enableBlinnPhong", blinnPhong);
+    lightProgram.set_bool("enableGamma", gamma);
+
+    // Lights add onto the emission, every volume is drawn by its back faces so it still covers the screen with
+    // the camera inside it, and a back face in front of the stored depth means the surface lies beyond the light.
+    // Depth clamping keeps volumes reaching past the far plane from being clipped open
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_GEQUAL);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glEnable(GL_DEPTH_CLAMP);
+    for (int volume = DEFERRED_SPHERE; volume <= DEFERRED_CONE; volume++)
+    {
+        if (instanceCount[volume] == 0)
+        {
+            continue;
+        }
+        lightProgram.set_int("volumeType", volume);
+        glBindVertexArray(VAOs[volume]);
+        bind_instances(instanceFirst[volume]);
+        glDrawElementsInstanced(GL_TRIANGLES, indexCounts[volume - DEFERRED_SPHERE], GL_UNSIGNED_INT, 0, instanceCount[volume]);
+    }
+
+    // Directional lights reach every surface and cover the whole screen
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    if (instanceCount[DEFERRED_FULL_SCREEN] > 0)
+    {
+        lightProgram.set_int("volumeType", DEFERRED_FULL_SCREEN);
+        glBindVertexArray(VAOs[DEFERRED_FULL_SCREEN]);
+        bind_instances(instanceFirst[DEFERRED_FULL_SCREEN]);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 3, instanceCount[DEFERRED_FULL_SCREEN]);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDisable(GL_DEPTH_CLAMP);
+    glCullFace(GL_BACK);
+    if (culling)
+    {
+        glEnable(GL_CULL_FACE);
+    }
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+}
+
+void DeferredRenderer::build_volume(int volume, const std::vector<glm::vec3> &positions, const std::vector<unsigned int> &indices)
+{
+    int mesh = volume - DEFERRED_SPHERE;
+    indexCounts[mesh] = (int)indices.size();
+    glBindVertexArray(VAOs[volume]);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[mesh]);
+    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffers[mesh]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DeferredRenderer::bind_instances(int first)
+{
+    // GL 3.3 has no base instance, so each shape starts its instance attribute at its own offset instead
+    glBindBuffer(GL_ARRAY_BUFFER, instanceSource);
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void *)(instanceOffset + first * sizeof(unsigned int)));
+}
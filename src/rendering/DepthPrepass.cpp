@@ -0,0 +1,151 @@
+#include "rendering/DepthPrepass.h"
+
+// Returns whether a program exists and linked
+static bool is_linked(Shader *program)
+{
+    int status = 0;
+    if (program->id != 0)
+    {
+        glGetProgramiv(program->id, GL_LINK_STATUS, &status);
+    }
+    return status != 0;
+}
+
+bool DepthPrepass::initialise(bool indirect)
+{
+    std::string fragmentPath = FileSystem::get_path("shaders/3dshaders/depthOnly.fs");
+    program.id = 0;
+    program.create_shader(FileSystem::get_path("shaders/3dshaders/depthOnly.vs").c_str(), fragmentPath.c_str());
+    coverageProgram.id = 0;
+    coverageProgram.create_shader(FileSystem::get_path("shaders/3dshaders/depthCoverage.vs").c_str(), fragmentPath.c_str());
+    bool linked = is_linked(&program) && is_linked(&coverageProgram);
+    if (indirect)
+    {
+        indirectProgram.id = 0;
+        indirectProgram.create_shader(FileSystem::get_path("shaders/3dshaders/depthIndirect.vs").c_str(), fragmentPath.c_str());
+        indirectBuilt = is_linked(&indirectProgram);
+        linked = linked && indirectBuilt;
+    }
+    if (!linked)
+    {
+        std::cout << "Failed to build depth pre-pass shaders" << std::endl;
+    }
+    glGenVertexArrays(1, &VAO);
+    glGenQueries(RENDER_GRAPH_QUERY_FRAMES, shadedQueries);
+    glGenQueries(RENDER_GRAPH_QUERY_FRAMES, coveredQueries);
+    return linked;
+}
+
+Shader *DepthPrepass::get_program()
+{
+    return &program;
+}
+
+Shader *DepthPrepass::get_indirect_program()
+{
+    return indirectBuilt ? &indirectProgram : NULL;
+}
+
+void DepthPrepass::begin_depth()
+{
+    GeometryPool::get().set_position_only(true);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+}
+
+void DepthPrepass::end_depth()
+{
+    GeometryPool::get().set_position_only(false);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void DepthPrepass::begin_shading(bool prepassed)
+{
+    // Only fragments on the surfaces the pre-pass kept pass, and the depth they match is left untouched
+    if (prepassed)
+    {
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    // Counts are read a few frames late so the CPU never waits on them
+    int slot = frame % RENDER_GRAPH_QUERY_FRAMES;
+    measuring = false;
+    if (pending[slot])
+    {
+        int available = 0;
+        glGetQueryObjectiv(coveredQueries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            return;
+        }
+        GLuint shaded = 0, covered = 0;
+        glGetQueryObjectuiv(shadedQueries[slot], GL_QUERY_RESULT, &shaded);
+        glGetQueryObjectuiv(coveredQueries[slot], GL_QUERY_RESULT, &covered);
+        overdraw = (covered > 0) ? (float)shaded / covered : 1.0f;
+        pending[slot] = false;
+    }
+    glBeginQuery(GL_SAMPLES_PASSED, shadedQueries[slot]);
+    measuring = true;
+}
+
+void DepthPrepass::end_shading()
+{
+    if (measuring)
+    {
+        glEndQuery(GL_SAMPLES_PASSED);
+
+        // Far plane fragments pass a greater test exactly where a surface was drawn, colour and depth stay as they are
+        int slot = frame % RENDER_GRAPH_QUERY_FRAMES;
+        GLint polygonMode[2];
+        glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+        GLboolean culling = glIsEnabled(GL_CULL_FACE);
+        glDisable(GL_CULL_FACE);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_GREATER);
+        glBeginQuery(GL_SAMPLES_PASSED, coveredQueries[slot]);
+        coverageProgram.use();
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glEndQuery(GL_SAMPLES_PASSED);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+        if (culling)
+        {
+            glEnable(GL_CULL_FACE);
+        }
+        pending[slot] = true;
+        frame++;
+        measuring = false;
+    }
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+}
+
+float DepthPrepass::get_overdraw()
+{
+    return overdraw;
+}
+
+void DepthPrepass::free_data()
+{
+    program.free_data();
+    coverageProgram.free_data();
+    if (indirectBuilt)
+    {
+        indirectProgram.free_data();
+        indirectBuilt = false;
+    }
+    if (VAO)
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteQueries(RENDER_GRAPH_QUERY_FRAMES, shadedQueries);
+        glDeleteQueries(RENDER_GRAPH_QUERY_FRAMES, coveredQueries);
+        VAO = 0;
+    }
+}
@@ -0,0 +1,169 @@
+#include "rendering/DynamicBuffer.h"
+
+// Standard Headers
+#include <cstring>
+#include <iostream>
+
+DynamicBuffer::DynamicBuffer()
+{
+}
+
+void DynamicBuffer::initialise(size_t frameSize_)
+{
+    // Keep every region aligned for the largest binding offset alignment drivers report
+    frameSize = (frameSize_ + 255) & ~(size_t)255;
+    frame = 0;
+    head = 0;
+    fences.assign(DYNAMIC_BUFFER_FRAMES, NULL);
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    GLsizeiptr totalSize = (GLsizeiptr)(frameSize * DYNAMIC_BUFFER_FRAMES);
+    if (glFeatures.bufferStorage)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, NULL, flags);
+        mapped = (char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags);
+    }
+    else
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, totalSize, NULL, GL_STREAM_DRAW);
+        staging.resize(frameSize);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+bool DynamicBuffer::is_active()
+{
+    return buffer != 0;
+}
+
+bool DynamicBuffer::is_persistent()
+{
+    return mapped != NULL;
+}
+
+void DynamicBuffer::begin_frame()
+{
+    if (buffer == 0)
+    {
+        return;
+    }
+    frame = (frame + 1) % DYNAMIC_BUFFER_FRAMES;
+    head = 0;
+    GLsync fence = fences[frame];
+    if (fence == NULL)
+    {
+        return;
+    }
+
+    // Only blocks when the CPU runs a full ring ahead of the GPU
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        stallCount++;
+        do
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    fences[frame] = NULL;
+}
+
+void DynamicBuffer::end_frame()
+{
+    if (buffer == 0)
+    {
+        return;
+    }
+    if (fences[frame] != NULL)
+    {
+        glDeleteSync(fences[frame]);
+    }
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+DynamicAllocation DynamicBuffer::allocate(size_t bytes, size_t alignment)
+{
+    DynamicAllocation allocation;
+    size_t start = (head + alignment - 1) / alignment * alignment;
+    if (buffer == 0 || start + bytes > frameSize)
+    {
+        if (buffer != 0 && !overflowReported)
+        {
+            std::cout << "Dynamic buffer frame region full, raise DYNAMIC_BUFFER_FRAME_SIZE" << std::endl;
+            overflowReported = true;
+        }
+        return allocation;
+    }
+    head = start + bytes;
+
+    allocation.offset = frame * frameSize + start;
+    allocation.size = bytes;
+    allocation.data = mapped ? (void *)(mapped + allocation.offset) : (void *)(staging.data() + start);
+    return allocation;
+}
+
+void DynamicBuffer::flush(const DynamicAllocation &allocation)
+{
+    if (mapped || allocation.data == NULL)
+    {
+        return;
+    }
+    // The region's fence has passed, so this copy never waits on the GPU
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.offset, allocation.size, allocation.data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+DynamicAllocation DynamicBuffer::upload(const void *data, size_t bytes, size_t alignment)
+{
+    DynamicAllocation allocation = allocate(bytes, alignment);
+    if (allocation.data != NULL)
+    {
+        memcpy(allocation.data, data, bytes);
+        flush(allocation);
+    }
+    return allocation;
+}
+
+unsigned int DynamicBuffer::get_buffer()
+{
+    return buffer;
+}
+
+size_t DynamicBuffer::get_frame_used()
+{
+    return head;
+}
+
+int DynamicBuffer::get_stall_count()
+{
+    return stallCount;
+}
+
+void DynamicBuffer::free_data()
+{
+    for (int i = 0; i < (int)fences.size(); i++)
+    {
+        if (fences[i] != NULL)
+        {
+            glDeleteSync(fences[i]);
+        }
+    }
+    fences.clear();
+    if (mapped)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        mapped = NULL;
+    }
+    if (buffer != 0)
+    {
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+    staging.clear();
+}
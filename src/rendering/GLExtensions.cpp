@@ -0,0 +1,74 @@
+#include "rendering/GLExtensions.h"
+
+// Third-party Headers
+#include "thirdparty/GLFW/glfw3.h"
+
+PFNGLBUFFERSTORAGEPROC glad_glBufferStorage = NULL;
+PFNGLDISPATCHCOMPUTEPROC glad_glDispatchCompute = NULL;
+PFNGLMEMORYBARRIERPROC glad_glMemoryBarrier = NULL;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glad_glMultiDrawElementsIndirect = NULL;
+PFNGLCLEARBUFFERSUBDATAPROC glad_glClearBufferSubData = NULL;
+PFNGLTEXSTORAGE2DPROC glad_glTexStorage2D = NULL;
+PFNGLTEXBUFFERRANGEPROC glad_glTexBufferRange = NULL;
+
+GLFeatures glFeatures;
+
+void load_gl_extensions()
+{
+    glFeatures = GLFeatures();
+
+    if (has_gl_version(4, 4) || has_gl_extension("GL_ARB_buffer_storage"))
+    {
+        glad_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)glfwGetProcAddress("glBufferStorage");
+        glFeatures.bufferStorage = (glad_glBufferStorage != NULL);
+    }
+
+    if (has_gl_version(4, 3))
+    {
+        // The culling path reads draw records from storage buffers in the vertex stage, which 4.3 makes optional
+        int vertexStorageBlocks = 0;
+        glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &vertexStorageBlocks);
+        glad_glDispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)glfwGetProcAddress("glDispatchCompute");
+        glad_glMemoryBarrier = (PFNGLMEMORYBARRIERPROC)glfwGetProcAddress("glMemoryBarrier");
+        glad_glClearBufferSubData = (PFNGLCLEARBUFFERSUBDATAPROC)glfwGetProcAddress("glClearBufferSubData");
+        glFeatures.computeShader = (glad_glDispatchCompute != NULL && glad_glMemoryBarrier != NULL && glad_glClearBufferSubData != NULL &&
+                                    vertexStorageBlocks > 0);
+    }
+    if (has_gl_version(4, 3) || has_gl_extension("GL_ARB_multi_draw_indirect"))
+    {
+        glad_glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)glfwGetProcAddress("glMultiDrawElementsIndirect");
+        glFeatures.multiDrawIndirect = (glad_glMultiDrawElementsIndirect != NULL);
+    }
+    if (has_gl_version(4, 2) || has_gl_extension("GL_ARB_texture_storage"))
+    {
+        glad_glTexStorage2D = (PFNGLTEXSTORAGE2DPROC)glfwGetProcAddress("glTexStorage2D");
+        glFeatures.textureStorage = (glad_glTexStorage2D != NULL);
+    }
+    if (has_gl_version(4, 3) || has_gl_extension("GL_ARB_texture_buffer_range"))
+    {
+        glad_glTexBufferRange = (PFNGLTEXBUFFERRANGEPROC)glfwGetProcAddress("glTexBufferRange");
+        glFeatures.textureBufferRange = (glad_glTexBufferRange != NULL);
+    }
+}
+
+bool has_gl_extension(const std::string &name)
+{
+    int extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (int i = 0; i < extensionCount; i++)
+    {
+        if (name == (const char *)glGetStringi(GL_EXTENSIONS, i))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool has_gl_version(int major, int minor)
+{
+    int contextMajor = 0, contextMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+    return (contextMajor > major) || (contextMajor == major && contextMinor >= minor);
+}
@@ -0,0 +1,510 @@
+#include "rendering/GeometryPool.h"
+
+// Standard Headers
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+bool GeometryFormat::operator==(const GeometryFormat &other) const
+{
+    if (stride != other.stride || indexType != other.indexType || attributes.size() != other.attributes.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < attributes.size(); i++)
+    {
+        const GeometryAttribute &a = attributes[i];
+        const GeometryAttribute &b = other.attributes[i];
+        if (a.location != b.location || a.count != b.count || a.type != b.type || a.normalized != b.normalized || a.offset != b.offset)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+RangeAllocator::RangeAllocator(size_t capacity_)
+{
+    capacity = capacity_;
+    freeCount = capacity_;
+    if (capacity > 0)
+    {
+        freeBlocks[0] = capacity;
+    }
+}
+
+bool RangeAllocator::allocate(size_t count, size_t *offset)
+{
+    // Best fit keeps large blocks intact for large meshes
+    auto best = freeBlocks.end();
+    for (auto it = freeBlocks.begin(); it != freeBlocks.end(); it++)
+    {
+        if (it->second >= count && (best == freeBlocks.end() || it->second < best->second))
+        {
+            best = it;
+        }
+    }
+    if (best == freeBlocks.end())
+    {
+        return false;
+    }
+
+    *offset = best->first;
+    size_t remaining = best->second - count;
+    freeBlocks.erase(best);
+    if (remaining > 0)
+    {
+        freeBlocks[*offset + count] = remaining;
+    }
+    freeCount -= count;
+    return true;
+}
+
+void RangeAllocator::release(size_t offset, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    freeCount += count;
+
+    // Merge with the following block, then with the preceding one
+    auto next = freeBlocks.lower_bound(offset);
+    if (next != freeBlocks.end() && offset + count == next->first)
+    {
+        count += next->second;
+        next = freeBlocks.erase(next);
+    }
+    if (next != freeBlocks.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += count;
+            return;
+        }
+    }
+    freeBlocks[offset] = count;
+}
+
+size_t RangeAllocator::get_capacity()
+{
+    return capacity;
+}
+
+size_t RangeAllocator::get_free()
+{
+    return freeCount;
+}
+
+int RangeAllocator::get_free_block_count()
+{
+    return (int)freeBlocks.size();
+}
+
+GeometryPool &GeometryPool::get()
+{
+    static GeometryPool pool;
+    return pool;
+}
+
+int GeometryPool::allocate(const GeometryFormat &format, const void *vertexData, size_t vertexCount, const void *indexData, size_t indexCount)
+{
+    int formatIndex = find_format(format);
+    GeometryRange range;
+    range.vertexCount = vertexCount;
+    range.indexCount = indexCount;
+    for (int i = 0; i < (int)pages.size() && range.page < 0; i++)
+    {
+        if (pages[i].format != formatIndex || !pages[i].vertices.allocate(vertexCount, &range.baseVertex))
+        {
+            continue;
+        }
+        if (!pages[i].indices.allocate(indexCount, &range.firstIndex))
+        {
+            pages[i].vertices.release(range.baseVertex, vertexCount);
+            continue;
+        }
+        range.page = i;
+    }
+
+    // Meshes larger than the default capacity get a page of their own size
+    if (range.page < 0)
+    {
+        range.page = create_page(formatIndex, std::max(vertexCount, (size_t)GEOMETRY_POOL_VERTEX_CAPACITY), std::max(indexCount, (size_t)GEOMETRY_POOL_INDEX_CAPACITY));
+        pages[range.page].vertices.allocate(vertexCount, &range.baseVertex);
+        pages[range.page].indices.allocate(indexCount, &range.firstIndex);
+    }
+
+    GeometryPage &page = pages[range.page];
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page.VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, range.baseVertex * format.stride, vertexCount * format.stride, vertexData);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page.EBO);
+    size_t indexSize = get_index_size(format.indexType);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, range.firstIndex * indexSize, indexCount * indexSize, indexData);
+
+    // Depth-only passes fetch only the positions, so they are also kept packed in a stream of their own
+    const GeometryAttribute &position = get_position_attribute(format);
+    size_t positionSize = get_attribute_size(position);
+    std::vector<unsigned char> positions(vertexCount * positionSize);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        memcpy(&positions[i * positionSize], (const unsigned char *)vertexData + i * format.stride + position.offset, positionSize);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page.positionVBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, range.baseVertex * positionSize, positions.size(), positions.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    int handle;
+    if (!freeHandles.empty())
+    {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+        ranges[handle] = range;
+    }
+    else
+    {
+        handle = (int)ranges.size();
+        ranges.push_back(range);
+    }
+    return handle;
+}
+
+void GeometryPool::release(int handle)
+{
+    if (handle < 0 || handle >= (int)ranges.size() || ranges[handle].page < 0)
+    {
+        return;
+    }
+    GeometryRange &range = ranges[handle];
+    pages[range.page].vertices.release(range.baseVertex, range.vertexCount);
+    pages[range.page].indices.release(range.firstIndex, range.indexCount);
+    range = GeometryRange();
+    freeHandles.push_back(handle);
+}
+
+const GeometryRange &GeometryPool::get_range(int handle)
+{
+    return ranges[handle];
+}
+
+void GeometryPool::bind_page(int page)
+{
+    glBindVertexArray(positionOnly ? pages[page].positionVAO : pages[page].VAO);
+}
+
+void GeometryPool::set_position_only(bool enabled)
+{
+    positionOnly = enabled;
+}
+
+GLenum GeometryPool::get_index_type(int page)
+{
+    return formats[pages[page].format].indexType;
+}
+
+const GeometryFormat &GeometryPool::get_format(int page)
+{
+    return formats[pages[page].format];
+}
+
+unsigned int GeometryPool::get_vertex_buffer(int page)
+{
+    return pages[page].VBO;
+}
+
+unsigned int GeometryPool::get_index_buffer(int page)
+{
+    return pages[page].EBO;
+}
+
+size_t GeometryPool::get_index_size(GLenum indexType)
+{
+    return (indexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+size_t GeometryPool::get_used_bytes()
+{
+    size_t used = 0;
+    for (int i = 0; i < (int)pages.size(); i++)
+    {
+        GeometryPage &page = pages[i];
+        if (page.format >= 0)
+        {
+            size_t vertexSize = formats[page.format].stride + get_attribute_size(get_position_attribute(formats[page.format]));
+            used += (page.vertices.get_capacity() - page.vertices.get_free()) * vertexSize;
+            used += (page.indices.get_capacity() - page.indices.get_free()) * get_index_size(formats[page.format].indexType);
+        }
+    }
+    return used;
+}
+
+void GeometryPool::draw(int handle)
+{
+    draw(handle, 0, ranges[handle].indexCount);
+}
+
+void GeometryPool::draw(int handle, size_t firstIndex, size_t indexCount)
+{
+    const GeometryRange &range = ranges[handle];
+    GLenum indexType = get_index_type(range.page);
+    bind_page(range.page);
+    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)indexCount, indexType, (void *)((range.firstIndex + firstIndex) * get_index_size(indexType)), (GLint)range.baseVertex);
+    glBindVertexArray(0);
+}
+
+void GeometryPool::draw_multi(int handle, const GLsizei *counts, const size_t *firstIndices, int drawCount)
+{
+    const GeometryRange &range = ranges[handle];
+    GLenum indexType = get_index_type(range.page);
+    std::vector<void *> offsets(drawCount);
+    std::vector<GLint> baseVertices(drawCount, (GLint)range.baseVertex);
+    for (int i = 0; i < drawCount; i++)
+    {
+        offsets[i] = (void *)((range.firstIndex + firstIndices[i]) * get_index_size(indexType));
+    }
+    bind_page(range.page);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts, indexType, offsets.data(), drawCount, baseVertices.data());
+    glBindVertexArray(0);
+}
+
+void GeometryPool::draw_instanced(int handle, size_t firstIndex, size_t indexCount, unsigned int instanceBuffer, int firstInstance, int instanceCount)
+{
+    const GeometryRange &range = ranges[handle];
+    GLenum indexType = get_index_type(range.page);
+    GLsizei matrixSize = 16 * sizeof(float);
+    bind_page(range.page);
+
+    // The transform columns are bound to the shared vertex array only for this draw
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (int i = 0; i < 4; i++)
+    {
+        glVertexAttribPointer(INSTANCE_TRANSFORM_LOCATION + i, 4, GL_FLOAT, GL_FALSE, matrixSize, (void *)((size_t)firstInstance * matrixSize + i * 4 * sizeof(float)));
+        glVertexAttribDivisor(INSTANCE_TRANSFORM_LOCATION + i, 1);
+        glEnableVertexAttribArray(INSTANCE_TRANSFORM_LOCATION + i);
+    }
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)indexCount, indexType, (void *)((range.firstIndex + firstIndex) * get_index_size(indexType)), instanceCount, (GLint)range.baseVertex);
+    for (int i = 0; i < 4; i++)
+    {
+        glDisableVertexAttribArray(INSTANCE_TRANSFORM_LOCATION + i);
+        glVertexAttribDivisor(INSTANCE_TRANSFORM_LOCATION + i, 0);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryPool::defragment()
+{
+    for (int i = 0; i < (int)pages.size(); i++)
+    {
+        GeometryPage &page = pages[i];
+        if (page.format < 0)
+        {
+            continue;
+        }
+        if (page.vertices.get_free() == page.vertices.get_capacity())
+        {
+            glDeleteVertexArrays(1, &page.VAO);
+            glDeleteVertexArrays(1, &page.positionVAO);
+            glDeleteBuffers(1, &page.VBO);
+            glDeleteBuffers(1, &page.EBO);
+            glDeleteBuffers(1, &page.positionVBO);
+            page = GeometryPage();
+        }
+        else if (page.vertices.get_free_block_count() > GEOMETRY_POOL_DEFRAG_BLOCKS || page.indices.get_free_block_count() > GEOMETRY_POOL_DEFRAG_BLOCKS)
+        {
+            compact_page(i);
+        }
+    }
+}
+
+void GeometryPool::free_data()
+{
+    for (int i = 0; i < (int)pages.size(); i++)
+    {
+        if (pages[i].format >= 0)
+        {
+            glDeleteVertexArrays(1, &pages[i].VAO);
+            glDeleteVertexArrays(1, &pages[i].positionVAO);
+            glDeleteBuffers(1, &pages[i].VBO);
+            glDeleteBuffers(1, &pages[i].EBO);
+            glDeleteBuffers(1, &pages[i].positionVBO);
+        }
+    }
+    pages.clear();
+    formats.clear();
+    ranges.clear();
+    freeHandles.clear();
+    positionOnly = false;
+}
+
+size_t GeometryPool::get_attribute_size(const GeometryAttribute &attribute)
+{
+    switch (attribute.type)
+    {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return attribute.count;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+        return attribute.count * 2;
+    case GL_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+        return 4;
+    default:
+        return attribute.count * 4;
+    }
+}
+
+const GeometryAttribute &GeometryPool::get_position_attribute(const GeometryFormat &format)
+{
+    for (int i = 0; i < (int)format.attributes.size(); i++)
+    {
+        if (format.attributes[i].location == 0)
+        {
+            return format.attributes[i];
+        }
+    }
+    return format.attributes[0];
+}
+
+int GeometryPool::find_format(const GeometryFormat &format)
+{
+    for (int i = 0; i < (int)formats.size(); i++)
+    {
+        if (formats[i] == format)
+        {
+            return i;
+        }
+    }
+    formats.push_back(format);
+    return (int)formats.size() - 1;
+}
+
+int GeometryPool::create_page(int format, size_t vertexCapacity, size_t indexCapacity)
+{
+    // Reuse the slot of a freed page so handles keep pointing at valid indices
+    int index = 0;
+    while (index < (int)pages.size() && pages[index].format >= 0)
+    {
+        index++;
+    }
+    if (index == (int)pages.size())
+    {
+        pages.push_back(GeometryPage());
+    }
+
+    GeometryPage &page = pages[index];
+    page.format = format;
+    page.vertices = RangeAllocator(vertexCapacity);
+    page.indices = RangeAllocator(indexCapacity);
+    glGenVertexArrays(1, &page.VAO);
+    glGenVertexArrays(1, &page.positionVAO);
+    glGenBuffers(1, &page.VBO);
+    glGenBuffers(1, &page.EBO);
+    glGenBuffers(1, &page.positionVBO);
+    create_storage(GL_COPY_WRITE_BUFFER, page.VBO, vertexCapacity * formats[format].stride);
+    create_storage(GL_COPY_WRITE_BUFFER, page.EBO, indexCapacity * get_index_size(formats[format].indexType));
+    create_storage(GL_COPY_WRITE_BUFFER, page.positionVBO, vertexCapacity * get_attribute_size(get_position_attribute(formats[format])));
+    setup_page_vao(&page);
+    return index;
+}
+
+void GeometryPool::create_storage(GLenum target, unsigned int buffer, GLsizeiptr size)
+{
+    glBindBuffer(target, buffer);
+    if (glFeatures.bufferStorage)
+    {
+        glBufferStorage(target, size, NULL, GL_DYNAMIC_STORAGE_BIT);
+    }
+    else
+    {
+        glBufferData(target, size, NULL, GL_STATIC_DRAW);
+    }
+    glBindBuffer(target, 0);
+}
+
+void GeometryPool::setup_page_vao(GeometryPage *page)
+{
+    const GeometryFormat &format = formats[page->format];
+    glBindVertexArray(page->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, page->VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->EBO);
+    for (int i = 0; i < (int)format.attributes.size(); i++)
+    {
+        const GeometryAttribute &attribute = format.attributes[i];
+        glVertexAttribPointer(attribute.location, attribute.count, attribute.type, attribute.normalized, format.stride, (void *)attribute.offset);
+        glEnableVertexAttribArray(attribute.location);
+    }
+
+    // The position stream shares the index buffer, and the same base vertex finds a mesh's positions in it
+    const GeometryAttribute &position = get_position_attribute(format);
+    glBindVertexArray(page->positionVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, page->positionVBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->EBO);
+    glVertexAttribPointer(position.location, position.count, position.type, position.normalized, (GLsizei)get_attribute_size(position), (void *)0);
+    glEnableVertexAttribArray(position.location);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryPool::compact_page(int pageIndex)
+{
+    GeometryPage &page = pages[pageIndex];
+    GLsizei stride = formats[page.format].stride;
+    size_t indexSize = get_index_size(formats[page.format].indexType);
+    size_t positionSize = get_attribute_size(get_position_attribute(formats[page.format]));
+    unsigned int oldVBO = page.VBO;
+    unsigned int oldEBO = page.EBO;
+    unsigned int oldPositionVBO = page.positionVBO;
+    glGenBuffers(1, &page.VBO);
+    glGenBuffers(1, &page.EBO);
+    glGenBuffers(1, &page.positionVBO);
+    create_storage(GL_COPY_WRITE_BUFFER, page.VBO, page.vertices.get_capacity() * stride);
+    create_storage(GL_COPY_WRITE_BUFFER, page.EBO, page.indices.get_capacity() * indexSize);
+    create_storage(GL_COPY_WRITE_BUFFER, page.positionVBO, page.vertices.get_capacity() * positionSize);
+
+    // Pack live ranges in their current order, indices stay relative to the base vertex
+    std::vector<int> live;
+    for (int i = 0; i < (int)ranges.size(); i++)
+    {
+        if (ranges[i].page == pageIndex)
+        {
+            live.push_back(i);
+        }
+    }
+    std::sort(live.begin(), live.end(), [&](int a, int b)
+              { return ranges[a].baseVertex < ranges[b].baseVertex; });
+
+    RangeAllocator vertices(page.vertices.get_capacity());
+    RangeAllocator indices(page.indices.get_capacity());
+    for (int i = 0; i < (int)live.size(); i++)
+    {
+        GeometryRange &range = ranges[live[i]];
+        size_t baseVertex, firstIndex;
+        vertices.allocate(range.vertexCount, &baseVertex);
+        indices.allocate(range.indexCount, &firstIndex);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, oldVBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, page.VBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range.baseVertex * stride, baseVertex * stride, range.vertexCount * stride);
+        glBindBuffer(GL_COPY_READ_BUFFER, oldEBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, page.EBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range.firstIndex * indexSize, firstIndex * indexSize, range.indexCount * indexSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, oldPositionVBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, page.positionVBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range.baseVertex * positionSize, baseVertex * positionSize, range.vertexCount * positionSize);
+        range.baseVertex = baseVertex;
+        range.firstIndex = firstIndex;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    page.vertices = vertices;
+    page.indices = indices;
+    glDeleteBuffers(1, &oldVBO);
+    glDeleteBuffers(1, &oldEBO);
+    glDeleteBuffers(1, &oldPositionVBO);
+    setup_page_vao(&page);
+}
@@ -0,0 +1,314 @@
+#include "rendering/IndirectRenderer.h"
+
+// Third-party Headers
+#include "thirdparty/glm/gtc/constants.hpp"
+
+// Custom Headers
+#include "rendering/Camera.h"
+
+// Standard Headers
+#include <algorithm>
+#include <cstring>
+
+IndirectRenderer::IndirectRenderer()
+{
+}
+
+bool IndirectRenderer::initialise(const char *vertexPath, const char *fragmentPath, const char *cullPath, DynamicBuffer *ring_)
+{
+    active = false;
+    ring = ring_;
+    if (!glFeatures.computeShader || !glFeatures.multiDrawIndirect)
+    {
+        return false;
+    }
+
+    shader.id = 0;
+    cullShader.id = 0;
+    shader.create_shader(vertexPath, fragmentPath);
+    cullShader.create_compute_shader(cullPath);
+    int shaderLinked = 0, cullLinked = 0;
+    if (shader.id != 0)
+    {
+        glGetProgramiv(shader.id, GL_LINK_STATUS, &shaderLinked);
+    }
+    if (cullShader.id != 0)
+    {
+        glGetProgramiv(cullShader.id, GL_LINK_STATUS, &cullLinked);
+    }
+    if (!shaderLinked || !cullLinked)
+    {
+        std::cout << "Failed to build indirect draw shaders, using the classic path" << std::endl;
+        return false;
+    }
+
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+    glGenBuffers(1, &recordBuffer);
+    glGenBuffers(1, &commandBuffer);
+    glGenBuffers(1, &groupBuffer);
+    glGenBuffers(1, &drawIdBuffer);
+    reserve(INDIRECT_INITIAL_RECORDS);
+    active = true;
+    return true;
+}
+
+bool IndirectRenderer::is_active()
+{
+    return active;
+}
+
+void IndirectRenderer::begin_frame()
+{
+    records.clear();
+    groups.clear();
+    maxIndexCount = 0;
+}
+
+void IndirectRenderer::add_model(Model *model, glm::mat4 matrix, float shininess, int lod, bool useMeshlets)
+{
+    for (int i = 0; i < model->meshes.size(); i++)
+    {
+        Mesh *mesh = &(model->meshes[i]);
+        if (mesh->geometry < 0)
+        {
+            continue;
+        }
+        const GeometryRange &range = GeometryPool::get().get_range(mesh->geometry);
+        const MeshLod &level = mesh->get_lod(lod);
+        int group = find_group(mesh, range.page, shininess);
+
+        // Clusters of the full level become records of their own, so the compute pass culls them one by one
+        Meshlet whole = {glm::vec4(mesh->boundsCenter, mesh->boundsRadius), glm::vec4(0.0f, 0.0f, 1.0f, glm::pi<float>()),
+                         (unsigned int)level.firstIndex, (unsigned int)level.indexCount};
+        const Meshlet *parts = &whole;
+        int partCount = 1;
+        if (useMeshlets && lod == 0 && !mesh->meshlets.empty())
+        {
+            parts = mesh->meshlets.data();
+            partCount = (int)mesh->meshlets.size();
+        }
+
+        // Every node instance of a mesh is its own record, culled on its own
+        for (int j = 0; j < model->meshNodes[i].size(); j++)
+        {
+            glm::mat4 instance = matrix * model->get_instance_transform(i, j);
+            for (int k = 0; k < partCount; k++)
+            {
+                IndirectRecord record;
+                record.model = instance;
+                record.bounds = parts[k].bounds;
+                record.cone = parts[k].cone;
+                record.positionOffset = glm::vec4(mesh->positionOffset, 0.0f);
+                record.positionScale = glm::vec4(mesh->positionScale, 0.0f);
+                record.indexCount = parts[k].indexCount;
+                record.firstIndex = (unsigned int)range.firstIndex + parts[k].firstIndex;
+                record.baseVertex = (unsigned int)range.baseVertex;
+                record.group = (unsigned int)group;
+                groups[record.group].commandCount++;
+                maxIndexCount = std::max(maxIndexCount, record.indexCount);
+                records.push_back(record);
+            }
+        }
+    }
+}
+
+int IndirectRenderer::get_record_count()
+{
+    return (int)records.size();
+}
+
+unsigned int IndirectRenderer::get_max_index_count()
+{
+    return maxIndexCount;
+}
+
+const std::vector<IndirectGroup> &IndirectRenderer::get_groups()
+{
+    return groups;
+}
+
+void IndirectRenderer::bind_records()
+{
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, recordSource, recordOffset, records.size() * sizeof(IndirectRecord));
+}
+
+void IndirectRenderer::cull(glm::mat4 viewProjection, glm::vec3 cameraPosition, bool coneCulling)
+{
+    if (records.empty())
+    {
+        return;
+    }
+    reserve(records.size());
+
+    // Each group owns a run of slots, the compute pass packs its visible draws to the front of the run
+    groupSlots.resize(groups.size() * 2);
+    int firstCommand = 0;
+    for (int i = 0; i < (int)groups.size(); i++)
+    {
+        groups[i].firstCommand = firstCommand;
+        groupSlots[i * 2] = (unsigned int)firstCommand;
+        groupSlots[i * 2 + 1] = 0;
+        firstCommand += groups[i].commandCount;
+    }
+
+    // The ring gives each frame in flight its own records and commands, the fixed buffers remain as the overflow path
+    if (!upload_to_ring())
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, recordBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, records.size() * sizeof(IndirectRecord), records.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, groupBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, groupSlots.size() * sizeof(unsigned int), groupSlots.data(), GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, recordBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, groupBuffer);
+        recordSource = recordBuffer;
+        recordOffset = 0;
+        commandSource = commandBuffer;
+        commandOffset = 0;
+    }
+    // Slots of culled draws must read as zero instances, cleared on the GPU so no CPU copy waits on earlier draws
+    size_t commandBytes = records.size() * sizeof(IndirectCommand);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandSource);
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, commandOffset, commandBytes, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glm::vec4 planes[6];
+    get_frustum_planes(viewProjection, planes);
+    cullShader.use();
+    glUniform4fv(glGetUniformLocation(cullShader.id, "frustumPlanes"), 6, &planes[0][0]);
+    glUniform1ui(glGetUniformLocation(cullShader.id, "recordCount"), (unsigned int)records.size());
+    cullShader.set_vec3("cameraPosition", cameraPosition);
+    cullShader.set_bool("coneCulling", coneCulling);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, commandSource, commandOffset, commandBytes);
+    glDispatchCompute((GLuint)((records.size() + INDIRECT_CULL_GROUP_SIZE - 1) / INDIRECT_CULL_GROUP_SIZE), 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void IndirectRenderer::draw(Shader *program)
+{
+    if (records.empty())
+    {
+        return;
+    }
+    program = program ? program : &shader;
+    program->use();
+    bind_records();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandSource);
+    for (int i = 0; i < (int)groups.size(); i++)
+    {
+        IndirectGroup &group = groups[i];
+        group.mesh->bind_textures(program);
+        program->set_float("mat.shininess", group.shininess);
+        bind_draw_ids(group.page);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GeometryPool::get().get_index_type(group.page), (void *)(commandOffset + group.firstCommand * sizeof(IndirectCommand)), group.commandCount, 0);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void IndirectRenderer::free_data()
+{
+    if (recordBuffer != 0)
+    {
+        glDeleteBuffers(1, &recordBuffer);
+        glDeleteBuffers(1, &commandBuffer);
+        glDeleteBuffers(1, &groupBuffer);
+        glDeleteBuffers(1, &drawIdBuffer);
+        recordBuffer = commandBuffer = groupBuffer = drawIdBuffer = 0;
+    }
+    if (active)
+    {
+        shader.free_data();
+        cullShader.free_data();
+    }
+    bufferCapacity = 0;
+    active = false;
+}
+
+int IndirectRenderer::find_group(Mesh *mesh, int page, float shininess)
+{
+    for (int i = 0; i < (int)groups.size(); i++)
+    {
+        IndirectGroup &group = groups[i];
+        if (group.page != page || group.shininess != shininess || group.mesh->bindings.size() != mesh->bindings.size())
+        {
+            continue;
+        }
+        bool sameTextures = true;
+        for (int j = 0; j < mesh->bindings.size() && sameTextures; j++)
+        {
+            sameTextures = (group.mesh->bindings[j].texture == mesh->bindings[j].texture &&
+                            group.mesh->bindings[j].uniform == mesh->bindings[j].uniform);
+        }
+        if (sameTextures)
+        {
+            return i;
+        }
+    }
+    groups.push_back({page, mesh, shininess, 0, 0});
+    return (int)groups.size() - 1;
+}
+
+void IndirectRenderer::reserve(size_t count)
+{
+    if (count <= bufferCapacity)
+    {
+        return;
+    }
+    bufferCapacity = std::max(count, bufferCapacity * 2);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, recordBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, bufferCapacity * sizeof(IndirectRecord), NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, bufferCapacity * sizeof(IndirectCommand), NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    std::vector<unsigned int> drawIds(bufferCapacity);
+    for (size_t i = 0; i < bufferCapacity; i++)
+    {
+        drawIds[i] = (unsigned int)i;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+    glBufferData(GL_ARRAY_BUFFER, bufferCapacity * sizeof(unsigned int), drawIds.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool IndirectRenderer::upload_to_ring()
+{
+    if (ring == NULL || !ring->is_active())
+    {
+        return false;
+    }
+    size_t recordBytes = records.size() * sizeof(IndirectRecord);
+    size_t slotBytes = groupSlots.size() * sizeof(unsigned int);
+    size_t commandBytes = records.size() * sizeof(IndirectCommand);
+    DynamicAllocation recordAllocation = ring->allocate(recordBytes, storageAlignment);
+    DynamicAllocation slotAllocation = ring->allocate(slotBytes, storageAlignment);
+    DynamicAllocation commandAllocation = ring->allocate(commandBytes, storageAlignment);
+    if (recordAllocation.data == NULL || slotAllocation.data == NULL || commandAllocation.data == NULL)
+    {
+        return false;
+    }
+    memcpy(recordAllocation.data, records.data(), recordBytes);
+    memcpy(slotAllocation.data, groupSlots.data(), slotBytes);
+    ring->flush(recordAllocation);
+    ring->flush(slotAllocation);
+
+    recordSource = ring->get_buffer();
+    recordOffset = recordAllocation.offset;
+    commandSource = recordSource;
+    commandOffset = commandAllocation.offset;
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, recordSource, recordOffset, recordBytes);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, recordSource, slotAllocation.offset, slotBytes);
+    return true;
+}
+
+void IndirectRenderer::bind_draw_ids(int page)
+{
+    // Instanced attributes start at baseInstance, which carries the record index of each command
+    GeometryPool::get().bind_page(page);
+    glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+    glVertexAttribIPointer(INDIRECT_DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, 0, (void *)0);
+    glVertexAttribDivisor(INDIRECT_DRAW_ID_LOCATION, 1);
+    glEnableVertexAttribArray(INDIRECT_DRAW_ID_LOCATION);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
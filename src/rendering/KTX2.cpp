@@ -0,0 +1,412 @@
+#include "rendering/KTX2.h"
+
+// Standard Headers
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+// File identifier every KTX2 file starts with
+static const unsigned char ktx2Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// Vulkan format values used by the container
+enum VK_FORMAT
+{
+    VK_FORMAT_R8_UNORM = 9,
+    VK_FORMAT_R8G8B8_UNORM = 23,
+    VK_FORMAT_R8G8B8_SRGB = 29,
+    VK_FORMAT_R8G8B8A8_UNORM = 37,
+    VK_FORMAT_R8G8B8A8_SRGB = 43,
+    VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131,
+    VK_FORMAT_BC1_RGB_SRGB_BLOCK = 132,
+    VK_FORMAT_BC3_UNORM_BLOCK = 137,
+    VK_FORMAT_BC3_SRGB_BLOCK = 138,
+    VK_FORMAT_BC4_UNORM_BLOCK = 139,
+    VK_FORMAT_BC5_UNORM_BLOCK = 141,
+    VK_FORMAT_BC7_UNORM_BLOCK = 145,
+    VK_FORMAT_BC7_SRGB_BLOCK = 146,
+};
+
+// Fixed size header following the identifier
+struct KTX2Header
+{
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+};
+
+// Offsets of the descriptor, metadata and supercompression sections
+struct KTX2Index
+{
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+// Location of one mip level in the file
+struct KTX2Level
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// Returns the Vulkan format for a cooked texture
+static uint32_t get_vk_format(const CookedTexture &texture)
+{
+    switch (texture.format)
+    {
+    case COMPRESSION_BC1:
+        return (texture.gamma) ? (VK_FORMAT_BC1_RGB_SRGB_BLOCK) : (VK_FORMAT_BC1_RGB_UNORM_BLOCK);
+    case COMPRESSION_BC3:
+        return (texture.gamma) ? (VK_FORMAT_BC3_SRGB_BLOCK) : (VK_FORMAT_BC3_UNORM_BLOCK);
+    case COMPRESSION_BC4:
+        return VK_FORMAT_BC4_UNORM_BLOCK;
+    case COMPRESSION_BC5:
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    case COMPRESSION_BC7:
+        return (texture.gamma) ? (VK_FORMAT_BC7_SRGB_BLOCK) : (VK_FORMAT_BC7_UNORM_BLOCK);
+    default:
+        break;
+    }
+    if (texture.components == 1)
+    {
+        return VK_FORMAT_R8_UNORM;
+    }
+    if (texture.components == 3)
+    {
+        return (texture.gamma) ? (VK_FORMAT_R8G8B8_SRGB) : (VK_FORMAT_R8G8B8_UNORM);
+    }
+    return (texture.gamma) ? (VK_FORMAT_R8G8B8A8_SRGB) : (VK_FORMAT_R8G8B8A8_UNORM);
+}
+
+// Fills the cooked texture format fields from a Vulkan format
+static bool set_vk_format(uint32_t vkFormat, CookedTexture *texture)
+{
+    switch (vkFormat)
+    {
+    case VK_FORMAT_R8_UNORM:
+        *texture = {0, 0, 1, false};
+        break;
+    case VK_FORMAT_R8G8B8_UNORM:
+    case VK_FORMAT_R8G8B8_SRGB:
+        *texture = {0, 0, 3, vkFormat == VK_FORMAT_R8G8B8_SRGB};
+        break;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        *texture = {0, 0, 4, vkFormat == VK_FORMAT_R8G8B8A8_SRGB};
+        break;
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        *texture = {0, 0, 3, vkFormat == VK_FORMAT_BC1_RGB_SRGB_BLOCK, COMPRESSION_BC1};
+        break;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        *texture = {0, 0, 4, vkFormat == VK_FORMAT_BC3_SRGB_BLOCK, COMPRESSION_BC3};
+        break;
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+        *texture = {0, 0, 1, false, COMPRESSION_BC4};
+        break;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        *texture = {0, 0, 2, false, COMPRESSION_BC5};
+        break;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        *texture = {0, 0, 4, vkFormat == VK_FORMAT_BC7_SRGB_BLOCK, COMPRESSION_BC7};
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+// Returns the size of one texel block in bytes
+static uint32_t get_texel_block_size(const CookedTexture &texture)
+{
+    if (texture.format != COMPRESSION_NONE)
+    {
+        return TextureCompression::get_block_size(texture.format);
+    }
+    return texture.components;
+}
+
+// Builds the basic data format descriptor for a cooked texture
+static std::vector<uint32_t> build_dfd(const CookedTexture &texture)
+{
+    // Color models and channel ids from the Khronos data format specification
+    struct Sample
+    {
+        uint32_t channel;
+        uint32_t bitOffset;
+        uint32_t bitLength;
+        uint32_t upper;
+    };
+    uint32_t colorModel = 1;
+    std::vector<Sample> samples;
+    bool compressed = texture.format != COMPRESSION_NONE;
+    switch (texture.format)
+    {
+    case COMPRESSION_BC1:
+        colorModel = 128;
+        samples = {{0, 0, 64, 0xFFFFFFFF}};
+        break;
+    case COMPRESSION_BC3:
+        colorModel = 130;
+        samples = {{15, 0, 64, 0xFFFFFFFF}, {0, 64, 64, 0xFFFFFFFF}};
+        break;
+    case COMPRESSION_BC4:
+        colorModel = 131;
+        samples = {{0, 0, 64, 0xFFFFFFFF}};
+        break;
+    case COMPRESSION_BC5:
+        colorModel = 132;
+        samples = {{0, 0, 64, 0xFFFFFFFF}, {1, 64, 64, 0xFFFFFFFF}};
+        break;
+    case COMPRESSION_BC7:
+        colorModel = 134;
+        samples = {{0, 0, 128, 0xFFFFFFFF}};
+        break;
+    default:
+    {
+        static const uint32_t channels[4] = {0, 1, 2, 15};
+        for (int c = 0; c < texture.components; c++)
+        {
+            samples.push_back({channels[(texture.components == 1) ? 0 : c], (uint32_t)c * 8, 8, 255});
+        }
+        break;
+    }
+    }
+
+    uint32_t blockSize = 24 + 16 * (uint32_t)samples.size();
+    uint32_t bytesPlane = get_texel_block_size(texture);
+    uint32_t transfer = (texture.gamma) ? 2 : 1;
+    uint32_t dims = (compressed) ? (3 | (3 << 8)) : 0;
+
+    std::vector<uint32_t> dfd;
+    dfd.push_back(4 + blockSize);
+    dfd.push_back(0);
+    dfd.push_back(2 | (blockSize << 16));
+    dfd.push_back(colorModel | (1 << 8) | (transfer << 16));
+    dfd.push_back(dims);
+    dfd.push_back(bytesPlane);
+    dfd.push_back(0);
+    for (const Sample &sample : samples)
+    {
+        // Alpha stays linear in sRGB textures
+        uint32_t qualifiers = (texture.gamma && sample.channel == 15) ? 0x10 : 0;
+        dfd.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | ((sample.channel | qualifiers) << 24));
+        dfd.push_back(0);
+        dfd.push_back(0);
+        dfd.push_back(sample.upper);
+    }
+    return dfd;
+}
+
+// Rounds a value up to a multiple of an alignment
+static uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+    return ((value + alignment - 1) / alignment) * alignment;
+}
+
+// Returns the byte size of one mip level, rounding compressed levels up to whole 4x4 blocks
+static uint64_t get_level_size(const CookedTexture &texture, uint32_t width, uint32_t height)
+{
+    if (texture.format != COMPRESSION_NONE)
+    {
+        return ((width + 3) / 4) * (uint64_t)((height + 3) / 4) * get_texel_block_size(texture);
+    }
+    return (uint64_t)width * height * get_texel_block_size(texture);
+}
+
+// Returns whether a byte range lies entirely inside a file of the given size
+static bool in_file(uint64_t offset, uint64_t length, uint64_t fileSize)
+{
+    return offset <= fileSize && length <= fileSize - offset;
+}
+
+bool KTX2::write(const std::string &path, const CookedTexture &texture, const std::map<std::string, std::string> &metadata)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+
+    uint32_t levelCount = (uint32_t)texture.mips.size();
+    std::vector<uint32_t> dfd = build_dfd(texture);
+
+    // Key/value pairs are sorted by key, which std::map already guarantees
+    std::vector<unsigned char> kvd;
+    for (const auto &pair : metadata)
+    {
+        uint32_t length = (uint32_t)(pair.first.size() + 1 + pair.second.size() + 1);
+        kvd.insert(kvd.end(), (unsigned char *)&length, (unsigned char *)&length + 4);
+        kvd.insert(kvd.end(), pair.first.begin(), pair.first.end());
+        kvd.push_back(0);
+        kvd.insert(kvd.end(), pair.second.begin(), pair.second.end());
+        kvd.push_back(0);
+        kvd.resize(align_up(kvd.size(), 4), 0);
+    }
+
+    KTX2Header header = {};
+    header.vkFormat = get_vk_format(texture);
+    header.typeSize = 1;
+    header.pixelWidth = texture.width;
+    header.pixelHeight = texture.height;
+    header.faceCount = 1;
+    header.levelCount = levelCount;
+
+    KTX2Index index = {};
+    index.dfdByteOffset = (uint32_t)(sizeof(ktx2Identifier) + sizeof(KTX2Header) + sizeof(KTX2Index) + levelCount * sizeof(KTX2Level));
+    index.dfdByteLength = (uint32_t)(dfd.size() * 4);
+    index.kvdByteOffset = (kvd.empty()) ? 0 : (index.dfdByteOffset + index.dfdByteLength);
+    index.kvdByteLength = (uint32_t)kvd.size();
+
+    // Levels are stored smallest first, each aligned to the texel block size and 4 bytes
+    uint64_t alignment = get_texel_block_size(texture);
+    while (alignment % 4 != 0)
+    {
+        alignment += get_texel_block_size(texture);
+    }
+    std::vector<KTX2Level> levels(levelCount);
+    uint64_t offset = index.dfdByteOffset + index.dfdByteLength + index.kvdByteLength;
+    for (int level = (int)levelCount - 1; level >= 0; level--)
+    {
+        offset = align_up(offset, alignment);
+        levels[level].byteOffset = offset;
+        levels[level].byteLength = texture.mips[level].data.size();
+        levels[level].uncompressedByteLength = texture.mips[level].data.size();
+        offset += levels[level].byteLength;
+    }
+
+    file.write((const char *)ktx2Identifier, sizeof(ktx2Identifier));
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)&index, sizeof(index));
+    file.write((const char *)levels.data(), levels.size() * sizeof(KTX2Level));
+    file.write((const char *)dfd.data(), dfd.size() * 4);
+    file.write((const char *)kvd.data(), kvd.size());
+
+    uint64_t position = index.dfdByteOffset + index.dfdByteLength + index.kvdByteLength;
+    static const char padding[16] = {};
+    for (int level = (int)levelCount - 1; level >= 0; level--)
+    {
+        file.write(padding, levels[level].byteOffset - position);
+        file.write((const char *)texture.mips[level].data.data(), levels[level].byteLength);
+        position = levels[level].byteOffset + levels[level].byteLength;
+    }
+    return (bool)file;
+}
+
+bool KTX2::read(const std::string &path, CookedTexture *texture, std::map<std::string, std::string> *metadata, int firstLevel, int lastLevel)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return false;
+    }
+    uint64_t fileSize = (uint64_t)file.tellg();
+    file.seekg(0);
+
+    unsigned char identifier[12];
+    KTX2Header header;
+    KTX2Index index;
+    file.read((char *)identifier, sizeof(identifier));
+    file.read((char *)&header, sizeof(header));
+    file.read((char *)&index, sizeof(index));
+    if (!file || std::memcmp(identifier, ktx2Identifier, sizeof(identifier)) != 0 || header.supercompressionScheme != 0 ||
+        header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || !set_vk_format(header.vkFormat, texture))
+    {
+        return false;
+    }
+
+    // A corrupt or truncated file is rejected so the caller recooks the source image
+    uint32_t maxLevelCount = 1;
+    while ((std::max(header.pixelWidth, header.pixelHeight) >> maxLevelCount) > 0)
+    {
+        maxLevelCount++;
+    }
+    uint32_t levelCount = std::max(1u, header.levelCount);
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || levelCount > maxLevelCount ||
+        !in_file(index.kvdByteOffset, index.kvdByteLength, fileSize))
+    {
+        return false;
+    }
+
+    std::vector<KTX2Level> levels(levelCount);
+    file.read((char *)levels.data(), levels.size() * sizeof(KTX2Level));
+    if (!file)
+    {
+        return false;
+    }
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        uint32_t width = std::max(1u, header.pixelWidth >> level);
+        uint32_t height = std::max(1u, header.pixelHeight >> level);
+        if (!in_file(levels[level].byteOffset, levels[level].byteLength, fileSize) ||
+            levels[level].byteLength != get_level_size(*texture, width, height))
+        {
+            return false;
+        }
+    }
+
+    if (metadata && index.kvdByteLength > 0)
+    {
+        std::vector<char> kvd(index.kvdByteLength);
+        file.seekg(index.kvdByteOffset);
+        file.read(kvd.data(), kvd.size());
+        size_t position = 0;
+        while (position + 4 <= kvd.size())
+        {
+            uint32_t length;
+            std::memcpy(&length, &kvd[position], 4);
+            position += 4;
+            if (length == 0 || position + length > kvd.size())
+            {
+                break;
+            }
+            // The key ends at the first NUL inside the entry, an entry without one is malformed
+            const char *keyStart = &kvd[position];
+            const char *keyEnd = (const char *)std::memchr(keyStart, '\0', length);
+            if (!keyEnd)
+            {
+                return false;
+            }
+            std::string key(keyStart, keyEnd);
+            size_t valueStart = position + key.size() + 1;
+            std::string value = (valueStart < position + length) ? std::string(&kvd[valueStart], position + length - valueStart) : "";
+            while (!value.empty() && value.back() == '\0')
+            {
+                value.pop_back();
+            }
+            (*metadata)[key] = value;
+            position = align_up(position + length, 4);
+        }
+    }
+
+    texture->width = header.pixelWidth;
+    texture->height = header.pixelHeight;
+    texture->mips.resize(levelCount);
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        CookedMip &mip = texture->mips[level];
+        mip.width = std::max(1u, header.pixelWidth >> level);
+        mip.height = std::max(1u, header.pixelHeight >> level);
+        if ((int)level < firstLevel || (lastLevel >= 0 && (int)level > lastLevel))
+        {
+            continue;
+        }
+        mip.data.resize(levels[level].byteLength);
+        file.seekg(levels[level].byteOffset);
+        file.read((char *)mip.data.data(), mip.data.size());
+    }
+    return (bool)file;
+}
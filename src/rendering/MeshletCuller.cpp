@@ -0,0 +1,96 @@
+#include "rendering/MeshletCuller.h"
+
+// Third-party Headers
+#include "thirdparty/glm/gtc/constants.hpp"
+
+// Custom Headers
+#include "rendering/Camera.h"
+#include "utility/JobSystem.h"
+
+// Standard Headers
+#include <cmath>
+
+void MeshletCuller::begin_frame(glm::mat4 viewProjection, glm::vec3 cameraPosition_, bool coneCulling_)
+{
+    get_frustum_planes(viewProjection, planes);
+    cameraPosition = cameraPosition_;
+    coneCulling = coneCulling_;
+    testedCount = 0;
+    visibleCount = 0;
+}
+
+void MeshletCuller::cull(const Mesh &mesh, glm::mat4 model, std::vector<MeshLod> *runs)
+{
+    runs->clear();
+    const std::vector<Meshlet> &meshlets = mesh.meshlets;
+    visible.assign(meshlets.size(), 0);
+    int batches = (int)((meshlets.size() + MESHLET_CULL_BATCH - 1) / MESHLET_CULL_BATCH);
+    JobSystem::get().parallel_for(batches, [&](int batch)
+                                  {
+                                      size_t end = glm::min(meshlets.size(), (size_t)(batch + 1) * MESHLET_CULL_BATCH);
+                                      for (size_t i = (size_t)batch * MESHLET_CULL_BATCH; i < end; i++)
+                                      {
+                                          visible[i] = is_visible(meshlets[i].bounds, meshlets[i].cone, model, planes, cameraPosition, coneCulling) ? 1 : 0;
+                                      } });
+
+    // Clusters are stored back to back, so neighbouring survivors merge into one draw
+    for (int i = 0; i < meshlets.size(); i++)
+    {
+        if (!visible[i])
+        {
+            continue;
+        }
+        visibleCount++;
+        if (!runs->empty() && runs->back().firstIndex + runs->back().indexCount == meshlets[i].firstIndex)
+        {
+            runs->back().indexCount += meshlets[i].indexCount;
+        }
+        else
+        {
+            runs->push_back({meshlets[i].firstIndex, meshlets[i].indexCount});
+        }
+    }
+    testedCount += (int)meshlets.size();
+}
+
+bool MeshletCuller::is_visible(const glm::vec4 &bounds, const glm::vec4 &cone, const glm::mat4 &model, const glm::vec4 planes[6], glm::vec3 cameraPosition, bool coneCulling)
+{
+    glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(bounds), 1.0f));
+    float scale = glm::max(glm::max(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1]))), glm::length(glm::vec3(model[2])));
+    float radius = bounds.w * scale;
+    for (int i = 0; i < 6; i++)
+    {
+        if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+        {
+            return false;
+        }
+    }
+
+    // Mirrored transforms flip the winding, so the cone no longer says which side is culled
+    glm::mat3 normalMatrix = glm::mat3(model);
+    if (!coneCulling || cone.w >= glm::half_pi<float>() || glm::determinant(normalMatrix) <= 0.0f)
+    {
+        return true;
+    }
+    glm::vec3 axis = glm::normalize(glm::transpose(glm::inverse(normalMatrix)) * glm::vec3(cone));
+    glm::vec3 toCenter = center - cameraPosition;
+    float distance = glm::length(toCenter);
+    if (distance <= radius)
+    {
+        return true;
+    }
+    // Back facing when the widest angle between any face normal and any view ray into the sphere stays below 90 degrees
+    float viewAngle = std::acos(glm::clamp(glm::dot(toCenter / distance, axis), -1.0f, 1.0f));
+    float spread = std::asin(radius / distance);
+    return viewAngle + cone.w + spread >= glm::half_pi<float>();
+}
+
+int MeshletCuller::get_tested_count()
+{
+    return testedCount;
+}
+
+int MeshletCuller::get_visible_count()
+{
+    return visibleCount;
+}
@@ -0,0 +1,204 @@
+#include "rendering/PostChain.h"
+
+// Standard Headers
+#include <cmath>
+
+// Fragment program of each effect, in POST_EFFECT order
+static const char *postEffectPaths[] = {"shaders/post/invert.fs", "shaders/post/grayscale.fs", "shaders/post/sharpen.fs",
+                                        "shaders/post/gaussianBlur.fs", "shaders/post/edge.fs", "shaders/post/emboss.fs"};
+
+bool PostChain::initialise()
+{
+    std::string vertexPath = FileSystem::get_path("shaders/post/post.vs");
+    bool linked = true;
+    for (int i = 0; i < POST_EFFECT_COUNT + 2; i++)
+    {
+        Shader *program = (i < POST_EFFECT_COUNT) ? &programs[i] : (i == POST_EFFECT_COUNT) ? &copyProgram : &upscaleProgram;
+        const char *fragmentFile = (i < POST_EFFECT_COUNT) ? postEffectPaths[i] : (i == POST_EFFECT_COUNT) ? "shaders/post/copy.fs" : "shaders/post/upscale.fs";
+        std::string fragmentPath = FileSystem::get_path(fragmentFile);
+        program->id = 0;
+        program->create_shader(vertexPath.c_str(), fragmentPath.c_str());
+        int status = 0;
+        if (program->id != 0)
+        {
+            glGetProgramiv(program->id, GL_LINK_STATUS, &status);
+        }
+        linked = linked && status;
+    }
+    if (!linked)
+    {
+        std::cout << "Failed to build post processing shaders" << std::endl;
+    }
+    glGenVertexArrays(1, &VAO);
+    return linked;
+}
+
+void PostChain::add_stage(POST_EFFECT effect)
+{
+    // Blurs lose nothing visible at half resolution, the 3x3 kernels would lose their one pixel detail
+    PostStage stage;
+    stage.effect = effect;
+    stage.scale = (effect == POST_BLUR) ? 2 : 1;
+    stages.push_back(stage);
+}
+
+void PostChain::add_passes(RenderGraph *graph, int source, int sourceWidth, int sourceHeight, int output, int outputWidth, int outputHeight)
+{
+    int lastStage = -1;
+    for (int i = 0; i < stages.size(); i++)
+    {
+        lastStage = stages[i].enabled ? i : lastStage;
+    }
+
+    // Each stage writes a fresh transient, the pool hands back the ones no longer read so two targets ping-pong
+    passNames.assign(stages.size(), std::vector<std::string>());
+    int input = source;
+    bool resampled = (sourceWidth != outputWidth || sourceHeight != outputHeight);
+    for (int i = 0; i <= lastStage; i++)
+    {
+        const PostStage &stage = stages[i];
+        if (!stage.enabled)
+        {
+            continue;
+        }
+        int scale = glm::max(stage.scale, 1);
+        int stageWidth = glm::max(sourceWidth / scale, 1);
+        int stageHeight = glm::max(sourceHeight / scale, 1);
+        std::string name = "Post " + std::to_string(i + 1) + ": " + postEffectNames[stage.effect];
+        // The last stage writes straight into the output instead of going through a copy when their sizes match
+        bool direct = (i == lastStage && stageWidth == outputWidth && stageHeight == outputHeight);
+        int result = direct ? output : graph->create_texture(name, stageWidth, stageHeight, GL_RGB8);
+
+        if (stage.effect == POST_BLUR)
+        {
+            // Both directions blur with the sigma scaled to the stage resolution, the first also resamples the input
+            float sigma = blurSigma / scale;
+            int horizontal = graph->create_texture(name + " H", stageWidth, stageHeight, GL_RGB8);
+            int in = input;
+            int horizontalPass = graph->add_pass(name + " H", [this, graph, in, stageWidth, sigma]()
+                                                 { draw_blur(graph->get_texture(in), glm::vec2(1.0f / stageWidth, 0.0f), sigma); });
+            graph->read(horizontalPass, input);
+            graph->write(horizontalPass, horizontal);
+            int verticalPass = graph->add_pass(name + " V", [this, graph, horizontal, stageHeight, sigma]()
+                                               { draw_blur(graph->get_texture(horizontal), glm::vec2(0.0f, 1.0f / stageHeight), sigma); });
+            graph->read(verticalPass, horizontal);
+            graph->write(verticalPass, result);
+            passNames[i].push_back(name + " H");
+            passNames[i].push_back(name + " V");
+        }
+        else
+        {
+            int in = input;
+            POST_EFFECT effect = stage.effect;
+            int pass = graph->add_pass(name, [this, graph, in, effect]()
+                                       {
+                                           programs[effect].use();
+                                           programs[effect].set_float("offset", kernelOffset);
+                                           draw(&programs[effect], graph->get_texture(in)); });
+            graph->read(pass, input);
+            graph->write(pass, result);
+            passNames[i].push_back(name);
+        }
+        input = result;
+        resampled = (stageWidth != outputWidth || stageHeight != outputHeight);
+        if (direct)
+        {
+            return;
+        }
+    }
+
+    // Reduced resolution results are upscaled into the output, an empty chain at the output size is copied
+    int in = input;
+    Shader *program = (resampled && upscaleFilter == POST_UPSCALE_EDGE) ? &upscaleProgram : &copyProgram;
+    int present = graph->add_pass(resampled ? "Post Upscale" : "Post Copy", [this, graph, in, program]()
+                                  {
+                                      program->use();
+                                      program->set_float("sharpness", upscaleSharpness);
+                                      draw(program, graph->get_texture(in)); });
+    graph->read(present, input);
+    graph->write(present, output);
+}
+
+float PostChain::get_stage_time(RenderGraph *graph, int stage)
+{
+    float time = 0.0f;
+    if (stage >= passNames.size())
+    {
+        return time;
+    }
+    const std::map<std::string, RenderGraphTiming> &timings = graph->get_timings();
+    for (int i = 0; i < passNames[stage].size(); i++)
+    {
+        std::map<std::string, RenderGraphTiming>::const_iterator found = timings.find(passNames[stage][i]);
+        time += (found != timings.end()) ? found->second.gpuTime : 0.0f;
+    }
+    return time;
+}
+
+int PostChain::get_blur_taps(float sigma, float *offsets, float *weights)
+{
+    // Discrete weights out to three sigma, clamped to what the taps can reach
+    sigma = glm::max(sigma, 0.1f);
+    int radius = glm::min((int)std::ceil(3.0f * sigma), 2 * (POST_BLUR_MAX_TAPS - 1));
+    std::vector<float> discrete(radius + 2, 0.0f);
+    float total = 0.0f;
+    for (int i = 0; i <= radius; i++)
+    {
+        discrete[i] = std::exp(-(float)(i * i) / (2.0f * sigma * sigma));
+        total += (i == 0) ? discrete[i] : 2.0f * discrete[i];
+    }
+
+    // Pairs of neighbouring texels become one bilinear tap placed at their weighted center
+    offsets[0] = 0.0f;
+    weights[0] = discrete[0] / total;
+    int taps = 1;
+    for (int i = 1; i <= radius; i += 2)
+    {
+        float weight = discrete[i] + discrete[i + 1];
+        offsets[taps] = (i * discrete[i] + (i + 1) * discrete[i + 1]) / weight;
+        weights[taps] = weight / total;
+        taps++;
+    }
+    return taps;
+}
+
+void PostChain::free_data()
+{
+    for (int i = 0; i < POST_EFFECT_COUNT; i++)
+    {
+        programs[i].free_data();
+    }
+    copyProgram.free_data();
+    upscaleProgram.free_data();
+    if (VAO)
+    {
+        glDeleteVertexArrays(1, &VAO);
+        VAO = 0;
+    }
+}
+
+void PostChain::draw_blur(unsigned int texture, glm::vec2 direction, float sigma)
+{
+    Shader *program = &programs[POST_BLUR];
+    float offsets[POST_BLUR_MAX_TAPS], weights[POST_BLUR_MAX_TAPS];
+    int taps = get_blur_taps(sigma, offsets, weights);
+    program->use();
+    program->set_vec2("direction", direction);
+    program->set_int("tapCount", taps);
+    glUniform1fv(glGetUniformLocation(program->id, "offsets"), taps, offsets);
+    glUniform1fv(glGetUniformLocation(program->id, "weights"), taps, weights);
+    draw(program, texture);
+}
+
+void PostChain::draw(Shader *program, unsigned int texture)
+{
+    glDisable(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    program->use();
+    program->set_int("tex", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,401 @@
+#include "rendering/RenderGraph.h"
+
+// Standard Headers
+#include <chrono>
+#include <iostream>
+#include <set>
+
+void RenderGraph::initialise(RenderTargetPool *pool_)
+{
+    pool = pool_;
+}
+
+void RenderGraph::reset()
+{
+    resources.clear();
+    passes.clear();
+    order.clear();
+}
+
+int RenderGraph::create_texture(std::string name, int width, int height, GLenum format)
+{
+    RenderGraphResource resource;
+    resource.name = name;
+    resource.width = width;
+    resource.height = height;
+    resource.format = format;
+    resources.push_back(resource);
+    return (int)resources.size() - 1;
+}
+
+int RenderGraph::import_texture(std::string name, unsigned int texture, int width, int height, GLenum format)
+{
+    int resource = create_texture(name, width, height, format);
+    resources[resource].imported = true;
+    resources[resource].texture = texture;
+    return resource;
+}
+
+int RenderGraph::import_backbuffer(std::string name, int width, int height)
+{
+    return import_texture(name, 0, width, height, GL_RGBA8);
+}
+
+int RenderGraph::add_pass(std::string name, std::function<void()> execute)
+{
+    RenderGraphPass pass;
+    pass.name = name;
+    pass.execute = execute;
+    passes.push_back(pass);
+    return (int)passes.size() - 1;
+}
+
+void RenderGraph::read(int pass, int resource)
+{
+    passes[pass].reads.push_back(resource);
+}
+
+void RenderGraph::write(int pass, int resource)
+{
+    passes[pass].writes.push_back(resource);
+    // Whatever ends up on screen is the point of the frame
+    if (resources[resource].imported && resources[resource].texture == 0)
+    {
+        passes[pass].sideEffect = true;
+    }
+}
+
+void RenderGraph::set_side_effect(int pass)
+{
+    passes[pass].sideEffect = true;
+}
+
+void RenderGraph::set_own_framebuffer(int pass)
+{
+    passes[pass].ownFramebuffer = true;
+}
+
+void RenderGraph::compile()
+{
+    // A pass depends on the writers of everything it touches declared before it, or on every writer when none was
+    // and it only reads the resource, the first writer of a resource depends on nothing through it
+    int passCount = (int)passes.size();
+    std::vector<std::vector<int>> writers(resources.size());
+    for (int i = 0; i < passCount; i++)
+    {
+        for (int j = 0; j < passes[i].writes.size(); j++)
+        {
+            writers[passes[i].writes[j]].push_back(i);
+        }
+    }
+    std::vector<std::set<int>> dependencies(passCount);
+    for (int i = 0; i < passCount; i++)
+    {
+        std::vector<int> used = passes[i].reads;
+        used.insert(used.end(), passes[i].writes.begin(), passes[i].writes.end());
+        for (int j = 0; j < used.size(); j++)
+        {
+            const std::vector<int> &candidates = writers[used[j]];
+            bool earlier = (!candidates.empty() && candidates[0] <= i);
+            for (int k = 0; k < candidates.size(); k++)
+            {
+                if (candidates[k] != i && (!earlier || candidates[k] < i))
+                {
+                    dependencies[i].insert(candidates[k]);
+                }
+            }
+        }
+    }
+
+    // Kahn's algorithm, taking the earliest declared ready pass so independent passes keep their declared order
+    std::vector<int> waiting(passCount, 0);
+    std::vector<std::vector<int>> dependents(passCount);
+    for (int i = 0; i < passCount; i++)
+    {
+        waiting[i] = (int)dependencies[i].size();
+        for (std::set<int>::iterator it = dependencies[i].begin(); it != dependencies[i].end(); it++)
+        {
+            dependents[*it].push_back(i);
+        }
+    }
+    std::set<int> ready;
+    for (int i = 0; i < passCount; i++)
+    {
+        if (waiting[i] == 0)
+        {
+            ready.insert(i);
+        }
+    }
+    std::vector<int> sorted;
+    while (!ready.empty())
+    {
+        int pass = *ready.begin();
+        ready.erase(ready.begin());
+        sorted.push_back(pass);
+        for (int i = 0; i < dependents[pass].size(); i++)
+        {
+            if (--waiting[dependents[pass][i]] == 0)
+            {
+                ready.insert(dependents[pass][i]);
+            }
+        }
+    }
+    if (sorted.size() != passCount)
+    {
+        std::cerr << "Render Graph Error. Passes depend on each other in a cycle, running them as declared.\n";
+        sorted.clear();
+        for (int i = 0; i < passCount; i++)
+        {
+            sorted.push_back(i);
+        }
+    }
+
+    // Walking back from the passes with side effects keeps only the work something depends on,
+    // dependencies sort before their dependents so one backward sweep misses nothing
+    std::vector<char> needed(passCount, 0);
+    for (int i = passCount - 1; i >= 0; i--)
+    {
+        int pass = sorted[i];
+        needed[pass] = needed[pass] || passes[pass].sideEffect;
+        if (!needed[pass])
+        {
+            continue;
+        }
+        for (std::set<int>::iterator it = dependencies[pass].begin(); it != dependencies[pass].end(); it++)
+        {
+            needed[*it] = 1;
+        }
+    }
+
+    order.clear();
+    for (int i = 0; i < resources.size(); i++)
+    {
+        resources[i].firstPass = -1;
+        resources[i].lastPass = -1;
+    }
+    for (int i = 0; i < passCount; i++)
+    {
+        int pass = sorted[i];
+        passes[pass].culled = !needed[pass];
+        if (passes[pass].culled)
+        {
+            continue;
+        }
+        int position = (int)order.size();
+        order.push_back(pass);
+        std::vector<int> used = passes[pass].reads;
+        used.insert(used.end(), passes[pass].writes.begin(), passes[pass].writes.end());
+        for (int j = 0; j < used.size(); j++)
+        {
+            RenderGraphResource *resource = &resources[used[j]];
+            resource->firstPass = (resource->firstPass < 0) ? position : resource->firstPass;
+            resource->lastPass = position;
+        }
+    }
+}
+
+void RenderGraph::execute()
+{
+    frame++;
+    // New pool textures may reuse the names of freed ones, so framebuffers made from the old ones are dropped
+    if (pool->get_allocation_count() != poolAllocations)
+    {
+        for (std::map<std::vector<unsigned int>, unsigned int>::iterator it = framebuffers.begin(); it != framebuffers.end(); it++)
+        {
+            glDeleteFramebuffers(1, &it->second);
+        }
+        framebuffers.clear();
+    }
+
+    std::set<unsigned int> physical;
+    for (int i = 0; i < order.size(); i++)
+    {
+        // Transients are acquired at their first use and returned after their last, so later ones can alias them
+        for (int j = 0; j < resources.size(); j++)
+        {
+            if (!resources[j].imported && resources[j].firstPass == i)
+            {
+                resources[j].target = pool->acquire(resources[j].width, resources[j].height, resources[j].format);
+                resources[j].texture = pool->get_texture(resources[j].target);
+                physical.insert(resources[j].texture);
+            }
+        }
+
+        RenderGraphPass &pass = passes[order[i]];
+        RenderGraphTiming *timing = &timings[pass.name];
+        bool timed = begin_timing(timing);
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        bind_outputs(pass);
+        pass.execute();
+        timing->cpuTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        if (timed)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+        }
+
+        for (int j = 0; j < resources.size(); j++)
+        {
+            if (!resources[j].imported && resources[j].lastPass == i)
+            {
+                pool->release(resources[j].target);
+                resources[j].target = -1;
+            }
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    physicalCount = (int)physical.size();
+    poolAllocations = pool->get_allocation_count();
+}
+
+unsigned int RenderGraph::get_texture(int resource)
+{
+    return resources[resource].texture;
+}
+
+const std::vector<int> &RenderGraph::get_order()
+{
+    return order;
+}
+
+const RenderGraphPass &RenderGraph::get_pass(int pass)
+{
+    return passes[pass];
+}
+
+const std::map<std::string, RenderGraphTiming> &RenderGraph::get_timings()
+{
+    return timings;
+}
+
+float RenderGraph::get_gpu_time()
+{
+    float time = 0.0f;
+    for (int i = 0; i < order.size(); i++)
+    {
+        time += timings[passes[order[i]].name].gpuTime;
+    }
+    return time;
+}
+
+int RenderGraph::get_transient_count()
+{
+    int count = 0;
+    for (int i = 0; i < resources.size(); i++)
+    {
+        count += (!resources[i].imported && resources[i].firstPass >= 0) ? 1 : 0;
+    }
+    return count;
+}
+
+int RenderGraph::get_physical_count()
+{
+    return physicalCount;
+}
+
+void RenderGraph::free_data()
+{
+    for (std::map<std::vector<unsigned int>, unsigned int>::iterator it = framebuffers.begin(); it != framebuffers.end(); it++)
+    {
+        glDeleteFramebuffers(1, &it->second);
+    }
+    framebuffers.clear();
+    for (std::map<std::string, RenderGraphTiming>::iterator it = timings.begin(); it != timings.end(); it++)
+    {
+        if (it->second.queries[0])
+        {
+            glDeleteQueries(RENDER_GRAPH_QUERY_FRAMES, it->second.queries);
+        }
+    }
+    timings.clear();
+    reset();
+}
+
+void RenderGraph::bind_outputs(const RenderGraphPass &pass)
+{
+    if (pass.writes.empty() || pass.ownFramebuffer)
+    {
+        return;
+    }
+    const RenderGraphResource &first = resources[pass.writes[0]];
+    glViewport(0, 0, first.width, first.height);
+    std::vector<unsigned int> attachments;
+    for (int i = 0; i < pass.writes.size(); i++)
+    {
+        const RenderGraphResource &resource = resources[pass.writes[i]];
+        if (resource.imported && resource.texture == 0)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            return;
+        }
+        attachments.push_back(resource.texture);
+    }
+
+    std::map<std::vector<unsigned int>, unsigned int>::iterator found = framebuffers.find(attachments);
+    if (found != framebuffers.end())
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, found->second);
+        return;
+    }
+    unsigned int framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    std::vector<GLenum> drawBuffers;
+    for (int i = 0; i < pass.writes.size(); i++)
+    {
+        const RenderGraphResource &resource = resources[pass.writes[i]];
+        if (RenderTargetPool::is_depth_format(resource.format))
+        {
+            GLenum attachment = (resource.format == GL_DEPTH24_STENCIL8) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, resource.texture, 0);
+            continue;
+        }
+        GLenum attachment = GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, resource.texture, 0);
+        drawBuffers.push_back(attachment);
+    }
+    if (drawBuffers.empty())
+    {
+        glDrawBuffer(GL_NONE);
+    }
+    else
+    {
+        glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Render Graph Error. Outputs of pass " << pass.name << " do not form a complete framebuffer.\n";
+    }
+    framebuffers[attachments] = framebuffer;
+}
+
+bool RenderGraph::begin_timing(RenderGraphTiming *timing)
+{
+    // A name seen twice in one frame is only timed the first time
+    if (timing->lastFrame == frame)
+    {
+        return false;
+    }
+    timing->lastFrame = frame;
+    if (!timing->queries[0])
+    {
+        glGenQueries(RENDER_GRAPH_QUERY_FRAMES, timing->queries);
+    }
+
+    // Results are read a few frames late so the CPU never waits on them
+    int slot = frame % RENDER_GRAPH_QUERY_FRAMES;
+    if (timing->pending[slot])
+    {
+        int available = 0;
+        glGetQueryObjectiv(timing->queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            return false;
+        }
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(timing->queries[slot], GL_QUERY_RESULT, &elapsed);
+        timing->gpuTime = elapsed / 1000000.0f;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, timing->queries[slot]);
+    timing->pending[slot] = true;
+    return true;
+}
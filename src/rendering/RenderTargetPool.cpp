@@ -0,0 +1,208 @@
+#include "rendering/RenderTargetPool.h"
+
+// Pixel format and type matching a sized format, for contexts without immutable storage
+static void get_upload_format(GLenum internalFormat, GLenum *format, GLenum *type)
+{
+    switch (internalFormat)
+    {
+    case GL_DEPTH24_STENCIL8:
+        *format = GL_DEPTH_STENCIL;
+        *type = GL_UNSIGNED_INT_24_8;
+        break;
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+        *format = GL_DEPTH_COMPONENT;
+        *type = GL_FLOAT;
+        break;
+    case GL_R32UI:
+        *format = GL_RED_INTEGER;
+        *type = GL_UNSIGNED_INT;
+        break;
+    case GL_R8:
+    case GL_R16F:
+    case GL_R32F:
+        *format = GL_RED;
+        *type = GL_FLOAT;
+        break;
+    case GL_RG8:
+    case GL_RG16F:
+        *format = GL_RG;
+        *type = GL_FLOAT;
+        break;
+    case GL_RGB8:
+    case GL_RGB16F:
+    case GL_R11F_G11F_B10F:
+        *format = GL_RGB;
+        *type = GL_FLOAT;
+        break;
+    default:
+        *format = GL_RGBA;
+        *type = GL_FLOAT;
+        break;
+    }
+}
+
+int RenderTargetPool::acquire(int width, int height, GLenum format)
+{
+    width = (width < 1) ? 1 : width;
+    height = (height < 1) ? 1 : height;
+    for (int i = 0; i < targets.size(); i++)
+    {
+        RenderTarget *target = &targets[i];
+        if (target->texture && !target->inUse && target->width == width && target->height == height && target->format == format)
+        {
+            target->inUse = true;
+            target->lastUsedFrame = frame;
+            return i;
+        }
+    }
+
+    RenderTarget target;
+    target.width = width;
+    target.height = height;
+    target.format = format;
+    target.inUse = true;
+    target.lastUsedFrame = frame;
+    create_storage(&target);
+    allocationCount++;
+
+    int handle = (int)targets.size();
+    if (!freeHandles.empty())
+    {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+        targets[handle] = target;
+    }
+    else
+    {
+        targets.push_back(target);
+    }
+    return handle;
+}
+
+void RenderTargetPool::release(int target)
+{
+    if (target < 0 || target >= targets.size())
+    {
+        return;
+    }
+    targets[target].inUse = false;
+    targets[target].lastUsedFrame = frame;
+}
+
+const RenderTarget &RenderTargetPool::get_target(int target)
+{
+    return targets[target];
+}
+
+unsigned int RenderTargetPool::get_texture(int target)
+{
+    return (target < 0 || target >= targets.size()) ? 0 : targets[target].texture;
+}
+
+void RenderTargetPool::end_frame()
+{
+    frame++;
+    // Targets of an old window size are kept a while so resizing back and forth does not churn memory
+    for (int i = 0; i < targets.size(); i++)
+    {
+        if (targets[i].texture && !targets[i].inUse && frame - targets[i].lastUsedFrame > RENDER_TARGET_IDLE_FRAMES)
+        {
+            free_target(i);
+        }
+    }
+}
+
+int RenderTargetPool::get_target_count()
+{
+    return (int)(targets.size() - freeHandles.size());
+}
+
+int RenderTargetPool::get_allocation_count()
+{
+    return allocationCount;
+}
+
+size_t RenderTargetPool::get_used_bytes()
+{
+    size_t bytes = 0;
+    for (int i = 0; i < targets.size(); i++)
+    {
+        if (targets[i].texture)
+        {
+            bytes += (size_t)targets[i].width * targets[i].height * get_format_size(targets[i].format);
+        }
+    }
+    return bytes;
+}
+
+bool RenderTargetPool::is_depth_format(GLenum format)
+{
+    return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F;
+}
+
+size_t RenderTargetPool::get_format_size(GLenum format)
+{
+    switch (format)
+    {
+    case GL_R8:
+        return 1;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+        return 2;
+    case GL_RGB8:
+        return 3;
+    case GL_RGBA16F:
+        return 8;
+    case GL_RGBA32F:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+void RenderTargetPool::free_data()
+{
+    for (int i = 0; i < targets.size(); i++)
+    {
+        if (targets[i].texture)
+        {
+            glDeleteTextures(1, &targets[i].texture);
+        }
+    }
+    targets.clear();
+    freeHandles.clear();
+}
+
+void RenderTargetPool::create_storage(RenderTarget *target)
+{
+    glGenTextures(1, &target->texture);
+    glBindTexture(GL_TEXTURE_2D, target->texture);
+    if (glFeatures.textureStorage)
+    {
+        glTexStorage2D(GL_TEXTURE_2D, 1, target->format, target->width, target->height);
+    }
+    else
+    {
+        GLenum format, type;
+        get_upload_format(target->format, &format, &type);
+        glTexImage2D(GL_TEXTURE_2D, 0, target->format, target->width, target->height, 0, format, type, NULL);
+    }
+    // Integer and depth targets are fetched texel by texel, colour targets may be resampled by later passes
+    GLenum filter = (target->format == GL_R32UI || is_depth_format(target->format)) ? GL_NEAREST : GL_LINEAR;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void RenderTargetPool::free_target(int target)
+{
+    glDeleteTextures(1, &targets[target].texture);
+    targets[target] = RenderTarget();
+    freeHandles.push_back(target);
+}
@@ -1,92 +1,9 @@
 #include "rendering/Renderer.h"
 
 static RenderCamera rCam;
-
-FrameBuffer::FrameBuffer()
-{
-}
-
-void FrameBuffer::generate_fbo()
-{
-    glGenFramebuffers(1, &FBO);
-}
-
-void FrameBuffer::bind_fbo()
-{
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-}
-
-void FrameBuffer::unbind_fbo()
-{
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
-void FrameBuffer::free_fbo()
-{
-    glDeleteFramebuffers(1, &FBO);
-}
-
-void FrameBuffer::generate_rbo()
-{
-    glGenRenderbuffers(1, &RBO);
-}
-
-void FrameBuffer::bind_rbo()
-{
-    glBindRenderbuffer(GL_RENDERBUFFER, RBO);
-}
-
-void FrameBuffer::unbind_rbo()
-{
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
-}
-
-void FrameBuffer::free_rbo()
-{
-    glDeleteRenderbuffers(1, &RBO);
-}
-
-void FrameBuffer::refresh_rbo(int width, int height)
-{
-    bind_rbo();
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-    unbind_rbo();
-}
-
-void FrameBuffer::refresh_texture(int width, int height)
-{
-    textureColorBuffer.bind_texture();
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    textureColorBuffer.unbind_texture();
-}
-
-void FrameBuffer::attach_rbo()
-{
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO);
-}
-
-void FrameBuffer::attach_texture()
-{
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorBuffer.id, 0);
-}
-
-void FrameBuffer::check_status()
-{
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-    {
-        std::cerr << "Frame Buffer Error. Frame Buffer not complete.\n";
-    }
-}
-
-void FrameBuffer::new_frame(int width, int height)
-{
-    bind_fbo();
-    glEnable(GL_DEPTH_TEST);
-    refresh_rbo(width, height);
-    refresh_texture(width, height);
-}
+static bool resizePending = false; // Whether the window reported a new framebuffer size
+static int pendingWidth = 0;       // Framebuffer width reported by the last resize
+static int pendingHeight = 0;      // Framebuffer height reported by the last resize
 
 Renderer::Renderer(int major_, int minor_, int width_, int height_)
 {
@@ -94,6 +11,8 @@ Renderer::Renderer(int major_, int minor_, int width_, int height_)
     minor = minor_;
     width = width_;
     height = height_;
+    frameWidth = width_;
+    frameHeight = height_;
 }
 
 void Renderer::initialise_glfw()
@@ -148,6 +67,7 @@ void Renderer::setup_window_data()
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
     }
+    load_gl_extensions();
 
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
@@ -156,19 +76,36 @@ void Renderer::setup_window_data()
     glFrontFace(GL_CCW);
 }
 
-void Renderer::setup_frame_buffer()
+void Renderer::setup_render_graph()
+{
+    glfwGetFramebufferSize(window, &frameWidth, &frameHeight);
+    renderGraph.initialise(&renderTargets);
+}
+
+bool Renderer::update_frame_size()
+{
+    // Targets of the new size are only requested after a resize event, a minimised window keeps its last size
+    if (!resizePending || pendingWidth <= 0 || pendingHeight <= 0)
+    {
+        return false;
+    }
+    resizePending = false;
+    frameWidth = pendingWidth;
+    frameHeight = pendingHeight;
+    return true;
+}
+
+void Renderer::setup_texture_streamer()
+{
+#if ENABLE_TEXTURE_COOKING && ENABLE_TEXTURE_STREAMING
+    textureStreamer.initialise();
+    set_texture_streamer(&textureStreamer);
+#endif
+}
+
+void Renderer::setup_dynamic_buffer()
 {
-    frameBuffer.generate_fbo();
-    frameBuffer.bind_fbo();
-    frameBuffer.textureColorBuffer.generate_texture();
-    frameBuffer.refresh_texture(width, height);
-    frameBuffer.attach_texture();
-    frameBuffer.generate_rbo();
-    frameBuffer.bind_rbo();
-    frameBuffer.refresh_rbo(width, height);
-    frameBuffer.attach_rbo();
-    frameBuffer.check_status();
-    frameBuffer.unbind_fbo();
+    dynamicBuffer.initialise(DYNAMIC_BUFFER_FRAME_SIZE);
 }
 
 bool Renderer::close_window()
@@ -178,6 +115,8 @@ bool Renderer::close_window()
 
 void Renderer::swap_buffers(bool lockFrameRate)
 {
+    dynamicBuffer.end_frame();
+    renderTargets.end_frame();
     glfwSwapBuffers(window);
     glfwPollEvents();
 
@@ -208,6 +147,8 @@ void Renderer::new_frame()
     currentTime = glfwGetTime();
     deltaTime = currentTime - previousTime;
     previousTime = currentTime;
+    dynamicBuffer.begin_frame();
+    update_frame_size();
 }
 
 void Renderer::set_draw_mode(int mode)
@@ -297,11 +238,10 @@ float Renderer::get_height()
     return (float)height;
 }
 
-void Renderer::start_fbo_pass(float r, float g, float b)
+void Renderer::free_render_graph()
 {
-    frameBuffer.unbind_fbo();
-    clear_screen(r, g, b, false);
-    glDisable(GL_DEPTH_TEST);
+    renderGraph.free_data();
+    renderTargets.free_data();
 }
 
 //------------------------------------------------------------
@@ -309,6 +249,9 @@ void Renderer::start_fbo_pass(float r, float g, float b)
 void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 {
     glViewport(0, 0, width, height);
+    resizePending = true;
+    pendingWidth = width;
+    pendingHeight = height;
 }
 
 void mouse_callback(GLFWwindow *window, double xpos, double ypos)
@@ -349,10 +292,10 @@ void VertexArray::unbind_vao()
     glBindVertexArray(0);
 }
 
-void VertexArray::bind_vbo(int vertexCount, GLsizeiptr stride, void *pointer)
+void VertexArray::bind_vbo(int vertexCount, GLsizeiptr stride, void *pointer, GLenum usage)
 {
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertexCount * stride, pointer, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * stride, pointer, usage);
 }
 
 void VertexArray::unbind_vbo()
@@ -360,10 +303,10 @@ void VertexArray::unbind_vbo()
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void VertexArray::bind_ebo(int indexCount, void *pointer)
+void VertexArray::bind_ebo(int indexCount, void *pointer, GLenum usage)
 {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), pointer, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), pointer, usage);
 }
 
 void VertexArray::unbind_ebo()
@@ -371,10 +314,19 @@ void VertexArray::unbind_ebo()
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-void VertexArray::set_attribute_array(int layoutLayer, int count, GLsizeiptr stride, const void *pointer)
+void VertexArray::set_attribute_array(int layoutLayer, int count, GLsizeiptr stride, const void *pointer, GLenum type, bool normalized)
 {
     glEnableVertexAttribArray(layoutLayer);
-    glVertexAttribPointer(layoutLayer, count, GL_FLOAT, GL_FALSE, stride, pointer);
+    glVertexAttribPointer(layoutLayer, count, type, normalized ? GL_TRUE : GL_FALSE, stride, pointer);
+}
+
+void VertexArray::set_layout(const GeometryFormat &format)
+{
+    for (int i = 0; i < (int)format.attributes.size(); i++)
+    {
+        const GeometryAttribute &attribute = format.attributes[i];
+        set_attribute_array(attribute.location, attribute.count, format.stride, (void *)attribute.offset, attribute.type, attribute.normalized);
+    }
 }
 
 void VertexArray::draw_triangle(int count, int startIndex)
@@ -0,0 +1,59 @@
+#include "rendering/ResolutionScaler.h"
+
+// Standard Headers
+#include <cmath>
+
+bool ResolutionScaler::update(float gpuTime)
+{
+    if (gpuTime <= 0.0f)
+    {
+        return false;
+    }
+    frameTime = (frameTime > 0.0f) ? glm::mix(frameTime, gpuTime, DRS_SMOOTHING) : gpuTime;
+    float target = enabled ? scale : maxScale;
+    if (enabled)
+    {
+        // Only a frame time staying outside the dead band for a while moves the scale, and since queries are read
+        // a few frames late the counters restart after every change so the next decision sees the new resolution
+        bool over = frameTime > budget;
+        bool under = frameTime < budget * DRS_LOWER_THRESHOLD;
+        overFrames = over ? overFrames + 1 : 0;
+        underFrames = under ? underFrames + 1 : 0;
+        if (overFrames >= DRS_HYSTERESIS_FRAMES || underFrames >= DRS_HYSTERESIS_FRAMES)
+        {
+            // GPU time follows the pixel count, so the scale aiming for the middle of the band is a square root away
+            float aim = budget * (1.0f + DRS_LOWER_THRESHOLD) * 0.5f;
+            float wanted = scale * std::sqrt(aim / frameTime);
+            float step = over ? DRS_MAX_STEP_DOWN : DRS_MAX_STEP_UP;
+            target = glm::clamp(wanted, scale - step, scale + step);
+            target = over ? glm::min(target, scale - DRS_SCALE_GRANULARITY) : glm::max(target, scale + DRS_SCALE_GRANULARITY);
+        }
+    }
+
+    // Snapping to a coarse grid keeps the pool from allocating targets for every slightly different size
+    target = std::round(target / DRS_SCALE_GRANULARITY) * DRS_SCALE_GRANULARITY;
+    target = glm::clamp(target, minScale, maxScale);
+    if (std::fabs(target - scale) < 0.5f * DRS_SCALE_GRANULARITY)
+    {
+        return false;
+    }
+    scale = target;
+    overFrames = 0;
+    underFrames = 0;
+    return true;
+}
+
+float ResolutionScaler::get_scale()
+{
+    return scale;
+}
+
+float ResolutionScaler::get_frame_time()
+{
+    return frameTime;
+}
+
+int ResolutionScaler::get_scaled_size(int size)
+{
+    return glm::max((int)(size * scale + 0.5f), 1);
+}
@@ -1,5 +1,8 @@
 #include "rendering/Shader.h"
 
+// Custom Headers
+#include "rendering/GLExtensions.h"
+
 LightSource::LightSource()
 {
     ambient = DEFAULT_LIGHT_COLOR;
@@ -82,6 +85,27 @@ SpotLight::SpotLight(glm::vec3 ambient_, glm::vec3 diffuse_, glm::vec3 specular_
     outerFallOff = outerFallOff_;
 }
 
+// Prepends the Config.h values shaders size their arrays and strides with after the version line, so the two never drift apart
+static std::string add_config_defines(const char *code)
+{
+    std::string source = code;
+    std::stringstream defines;
+    defines << "#define SHADOW_CASCADES " << SHADOW_CASCADE_COUNT << "\n"
+            << "#define SHADOW_LAYERS " << SHADOW_CASCADE_COUNT * SHADOW_MAX_DIRECTIONAL_LIGHTS << "\n"
+            << "#define SHADOW_TILE_TEXELS " << SHADOW_ATLAS_RECORD_TEXELS << "\n";
+
+    // The version has to stay the first statement, and the line directive keeps compile errors pointing at the file's own lines
+    size_t versionEnd = 0;
+    if (source.compare(0, 8, "#version") == 0)
+    {
+        versionEnd = source.find('\n');
+        versionEnd = (versionEnd == std::string::npos) ? source.size() : versionEnd + 1;
+        defines << "#line 2\n";
+    }
+    source.insert(versionEnd, defines.str());
+    return source;
+}
+
 Shader::Shader()
 {
 }
@@ -156,6 +180,41 @@ void Shader::create_shader(const char *vertexPath, const char *fragmentPath)
     glDeleteShader(fragment);
 }
 
+void Shader::create_compute_shader(const char *computePath)
+{
+    std::string computeCode;
+    std::ifstream computeShaderFile;
+    computeShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+    try
+    {
+        computeShaderFile.open(computePath);
+        std::stringstream computeShaderStream;
+        computeShaderStream << computeShaderFile.rdbuf();
+        computeShaderFile.close();
+        computeCode = computeShaderStream.str();
+    }
+    catch (const std::ifstream::failure &e)
+    {
+        std::cout << "Error Shader File Not loaded successfully" << std::endl;
+    }
+
+    // The shader object is deleted on every path, a linked program keeps its own copy of the code
+    unsigned int compute = compile_shader(computeCode.c_str(), COMPUTE_SHADER);
+    if (check_compile_errors(compute, COMPUTE_SHADER))
+    {
+        glDeleteShader(compute);
+        return;
+    }
+
+    id = glCreateProgram();
+    glAttachShader(id, compute);
+
+    glLinkProgram(id);
+    glDeleteShader(compute);
+    check_compile_errors(id, COMBINED_SHADER);
+}
+
 unsigned int Shader::compile_shader(const char *code, SHADER_TYPE type)
 {
     unsigned int shader;
@@ -168,8 +227,14 @@ unsigned int Shader::compile_shader(const char *code, SHADER_TYPE type)
     {
         shader = glCreateShader(GL_FRAGMENT_SHADER);
     }
+    else if (type == COMPUTE_SHADER)
+    {
+        shader = glCreateShader(GL_COMPUTE_SHADER);
+    }
 
-    glShaderSource(shader, 1, &code, NULL);
+    std::string source = add_config_defines(code);
+    const char *sourceCode = source.c_str();
+    glShaderSource(shader, 1, &sourceCode, NULL);
     glCompileShader(shader);
     return shader;
 }
@@ -244,10 +309,10 @@ void Shader::set_mat4(const std::string name, glm::mat4 value)
     glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &value[0][0]);
 }
 
-void Shader::set_texture(const std::string name, Texture *tex)
+void Shader::set_texture(const std::string name, Texture *tex, int unit)
 {
-    set_active_texture(tex->id);
-    set_int(name, tex->id);
+    set_active_texture(unit);
+    set_int(name, unit);
     tex->bind_texture();
 }
 
@@ -0,0 +1,599 @@
+#include "rendering/ShadowAtlas.h"
+
+// Custom Headers
+#include "rendering/Camera.h"
+#include "rendering/ClusteredLighting.h"
+#include "rendering/GeometryPool.h"
+
+// Standard Headers
+#include <algorithm>
+#include <cmath>
+
+// Cube faces in the order the lighting shaders pick them, +X, -X, +Y, -Y, +Z and -Z, with the up vector of each
+static const glm::vec3 faceAxes[6] = {glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+                                      glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)};
+static const glm::vec3 faceUps[6] = {glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                                     glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)};
+
+// Cells along each side of the atlas
+static const int atlasCells = SHADOW_ATLAS_SIZE / SHADOW_ATLAS_MIN_TILE;
+
+// Returns whether a program exists and linked
+static bool is_linked(Shader *program)
+{
+    int status = 0;
+    if (program->id != 0)
+    {
+        glGetProgramiv(program->id, GL_LINK_STATUS, &status);
+    }
+    return status != 0;
+}
+
+bool ShadowAtlas::initialise(DynamicBuffer *ring_)
+{
+    ring = ring_;
+    if (glFeatures.textureBufferRange)
+    {
+        glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &textureAlignment);
+    }
+    program.id = 0;
+    program.create_shader(FileSystem::get_path("shaders/3dshaders/depthOnly.vs").c_str(), FileSystem::get_path("shaders/3dshaders/depthOnly.fs").c_str());
+    bool linked = is_linked(&program);
+    if (!linked)
+    {
+        std::cout << "Failed to build shadow atlas shaders" << std::endl;
+    }
+
+    // Compared in hardware so a filtered lookup returns the lit fraction of its texels
+    glGenTextures(1, &atlas);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, atlas, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // A buffer with storage keeps the texture complete before the first upload
+    glGenBuffers(1, &tileBuffer);
+    glGenTextures(1, &tileTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, tileBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_DYNAMIC_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, tileTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, tileBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    cells.assign(atlasCells * atlasCells, 0);
+    return linked;
+}
+
+void ShadowAtlas::update(const std::vector<LightSource *> &lights, const std::vector<RenderActor *> &actors, glm::mat4 view, glm::mat4 projection, float viewportHeight, bool gamma)
+{
+    frame++;
+
+    // Casters whose transform changed, or that appeared or disappeared, stale every tile they were or are now seen by
+    std::map<RenderActor *, glm::mat4> matrices;
+    std::map<RenderActor *, glm::vec4> bounds;
+    casters.clear();
+    moves.clear();
+    for (int i = 0; i < actors.size(); i++)
+    {
+        RenderActor *actor = actors[i];
+        if (!actor->toRender || (actor->type != MODEL_ACTOR && actor->type != OBJECT_ACTOR))
+        {
+            continue;
+        }
+        ShadowCaster caster;
+        glm::vec4 sphere = CascadedShadows::get_caster_bounds(actor);
+        caster.actor = actor;
+        caster.center = glm::vec3(sphere);
+        caster.radius = sphere.w;
+        casters.push_back(caster);
+        matrices[actor] = actor->tr.get_model_matrix();
+        bounds[actor] = sphere;
+        std::map<RenderActor *, glm::mat4>::iterator last = lastMatrices.find(actor);
+        if (last == lastMatrices.end() || last->second != matrices[actor])
+        {
+            ShadowMove move;
+            move.before = (last == lastMatrices.end()) ? glm::vec4(-1.0f) : lastBounds[actor];
+            move.after = sphere;
+            moves.push_back(move);
+        }
+    }
+    for (std::map<RenderActor *, glm::vec4>::iterator it = lastBounds.begin(); it != lastBounds.end(); it++)
+    {
+        if (bounds.find(it->first) == bounds.end())
+        {
+            ShadowMove move;
+            move.before = it->second;
+            moves.push_back(move);
+        }
+    }
+    lastMatrices.swap(matrices);
+    lastBounds.swap(bounds);
+
+    // Lights are ranked by the screen size of their volume, those off screen give their tiles back
+    glm::vec4 cameraPlanes[6];
+    get_frustum_planes(projection * view, cameraPlanes);
+    ranked.clear();
+    for (int i = 0; i < lights.size(); i++)
+    {
+        LightSource *light = lights[i];
+        if (light->type != POINT_LIGHT && light->type != SPOT_LIGHT)
+        {
+            continue;
+        }
+        ShadowLight *shadow = &shadowLights[light];
+        shadow->light = light;
+        shadow->lastSeen = frame;
+        shadow->record = -1;
+        glm::vec3 position, direction(0.0f);
+        float range, angle = 0.0f;
+        if (light->type == POINT_LIGHT)
+        {
+            position = ((PointLight *)light)->position;
+            range = ClusteredLighting::get_point_light_range((PointLight *)light, gamma);
+            shadow->faceCount = 6;
+        }
+        else
+        {
+            position = ((SpotLight *)light)->position;
+            direction = glm::normalize(((SpotLight *)light)->lookAt);
+            range = CLUSTER_SPOT_RANGE;
+            angle = glm::clamp(((SpotLight *)light)->outerFallOff, 1.0f, SHADOW_ATLAS_MAX_SPOT_ANGLE);
+            shadow->faceCount = 1;
+        }
+        if (position != shadow->position || direction != shadow->direction || range != shadow->range || angle != shadow->angle)
+        {
+            shadow->position = position;
+            shadow->direction = direction;
+            shadow->range = range;
+            shadow->angle = angle;
+            set_views(shadow);
+        }
+
+        bool visible = true;
+        for (int j = 0; j < 6 && visible; j++)
+        {
+            visible = glm::dot(glm::vec3(cameraPlanes[j]), position) + cameraPlanes[j].w >= -range;
+        }
+        glm::vec3 viewPosition = glm::vec3(view * glm::vec4(position, 1.0f));
+        shadow->importance = visible ? glm::min(get_screen_size(projection, viewPosition, range, viewportHeight), (float)SHADOW_ATLAS_SIZE) : 0.0f;
+        if (shadow->importance > 0.0f)
+        {
+            ranked.push_back(shadow);
+            continue;
+        }
+        for (int j = 0; j < 6; j++)
+        {
+            release(&shadow->tiles[j]);
+        }
+    }
+    for (std::map<LightSource *, ShadowLight>::iterator it = shadowLights.begin(); it != shadowLights.end();)
+    {
+        if (it->second.lastSeen != frame)
+        {
+            for (int j = 0; j < 6; j++)
+            {
+                release(&it->second.tiles[j]);
+            }
+            it = shadowLights.erase(it);
+            continue;
+        }
+        it++;
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const ShadowLight *a, const ShadowLight *b)
+                     { return a->importance > b->importance; });
+
+    // Tile sizes follow the screen size in powers of two, kept within a margin so lights near a boundary do not
+    // move around the atlas every frame, and the least important lights make room when the atlas is full
+    tileCount = 0;
+    int recordCount = 0;
+    for (int i = 0; i < ranked.size(); i++)
+    {
+        ShadowLight *shadow = ranked[i];
+        float target = shadow->importance * SHADOW_ATLAS_TILE_SCALE;
+        int size = SHADOW_ATLAS_MIN_TILE;
+        while (size * 2 <= target && size < SHADOW_ATLAS_MAX_TILE)
+        {
+            size *= 2;
+        }
+        int current = 0;
+        for (int j = 0; j < shadow->faceCount; j++)
+        {
+            current = glm::max(current, shadow->tiles[j].size);
+        }
+        if (current > 0 && target >= current * (1.0f - SHADOW_ATLAS_HYSTERESIS) && target < 2.0f * current * (1.0f + SHADOW_ATLAS_HYSTERESIS))
+        {
+            size = current;
+        }
+
+        int placed = 0;
+        for (int j = 0; j < shadow->faceCount; j++)
+        {
+            ShadowTile *tile = &shadow->tiles[j];
+            if (!needs_tile(*tile, cameraPlanes))
+            {
+                release(tile);
+                continue;
+            }
+            if (tile->size != size)
+            {
+                release(tile);
+                int evict = (int)ranked.size() - 1;
+                for (int attempt = size; tile->size == 0 && attempt >= SHADOW_ATLAS_MIN_TILE;)
+                {
+                    if (allocate(tile, attempt))
+                    {
+                        break;
+                    }
+                    if (evict > i)
+                    {
+                        for (int k = 0; k < 6; k++)
+                        {
+                            release(&ranked[evict]->tiles[k]);
+                        }
+                        evict--;
+                        continue;
+                    }
+                    attempt /= 2;
+                }
+            }
+            placed += (tile->size > 0) ? 1 : 0;
+        }
+        tileCount += placed;
+        if (placed > 0)
+        {
+            shadow->record = recordCount;
+            recordCount += shadow->faceCount;
+        }
+    }
+
+    for (int i = 0; i < moves.size(); i++)
+    {
+        for (int j = 0; j < ranked.size(); j++)
+        {
+            for (int k = 0; k < ranked[j]->faceCount; k++)
+            {
+                ShadowTile *tile = &ranked[j]->tiles[k];
+                if (tile->size > 0 && tile->drawn && (touches(*tile, moves[i].before) || touches(*tile, moves[i].after)))
+                {
+                    tile->dirty = true;
+                    tile->moving = true;
+                }
+            }
+        }
+    }
+}
+
+void ShadowAtlas::set_views(ShadowLight *shadow)
+{
+    for (int i = 0; i < shadow->faceCount; i++)
+    {
+        ShadowTile *tile = &shadow->tiles[i];
+        if (shadow->faceCount == 6)
+        {
+            tile->matrix = glm::perspective(glm::radians(90.0f), 1.0f, SHADOW_ATLAS_NEAR_PLANE, shadow->range) *
+                           glm::lookAt(shadow->position, shadow->position + faceAxes[i], faceUps[i]);
+        }
+        else
+        {
+            glm::vec3 up = (std::abs(shadow->direction.y) > 0.99f) ? WORLD_FORWARD : WORLD_UP;
+            tile->matrix = glm::perspective(glm::radians(2.0f * shadow->angle), 1.0f, SHADOW_ATLAS_NEAR_PLANE, shadow->range) *
+                           glm::lookAt(shadow->position, shadow->position + shadow->direction, up);
+        }
+        get_frustum_planes(tile->matrix, tile->planes);
+        // A tile drawn from the old view stays usable, it keeps its own matrix until redrawn
+        tile->dirty = true;
+    }
+}
+
+bool ShadowAtlas::needs_tile(const ShadowTile &tile, const glm::vec4 cameraPlanes[6])
+{
+    // A view with every corner behind one plane of the camera's frustum shades nothing on screen
+    glm::mat4 inverse = glm::inverse(tile.matrix);
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec4 corner = inverse * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 1.0f);
+        corners[i] = glm::vec3(corner) / corner.w;
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        int outside = 0;
+        for (int j = 0; j < 8; j++)
+        {
+            outside += (glm::dot(glm::vec3(cameraPlanes[i]), corners[j]) + cameraPlanes[i].w < 0.0f) ? 1 : 0;
+        }
+        if (outside == 8)
+        {
+            return false;
+        }
+    }
+    for (int i = 0; i < casters.size(); i++)
+    {
+        if (touches(tile, glm::vec4(casters[i].center, casters[i].radius)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ShadowAtlas::allocate(ShadowTile *tile, int size)
+{
+    // Tiles are powers of two placed on multiples of their size, so free space never splinters below a tile
+    int span = size / SHADOW_ATLAS_MIN_TILE;
+    for (int y = 0; y < atlasCells; y += span)
+    {
+        for (int x = 0; x < atlasCells; x += span)
+        {
+            bool free = true;
+            for (int j = 0; j < span && free; j++)
+            {
+                for (int i = 0; i < span && free; i++)
+                {
+                    free = !cells[(y + j) * atlasCells + x + i];
+                }
+            }
+            if (!free)
+            {
+                continue;
+            }
+            for (int j = 0; j < span; j++)
+            {
+                std::fill(cells.begin() + (y + j) * atlasCells + x, cells.begin() + (y + j) * atlasCells + x + span, 1);
+            }
+            tile->x = x * SHADOW_ATLAS_MIN_TILE;
+            tile->y = y * SHADOW_ATLAS_MIN_TILE;
+            tile->size = size;
+            tile->drawn = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShadowAtlas::release(ShadowTile *tile)
+{
+    if (tile->size == 0)
+    {
+        return;
+    }
+    int span = tile->size / SHADOW_ATLAS_MIN_TILE;
+    int x = tile->x / SHADOW_ATLAS_MIN_TILE;
+    int y = tile->y / SHADOW_ATLAS_MIN_TILE;
+    for (int j = 0; j < span; j++)
+    {
+        std::fill(cells.begin() + (y + j) * atlasCells + x, cells.begin() + (y + j) * atlasCells + x + span, 0);
+    }
+    tile->size = 0;
+    tile->drawn = false;
+}
+
+bool ShadowAtlas::touches(const ShadowTile &tile, glm::vec4 sphere)
+{
+    if (sphere.w < 0.0f)
+    {
+        return false;
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        if (glm::dot(glm::vec3(tile.planes[i]), glm::vec3(sphere)) + tile.planes[i].w < -sphere.w)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ShadowAtlas::add_pass(RenderGraph *graph, std::function<void(RenderActor *, Shader *)> drawCaster)
+{
+    updateCount = 0;
+    pendingCount = 0;
+    if (ranked.empty())
+    {
+        return -1;
+    }
+
+    // The atlas lives outside the graph and is imported so the passes sampling it wait on this one,
+    // the pass keeps its own framebuffer and scissors each tile inside it
+    int resource = graph->import_texture("Shadow Atlas", atlas, SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, GL_DEPTH_COMPONENT32F);
+    int pass = graph->add_pass("Shadow Atlas", [this, drawCaster]() mutable
+                               {
+                                   GLint polygonMode[2];
+                                   glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+                                   glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                                   glEnable(GL_POLYGON_OFFSET_FILL);
+                                   glPolygonOffset(SHADOW_SLOPE_BIAS, SHADOW_CONSTANT_BIAS);
+                                   glEnable(GL_SCISSOR_TEST);
+                                   glEnable(GL_DEPTH_TEST);
+                                   glDepthFunc(GL_LESS);
+                                   glDepthMask(GL_TRUE);
+                                   glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+                                   GeometryPool::get().set_position_only(true);
+                                   program.use();
+                                   program.set_mat4("view", glm::mat4(1.0f));
+                                   draw_tiles(drawCaster);
+                                   GeometryPool::get().set_position_only(false);
+                                   glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                                   glDisable(GL_SCISSOR_TEST);
+                                   glDisable(GL_POLYGON_OFFSET_FILL);
+                                   glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+                                   upload_records(); });
+    graph->write(pass, resource);
+    graph->set_own_framebuffer(pass);
+    return resource;
+}
+
+void ShadowAtlas::draw_tiles(std::function<void(RenderActor *, Shader *)> &drawCaster)
+{
+    // Tiles never drawn at their place come first, then the stale ones by screen size and how long they have waited,
+    // those with moving casters weighted up, so the cost per frame stays bounded however many lights there are
+    std::vector<std::pair<std::pair<bool, float>, ShadowTile *>> candidates;
+    for (int i = 0; i < ranked.size(); i++)
+    {
+        for (int j = 0; j < ranked[i]->faceCount; j++)
+        {
+            ShadowTile *tile = &ranked[i]->tiles[j];
+            if (tile->size == 0 || (tile->drawn && !tile->dirty))
+            {
+                continue;
+            }
+            // Undrawn tiles sort ahead on a flag of their own, then by importance, which adding to a huge constant would round away
+            float score = tile->drawn ? ranked[i]->importance * (frame - tile->lastDrawn) * (tile->moving ? SHADOW_ATLAS_MOVING_PRIORITY : 1.0f)
+                                      : ranked[i]->importance;
+            candidates.push_back(std::make_pair(std::make_pair(!tile->drawn, score), tile));
+        }
+    }
+    int count = glm::min((int)candidates.size(), SHADOW_ATLAS_UPDATES_PER_FRAME);
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+                      [](const std::pair<std::pair<bool, float>, ShadowTile *> &a, const std::pair<std::pair<bool, float>, ShadowTile *> &b)
+                      { return a.first > b.first; });
+    for (int i = 0; i < count; i++)
+    {
+        ShadowTile *tile = candidates[i].second;
+        glViewport(tile->x, tile->y, tile->size, tile->size);
+        glScissor(tile->x, tile->y, tile->size, tile->size);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        program.set_mat4("projection", tile->matrix);
+        for (int j = 0; j < casters.size(); j++)
+        {
+            if (touches(*tile, glm::vec4(casters[j].center, casters[j].radius)))
+            {
+                drawCaster(casters[j].actor, &program);
+            }
+        }
+        tile->drawnMatrix = tile->matrix;
+        tile->drawn = true;
+        tile->dirty = false;
+        tile->moving = false;
+        tile->lastDrawn = frame;
+    }
+    updateCount = count;
+    pendingCount = (int)candidates.size() - count;
+}
+
+void ShadowAtlas::upload_records()
+{
+    // Per tile: its rectangle in atlas units with the normal offset per unit of distance, zero while it holds nothing,
+    // then the matrix it was drawn with
+    records.clear();
+    for (int i = 0; i < ranked.size(); i++)
+    {
+        ShadowLight *shadow = ranked[i];
+        if (shadow->record < 0)
+        {
+            continue;
+        }
+        float tanHalfAngle = (shadow->faceCount == 6) ? 1.0f : std::tan(glm::radians(shadow->angle));
+        for (int j = 0; j < shadow->faceCount; j++)
+        {
+            const ShadowTile &tile = shadow->tiles[j];
+            glm::vec4 rect(0.0f);
+            if (tile.size > 0 && tile.drawn)
+            {
+                rect = glm::vec4(glm::vec3((float)tile.x, (float)tile.y, (float)tile.size) / (float)SHADOW_ATLAS_SIZE,
+                                 SHADOW_NORMAL_OFFSET * 2.0f * tanHalfAngle / tile.size);
+            }
+            records.push_back(rect);
+            for (int k = 0; k < 4; k++)
+            {
+                records.push_back(tile.drawnMatrix[k]);
+            }
+        }
+    }
+
+    // The ring gives every frame in flight its own copy, which the texture view is pointed at
+    size_t size = records.size() * sizeof(glm::vec4);
+    glBindTexture(GL_TEXTURE_BUFFER, tileTexture);
+    if (size > 0 && ring != NULL && ring->is_active() && glFeatures.textureBufferRange)
+    {
+        DynamicAllocation allocation = ring->upload(records.data(), size, textureAlignment);
+        if (allocation.data != NULL)
+        {
+            glTexBufferRange(GL_TEXTURE_BUFFER, GL_RGBA32F, ring->get_buffer(), allocation.offset, size);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+            return;
+        }
+    }
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, tileBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    // Orphaning the old storage lets the driver hand out fresh memory instead of waiting on draws still reading it
+    glBindBuffer(GL_TEXTURE_BUFFER, tileBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, glm::max(size, (size_t)16), NULL, GL_STREAM_DRAW);
+    if (size > 0)
+    {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, records.data());
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+int ShadowAtlas::get_tile_record(LightSource *light)
+{
+    std::map<LightSource *, ShadowLight>::iterator found = shadowLights.find(light);
+    return (found != shadowLights.end() && found->second.lastSeen == frame) ? found->second.record : -1;
+}
+
+void ShadowAtlas::bind_textures()
+{
+    glActiveTexture(GL_TEXTURE0 + SHADOW_ATLAS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glActiveTexture(GL_TEXTURE0 + SHADOW_ATLAS_TEXTURE_UNIT + 1);
+    glBindTexture(GL_TEXTURE_BUFFER, tileTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void ShadowAtlas::set_uniforms(Shader *shader)
+{
+    shader->set_int("shadowAtlas", SHADOW_ATLAS_TEXTURE_UNIT);
+    shader->set_int("shadowTiles", SHADOW_ATLAS_TEXTURE_UNIT + 1);
+}
+
+int ShadowAtlas::get_light_count()
+{
+    int count = 0;
+    for (int i = 0; i < ranked.size(); i++)
+    {
+        count += (ranked[i]->record >= 0) ? 1 : 0;
+    }
+    return count;
+}
+
+int ShadowAtlas::get_tile_count()
+{
+    return tileCount;
+}
+
+int ShadowAtlas::get_pending_count()
+{
+    return pendingCount;
+}
+
+int ShadowAtlas::get_update_count()
+{
+    return updateCount;
+}
+
+void ShadowAtlas::free_data()
+{
+    program.free_data();
+    if (atlas)
+    {
+        glDeleteTextures(1, &atlas);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteTextures(1, &tileTexture);
+        glDeleteBuffers(1, &tileBuffer);
+        atlas = 0;
+    }
+}
@@ -1,5 +1,8 @@
 #include "rendering/Texture.h"
 
+// Streamer used by load_texture_from_path when set
+static TextureStreamer *textureStreamer = NULL;
+
 Texture::Texture()
 {
 }
@@ -14,6 +17,23 @@ void Texture::load_texture_from_path(bool gamma)
 {
     generate_texture();
 
+#if ENABLE_TEXTURE_COOKING && ENABLE_TEXTURE_STREAMING
+    if (textureStreamer && textureStreamer->is_active())
+    {
+        textureStreamer->request(id, path, gamma);
+        return;
+    }
+#endif
+
+#if ENABLE_TEXTURE_COOKING
+    CookedTexture cooked;
+    if (TextureCook::load(path, gamma, &cooked, TextureCook::get_compression_formats()))
+    {
+        load_texture_from_cook(cooked);
+        return;
+    }
+#endif
+
     int width, height, nrComponents;
     stbi_set_flip_vertically_on_load(true);
     unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
@@ -54,6 +74,40 @@ void Texture::load_texture_from_path(bool gamma)
     stbi_image_free(data);
 }
 
+void Texture::load_texture_from_cook(const CookedTexture &cooked)
+{
+    GLenum format;
+    GLenum otherFormat;
+    TextureCook::get_gl_formats(cooked, &format, &otherFormat);
+    bind_texture();
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int level = 0; level < (int)cooked.mips.size(); level++)
+    {
+        const CookedMip &mip = cooked.mips[level];
+        if (cooked.format != COMPRESSION_NONE)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, otherFormat, mip.width, mip.height, 0, (GLsizei)mip.data.size(), mip.data.data());
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, level, otherFormat, mip.width, mip.height, 0, format, GL_UNSIGNED_BYTE, mip.data.data());
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    GLint swizzle[4];
+    TextureCook::get_gl_swizzle(cooked.swizzle, swizzle);
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (int)cooked.mips.size() - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
 void Texture::generate_texture()
 {
     glGenTextures(1, &id);
@@ -74,6 +128,11 @@ void set_active_texture(int index)
     glActiveTexture(GL_TEXTURE0 + index);
 }
 
+void set_texture_streamer(TextureStreamer *streamer)
+{
+    textureStreamer = streamer;
+}
+
 std::string texturePaths[] = {
     "resources/textures/bricks.jpg",
     "resources/textures/brickwall.jpg",
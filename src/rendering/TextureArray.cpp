@@ -0,0 +1,189 @@
+#include "rendering/TextureArray.h"
+
+// Custom Headers
+#include "utility/JobSystem.h"
+
+// Standard Headers
+#include <algorithm>
+#include <iostream>
+
+TextureArrayBins::TextureArrayBins()
+{
+}
+
+std::vector<TextureLayer> TextureArrayBins::load_textures(const std::vector<std::string> &paths, const std::vector<bool> &gammas)
+{
+    std::vector<TextureLayer> layers(paths.size());
+    std::vector<CookedTexture> cooked(paths.size());
+    std::vector<char> loaded(paths.size(), 0);
+    unsigned int formats = TextureCook::get_compression_formats();
+
+    JobSystem::get().parallel_for((int)paths.size(), [&](int i)
+                                  { loaded[i] = TextureCook::load(paths[i], gammas[i], &cooked[i], formats); });
+
+    // Group textures into new bins by size, format and swizzle
+    int firstNewBin = (int)bins.size();
+    for (int i = 0; i < (int)paths.size(); i++)
+    {
+        if (!loaded[i])
+        {
+            std::cout << "Failed to load Texture" << std::endl;
+            continue;
+        }
+        int bin = firstNewBin;
+        while (bin < (int)bins.size() && !matches_bin(bins[bin], cooked[i]))
+        {
+            bin++;
+        }
+        if (bin == (int)bins.size())
+        {
+            TextureBin newBin;
+            newBin.width = cooked[i].width;
+            newBin.height = cooked[i].height;
+            newBin.levelCount = (int)cooked[i].mips.size();
+            newBin.components = cooked[i].components;
+            newBin.gamma = cooked[i].gamma;
+            newBin.format = cooked[i].format;
+            newBin.swizzle = cooked[i].swizzle;
+            bins.push_back(newBin);
+        }
+        layers[i].bin = bin;
+        layers[i].layer = (int)bins[bin].paths.size();
+        bins[bin].paths.push_back(paths[i]);
+    }
+
+    for (int bin = firstNewBin; bin < (int)bins.size(); bin++)
+    {
+        allocate_bin(&bins[bin], (int)bins[bin].paths.size());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i < (int)paths.size(); i++)
+    {
+        if (layers[i].bin >= 0)
+        {
+            upload_layer(bins[layers[i].bin], layers[i].layer, cooked[i]);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // Missing textures sample the first bin rather than an unbound unit
+    for (int i = 0; i < (int)layers.size(); i++)
+    {
+        if (layers[i].bin < 0 && !bins.empty())
+        {
+            layers[i].bin = 0;
+        }
+    }
+    return layers;
+}
+
+void TextureArrayBins::bind_bins(int firstUnit)
+{
+    // Bins and their spare units stay below the units reserved for shadows, lights and the visibility buffer
+    int maxUnits = 16;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maxUnits);
+    firstBoundUnit = firstUnit;
+    firstSpareUnit = std::min(maxUnits, RESERVED_TEXTURE_UNIT_FIRST) - TEXTURE_BIN_SPARE_UNITS;
+    boundCount = std::min((int)bins.size(), firstSpareUnit - firstUnit);
+    for (int bin = 0; bin < boundCount; bin++)
+    {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + bin);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, bins[bin].id);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+int TextureArrayBins::get_unit(const TextureLayer &layer, int slot)
+{
+    if (layer.bin < boundCount)
+    {
+        return firstBoundUnit + std::max(layer.bin, 0);
+    }
+
+    // Every sampler of a draw has a spare unit of its own, so two bins past the limit in one draw never alias
+    if (slot < 0 || slot >= TEXTURE_BIN_SPARE_UNITS)
+    {
+        std::cout << "Texture bin sampler slot " << slot << " has no spare unit" << std::endl;
+        slot = std::min(std::max(slot, 0), TEXTURE_BIN_SPARE_UNITS - 1);
+    }
+    int unit = firstSpareUnit + slot;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, bins[layer.bin].id);
+    glActiveTexture(GL_TEXTURE0);
+    return unit;
+}
+
+void TextureArrayBins::free_data()
+{
+    for (int bin = 0; bin < (int)bins.size(); bin++)
+    {
+        glDeleteTextures(1, &bins[bin].id);
+    }
+    bins.clear();
+    boundCount = 0;
+}
+
+bool TextureArrayBins::matches_bin(const TextureBin &bin, const CookedTexture &cooked)
+{
+    return bin.width == cooked.width && bin.height == cooked.height && bin.levelCount == (int)cooked.mips.size() &&
+           bin.components == cooked.components && bin.gamma == cooked.gamma && bin.format == cooked.format &&
+           bin.swizzle == cooked.swizzle;
+}
+
+void TextureArrayBins::allocate_bin(TextureBin *bin, int layerCount)
+{
+    CookedTexture layout;
+    layout.components = bin->components;
+    layout.gamma = bin->gamma;
+    layout.format = bin->format;
+    GLenum format, internalFormat;
+    TextureCook::get_gl_formats(layout, &format, &internalFormat);
+
+    glGenTextures(1, &bin->id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, bin->id);
+    for (int level = 0; level < bin->levelCount; level++)
+    {
+        int width = std::max(1, bin->width >> level);
+        int height = std::max(1, bin->height >> level);
+        if (format == GL_NONE)
+        {
+            GLsizei levelSize = ((width + 3) / 4) * ((height + 3) / 4) * TextureCompression::get_block_size(bin->format) * layerCount;
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, width, height, layerCount, 0, levelSize, NULL);
+        }
+        else
+        {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, width, height, layerCount, 0, format, GL_UNSIGNED_BYTE, NULL);
+        }
+    }
+
+    GLint swizzle[4];
+    TextureCook::get_gl_swizzle(bin->swizzle, swizzle);
+    glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, bin->levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void TextureArrayBins::upload_layer(const TextureBin &bin, int layer, const CookedTexture &cooked)
+{
+    GLenum format, internalFormat;
+    TextureCook::get_gl_formats(cooked, &format, &internalFormat);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, bin.id);
+    for (int level = 0; level < (int)cooked.mips.size(); level++)
+    {
+        const CookedMip &mip = cooked.mips[level];
+        if (format == GL_NONE)
+        {
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, mip.width, mip.height, 1, internalFormat, (GLsizei)mip.data.size(), mip.data.data());
+        }
+        else
+        {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, mip.width, mip.height, 1, format, GL_UNSIGNED_BYTE, mip.data.data());
+        }
+    }
+}
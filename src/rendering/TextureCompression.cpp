@@ -0,0 +1,537 @@
+#include "rendering/TextureCompression.h"
+
+// Custom Headers
+#include "rendering/GLExtensions.h"
+#include "utility/JobSystem.h"
+
+// Standard Headers
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_COMPRESSION_SSE2 1
+#else
+#define TEXTURE_COMPRESSION_SSE2 0
+#endif
+
+// Interpolation weights for 4-bit BC7 indices
+static const int bc7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Copies a 4x4 RGBA block, clamping reads at the image edges
+static void fetch_block(const unsigned char *rgba, int width, int height, int bx, int by, unsigned char block[64])
+{
+    for (int y = 0; y < 4; y++)
+    {
+        int sy = std::min(by * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++)
+        {
+            int sx = std::min(bx * 4 + x, width - 1);
+            std::memcpy(&block[(y * 4 + x) * 4], &rgba[((size_t)sy * width + sx) * 4], 4);
+        }
+    }
+}
+
+// Finds the per channel minimum and maximum of a block
+static void get_block_bounds(const unsigned char block[64], unsigned char minColor[4], unsigned char maxColor[4])
+{
+#if TEXTURE_COMPRESSION_SSE2
+    __m128i a = _mm_loadu_si128((const __m128i *)(block));
+    __m128i b = _mm_loadu_si128((const __m128i *)(block + 16));
+    __m128i c = _mm_loadu_si128((const __m128i *)(block + 32));
+    __m128i d = _mm_loadu_si128((const __m128i *)(block + 48));
+    __m128i mn = _mm_min_epu8(_mm_min_epu8(a, b), _mm_min_epu8(c, d));
+    __m128i mx = _mm_max_epu8(_mm_max_epu8(a, b), _mm_max_epu8(c, d));
+    mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 8));
+    mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 8));
+    mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 4));
+    mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 4));
+    uint32_t packedMin = (uint32_t)_mm_cvtsi128_si32(mn);
+    uint32_t packedMax = (uint32_t)_mm_cvtsi128_si32(mx);
+    std::memcpy(minColor, &packedMin, 4);
+    std::memcpy(maxColor, &packedMax, 4);
+#else
+    for (int c = 0; c < 4; c++)
+    {
+        minColor[c] = 255;
+        maxColor[c] = 0;
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            minColor[c] = std::min(minColor[c], block[i * 4 + c]);
+            maxColor[c] = std::max(maxColor[c], block[i * 4 + c]);
+        }
+    }
+#endif
+}
+
+// Projects every texel of a block onto an axis, relative to an origin
+static void project_block(const unsigned char block[64], const int origin[4], const int axis[4], int projection[16])
+{
+#if TEXTURE_COMPRESSION_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i o = _mm_set_epi16(origin[3], origin[2], origin[1], origin[0], origin[3], origin[2], origin[1], origin[0]);
+    __m128i ax = _mm_set_epi16(axis[3], axis[2], axis[1], axis[0], axis[3], axis[2], axis[1], axis[0]);
+    for (int i = 0; i < 4; i++)
+    {
+        __m128i texels = _mm_loadu_si128((const __m128i *)(block + i * 16));
+        __m128i lo = _mm_madd_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(texels, zero), o), ax);
+        __m128i hi = _mm_madd_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(texels, zero), o), ax);
+        lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+        hi = _mm_add_epi32(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+        projection[i * 4 + 0] = _mm_cvtsi128_si32(lo);
+        projection[i * 4 + 1] = _mm_cvtsi128_si32(_mm_srli_si128(lo, 8));
+        projection[i * 4 + 2] = _mm_cvtsi128_si32(hi);
+        projection[i * 4 + 3] = _mm_cvtsi128_si32(_mm_srli_si128(hi, 8));
+    }
+#else
+    for (int i = 0; i < 16; i++)
+    {
+        projection[i] = 0;
+        for (int c = 0; c < 4; c++)
+        {
+            projection[i] += (block[i * 4 + c] - origin[c]) * axis[c];
+        }
+    }
+#endif
+}
+
+// Quantises an 8-bit color to RGB565
+static uint16_t to_565(const int color[3])
+{
+    return (uint16_t)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+// Expands an RGB565 color back to 8-bit channels
+static void from_565(uint16_t packed, int color[4])
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+    color[3] = 0;
+}
+
+// Encodes the color part of a block as BC1 in four color mode
+static void encode_bc1(const unsigned char block[64], unsigned char *out)
+{
+    unsigned char minColor[4], maxColor[4];
+    get_block_bounds(block, minColor, maxColor);
+
+    // Flip the bounding box diagonal for channels that move against green
+    int mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            mean[c] += block[i * 4 + c];
+        }
+    }
+    int covRG = 0, covBG = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int g = block[i * 4 + 1] * 16 - mean[1];
+        covRG += (block[i * 4 + 0] * 16 - mean[0]) * g;
+        covBG += (block[i * 4 + 2] * 16 - mean[2]) * g;
+    }
+
+    int hi[3], lo[3];
+    for (int c = 0; c < 3; c++)
+    {
+        int inset = (maxColor[c] - minColor[c]) >> 4;
+        hi[c] = std::min(255, maxColor[c] - inset);
+        lo[c] = std::max(0, minColor[c] + inset);
+    }
+    if (covRG < 0)
+    {
+        std::swap(hi[0], lo[0]);
+    }
+    if (covBG < 0)
+    {
+        std::swap(hi[2], lo[2]);
+    }
+
+    uint16_t c0 = to_565(hi);
+    uint16_t c1 = to_565(lo);
+    if (c0 < c1)
+    {
+        std::swap(c0, c1);
+    }
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        int p0[4], p1[4];
+        from_565(c0, p0);
+        from_565(c1, p1);
+        int axis[4] = {p0[0] - p1[0], p0[1] - p1[1], p0[2] - p1[2], 0};
+        int length = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+        // Levels run from c1 to c0, which are palette entries 1, 3, 2, 0
+        static const uint32_t levelToIndex[4] = {1, 3, 2, 0};
+        int projection[16];
+        project_block(block, p1, axis, projection);
+        for (int i = 0; i < 16; i++)
+        {
+            int level = (projection[i] * 3 + length / 2) / length;
+            level = std::min(3, std::max(0, level));
+            indices |= levelToIndex[level] << (2 * i);
+        }
+    }
+
+    out[0] = c0 & 0xFF;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF;
+    out[3] = c1 >> 8;
+    std::memcpy(out + 4, &indices, 4);
+}
+
+// Encodes one channel of a block as BC4 in eight value mode
+static void encode_bc4(const unsigned char block[64], int channel, unsigned char *out)
+{
+    int minValue = 255, maxValue = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        minValue = std::min(minValue, (int)block[i * 4 + channel]);
+        maxValue = std::max(maxValue, (int)block[i * 4 + channel]);
+    }
+
+    uint64_t indices = 0;
+    int range = maxValue - minValue;
+    if (range > 0)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int level = ((block[i * 4 + channel] - minValue) * 7 + range / 2) / range;
+            uint64_t index = (level == 7) ? 0 : ((level == 0) ? 1 : (8 - level));
+            indices |= index << (3 * i);
+        }
+    }
+
+    out[0] = (unsigned char)maxValue;
+    out[1] = (unsigned char)minValue;
+    for (int i = 0; i < 6; i++)
+    {
+        out[2 + i] = (unsigned char)(indices >> (8 * i));
+    }
+}
+
+// Writes bits into a 128-bit little endian block
+static void write_bits(unsigned char *out, int *position, uint32_t value, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int bit = *position + i;
+        out[bit >> 3] |= ((value >> i) & 1) << (bit & 7);
+    }
+    *position += count;
+}
+
+// Quantises an endpoint to 7 bits per channel plus a shared p-bit
+static void quantise_bc7_endpoint(const float endpoint[4], int quantised[4], int *pBit)
+{
+    float bestError = 1e30f;
+    for (int p = 0; p < 2; p++)
+    {
+        int candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++)
+        {
+            candidate[c] = std::min(127, std::max(0, (int)std::lround((endpoint[c] - p) / 2.0f)));
+            float delta = (float)((candidate[c] << 1) | p) - endpoint[c];
+            error += delta * delta;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            *pBit = p;
+            std::memcpy(quantised, candidate, sizeof(candidate));
+        }
+    }
+}
+
+// Encodes a block as BC7 mode 6, a single subset with 4-bit indices
+static void encode_bc7(const unsigned char block[64], unsigned char *out)
+{
+    // Principal axis of the block through power iteration on its covariance
+    float mean[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            mean[c] += block[i * 4 + c] / 16.0f;
+        }
+    }
+    float cov[4][4] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        float d[4];
+        for (int c = 0; c < 4; c++)
+        {
+            d[c] = block[i * 4 + c] - mean[c];
+        }
+        for (int r = 0; r < 4; r++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                cov[r][c] += d[r] * d[c];
+            }
+        }
+    }
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int r = 0; r < 4; r++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                next[r] += cov[r][c] * axis[c];
+            }
+        }
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+        if (length < 1e-6f)
+        {
+            break;
+        }
+        for (int c = 0; c < 4; c++)
+        {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float tMin = 1e30f, tMax = -1e30f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < 4; c++)
+        {
+            t += (block[i * 4 + c] - mean[c]) * axis[c];
+        }
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+
+    float ends[2][4];
+    for (int c = 0; c < 4; c++)
+    {
+        ends[0][c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * tMin));
+        ends[1][c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * tMax));
+    }
+
+    int q[2][4], p[2];
+    quantise_bc7_endpoint(ends[0], q[0], &p[0]);
+    quantise_bc7_endpoint(ends[1], q[1], &p[1]);
+
+    int e[2][4];
+    for (int j = 0; j < 2; j++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            e[j][c] = (q[j][c] << 1) | p[j];
+        }
+    }
+
+    int indices[16];
+    for (int i = 0; i < 16; i++)
+    {
+        int bestError = 1 << 30;
+        for (int w = 0; w < 16; w++)
+        {
+            int error = 0;
+            for (int c = 0; c < 4; c++)
+            {
+                int value = ((64 - bc7Weights[w]) * e[0][c] + bc7Weights[w] * e[1][c] + 32) >> 6;
+                int delta = value - block[i * 4 + c];
+                error += delta * delta;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                indices[i] = w;
+            }
+        }
+    }
+
+    // The anchor index is stored with an implicit zero top bit
+    if (indices[0] & 8)
+    {
+        std::swap(q[0], q[1]);
+        std::swap(p[0], p[1]);
+        for (int i = 0; i < 16; i++)
+        {
+            indices[i] = 15 - indices[i];
+        }
+    }
+
+    std::memset(out, 0, 16);
+    int position = 0;
+    write_bits(out, &position, 1 << 6, 7);
+    for (int c = 0; c < 4; c++)
+    {
+        write_bits(out, &position, q[0][c], 7);
+        write_bits(out, &position, q[1][c], 7);
+    }
+    write_bits(out, &position, p[0], 1);
+    write_bits(out, &position, p[1], 1);
+    write_bits(out, &position, indices[0], 3);
+    for (int i = 1; i < 16; i++)
+    {
+        write_bits(out, &position, indices[i], 4);
+    }
+}
+
+unsigned int TextureCompression::get_supported_formats()
+{
+    static const unsigned int supported = []()
+    {
+        bool s3tc = has_gl_extension("GL_EXT_texture_compression_s3tc");
+        bool srgb = has_gl_extension("GL_EXT_texture_sRGB") || has_gl_extension("GL_EXT_texture_compression_s3tc_srgb");
+        bool bptc = has_gl_version(4, 2) || has_gl_extension("GL_ARB_texture_compression_bptc");
+
+        // RGTC is core since GL 3.0
+        unsigned int mask = COMPRESSION_BIT(COMPRESSION_BC4) | COMPRESSION_BIT(COMPRESSION_BC5);
+        if (s3tc && srgb)
+        {
+            mask |= COMPRESSION_BIT(COMPRESSION_BC1) | COMPRESSION_BIT(COMPRESSION_BC3);
+        }
+        if (bptc)
+        {
+            mask |= COMPRESSION_BIT(COMPRESSION_BC7);
+        }
+        return mask;
+    }();
+    return supported;
+}
+
+COMPRESSION_FORMAT TextureCompression::select_format(const unsigned char *rgba, int width, int height, int components, bool gamma, unsigned int supportedFormats, std::string *swizzle)
+{
+    *swizzle = "rgba";
+    bool hasAlpha = false;
+    bool isGray = true;
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        const unsigned char *texel = &rgba[i * 4];
+        hasAlpha = hasAlpha || (texel[3] < 255);
+        isGray = isGray && (std::abs(texel[0] - texel[1]) <= 2) && (std::abs(texel[1] - texel[2]) <= 2);
+    }
+
+    // Single and dual channel sources are masks. Single channel sources are always cooked as linear, while dual channel
+    // sources flagged as gamma hold sRGB gray and alpha, which BC5 cannot decode, so they take the color formats below
+    if (components == 1 && (supportedFormats & COMPRESSION_BIT(COMPRESSION_BC4)))
+    {
+        return COMPRESSION_BC4;
+    }
+    if (components == 2 && !gamma && (supportedFormats & COMPRESSION_BIT(COMPRESSION_BC5)))
+    {
+        *swizzle = "rrrg";
+        return COMPRESSION_BC5;
+    }
+
+    if (hasAlpha)
+    {
+        if (supportedFormats & COMPRESSION_BIT(COMPRESSION_BC7))
+        {
+            return COMPRESSION_BC7;
+        }
+        if (supportedFormats & COMPRESSION_BIT(COMPRESSION_BC3))
+        {
+            return COMPRESSION_BC3;
+        }
+        return COMPRESSION_NONE;
+    }
+
+    // Grayscale linear maps such as specular masks only need one channel
+    if (!gamma && isGray && (supportedFormats & COMPRESSION_BIT(COMPRESSION_BC4)))
+    {
+        *swizzle = "rrr1";
+        return COMPRESSION_BC4;
+    }
+
+    if (supportedFormats & COMPRESSION_BIT(COMPRESSION_BC1))
+    {
+        return COMPRESSION_BC1;
+    }
+    return COMPRESSION_NONE;
+}
+
+std::vector<unsigned char> TextureCompression::compress(const unsigned char *rgba, int width, int height, COMPRESSION_FORMAT format)
+{
+    int blockSize = get_block_size(format);
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    std::vector<unsigned char> output((size_t)blocksX * blocksY * blockSize);
+
+    JobSystem::get().parallel_for(blocksY, [&](int by)
+                                  {
+                                      unsigned char block[64];
+                                      for (int bx = 0; bx < blocksX; bx++)
+                                      {
+                                          fetch_block(rgba, width, height, bx, by, block);
+                                          unsigned char *out = &output[((size_t)by * blocksX + bx) * blockSize];
+                                          switch (format)
+                                          {
+                                          case COMPRESSION_BC1:
+                                              encode_bc1(block, out);
+                                              break;
+                                          case COMPRESSION_BC3:
+                                              encode_bc4(block, 3, out);
+                                              encode_bc1(block, out + 8);
+                                              break;
+                                          case COMPRESSION_BC4:
+                                              encode_bc4(block, 0, out);
+                                              break;
+                                          case COMPRESSION_BC5:
+                                              encode_bc4(block, 0, out);
+                                              encode_bc4(block, 1, out + 8);
+                                              break;
+                                          case COMPRESSION_BC7:
+                                              encode_bc7(block, out);
+                                              break;
+                                          default:
+                                              break;
+                                          }
+                                      } });
+    return output;
+}
+
+int TextureCompression::get_block_size(COMPRESSION_FORMAT format)
+{
+    switch (format)
+    {
+    case COMPRESSION_BC1:
+    case COMPRESSION_BC4:
+        return 8;
+    case COMPRESSION_BC3:
+    case COMPRESSION_BC5:
+    case COMPRESSION_BC7:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+GLenum TextureCompression::get_gl_format(COMPRESSION_FORMAT format, bool gamma)
+{
+    switch (format)
+    {
+    case COMPRESSION_BC1:
+        return (gamma) ? (GL_COMPRESSED_SRGB_S3TC_DXT1_EXT) : (GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+    case COMPRESSION_BC3:
+        return (gamma) ? (GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT) : (GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+    case COMPRESSION_BC4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case COMPRESSION_BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    case COMPRESSION_BC7:
+        return (gamma) ? (GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM) : (GL_COMPRESSED_RGBA_BPTC_UNORM);
+    default:
+        return GL_NONE;
+    }
+}
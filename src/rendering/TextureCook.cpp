@@ -0,0 +1,374 @@
+#include "rendering/TextureCook.h"
+
+// Custom Headers
+#include "rendering/KTX2.h"
+
+// Standard Headers
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_COOK_SSE2 1
+#else
+#define TEXTURE_COOK_SSE2 0
+#endif
+
+// Image in linear space with four float channels per pixel
+struct LinearImage
+{
+    int width;
+    int height;
+    std::vector<float> texels;
+};
+
+// Lookup from an 8-bit sRGB value to linear intensity
+static const float *get_srgb_to_linear_table()
+{
+    static const std::vector<float> table = []()
+    {
+        std::vector<float> values(256);
+        for (int i = 0; i < 256; i++)
+        {
+            float c = i / 255.0f;
+            values[i] = (c <= 0.04045f) ? (c / 12.92f) : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return values;
+    }();
+    return table.data();
+}
+
+// Lookup from quantised linear intensity to an 8-bit sRGB value
+static const unsigned char *get_linear_to_srgb_table()
+{
+    static const std::vector<unsigned char> table = []()
+    {
+        std::vector<unsigned char> values(4096);
+        for (int i = 0; i < 4096; i++)
+        {
+            float c = i / 4095.0f;
+            float s = (c <= 0.0031308f) ? (c * 12.92f) : (1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f);
+            values[i] = (unsigned char)(std::min(255.0f, std::max(0.0f, s * 255.0f + 0.5f)));
+        }
+        return values;
+    }();
+    return table.data();
+}
+
+// Expands 8-bit pixels into linear float pixels
+static LinearImage to_linear(const unsigned char *data, int width, int height, int components, bool gamma)
+{
+    const float *srgbToLinear = get_srgb_to_linear_table();
+    int colorChannels = (components >= 3) ? 3 : 0;
+
+    LinearImage image;
+    image.width = width;
+    image.height = height;
+    image.texels.assign((size_t)width * height * 4, 1.0f);
+
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        for (int c = 0; c < components; c++)
+        {
+            unsigned char value = data[i * components + c];
+            image.texels[i * 4 + c] = (gamma && c < colorChannels) ? srgbToLinear[value] : (value / 255.0f);
+        }
+    }
+    return image;
+}
+
+// Packs linear float pixels back into 8-bit pixels
+static std::vector<unsigned char> to_bytes(const LinearImage &image, int components, bool gamma)
+{
+    const unsigned char *linearToSrgb = get_linear_to_srgb_table();
+    int colorChannels = (components >= 3) ? 3 : 0;
+
+    std::vector<unsigned char> data((size_t)image.width * image.height * components);
+    for (size_t i = 0; i < (size_t)image.width * image.height; i++)
+    {
+        for (int c = 0; c < components; c++)
+        {
+            float value = std::min(1.0f, std::max(0.0f, image.texels[i * 4 + c]));
+            if (gamma && c < colorChannels)
+            {
+                data[i * components + c] = linearToSrgb[(int)(value * 4095.0f + 0.5f)];
+            }
+            else
+            {
+                data[i * components + c] = (unsigned char)(value * 255.0f + 0.5f);
+            }
+        }
+    }
+    return data;
+}
+
+// Halves an image with a 2x2 box filter, clamping at odd edges
+static LinearImage downsample(const LinearImage &src)
+{
+    LinearImage dst;
+    dst.width = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.texels.resize((size_t)dst.width * dst.height * 4);
+
+    for (int y = 0; y < dst.height; y++)
+    {
+        const float *row0 = &src.texels[(size_t)std::min(2 * y, src.height - 1) * src.width * 4];
+        const float *row1 = &src.texels[(size_t)std::min(2 * y + 1, src.height - 1) * src.width * 4];
+        float *out = &dst.texels[(size_t)y * dst.width * 4];
+
+        for (int x = 0; x < dst.width; x++)
+        {
+            int x0 = std::min(2 * x, src.width - 1) * 4;
+            int x1 = std::min(2 * x + 1, src.width - 1) * 4;
+#if TEXTURE_COOK_SSE2
+            __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)),
+                                    _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+            _mm_storeu_ps(out + x * 4, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+            for (int c = 0; c < 4; c++)
+            {
+                out[x * 4 + c] = 0.25f * (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]);
+            }
+#endif
+        }
+    }
+    return dst;
+}
+
+bool TextureCook::load(const std::string &sourcePath, bool gamma, CookedTexture *cooked, unsigned int compressionFormats, int maxResolution)
+{
+    std::string stamp = get_cook_stamp(sourcePath, compressionFormats, maxResolution);
+    if (stamp.empty())
+    {
+        return false;
+    }
+
+    std::string cachePath = get_cache_path(sourcePath, gamma);
+    std::map<std::string, std::string> metadata;
+    if (KTX2::read(cachePath, cooked, &metadata) && metadata["GScookStamp"] == stamp)
+    {
+        if (metadata.count("KTXswizzle"))
+        {
+            cooked->swizzle = metadata["KTXswizzle"];
+        }
+        return true;
+    }
+
+    if (!cook(sourcePath, gamma, cooked, compressionFormats, maxResolution))
+    {
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+    metadata.clear();
+    metadata["GScookStamp"] = stamp;
+    metadata["KTXswizzle"] = cooked->swizzle;
+    metadata["KTXwriter"] = "graphics-and-shaders texture cook";
+    if (!KTX2::write(cachePath, *cooked, metadata))
+    {
+        std::cout << "Failed to write texture cache: " << cachePath << std::endl;
+    }
+    return true;
+}
+
+bool TextureCook::cook(const std::string &sourcePath, bool gamma, CookedTexture *cooked, unsigned int compressionFormats, int maxResolution)
+{
+    int width, height, nrComponents;
+    stbi_set_flip_vertically_on_load_thread(true);
+    unsigned char *data = stbi_load(sourcePath.c_str(), &width, &height, &nrComponents, 0);
+    if (!data)
+    {
+        return false;
+    }
+
+    // Two channel images are widened so every level maps onto a GL format used by the renderer
+    int components = (nrComponents == 2) ? 4 : nrComponents;
+    if (nrComponents != components)
+    {
+        stbi_image_free(data);
+        data = stbi_load(sourcePath.c_str(), &width, &height, &nrComponents, components);
+        if (!data)
+        {
+            return false;
+        }
+    }
+
+    LinearImage level = to_linear(data, width, height, components, gamma);
+    stbi_image_free(data);
+
+    while (maxResolution > 0 && std::max(level.width, level.height) > maxResolution)
+    {
+        level = downsample(level);
+    }
+
+    cooked->width = level.width;
+    cooked->height = level.height;
+    cooked->gamma = gamma;
+    cooked->format = COMPRESSION_NONE;
+    cooked->swizzle = "rgba";
+    cooked->mips.clear();
+
+    if (compressionFormats != 0)
+    {
+        std::vector<unsigned char> top = to_bytes(level, 4, gamma);
+        cooked->format = TextureCompression::select_format(top.data(), level.width, level.height, nrComponents, gamma, compressionFormats, &(cooked->swizzle));
+    }
+
+    switch (cooked->format)
+    {
+    case COMPRESSION_BC1:
+        cooked->components = 3;
+        break;
+    case COMPRESSION_BC4:
+        cooked->components = 1;
+        break;
+    case COMPRESSION_BC5:
+        cooked->components = 2;
+        break;
+    case COMPRESSION_BC3:
+    case COMPRESSION_BC7:
+        cooked->components = 4;
+        break;
+    default:
+        cooked->components = components;
+        break;
+    }
+
+    while (true)
+    {
+        CookedMip mip;
+        mip.width = level.width;
+        mip.height = level.height;
+        if (cooked->format == COMPRESSION_NONE)
+        {
+            mip.data = to_bytes(level, components, gamma);
+        }
+        else
+        {
+            std::vector<unsigned char> rgba = to_bytes(level, 4, gamma);
+            if (cooked->format == COMPRESSION_BC5 && nrComponents == 2)
+            {
+                // Gray and alpha of two channel sources go into the red and green blocks
+                for (size_t i = 0; i < (size_t)level.width * level.height; i++)
+                {
+                    rgba[i * 4 + 1] = rgba[i * 4 + 3];
+                }
+            }
+            mip.data = TextureCompression::compress(rgba.data(), level.width, level.height, cooked->format);
+        }
+        cooked->mips.push_back(std::move(mip));
+
+        if (level.width == 1 && level.height == 1)
+        {
+            break;
+        }
+        level = downsample(level);
+    }
+    return true;
+}
+
+unsigned int TextureCook::get_compression_formats()
+{
+#if ENABLE_TEXTURE_COMPRESSION
+    return TextureCompression::get_supported_formats();
+#else
+    return 0;
+#endif
+}
+
+std::string TextureCook::get_cache_path(const std::string &sourcePath, bool gamma)
+{
+    // FNV-1a keeps cache names stable between builds and compilers
+    uint64_t hash = 14695981039346656037ull;
+    std::string key = sourcePath + (gamma ? "|srgb" : "|linear");
+    for (unsigned char c : key)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+
+    std::stringstream name;
+    name << std::filesystem::path(sourcePath).stem().string() << "_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".ktx2";
+    return FileSystem::get_path(TEXTURE_CACHE_DIRECTORY) + "/" + name.str();
+}
+
+void TextureCook::get_gl_formats(const CookedTexture &cooked, GLenum *format, GLenum *internalFormat)
+{
+    if (cooked.format != COMPRESSION_NONE)
+    {
+        *format = GL_NONE;
+        *internalFormat = TextureCompression::get_gl_format(cooked.format, cooked.gamma);
+    }
+    else if (cooked.components == 1)
+    {
+        *format = GL_RED;
+        *internalFormat = *format;
+    }
+    else if (cooked.components == 3)
+    {
+        *format = GL_RGB;
+        *internalFormat = (cooked.gamma) ? (GL_SRGB) : (*format);
+    }
+    else
+    {
+        *format = GL_RGBA;
+        *internalFormat = (cooked.gamma) ? (GL_SRGB_ALPHA) : (*format);
+    }
+}
+
+void TextureCook::get_gl_swizzle(const std::string &swizzle, GLint *glSwizzle)
+{
+    const GLint identity[4] = {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA};
+    for (int c = 0; c < 4; c++)
+    {
+        glSwizzle[c] = identity[c];
+        if (c >= (int)swizzle.size())
+        {
+            continue;
+        }
+        switch (swizzle[c])
+        {
+        case 'r':
+            glSwizzle[c] = GL_RED;
+            break;
+        case 'g':
+            glSwizzle[c] = GL_GREEN;
+            break;
+        case 'b':
+            glSwizzle[c] = GL_BLUE;
+            break;
+        case 'a':
+            glSwizzle[c] = GL_ALPHA;
+            break;
+        case '0':
+            glSwizzle[c] = GL_ZERO;
+            break;
+        case '1':
+            glSwizzle[c] = GL_ONE;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+std::string TextureCook::get_cook_stamp(const std::string &sourcePath, unsigned int compressionFormats, int maxResolution)
+{
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(sourcePath, error);
+    if (error)
+    {
+        return "";
+    }
+    uint64_t time = (uint64_t)std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count();
+
+    std::stringstream stamp;
+    // The cook version changes whenever format selection or encoding does, so stale caches are cooked again
+    stamp << TEXTURE_COOK_VERSION << ":" << size << ":" << time << ":" << maxResolution << ":" << compressionFormats;
+    return stamp.str();
+}
@@ -0,0 +1,666 @@
+#include "rendering/TextureStreamer.h"
+
+// Custom Headers
+#include "rendering/KTX2.h"
+#include "utility/JobSystem.h"
+
+// Standard Headers
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// Offsets of chunks in a slot are kept aligned for the copy
+static const size_t STREAM_CHUNK_ALIGNMENT = 16;
+// Loads in flight before residency stops queueing more
+static const int STREAM_MAX_LOADS = 4;
+
+TextureStreamer::TextureStreamer()
+{
+    pendingCount = 0;
+}
+
+void TextureStreamer::initialise(size_t frameBudget_, int slotCount)
+{
+    if (active)
+    {
+        return;
+    }
+
+    // A slot must hold at least one row of blocks of the largest level
+    frameBudget = std::max(frameBudget_, (size_t)TEXTURE_MAX_RESOLUTION * 4 * 4);
+    compressionFormats = TextureCook::get_compression_formats();
+    persistent = glFeatures.bufferStorage;
+
+    slots.resize(std::max(slotCount, 2));
+    for (StreamSlot &slot : slots)
+    {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        if (persistent)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, frameBudget, NULL, flags);
+            slot.mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, frameBudget, flags);
+        }
+        else
+        {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, frameBudget, NULL, GL_STREAM_DRAW);
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    stopping = false;
+    submitIndex = 0;
+    writeIndex = 0;
+    active = true;
+    copyThread = std::thread(&TextureStreamer::copy_loop, this);
+}
+
+void TextureStreamer::request(unsigned int textureId, const std::string &path, bool gamma)
+{
+    // Gray placeholder keeps the texture complete until its first levels arrive
+    const unsigned char placeholder[4] = {128, 128, 128, 255};
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    std::shared_ptr<StreamItem> item = std::make_shared<StreamItem>();
+    item->textureId = textureId;
+    item->path = path;
+    item->gamma = gamma;
+
+    StreamTexture texture;
+    texture.path = path;
+    texture.gamma = gamma;
+    texture.load = item;
+    residency[textureId] = texture;
+
+    queue_item(item);
+}
+
+void TextureStreamer::request_screen_size(unsigned int textureId, float screenSize)
+{
+    auto it = residency.find(textureId);
+    if (it != residency.end())
+    {
+        it->second.requestedSize = std::max(it->second.requestedSize, screenSize);
+    }
+}
+
+void TextureStreamer::update()
+{
+    if (!active)
+    {
+        return;
+    }
+
+    // Slot states are shared with the copy thread, which scans them while waiting for work
+    std::unique_lock<std::mutex> lock(streamMutex);
+
+    // Recycle slots the GPU has finished reading
+    for (StreamSlot &slot : slots)
+    {
+        if (slot.state != SLOT_IN_FLIGHT)
+        {
+            continue;
+        }
+        GLenum result = glClientWaitSync(slot.fence, 0, 0);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+        {
+            glDeleteSync(slot.fence);
+            slot.fence = NULL;
+            slot.uploads.clear();
+            slot.state = SLOT_FREE;
+        }
+    }
+
+    // Submit one filled slot, which bounds the bytes uploaded this frame to the slot size
+    StreamSlot &ready = slots[submitIndex];
+    if (ready.state == SLOT_READY)
+    {
+        lock.unlock();
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ready.pbo);
+        if (!persistent)
+        {
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            ready.mapped = NULL;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (const StreamUpload &upload : ready.uploads)
+        {
+            apply_upload(upload);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        ready.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        lock.lock();
+        ready.state = SLOT_IN_FLIGHT;
+        submitIndex = (submitIndex + 1) % (int)slots.size();
+    }
+
+    // Hand the next free slot to the copy thread once there is something to copy
+    bool writing = false;
+    for (StreamSlot &slot : slots)
+    {
+        writing = writing || (slot.state == SLOT_WRITING);
+    }
+    StreamSlot &next = slots[writeIndex];
+    if (!writing && next.state == SLOT_FREE && has_copy_work())
+    {
+        if (!persistent)
+        {
+            // The slot's fence has passed, so the old contents can be discarded without a stall
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, next.pbo);
+            next.mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, frameBudget, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        if (next.mapped)
+        {
+            next.state = SLOT_WRITING;
+            writeIndex = (writeIndex + 1) % (int)slots.size();
+            streamCondition.notify_all();
+        }
+    }
+    lock.unlock();
+
+    update_loads();
+    balance_residency();
+}
+
+void TextureStreamer::set_memory_budget(size_t bytes)
+{
+    memoryBudget = bytes;
+}
+
+StreamStats TextureStreamer::get_stats()
+{
+    StreamStats stats;
+    stats.budgetBytes = memoryBudget;
+    for (auto it = residency.begin(); it != residency.end(); it++)
+    {
+        const StreamTexture &texture = it->second;
+        stats.textureCount++;
+        stats.loadingCount += (texture.load != NULL);
+        if (texture.levelCount > 0)
+        {
+            stats.residentBytes += get_chain_bytes(texture, texture.residentLevel);
+            stats.requestedBytes += get_chain_bytes(texture, texture.wantedLevel);
+        }
+    }
+    return stats;
+}
+
+int TextureStreamer::get_pending_count()
+{
+    return pendingCount;
+}
+
+bool TextureStreamer::is_active()
+{
+    return active;
+}
+
+void TextureStreamer::free_data()
+{
+    if (!active)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(streamMutex);
+        stopping = true;
+        streamCondition.notify_all();
+    }
+    copyThread.join();
+    // Cook jobs write into items owned by this streamer
+    JobSystem::get().wait();
+
+    for (StreamSlot &slot : slots)
+    {
+        if (slot.fence)
+        {
+            glDeleteSync(slot.fence);
+        }
+        if (slot.mapped)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        glDeleteBuffers(1, &slot.pbo);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    slots.clear();
+    items.clear();
+    residency.clear();
+    pendingCount = 0;
+    active = false;
+}
+
+void TextureStreamer::copy_loop()
+{
+    std::unique_lock<std::mutex> lock(streamMutex);
+    while (true)
+    {
+        StreamSlot *slot = NULL;
+        streamCondition.wait(lock, [this, &slot]()
+                             {
+            if (stopping)
+            {
+                return true;
+            }
+            for (StreamSlot &candidate : slots)
+            {
+                if (candidate.state == SLOT_WRITING)
+                {
+                    slot = &candidate;
+                    return has_copy_work();
+                }
+            }
+            return false; });
+
+        if (stopping)
+        {
+            return;
+        }
+
+        // Items are only appended while the copy runs, so the copy itself happens unlocked
+        lock.unlock();
+        fill_slot(slot);
+        lock.lock();
+        slot->state = SLOT_READY;
+    }
+}
+
+bool TextureStreamer::fill_slot(StreamSlot *slot)
+{
+    unsigned char *mapped = (unsigned char *)slot->mapped;
+    size_t used = 0;
+    bool full = false;
+
+    while (!full)
+    {
+        std::shared_ptr<StreamItem> item;
+        {
+            std::lock_guard<std::mutex> lock(streamMutex);
+            for (auto it = items.begin(); it != items.end(); it++)
+            {
+                if (!(*it)->cooked)
+                {
+                    continue;
+                }
+                if ((*it)->failed)
+                {
+                    std::cout << "Failed to load Texture" << std::endl;
+                    pendingCount--;
+                    items.erase(it);
+                    break;
+                }
+                item = *it;
+                break;
+            }
+        }
+        if (!item)
+        {
+            std::lock_guard<std::mutex> lock(streamMutex);
+            if (has_copy_work())
+            {
+                continue;
+            }
+            break;
+        }
+
+        // Copy whole rows, or rows of blocks for compressed levels, smallest level first
+        const CookedTexture &texture = item->texture;
+        const CookedMip &mip = texture.mips[item->nextLevel];
+        bool compressed = (texture.format != COMPRESSION_NONE);
+        int rowHeight = compressed ? 4 : 1;
+        size_t rowBytes = compressed ? (size_t)((mip.width + 3) / 4) * TextureCompression::get_block_size(texture.format)
+                                     : (size_t)mip.width * texture.components;
+        size_t alignedUsed = (used + STREAM_CHUNK_ALIGNMENT - 1) & ~(STREAM_CHUNK_ALIGNMENT - 1);
+        size_t remainingBytes = mip.data.size() - item->levelOffset;
+        size_t fitRows = (alignedUsed < frameBudget) ? (frameBudget - alignedUsed) / rowBytes : 0;
+        size_t chunkBytes = std::min(fitRows * rowBytes, remainingBytes);
+        if (chunkBytes == 0)
+        {
+            full = true;
+            break;
+        }
+
+        std::memcpy(mapped + alignedUsed, mip.data.data() + item->levelOffset, chunkBytes);
+
+        StreamUpload upload;
+        upload.item = item;
+        upload.level = item->nextLevel;
+        upload.y = (int)(item->levelOffset / rowBytes) * rowHeight;
+        upload.height = std::min((int)((chunkBytes + rowBytes - 1) / rowBytes) * rowHeight, mip.height - upload.y);
+        upload.offset = alignedUsed;
+        upload.size = chunkBytes;
+        upload.firstChunk = (item->levelOffset == 0);
+        upload.lastChunk = (chunkBytes == remainingBytes);
+        slot->uploads.push_back(upload);
+        used = alignedUsed + chunkBytes;
+
+        if (upload.lastChunk)
+        {
+            item->levelOffset = 0;
+            item->nextLevel--;
+            if (item->nextLevel < item->lastLevel)
+            {
+                std::lock_guard<std::mutex> lock(streamMutex);
+                items.erase(std::find(items.begin(), items.end(), item));
+            }
+        }
+        else
+        {
+            item->levelOffset += chunkBytes;
+            full = true;
+        }
+    }
+
+    return used > 0;
+}
+
+void TextureStreamer::apply_upload(const StreamUpload &upload)
+{
+    const CookedTexture &texture = upload.item->texture;
+    const CookedMip &mip = texture.mips[upload.level];
+    int levelCount = (int)texture.mips.size();
+    GLenum format, internalFormat;
+    TextureCook::get_gl_formats(texture, &format, &internalFormat);
+
+    glBindTexture(GL_TEXTURE_2D, upload.item->textureId);
+    if (upload.firstChunk)
+    {
+        // Allocation reads no pixels, so it has to happen with the pixel buffer unbound
+        int slotBuffer = 0;
+        glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &slotBuffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (format == GL_NONE)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, upload.level, internalFormat, mip.width, mip.height, 0, (GLsizei)mip.data.size(), NULL);
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, upload.level, internalFormat, mip.width, mip.height, 0, format, GL_UNSIGNED_BYTE, NULL);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slotBuffer);
+
+        if (upload.level == levelCount - 1)
+        {
+            GLint swizzle[4];
+            TextureCook::get_gl_swizzle(texture.swizzle, swizzle);
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        }
+    }
+
+    if (format == GL_NONE)
+    {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, upload.level, 0, upload.y, mip.width, upload.height, internalFormat, (GLsizei)upload.size, (const void *)upload.offset);
+    }
+    else
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, upload.level, 0, upload.y, mip.width, upload.height, format, GL_UNSIGNED_BYTE, (const void *)upload.offset);
+    }
+
+    if (upload.lastChunk)
+    {
+        // Levels below the finished one are all resident, so sampling can start from it
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, upload.level);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        if (upload.level == upload.item->lastLevel)
+        {
+            upload.item->uploaded = true;
+            pendingCount--;
+        }
+    }
+}
+
+bool TextureStreamer::has_copy_work()
+{
+    for (const std::shared_ptr<StreamItem> &item : items)
+    {
+        if (item->cooked)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TextureStreamer::queue_item(const std::shared_ptr<StreamItem> &item)
+{
+    pendingCount++;
+    {
+        std::lock_guard<std::mutex> lock(streamMutex);
+        items.push_back(item);
+    }
+
+    unsigned int formats = compressionFormats;
+    JobSystem::get().submit([this, item, formats]()
+                            {
+        CookedTexture cooked;
+        bool loaded = false;
+        if (item->firstLevel >= 0)
+        {
+            // Finer levels are read straight from the cache the first load wrote
+            loaded = KTX2::read(TextureCook::get_cache_path(item->path, item->gamma), &cooked, NULL, item->lastLevel, item->firstLevel);
+        }
+        if (!loaded)
+        {
+            loaded = TextureCook::load(item->path, item->gamma, &cooked, formats);
+        }
+
+        int levelCount = (int)cooked.mips.size();
+        if (loaded && item->firstLevel < 0)
+        {
+            // Only levels up to the initial size are streamed before the texture is drawn
+            item->firstLevel = levelCount - 1;
+            item->lastLevel = levelCount - 1;
+            while (item->lastLevel > 0 && std::max(cooked.mips[item->lastLevel - 1].width, cooked.mips[item->lastLevel - 1].height) <= TEXTURE_STREAM_INITIAL_SIZE)
+            {
+                item->lastLevel--;
+            }
+        }
+        for (int level = 0; level < item->lastLevel && level < levelCount; level++)
+        {
+            std::vector<unsigned char>().swap(cooked.mips[level].data);
+        }
+
+        std::lock_guard<std::mutex> lock(streamMutex);
+        item->texture = std::move(cooked);
+        item->nextLevel = item->firstLevel;
+        item->failed = !loaded || item->firstLevel >= levelCount || item->lastLevel < 0;
+        item->cooked = true;
+        streamCondition.notify_all(); });
+}
+
+void TextureStreamer::update_loads()
+{
+    std::lock_guard<std::mutex> lock(streamMutex);
+    for (auto it = residency.begin(); it != residency.end(); it++)
+    {
+        StreamTexture &texture = it->second;
+        if (!texture.load)
+        {
+            continue;
+        }
+
+        if (texture.load->uploaded)
+        {
+            const CookedTexture &cooked = texture.load->texture;
+            if (texture.levelCount == 0)
+            {
+                // Level sizes are known once the first load has been cooked
+                texture.size = std::max(cooked.width, cooked.height);
+                texture.levelCount = (int)cooked.mips.size();
+                texture.levelBytes.resize(texture.levelCount);
+                for (int level = 0; level < texture.levelCount; level++)
+                {
+                    const CookedMip &mip = cooked.mips[level];
+                    if (cooked.format != COMPRESSION_NONE)
+                    {
+                        texture.levelBytes[level] = (size_t)((mip.width + 3) / 4) * ((mip.height + 3) / 4) * TextureCompression::get_block_size(cooked.format);
+                    }
+                    else
+                    {
+                        texture.levelBytes[level] = (size_t)mip.width * mip.height * cooked.components;
+                    }
+                }
+                texture.minLevel = texture.load->lastLevel;
+                texture.wantedLevel = texture.minLevel;
+            }
+            texture.residentLevel = texture.load->lastLevel;
+            texture.loadingLevel = texture.residentLevel;
+            texture.load = NULL;
+        }
+        else if (texture.load->failed)
+        {
+            texture.loadingLevel = texture.residentLevel;
+            texture.load = NULL;
+        }
+    }
+}
+
+void TextureStreamer::balance_residency()
+{
+    frameIndex++;
+
+    // Turn the sizes drawn since the last update into the levels each texture needs
+    size_t committedBytes = 0;
+    std::vector<unsigned int> candidates;
+    for (auto it = residency.begin(); it != residency.end(); it++)
+    {
+        StreamTexture &texture = it->second;
+        if (texture.levelCount == 0)
+        {
+            continue;
+        }
+        if (texture.requestedSize > 0.0f)
+        {
+            float ratio = (float)texture.size / texture.requestedSize;
+            int level = (ratio > 1.0f) ? (int)std::floor(std::log2(ratio)) : 0;
+            texture.wantedLevel = std::min(level, texture.minLevel);
+            texture.lastUsedFrame = frameIndex;
+            texture.requestedSize = 0.0f;
+        }
+        committedBytes += get_chain_bytes(texture, texture.loadingLevel);
+        if (!texture.load && texture.wantedLevel < texture.loadingLevel)
+        {
+            candidates.push_back(it->first);
+        }
+    }
+
+    // Most recently drawn textures with the largest shortfall are streamed first
+    std::sort(candidates.begin(), candidates.end(), [this](unsigned int a, unsigned int b)
+              {
+        const StreamTexture &textureA = residency[a];
+        const StreamTexture &textureB = residency[b];
+        if (textureA.lastUsedFrame != textureB.lastUsedFrame)
+        {
+            return textureA.lastUsedFrame > textureB.lastUsedFrame;
+        }
+        return (textureA.residentLevel - textureA.wantedLevel) > (textureB.residentLevel - textureB.wantedLevel); });
+
+    for (unsigned int textureId : candidates)
+    {
+        if (pendingCount >= STREAM_MAX_LOADS)
+        {
+            break;
+        }
+        StreamTexture &texture = residency[textureId];
+        int targetLevel = texture.wantedLevel;
+        size_t neededBytes = get_chain_bytes(texture, targetLevel) - get_chain_bytes(texture, texture.loadingLevel);
+
+        while (committedBytes + neededBytes > memoryBudget && evict_level(textureId, texture.lastUsedFrame, &committedBytes))
+        {
+        }
+
+        // Stream as many of the wanted levels as the budget allows
+        while (targetLevel < texture.loadingLevel && committedBytes + neededBytes > memoryBudget)
+        {
+            targetLevel++;
+            neededBytes = get_chain_bytes(texture, targetLevel) - get_chain_bytes(texture, texture.loadingLevel);
+        }
+        if (targetLevel >= texture.loadingLevel)
+        {
+            continue;
+        }
+
+        std::shared_ptr<StreamItem> item = std::make_shared<StreamItem>();
+        item->textureId = textureId;
+        item->path = texture.path;
+        item->gamma = texture.gamma;
+        item->firstLevel = texture.loadingLevel - 1;
+        item->lastLevel = targetLevel;
+        texture.load = item;
+        texture.loadingLevel = targetLevel;
+        committedBytes += neededBytes;
+        queue_item(item);
+    }
+
+    // Shrink back under a lowered budget without touching what the last frame drew
+    while (committedBytes > memoryBudget && evict_level(0, frameIndex, &committedBytes))
+    {
+    }
+}
+
+bool TextureStreamer::evict_level(unsigned int keepId, unsigned long usedBefore, size_t *committedBytes)
+{
+    // Levels finer than needed go first, then levels of the least recently drawn textures
+    StreamTexture *victim = NULL;
+    unsigned int victimId = 0;
+    for (auto it = residency.begin(); it != residency.end(); it++)
+    {
+        StreamTexture &texture = it->second;
+        if (it->first == keepId || texture.load || texture.levelCount == 0 || texture.residentLevel >= texture.minLevel)
+        {
+            continue;
+        }
+        bool overResident = texture.residentLevel < texture.wantedLevel;
+        if (!overResident && texture.lastUsedFrame >= usedBefore)
+        {
+            continue;
+        }
+        bool victimOverResident = victim && (victim->residentLevel < victim->wantedLevel);
+        if (!victim || (overResident && !victimOverResident) ||
+            (overResident == victimOverResident && texture.lastUsedFrame < victim->lastUsedFrame))
+        {
+            victim = &texture;
+            victimId = it->first;
+        }
+    }
+    if (!victim)
+    {
+        return false;
+    }
+
+    // Redefining the level as empty releases its storage, sampling already starts below it
+    int level = victim->residentLevel;
+    glBindTexture(GL_TEXTURE_2D, victimId);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    victim->residentLevel = level + 1;
+    victim->loadingLevel = victim->residentLevel;
+    *committedBytes -= victim->levelBytes[level];
+    return true;
+}
+
+size_t TextureStreamer::get_chain_bytes(const StreamTexture &texture, int level)
+{
+    size_t bytes = 0;
+    for (int i = std::max(level, 0); i < texture.levelCount; i++)
+    {
+        bytes += texture.levelBytes[i];
+    }
+    return bytes;
+}
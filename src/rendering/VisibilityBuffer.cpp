@@ -0,0 +1,263 @@
+#include "rendering/VisibilityBuffer.h"
+
+// Standard Headers
+#include <algorithm>
+
+// Returns whether a program exists and linked
+static bool is_linked(Shader *program)
+{
+    int status = 0;
+    if (program->id != 0)
+    {
+        glGetProgramiv(program->id, GL_LINK_STATUS, &status);
+    }
+    return status != 0;
+}
+
+bool VisibilityBuffer::initialise(IndirectRenderer *indirect_, ClusteredLighting *lighting_)
+{
+    indirect = indirect_;
+    lighting = lighting_;
+    active = false;
+    if (!indirect->is_active())
+    {
+        return false;
+    }
+
+    std::string screenVertex = FileSystem::get_path("shaders/visibility/visibilityScreen.vs");
+    idProgram.id = 0;
+    idProgram.create_shader(FileSystem::get_path("shaders/visibility/visibilityId.vs").c_str(),
+                            FileSystem::get_path("shaders/visibility/visibilityId.fs").c_str());
+    classifyProgram.id = 0;
+    classifyProgram.create_shader(screenVertex.c_str(), FileSystem::get_path("shaders/visibility/visibilityClassify.fs").c_str());
+    materialProgram.id = 0;
+    materialProgram.create_shader(screenVertex.c_str(), FileSystem::get_path("shaders/visibility/visibilityMaterial.fs").c_str());
+    active = is_linked(&idProgram) && is_linked(&classifyProgram) && is_linked(&materialProgram);
+    if (!active)
+    {
+        std::cout << "Failed to build visibility buffer shaders" << std::endl;
+    }
+    glGenVertexArrays(1, &VAO);
+    return active;
+}
+
+bool VisibilityBuffer::is_active()
+{
+    return active;
+}
+
+void VisibilityBuffer::set_frame(glm::mat4 view_, glm::mat4 projection_, glm::vec3 cameraPosition_, glm::vec3 background_, bool blinnPhong_, bool gamma_)
+{
+    view = view_;
+    projection = projection_;
+    cameraPosition = cameraPosition_;
+    background = background_;
+    blinnPhong = blinnPhong_;
+    gamma = gamma_;
+}
+
+void VisibilityBuffer::add_passes(RenderGraph *graph, std::function<void()> drawGeometry, int sceneColor, int sceneDepth, const std::vector<int> &shadowMaps, int width, int height)
+{
+    // A pixel is one 32-bit id, the material depth sorts the pixels by the material shading them
+    int ids = graph->create_texture("Visibility IDs", width, height, GL_R32UI);
+    int materialDepth = graph->create_texture("Material Depth", width, height, GL_DEPTH24_STENCIL8);
+
+    int idPass = graph->add_pass("Visibility", [drawGeometry]()
+                                 {
+                                     // No draw writes a zero id, so it marks the pixels left to the forward draws or the background
+                                     const GLuint empty[4] = {0, 0, 0, 0};
+                                     glEnable(GL_DEPTH_TEST);
+                                     glClearBufferuiv(GL_COLOR, 0, empty);
+                                     glClear(GL_DEPTH_BUFFER_BIT);
+                                     drawGeometry(); });
+    graph->write(idPass, ids);
+    graph->write(idPass, sceneDepth);
+
+    int classifyPass = graph->add_pass("Material Classify", [this, graph, ids]()
+                                       { classify(graph->get_texture(ids)); });
+    graph->read(classifyPass, ids);
+    graph->write(classifyPass, materialDepth);
+
+    int materialPass = graph->add_pass("Material", [this, graph, ids, width, height]()
+                                       { draw_materials(graph->get_texture(ids), width, height); });
+    graph->read(materialPass, ids);
+    for (int i = 0; i < shadowMaps.size(); i++)
+    {
+        graph->read(materialPass, shadowMaps[i]);
+    }
+    graph->write(materialPass, sceneColor);
+    graph->write(materialPass, materialDepth);
+}
+
+void VisibilityBuffer::draw_ids()
+{
+    if (indirect->get_record_count() == 0)
+    {
+        return;
+    }
+
+    // The triangle field is sized to the largest draw of the frame, the rest of the id names the record
+    unsigned int triangles = std::max(indirect->get_max_index_count() / 3, 1u);
+    triangleBits = 1;
+    while (triangleBits < 31 && (1u << triangleBits) < triangles)
+    {
+        triangleBits++;
+    }
+    if ((unsigned long long)indirect->get_record_count() >= (1ull << (32 - triangleBits)) && !warnedOverflow)
+    {
+        std::cout << "Visibility buffer ids cannot name " << indirect->get_record_count() << " draws of up to " << triangles << " triangles" << std::endl;
+        warnedOverflow = true;
+    }
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    idProgram.use();
+    idProgram.set_mat4("view", view);
+    idProgram.set_mat4("projection", projection);
+    glUniform1ui(glGetUniformLocation(idProgram.id, "triangleBits"), triangleBits);
+    indirect->draw(&idProgram);
+}
+
+int VisibilityBuffer::get_material_count()
+{
+    return materialCount;
+}
+
+int VisibilityBuffer::get_triangle_bits()
+{
+    return (int)triangleBits;
+}
+
+void VisibilityBuffer::free_data()
+{
+    if (active)
+    {
+        idProgram.free_data();
+        classifyProgram.free_data();
+        materialProgram.free_data();
+        active = false;
+    }
+    if (VAO)
+    {
+        glDeleteVertexArrays(1, &VAO);
+        VAO = 0;
+    }
+}
+
+void VisibilityBuffer::classify(unsigned int visibility)
+{
+    GLint polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    GLboolean culling = glIsEnabled(GL_CULL_FACE);
+
+    // The far plane is left where no indirect draw is visible, which no material depth equals
+    glDisable(GL_CULL_FACE);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    if (indirect->get_record_count() > 0)
+    {
+        glDepthFunc(GL_ALWAYS);
+        classifyProgram.use();
+        classifyProgram.set_int("visibility", VISIBILITY_TEXTURE_UNIT);
+        classifyProgram.set_float("materialDepthScale", 1.0f / VISIBILITY_MATERIAL_DEPTH_STEPS);
+        glUniform1ui(glGetUniformLocation(classifyProgram.id, "triangleBits"), triangleBits);
+        indirect->bind_records();
+        glActiveTexture(GL_TEXTURE0 + VISIBILITY_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, visibility);
+        glActiveTexture(GL_TEXTURE0);
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glDepthFunc(GL_LESS);
+    }
+
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+    if (culling)
+    {
+        glEnable(GL_CULL_FACE);
+    }
+}
+
+void VisibilityBuffer::draw_materials(unsigned int visibility, int width, int height)
+{
+    glClearColor(background.r, background.g, background.b, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    materialCount = 0;
+    if (indirect->get_record_count() == 0)
+    {
+        return;
+    }
+    GLint polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    GLboolean culling = glIsEnabled(GL_CULL_FACE);
+
+    materialProgram.use();
+    lighting->bind_buffers();
+    lighting->set_uniforms(&materialProgram);
+    materialProgram.set_mat4("view", view);
+    materialProgram.set_mat4("projection", projection);
+    materialProgram.set_vec3("viewPos", cameraPosition);
+    materialProgram.set_bool("enableBlinnPhong", blinnPhong);
+    materialProgram.set_bool("enableGamma", gamma);
+    materialProgram.set_vec2("screenSize", glm::vec2((float)width, (float)height));
+    materialProgram.set_int("visibility", VISIBILITY_TEXTURE_UNIT);
+    glUniform1ui(glGetUniformLocation(materialProgram.id, "triangleBits"), triangleBits);
+    indirect->bind_records();
+    glActiveTexture(GL_TEXTURE0 + VISIBILITY_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, visibility);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Each group's triangle only passes the equal test on the pixels classified as its material, so every
+    // pixel is shaded once however many groups there are
+    glDisable(GL_CULL_FACE);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_EQUAL);
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(VAO);
+    const std::vector<IndirectGroup> &groups = indirect->get_groups();
+    int drawable = std::min((int)groups.size(), VISIBILITY_MATERIAL_DEPTH_STEPS - 1);
+    for (int i = 0; i < drawable; i++)
+    {
+        const IndirectGroup &group = groups[i];
+        const GeometryFormat &format = GeometryPool::get().get_format(group.page);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, GeometryPool::get().get_vertex_buffer(group.page));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, GeometryPool::get().get_index_buffer(group.page));
+        glUniform1ui(glGetUniformLocation(materialProgram.id, "vertexStride"), (GLuint)format.stride);
+        materialProgram.set_bool("shortIndices", format.indexType == GL_UNSIGNED_SHORT);
+        set_attribute("positionAttribute", format, 0);
+        set_attribute("normalAttribute", format, 1);
+        set_attribute("uvAttribute", format, 2);
+        group.mesh->bind_textures(&materialProgram);
+        materialProgram.set_float("mat.shininess", group.shininess);
+        materialProgram.set_float("materialDepth", (float)(i + 1) / VISIBILITY_MATERIAL_DEPTH_STEPS);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        materialCount++;
+    }
+    glBindVertexArray(0);
+
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+    if (culling)
+    {
+        glEnable(GL_CULL_FACE);
+    }
+}
+
+void VisibilityBuffer::set_attribute(const char *name, const GeometryFormat &format, int location)
+{
+    // A format without the attribute reads zero components, as an unbound vertex attribute would
+    GLint uniform = glGetUniformLocation(materialProgram.id, name);
+    for (int i = 0; i < format.attributes.size(); i++)
+    {
+        const GeometryAttribute &attribute = format.attributes[i];
+        if (attribute.location == location)
+        {
+            glUniform4i(uniform, (GLint)attribute.offset, (GLint)attribute.type, attribute.count, attribute.normalized ? 1 : 0);
+            return;
+        }
+    }
+    glUniform4i(uniform, 0, GL_FLOAT, 0, 0);
+}
@@ -0,0 +1,65 @@
+#include "utility/Benchmark.h"
+
+// Standard Headers
+#include <algorithm>
+#include <iostream>
+
+void Benchmark::start(int warmupFrames_, int frameCount_)
+{
+    warmupFrames = warmupFrames_;
+    frameCount = frameCount_;
+    running = true;
+    frameTimes.clear();
+    frameTimes.reserve(frameCount);
+}
+
+bool Benchmark::record_frame(float frameTime)
+{
+    if (!running)
+    {
+        return false;
+    }
+    // Warmup frames cover loading, shader compilation and texture streaming settling down
+    if (warmupFrames > 0)
+    {
+        warmupFrames--;
+        return true;
+    }
+    frameTimes.push_back(frameTime * 1000.0f);
+    running = (int)frameTimes.size() < frameCount;
+    return running;
+}
+
+bool Benchmark::is_running()
+{
+    return running;
+}
+
+BenchmarkResult Benchmark::get_result()
+{
+    BenchmarkResult result;
+    result.frameCount = (int)frameTimes.size();
+    if (frameTimes.empty())
+    {
+        return result;
+    }
+    std::vector<float> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    float total = 0.0f;
+    for (int i = 0; i < sorted.size(); i++)
+    {
+        total += sorted[i];
+    }
+    result.average = total / sorted.size();
+    result.median = sorted[sorted.size() / 2];
+    result.high = sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * 0.99f))];
+    result.worst = sorted.back();
+    return result;
+}
+
+void Benchmark::report(const std::string &label)
+{
+    BenchmarkResult result = get_result();
+    std::cout << "Benchmark " << label << ": " << result.frameCount << " frames, " << result.average << " ms average, "
+              << result.median << " ms median, " << result.high << " ms 99th percentile, " << result.worst << " ms worst" << std::endl;
+}
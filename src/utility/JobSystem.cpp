@@ -0,0 +1,145 @@
+#include "utility/JobSystem.h"
+
+// Standard Headers
+#include <algorithm>
+
+// Set on worker threads so nested parallel loops run inline instead of waiting on busy workers
+static thread_local bool isWorkerThread = false;
+
+JobSystem::JobSystem(int threadCount)
+{
+    if (threadCount <= 0)
+    {
+        threadCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    }
+    for (int i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&JobSystem::worker_loop, this);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    for (int i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+}
+
+JobSystem &JobSystem::get()
+{
+    static JobSystem jobSystem;
+    return jobSystem;
+}
+
+void JobSystem::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        jobs.push_back(std::move(job));
+        activeJobs++;
+    }
+    queueCondition.notify_one();
+}
+
+void JobSystem::parallel_for(int count, const std::function<void(int)> &func)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+    if (count == 1 || workers.empty() || isWorkerThread)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            func(i);
+        }
+        return;
+    }
+
+    // Indices are handed out from a shared counter so the caller helps instead of blocking
+    std::atomic<int> next(0);
+    std::atomic<int> done(0);
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    auto run = [&]()
+    {
+        int index;
+        while ((index = next.fetch_add(1)) < count)
+        {
+            func(index);
+            if (done.fetch_add(1) + 1 == count)
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                doneCondition.notify_all();
+            }
+        }
+    };
+
+    int helpers = std::min((int)workers.size(), count - 1);
+    std::atomic<int> exited(0);
+    for (int i = 0; i < helpers; i++)
+    {
+        submit([&]()
+               {
+                   run();
+                   std::lock_guard<std::mutex> lock(doneMutex);
+                   exited++;
+                   doneCondition.notify_all();
+               });
+    }
+    run();
+
+    // Helpers reference this stack frame, so wait for them to leave as well
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneCondition.wait(lock, [&]()
+                       { return done.load() == count && exited.load() == helpers; });
+}
+
+void JobSystem::wait()
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    idleCondition.wait(lock, [this]()
+                       { return activeJobs == 0; });
+}
+
+int JobSystem::get_thread_count()
+{
+    return (int)workers.size();
+}
+
+void JobSystem::worker_loop()
+{
+    isWorkerThread = true;
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]()
+                                { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty())
+            {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            activeJobs--;
+            if (activeJobs == 0)
+            {
+                idleCondition.notify_all();
+            }
+        }
+    }
+}